@@ -0,0 +1,291 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 16:12:40
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 16:12:40
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/resource.h>
+#include <luisa/dsl/stmt.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/var.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/agent/policy.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    /**
+     * @brief Histogram of one tile range per block, channels interleaved in the samples.
+     *
+     * Bins live in block-private shared memory when all channels fit in PRIVATIZED_BINS and are
+     * flushed to global memory once per block, otherwise the block counts into global memory
+     * directly. Lanes of a warp hitting the same bin add once for the whole warp.
+     */
+    template <typename AgentHistogramPolicyT, NumericT SampleT, size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, bool IS_EVEN, size_t PRIVATIZED_BINS>
+    class AgentHistogram : public LuisaModule
+    {
+      public:
+        static constexpr uint BLOCK_THREADS     = AgentHistogramPolicyT::BLOCK_THREADS;
+        static constexpr uint PIXELS_PER_THREAD = AgentHistogramPolicyT::PIXELS_PER_THREAD;
+        static constexpr uint TILE_PIXELS       = BLOCK_THREADS * PIXELS_PER_THREAD;
+        static constexpr bool IS_RLE_COMPRESS   = AgentHistogramPolicyT::IS_RLE_COMPRESS;
+        static constexpr bool IS_WORK_STEALING  = AgentHistogramPolicyT::IS_WORK_STEALING;
+
+        using LevelVecT = Vector<SampleT, 4>;
+
+        static_assert(NUM_ACTIVE_CHANNELS >= 1 && NUM_ACTIVE_CHANNELS <= NUM_CHANNELS && NUM_ACTIVE_CHANNELS <= 4,
+                      "Up to four active channels are supported");
+
+        AgentHistogram(const BufferVar<SampleT>& samples,
+                       const BufferVar<SampleT>& levels,
+                       BufferVar<uint>&          bins,
+                       BufferVar<uint>&          tile_queue,
+                       UInt                      num_pixels,
+                       UInt                      total_bins,
+                       Var<uint4>                num_bins,
+                       Var<uint4>                bin_offsets,
+                       Var<LevelVecT>            lower_levels,
+                       Var<LevelVecT>            upper_levels,
+                       Var<uint4>                level_offsets)
+            : d_samples(samples)
+            , d_levels(levels)
+            , d_bins(bins)
+            , d_tile_queue(tile_queue)
+            , num_pixels(num_pixels)
+            , total_bins(total_bins)
+            , num_bins(num_bins)
+            , bin_offsets(bin_offsets)
+            , lower_levels(lower_levels)
+            , upper_levels(upper_levels)
+            , level_offsets(level_offsets)
+            , privatized(total_bins <= UInt(PRIVATIZED_BINS))
+        {
+            m_shared_bins = new SmemType<uint>{PRIVATIZED_BINS};
+            if constexpr(IS_WORK_STEALING)
+            {
+                m_shared_tile = new SmemType<uint>{1};
+            }
+        }
+
+        void InitBins()
+        {
+            $if(privatized)
+            {
+                $for(bin, thread_id().x, total_bins, UInt(BLOCK_THREADS))
+                {
+                    m_shared_bins->write(bin, 0u);
+                };
+            };
+        }
+
+        // bin of sample within its channel, valid is false for samples outside the levels
+        UInt Bin(uint channel, const Var<SampleT>& sample, Bool& valid)
+        {
+            UInt channel_bins = num_bins[channel];
+            UInt bin          = 0u;
+            if constexpr(IS_EVEN)
+            {
+                Var<SampleT> lower = lower_levels[channel];
+                Var<SampleT> upper = upper_levels[channel];
+                valid              = channel_bins > 0u & sample >= lower & sample < upper;
+                $if(valid)
+                {
+                    // exact for integer samples below 2^24, the division keeps bin edges on the levels
+                    Float scaled = cast<float>(sample - lower) * cast<float>(channel_bins) / cast<float>(upper - lower);
+                    bin          = min(cast<uint>(scaled), channel_bins - 1u);
+                };
+            }
+            else
+            {
+                UInt offset = level_offsets[channel];
+                valid       = channel_bins > 0u & sample >= d_levels.read(offset)
+                        & sample < d_levels.read(offset + channel_bins);
+                $if(valid)
+                {
+                    // largest bin with levels[bin] <= sample
+                    UInt lo = 0u;
+                    UInt hi = channel_bins - 1u;
+                    $while(lo < hi)
+                    {
+                        UInt mid = (lo + hi) / 2u;
+                        $if(sample >= d_levels.read(offset + mid + 1u))
+                        {
+                            lo = mid + 1u;
+                        }
+                        $else
+                        {
+                            hi = mid;
+                        };
+                    };
+                    bin = lo;
+                };
+            }
+            return bin;
+        }
+
+        void AddCount(const UInt& index, const UInt& count)
+        {
+            $if(privatized)
+            {
+                m_shared_bins->atomic(index).fetch_add(count);
+            }
+            $else
+            {
+                d_bins.atomic(index).fetch_add(count);
+            };
+        }
+
+        void WarpAggregatedAdd(const UInt& index)
+        {
+            // flat image regions put a whole warp into one bin, one atomic covers it
+            $if(warp_active_all_equal(index))
+            {
+                UInt count = warp_active_count_bits(Bool(true));
+                $if(warp_is_first_active_lane())
+                {
+                    AddCount(index, count);
+                };
+            }
+            $else
+            {
+                AddCount(index, 1u);
+            };
+        }
+
+        void ConsumeTile(const UInt& tile_offset)
+        {
+            if constexpr(IS_RLE_COMPRESS)
+            {
+                // blocked arrangement, a thread adds each run of equal bins once
+                for(auto channel = 0u; channel < NUM_ACTIVE_CHANNELS; ++channel)
+                {
+                    UInt run_index = 0u;
+                    UInt run_count = 0u;
+                    for(auto i = 0u; i < PIXELS_PER_THREAD; ++i)
+                    {
+                        UInt pixel = tile_offset + thread_id().x * UInt(PIXELS_PER_THREAD) + UInt(i);
+                        $if(pixel < num_pixels)
+                        {
+                            Bool valid = false;
+                            UInt bin = Bin(channel, d_samples.read(pixel * UInt(NUM_CHANNELS) + UInt(channel)), valid);
+                            $if(valid)
+                            {
+                                UInt index = bin_offsets[channel] + bin;
+                                $if(run_count > 0u & index != run_index)
+                                {
+                                    AddCount(run_index, run_count);
+                                    run_count = 0u;
+                                };
+                                run_index = index;
+                                run_count += 1u;
+                            };
+                        };
+                    }
+                    $if(run_count > 0u)
+                    {
+                        AddCount(run_index, run_count);
+                    };
+                }
+            }
+            else
+            {
+                // striped arrangement, coalesced loads
+                for(auto i = 0u; i < PIXELS_PER_THREAD; ++i)
+                {
+                    UInt pixel = tile_offset + UInt(i * BLOCK_THREADS) + thread_id().x;
+                    $if(pixel < num_pixels)
+                    {
+                        for(auto channel = 0u; channel < NUM_ACTIVE_CHANNELS; ++channel)
+                        {
+                            Bool valid = false;
+                            UInt bin = Bin(channel, d_samples.read(pixel * UInt(NUM_CHANNELS) + UInt(channel)), valid);
+                            $if(valid)
+                            {
+                                WarpAggregatedAdd(bin_offsets[channel] + bin);
+                            };
+                        }
+                    };
+                }
+            }
+        }
+
+        void StoreOutput()
+        {
+            $if(privatized)
+            {
+                $for(bin, thread_id().x, total_bins, UInt(BLOCK_THREADS))
+                {
+                    UInt count = m_shared_bins->read(bin);
+                    $if(count > 0u)
+                    {
+                        d_bins.atomic(bin).fetch_add(count);
+                    };
+                };
+            };
+        }
+
+        void Process()
+        {
+            InitBins();
+            sync_block();
+
+            UInt num_tiles  = ceil_div(num_pixels, UInt(TILE_PIXELS));
+            UInt num_blocks = dispatch_size().x / UInt(BLOCK_THREADS);
+            if constexpr(IS_WORK_STEALING)
+            {
+                // first tile by block id, then dequeue from the global counter
+                UInt tile = block_id().x;
+                $while(tile < num_tiles)
+                {
+                    ConsumeTile(tile * UInt(TILE_PIXELS));
+                    sync_block();
+                    $if(thread_id().x == 0u)
+                    {
+                        m_shared_tile->write(0u, d_tile_queue.atomic(0u).fetch_add(1u) + num_blocks);
+                    };
+                    sync_block();
+                    tile = m_shared_tile->read(0u);
+                };
+            }
+            else
+            {
+                $for(tile, block_id().x, num_tiles, num_blocks)
+                {
+                    ConsumeTile(tile * UInt(TILE_PIXELS));
+                };
+            }
+            sync_block();
+            StoreOutput();
+        }
+
+      private:
+        SmemTypePtr<uint> m_shared_bins;
+        SmemTypePtr<uint> m_shared_tile = nullptr;
+
+        const BufferVar<SampleT>& d_samples;
+        const BufferVar<SampleT>& d_levels;
+        BufferVar<uint>&          d_bins;
+        BufferVar<uint>&          d_tile_queue;
+
+        UInt           num_pixels;
+        UInt           total_bins;
+        Var<uint4>     num_bins;
+        Var<uint4>     bin_offsets;
+        Var<LevelVecT> lower_levels;
+        Var<LevelVecT> upper_levels;
+        Var<uint4>     level_offsets;
+        Bool           privatized;
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
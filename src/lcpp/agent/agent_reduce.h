@@ -28,17 +28,98 @@ namespace luisa::parallel_primitive
 namespace details
 {
     using namespace luisa::compute;
-    template <typename Type4Byte, typename ReduceOp, typename TransformOp, typename CollectiveReduceT, bool IsWarpReduction, size_t NUM_THREADS, size_t ITEMS_PER_THREAD>
+
+    // load stage of the reduce agents, InputT is either a bound iterator (transform, counting, zip ...)
+    template <typename AccumT, typename InputT>
+    struct ReduceInput
+    {
+        using SourceT = const InputT;
+
+        InputT it;
+
+        Var<AccumT> read(UInt index) const noexcept { return it.read(index); }
+    };
+
+    // or the element type of a plain buffer holding the accumulator type
+    template <typename Type4Byte>
+    struct ReduceInput<Type4Byte, Type4Byte>
+    {
+        using SourceT = BufferVar<Type4Byte>;
+
+        BufferVar<Type4Byte>& buffer;
+
+        Var<Type4Byte> read(UInt index) const noexcept { return buffer.read(index); }
+    };
+
+    // arg reductions pair every value with its global index while loading,
+    // so no key value copy of the input is materialized
+    template <NumericT Type4Byte>
+    struct ReduceInput<IndexValuePairT<Type4Byte>, Type4Byte>
+    {
+        using SourceT = BufferVar<Type4Byte>;
+
+        BufferVar<Type4Byte>& buffer;
+
+        Var<IndexValuePairT<Type4Byte>> read(UInt index) const noexcept
+        {
+            Var<IndexValuePairT<Type4Byte>> pair;
+            pair.key   = index;
+            pair.value = buffer.read(index);
+            return pair;
+        }
+    };
+
+    // statistics start from the value itself and a count of one
+    template <NumericT Type4Byte>
+    struct ReduceInput<ReduceStats<Type4Byte>, Type4Byte>
+    {
+        using SourceT = BufferVar<Type4Byte>;
+
+        BufferVar<Type4Byte>& buffer;
+
+        Var<ReduceStats<Type4Byte>> read(UInt index) const noexcept
+        {
+            Var<Type4Byte>              value = buffer.read(index);
+            Var<ReduceStats<Type4Byte>> stats;
+            stats.minimum = value;
+            stats.maximum = value;
+            stats.sum     = value;
+            stats.count   = 1u;
+            return stats;
+        }
+    };
+
+    // a single value is its own mean with no spread
+    template <NumericT Type4Byte>
+    struct ReduceInput<WelfordStats<Type4Byte>, Type4Byte>
+    {
+        using SourceT = BufferVar<Type4Byte>;
+
+        BufferVar<Type4Byte>& buffer;
+
+        Var<WelfordStats<Type4Byte>> read(UInt index) const noexcept
+        {
+            Var<WelfordStats<Type4Byte>> stats;
+            stats.mean  = buffer.read(index);
+            stats.m2    = Type4Byte(0);
+            stats.count = 1u;
+            return stats;
+        }
+    };
+
+    template <typename Type4Byte, typename ReduceOp, typename TransformOp, typename CollectiveReduceT, bool IsWarpReduction, size_t NUM_THREADS, size_t ITEMS_PER_THREAD, typename InputT = Type4Byte>
     class AgentReduceImpl : public LuisaModule
     {
       public:
+        using InputSourceT = typename ReduceInput<Type4Byte, InputT>::SourceT;
+
         AgentReduceImpl(SmemTypePtr<Type4Byte>& smem_data,
-                        BufferVar<Type4Byte>&   d_in,
+                        InputSourceT&           d_in,
                         ReduceOp                reduce_op,
                         TransformOp             transform_op,
                         UInt                    land_id)
             : m_smem_data(smem_data)
-            , m_in_data(d_in)
+            , m_in_data{d_in}
             , m_reduce_op(reduce_op)
             , m_transform_op(transform_op)
             , m_land_id(land_id) {};
@@ -153,34 +234,34 @@ namespace details
         ReduceOp               m_reduce_op;
         UInt                   m_land_id;
 
-        BufferVar<Type4Byte>& m_in_data;
+        ReduceInput<Type4Byte, InputT> m_in_data;
     };
 
-    template <typename Type4Byte, typename ReduceOp, typename TransformOp, size_t NUM_THREADS, size_t ITEMS_PER_THREAD, size_t WARP_SIZE = details::WARP_SIZE>
+    template <typename Type4Byte, typename ReduceOp, typename TransformOp, size_t NUM_THREADS, size_t ITEMS_PER_THREAD, size_t WARP_SIZE = details::WARP_SIZE, typename InputT = Type4Byte>
     class AgentReduce
-        : public AgentReduceImpl<Type4Byte, ReduceOp, TransformOp, BlockReduce<Type4Byte, NUM_THREADS, ITEMS_PER_THREAD, WARP_SIZE>, false, NUM_THREADS, ITEMS_PER_THREAD>
+        : public AgentReduceImpl<Type4Byte, ReduceOp, TransformOp, BlockReduce<Type4Byte, NUM_THREADS, ITEMS_PER_THREAD, WARP_SIZE>, false, NUM_THREADS, ITEMS_PER_THREAD, InputT>
     {
       public:
         using Base =
-            AgentReduceImpl<Type4Byte, ReduceOp, TransformOp, BlockReduce<Type4Byte, NUM_THREADS, ITEMS_PER_THREAD, WARP_SIZE>, false, NUM_THREADS, ITEMS_PER_THREAD>;
-        AgentReduce(SmemTypePtr<Type4Byte>& smem_data,
-                    BufferVar<Type4Byte>&   in,
-                    ReduceOp                reduce_op,
-                    TransformOp             transform_op = IdentityOp())
+            AgentReduceImpl<Type4Byte, ReduceOp, TransformOp, BlockReduce<Type4Byte, NUM_THREADS, ITEMS_PER_THREAD, WARP_SIZE>, false, NUM_THREADS, ITEMS_PER_THREAD, InputT>;
+        AgentReduce(SmemTypePtr<Type4Byte>&      smem_data,
+                    typename Base::InputSourceT& in,
+                    ReduceOp                     reduce_op,
+                    TransformOp                  transform_op = IdentityOp())
             : Base(smem_data, in, reduce_op, transform_op, thread_id().x) {};
     };
 
-    template <typename Type4Byte, typename ReduceOp, typename TransformOp, size_t NUM_THREADS, size_t ITEMS_PER_THREAD>
+    template <typename Type4Byte, typename ReduceOp, typename TransformOp, size_t NUM_THREADS, size_t ITEMS_PER_THREAD, typename InputT = Type4Byte>
     class AgentWarpReduce
-        : public AgentReduceImpl<Type4Byte, ReduceOp, TransformOp, WarpReduce<Type4Byte, NUM_THREADS>, true, NUM_THREADS, ITEMS_PER_THREAD>
+        : public AgentReduceImpl<Type4Byte, ReduceOp, TransformOp, WarpReduce<Type4Byte, NUM_THREADS>, true, NUM_THREADS, ITEMS_PER_THREAD, InputT>
     {
       public:
         using Base =
-            AgentReduceImpl<Type4Byte, ReduceOp, TransformOp, WarpReduce<Type4Byte, NUM_THREADS>, true, NUM_THREADS, ITEMS_PER_THREAD>;
-        AgentWarpReduce(SmemTypePtr<Type4Byte>& smem_data,
-                        BufferVar<Type4Byte>&   in,
-                        ReduceOp                reduce_op,
-                        TransformOp             transform_op = IdentityOp())
+            AgentReduceImpl<Type4Byte, ReduceOp, TransformOp, WarpReduce<Type4Byte, NUM_THREADS>, true, NUM_THREADS, ITEMS_PER_THREAD, InputT>;
+        AgentWarpReduce(SmemTypePtr<Type4Byte>&      smem_data,
+                        typename Base::InputSourceT& in,
+                        ReduceOp                     reduce_op,
+                        TransformOp                  transform_op = IdentityOp())
             : Base(smem_data, in, reduce_op, transform_op, thread_id().x % UInt(NUM_THREADS)) {};
     };
 }  // namespace details
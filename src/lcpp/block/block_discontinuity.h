@@ -282,7 +282,7 @@ class BlockDiscontinuity : public LuisaModule
                 }
                 $else
                 {
-                    head_flags[i] = ApplyOp(flag_op, input[i], m_shared_data.last_element[thid - 1], i);
+                    head_flags[i] = ApplyOp(flag_op, input[i], (*m_shared_data.last_element)[thid - 1], i);
                 };
             }
             $else
@@ -299,7 +299,7 @@ class BlockDiscontinuity : public LuisaModule
                 }
                 $else
                 {
-                    tail_flags[i] = ApplyOp(flag_op, input[i], m_shared_data.first_element[thid + 1], i);
+                    tail_flags[i] = ApplyOp(flag_op, input[i], (*m_shared_data.first_element)[thid + 1], i);
                 };
             }
             $else
@@ -11,6 +11,7 @@
 #include <luisa/dsl/sugar.h>
 #include <luisa/dsl/resource.h>
 #include <lcpp/common/type_trait.h>
+#include <lcpp/common/iterator.h>
 #include <lcpp/runtime/core.h>
 
 namespace luisa::parallel_primitive
@@ -229,6 +230,48 @@ void LoadDirectWarpStriped(compute::UInt                         linear_tid,
 }
 
 
+// bound iterators (transform, counting, zip ...) read in the same warp-striped order
+template <typename T, size_t ItemsPerThread, size_t WARP_SIZE = details::WARP_SIZE, DeviceInputIteratorT InputIt>
+void LoadDirectWarpStriped(compute::UInt                         linear_tid,
+                           const InputIt&                        block_src_it,
+                           compute::UInt                         tile_offset,
+                           compute::ArrayVar<T, ItemsPerThread>& dst_items)
+{
+    compute::UInt tid         = linear_tid & compute::UInt(WARP_SIZE - 1);
+    compute::UInt wid         = linear_tid >> details::LOG_WARP_SIZE;
+    compute::UInt warp_offset = wid * compute::UInt(WARP_SIZE * ItemsPerThread);
+
+    for(int i = 0; i < ItemsPerThread; i++)
+    {
+        UInt src_pos = tile_offset + warp_offset + tid + (i * compute::UInt(WARP_SIZE));
+        dst_items[i] = block_src_it.read(src_pos);
+    }
+}
+
+template <typename T, size_t ItemsPerThread, size_t WARP_SIZE = details::WARP_SIZE, DeviceInputIteratorT InputIt>
+void LoadDirectWarpStriped(compute::UInt                         linear_tid,
+                           const InputIt&                        block_src_it,
+                           compute::UInt                         tile_offset,
+                           compute::ArrayVar<T, ItemsPerThread>& dst_items,
+                           compute::UInt                         block_item_end,
+                           compute::Var<T>                       default_value)
+{
+    compute::UInt tid         = linear_tid & compute::UInt(WARP_SIZE - 1);
+    compute::UInt wid         = linear_tid >> details::LOG_WARP_SIZE;
+    compute::UInt warp_offset = wid * compute::UInt(WARP_SIZE * ItemsPerThread);
+
+    for(auto i = 0; i < ItemsPerThread; i++)
+    {
+        dst_items[i] = default_value;
+        UInt src_pos = warp_offset + tid + (i * compute::UInt(WARP_SIZE));
+        $if(src_pos < block_item_end)
+        {
+            dst_items[i] = block_src_it.read(tile_offset + src_pos);
+        };
+    }
+}
+
+
 template <typename Type4Byte, size_t BlockSize = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = 2, BlockLoadAlgorithm DefaultLoadAlgorithm = BlockLoadAlgorithm::BLOCK_LOAD_DIRECT>
 class BlockLoad : public LuisaModule
 {
@@ -242,14 +285,17 @@ class BlockLoad : public LuisaModule
     ~BlockLoad() = default;
 
   public:
-    void Load(const compute::BufferVar<Type4Byte>&            d_in,
+    // d_in is a BufferVar or any bound input iterator
+    template <DeviceInputIteratorT InputIt>
+    void Load(const InputIt&                                  d_in,
               compute::ArrayVar<Type4Byte, ITEMS_PER_THREAD>& thread_data,
               compute::UInt                                   block_item_start)
     {
         Load(d_in, thread_data, block_item_start, compute::UInt(BlockSize * ITEMS_PER_THREAD), Type4Byte(0));
     }
 
-    void Load(const compute::BufferVar<Type4Byte>&            d_in,
+    template <DeviceInputIteratorT InputIt>
+    void Load(const InputIt&                                  d_in,
               compute::ArrayVar<Type4Byte, ITEMS_PER_THREAD>& thread_data,
               compute::UInt                                   block_item_start,
               compute::UInt                                   block_item_end)
@@ -257,7 +303,8 @@ class BlockLoad : public LuisaModule
         Load(d_in, thread_data, block_item_start, block_item_end, Type4Byte(0));
     }
 
-    void Load(const compute::BufferVar<Type4Byte>&            d_in,
+    template <DeviceInputIteratorT InputIt>
+    void Load(const InputIt&                                  d_in,
               compute::ArrayVar<Type4Byte, ITEMS_PER_THREAD>& thread_data,
               compute::UInt                                   block_item_start,
               compute::UInt                                   block_item_end,
@@ -274,8 +321,9 @@ class BlockLoad : public LuisaModule
 
 
   private:
+    template <DeviceInputIteratorT InputIt>
     void LoadDirectedBlocked(compute::UInt                                   linear_tid,
-                             const compute::BufferVar<Type4Byte>&            d_in,
+                             const InputIt&                                  d_in,
                              compute::ArrayVar<Type4Byte, ITEMS_PER_THREAD>& thread_data,
                              compute::UInt                                   block_item_start,
                              compute::UInt                                   block_item_end,
@@ -0,0 +1,244 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 21:02:36
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 21:02:36
+ */
+
+#pragma once
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/var.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/runtime/core.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    /**
+     * @brief Number of items taken from the first list on the merge path diagonal diag, keys1_at and
+     * keys2_at read the two sorted lists so the search runs on shared memory and on buffers alike.
+     */
+    template <typename Keys1At, typename Keys2At, typename CompareOp>
+    compute::UInt MergePath(Keys1At              keys1_at,
+                            Keys2At              keys2_at,
+                            const compute::UInt& keys1_count,
+                            const compute::UInt& keys2_count,
+                            const compute::UInt& diag,
+                            CompareOp            compare_op)
+    {
+        using namespace luisa::compute;
+        UInt begin = select(0u, diag - keys2_count, diag > keys2_count);
+        UInt end   = min(diag, keys1_count);
+        $while(begin < end)
+        {
+            UInt mid = (begin + end) >> 1u;
+            // ties go to the first list, which keeps the merge stable
+            $if(compare_op(keys2_at(diag - 1u - mid), keys1_at(mid)))
+            {
+                end = mid;
+            }
+            $else
+            {
+                begin = mid + 1u;
+            };
+        };
+        return begin;
+    }
+
+    // merges ITEMS_PER_THREAD items of two sorted ranges of keys_shared, indices are the source positions
+    template <typename KeyType, size_t ITEMS_PER_THREAD, typename CompareOp>
+    void SerialMerge(compute::Shared<KeyType>*                     keys_shared,
+                     compute::UInt                                 keys1_beg,
+                     compute::UInt                                 keys2_beg,
+                     const compute::UInt&                          keys1_count,
+                     const compute::UInt&                          keys2_count,
+                     compute::ArrayVar<KeyType, ITEMS_PER_THREAD>& output,
+                     compute::ArrayVar<uint, ITEMS_PER_THREAD>&    indices,
+                     CompareOp                                     compare_op)
+    {
+        using namespace luisa::compute;
+        UInt keys1_end = keys1_beg + keys1_count;
+        UInt keys2_end = keys2_beg + keys2_count;
+
+        Var<KeyType> key1 = (*keys_shared)[keys1_beg];
+        Var<KeyType> key2 = (*keys_shared)[keys2_beg];
+        for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+        {
+            Bool take_key2 = keys2_beg < keys2_end & (keys1_beg >= keys1_end | compare_op(key2, key1));
+            $if(take_key2)
+            {
+                output[item]  = key2;
+                indices[item] = keys2_beg;
+                keys2_beg += 1u;
+                key2          = (*keys_shared)[keys2_beg];
+            }
+            $else
+            {
+                // past the valid items both ranges run dry, stay on the last slot instead of reading beyond the tile
+                output[item]  = key1;
+                indices[item] = keys1_beg;
+                keys1_beg     = min(keys1_beg + 1u, keys1_end);
+                key1          = (*keys_shared)[keys1_beg];
+            };
+        };
+    }
+}  // namespace details
+
+/**
+ * @brief Stable sort of a tile in blocked arrangement with a user comparator: every thread sorts
+ * its items, then log2(BlockSize) rounds merge pairs of sorted runs through shared memory,
+ * each thread finding its share of the merge by a merge path search.
+ */
+template <typename KeyType, size_t BlockSize = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+class BlockMergeSort : public LuisaModule
+{
+  public:
+    static constexpr uint TILE_ITEMS = BlockSize * ITEMS_PER_THREAD;
+    static_assert((BlockSize & (BlockSize - 1)) == 0, "BlockMergeSort needs a power of two block size.");
+
+  public:
+    BlockMergeSort()
+    {
+        // one extra slot, the serial merge reads one key past its range
+        m_keys_shared = new SmemType<KeyType>{TILE_ITEMS + 1};
+    };
+
+    BlockMergeSort(SmemTypePtr<KeyType> keys_shared)
+        : m_keys_shared(keys_shared) {};
+    ~BlockMergeSort() = default;
+
+    // items at or after valid_items stay behind the valid ones in unspecified order
+    template <typename CompareOp>
+    void Sort(compute::ArrayVar<KeyType, ITEMS_PER_THREAD>& keys, CompareOp compare_op, const compute::UInt& valid_items)
+    {
+        compute::ArrayVar<KeyType, ITEMS_PER_THREAD> values;
+        SortImpl<true>(keys, values, compare_op, valid_items);
+    }
+
+    template <typename ValueType, typename CompareOp>
+    void Sort(compute::ArrayVar<KeyType, ITEMS_PER_THREAD>&   keys,
+              compute::ArrayVar<ValueType, ITEMS_PER_THREAD>& values,
+              CompareOp                                       compare_op,
+              const compute::UInt&                            valid_items)
+    {
+        SortImpl<false>(keys, values, compare_op, valid_items);
+    }
+
+  private:
+    template <bool KEYS_ONLY, typename ValueType, typename CompareOp>
+    void SortImpl(compute::ArrayVar<KeyType, ITEMS_PER_THREAD>&   keys,
+                  compute::ArrayVar<ValueType, ITEMS_PER_THREAD>& values,
+                  CompareOp                                       compare_op,
+                  const compute::UInt&                            valid_items)
+    {
+        using namespace luisa::compute;
+        luisa::compute::set_block_size(BlockSize);
+        UInt thid = thread_id().x;
+
+        // invalid items take the largest valid key of the thread so they sort behind it
+        Var<KeyType> max_key = keys[0];
+        for(auto item = 1u; item < ITEMS_PER_THREAD; ++item)
+        {
+            $if(thid * UInt(ITEMS_PER_THREAD) + item < valid_items)
+            {
+                $if(compare_op(max_key, keys[item]))
+                {
+                    max_key = keys[item];
+                };
+            }
+            $else
+            {
+                keys[item] = max_key;
+            };
+        };
+
+        // odd-even transposition sort, swapping only strictly smaller keys keeps it stable
+        for(auto i = 0u; i < ITEMS_PER_THREAD; ++i)
+        {
+            for(auto j = 1u & i; j + 1u < ITEMS_PER_THREAD; j += 2u)
+            {
+                $if(compare_op(keys[j + 1], keys[j]))
+                {
+                    Var<KeyType> key = keys[j];
+                    keys[j]          = keys[j + 1];
+                    keys[j + 1]      = key;
+                    if constexpr(!KEYS_ONLY)
+                    {
+                        Var<ValueType> value = values[j];
+                        values[j]            = values[j + 1];
+                        values[j + 1]        = value;
+                    }
+                };
+            };
+        };
+
+        SmemTypePtr<ValueType> values_shared = nullptr;
+        if constexpr(!KEYS_ONLY)
+        {
+            values_shared = new SmemType<ValueType>{TILE_ITEMS};
+        }
+
+        for(auto target_merged_threads = 2u; target_merged_threads <= BlockSize; target_merged_threads *= 2u)
+        {
+            const uint merged_threads = target_merged_threads / 2u;
+            const uint mask           = target_merged_threads - 1u;
+
+            sync_block();
+            for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+            {
+                (*m_keys_shared)[thid * UInt(ITEMS_PER_THREAD) + item] = keys[item];
+            };
+            sync_block();
+
+            // the pair of sorted runs this thread helps merge and its diagonal within them
+            UInt start       = UInt(ITEMS_PER_THREAD) * (thid & UInt(~mask));
+            UInt diag        = min(valid_items, UInt(ITEMS_PER_THREAD) * (thid & UInt(mask)));
+            UInt keys1_beg   = min(valid_items, start);
+            UInt keys1_end   = min(valid_items, keys1_beg + UInt(ITEMS_PER_THREAD * merged_threads));
+            UInt keys2_beg   = keys1_end;
+            UInt keys2_end   = min(valid_items, keys2_beg + UInt(ITEMS_PER_THREAD * merged_threads));
+            UInt keys1_count = keys1_end - keys1_beg;
+            UInt keys2_count = keys2_end - keys2_beg;
+
+            UInt partition_diag = details::MergePath(
+                [&](const UInt& i) -> Var<KeyType> { return (*m_keys_shared)[keys1_beg + i]; },
+                [&](const UInt& i) -> Var<KeyType> { return (*m_keys_shared)[keys2_beg + i]; },
+                keys1_count,
+                keys2_count,
+                diag,
+                compare_op);
+
+            UInt keys1_beg_loc = keys1_beg + partition_diag;
+            UInt keys2_beg_loc = keys2_beg + diag - partition_diag;
+
+            ArrayVar<uint, ITEMS_PER_THREAD> indices;
+            details::SerialMerge<KeyType, ITEMS_PER_THREAD>(m_keys_shared,
+                                                            keys1_beg_loc,
+                                                            keys2_beg_loc,
+                                                            keys1_end - keys1_beg_loc,
+                                                            keys2_end - keys2_beg_loc,
+                                                            keys,
+                                                            indices,
+                                                            compare_op);
+
+            if constexpr(!KEYS_ONLY)
+            {
+                sync_block();
+                for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                {
+                    (*values_shared)[thid * UInt(ITEMS_PER_THREAD) + item] = values[item];
+                };
+                sync_block();
+                for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                {
+                    values[item] = (*values_shared)[indices[item]];
+                };
+            }
+        }
+    }
+
+    SmemTypePtr<KeyType> m_keys_shared;
+};
+}  // namespace luisa::parallel_primitive
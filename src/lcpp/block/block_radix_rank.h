@@ -35,7 +35,7 @@ using namespace luisa::compute;
 template <int BINS_PER_THREAD>
 struct BlockRadixRankEmptyCallback
 {
-    inline void operator()(const ArrayVar<int, BINS_PER_THREAD>&) {}
+    inline void operator()(const ArrayVar<uint, BINS_PER_THREAD>&) {}
 };
 
 namespace details
@@ -330,7 +330,7 @@ class BlockRadixRankMatchEarlyCounts : public LuisaModule
                   compute::ArrayVar<uint, KEY_PER_THREAD>&               ranks,
                   DigitExtractorT                                        digit_extractor)
     {
-        compute::ArrayVar<int, BINS_PER_THREAD> exclusive_digit_prefix;
+        compute::ArrayVar<uint, BINS_PER_THREAD> exclusive_digit_prefix;
         RankKeys(keys, ranks, digit_extractor, exclusive_digit_prefix);
     }
 };
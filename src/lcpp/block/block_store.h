@@ -10,6 +10,7 @@
 #include <luisa/dsl/var.h>
 #include <luisa/dsl/sugar.h>
 #include <lcpp/common/type_trait.h>
+#include <lcpp/common/iterator.h>
 #include <lcpp/runtime/core.h>
 
 namespace luisa::parallel_primitive
@@ -118,15 +119,18 @@ class BlockStore : public LuisaModule
     ~BlockStore() = default;
 
   public:
+    // d_out is a BufferVar or any bound output iterator
+    template <DeviceOutputIteratorT<Type4Byte> OutputIt>
     void Store(const compute::ArrayVar<Type4Byte, ITEMS_PER_THREAD>& thread_data,
-               const compute::BufferVar<Type4Byte>&                  d_out,
+               const OutputIt&                                       d_out,
                compute::UInt                                         block_item_start)
     {
         Store(thread_data, d_out, block_item_start, compute::UInt(BlockSize * ITEMS_PER_THREAD));
     }
 
+    template <DeviceOutputIteratorT<Type4Byte> OutputIt>
     void Store(const compute::ArrayVar<Type4Byte, ITEMS_PER_THREAD>& thread_data,
-               const compute::BufferVar<Type4Byte>&                  d_out,
+               const OutputIt&                                       d_out,
                compute::UInt                                         block_item_start,
                compute::UInt                                         block_item_end)
     {
@@ -141,9 +145,10 @@ class BlockStore : public LuisaModule
     };
 
   private:
+    template <DeviceOutputIteratorT<Type4Byte> OutputIt>
     void StoreDirectedBlocked(compute::UInt                                         linear_tid,
                               const compute::ArrayVar<Type4Byte, ITEMS_PER_THREAD>& thread_data,
-                              const compute::BufferVar<Type4Byte>&                  d_out,
+                              const OutputIt&                                       d_out,
                               compute::UInt block_item_start,
                               compute::UInt block_item_end)
     {
@@ -28,6 +28,25 @@ struct GridEvenShared
     compute::uint block_offset;
     compute::uint block_end;
     compute::uint block_stride;
+
+  public:
+    // host side: split num_items into contiguous, tile-aligned shares for at most max_grid_size blocks
+    void DispatchInit(compute::uint num_items, int max_grid_size, int tile_items) noexcept
+    {
+        this->num_items    = num_items;
+        this->block_offset = num_items;
+        this->block_end    = num_items;
+        this->block_stride = tile_items;
+
+        total_tiles = static_cast<int>((num_items + tile_items - 1) / tile_items);
+        grid_size   = total_tiles < max_grid_size ? total_tiles : max_grid_size;
+
+        int avg_tiles_per_block = grid_size > 0 ? total_tiles / grid_size : 0;
+        big_shares              = total_tiles - (avg_tiles_per_block * grid_size);
+        normal_share_items      = avg_tiles_per_block * tile_items;
+        normal_base_offset      = big_shares * tile_items;
+        big_shared_items        = normal_share_items + tile_items;
+    };
 };
 }  // namespace luisa::parallel_primitive
 
@@ -0,0 +1,494 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 23:41:27
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 23:41:27
+ */
+
+#pragma once
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <luisa/core/stl/string.h>
+#include <luisa/ast/type.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/runtime/buffer.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/common/thread_operators.h>
+
+namespace luisa::parallel_primitive
+{
+/**
+ * @brief Fancy iterators, inputs and outputs of the device primitives that need no buffer of their own.
+ *
+ * An iterator is a host side description with three parts:
+ * - params: the kernel arguments it binds, e.g. ParamList<Buffer<float>, float4>
+ * - args(): their host values at dispatch
+ * - bind(): the device side iterator rebuilt from those arguments inside the kernel, with read(index)
+ *   and/or write(index, value)
+ * Operators are compiled into the shader and keyed by their type, the float4 params() of named
+ * operators stay kernel arguments as everywhere else.
+ */
+template <typename... Ts>
+struct ParamList
+{
+    static constexpr size_t size = sizeof...(Ts);
+};
+
+namespace details
+{
+    template <typename... Lists>
+    struct concat_params;
+
+    template <>
+    struct concat_params<>
+    {
+        using type = ParamList<>;
+    };
+
+    template <typename... Ts>
+    struct concat_params<ParamList<Ts...>>
+    {
+        using type = ParamList<Ts...>;
+    };
+
+    template <typename... As, typename... Bs, typename... Rest>
+    struct concat_params<ParamList<As...>, ParamList<Bs...>, Rest...>
+    {
+        using type = typename concat_params<ParamList<As..., Bs...>, Rest...>::type;
+    };
+
+    template <typename List>
+    struct shader_of_params;
+
+    template <typename... Ts>
+    struct shader_of_params<ParamList<Ts...>>
+    {
+        using type = compute::Shader<1, Ts...>;
+    };
+
+    // the device side expressions of a parameter list, as handed to bind()
+    template <typename List>
+    struct param_exprs;
+
+    template <typename... Ts>
+    struct param_exprs<ParamList<Ts...>>
+    {
+        using type = std::tuple<compute::Expr<Ts>...>;
+    };
+
+    template <size_t Offset, typename Tuple, size_t... I>
+    auto tuple_slice_impl(const Tuple& tuple, std::index_sequence<I...>)
+    {
+        return std::make_tuple(std::get<Offset + I>(tuple)...);
+    }
+
+    template <size_t Offset, size_t Count, typename Tuple>
+    auto tuple_slice(const Tuple& tuple)
+    {
+        return tuple_slice_impl<Offset>(tuple, std::make_index_sequence<Count>{});
+    }
+}  // namespace details
+
+template <typename... Lists>
+using concat_params_t = typename details::concat_params<Lists...>::type;
+
+// Shader<1, ...> over the concatenated parameter lists
+template <typename... Lists>
+using ShaderOfParams = typename details::shader_of_params<concat_params_t<Lists...>>::type;
+
+template <typename List>
+using param_exprs_t = typename details::param_exprs<List>::type;
+
+template <typename It>
+concept IteratorT = requires(const It& it) {
+    typename It::value_type;
+    typename It::params;
+    it.args();
+    it.desc();
+};
+
+// what the block and agent loads/stores accept in a kernel: buffers and bound iterators alike
+template <typename It>
+concept DeviceInputIteratorT = requires(const It& it, compute::UInt index) { it.read(index); };
+
+template <typename It, typename T>
+concept DeviceOutputIteratorT = requires(const It& it, compute::UInt index, compute::Var<T> value) {
+    it.write(index, value);
+};
+
+
+template <typename T>
+struct BufferIterator
+{
+    using value_type = T;
+    using params     = ParamList<compute::Buffer<T>>;
+
+    compute::BufferView<T> view;
+
+    struct DeviceIterator
+    {
+        compute::Expr<compute::Buffer<T>> buffer;
+
+        compute::Var<T> read(compute::Expr<uint> index) const noexcept { return buffer.read(index); }
+
+        template <typename V>
+        void write(compute::Expr<uint> index, V&& value) const noexcept
+        {
+            buffer.write(index, std::forward<V>(value));
+        }
+    };
+
+    auto args() const noexcept { return std::make_tuple(view); }
+
+    template <typename Tuple>
+    DeviceIterator bind(const Tuple& params) const noexcept
+    {
+        return DeviceIterator{std::get<0>(params)};
+    }
+
+    // the element type keeps composite iterators over different buffers apart in the persistent cache
+    luisa::string desc() const
+    {
+        return "buffer<" + luisa::string{compute::Type::of<T>()->description()} + ">";
+    }
+};
+
+// base, base + 1, base + 2, ...
+template <NumericT T = uint>
+struct CountingIterator
+{
+    using value_type = T;
+    using params     = ParamList<T>;
+
+    T base = T(0);
+
+    struct DeviceIterator
+    {
+        compute::Expr<T> base;
+
+        compute::Var<T> read(compute::Expr<uint> index) const noexcept
+        {
+            return compute::def(base + compute::cast<T>(index));
+        }
+    };
+
+    auto args() const noexcept { return std::make_tuple(base); }
+
+    template <typename Tuple>
+    DeviceIterator bind(const Tuple& params) const noexcept
+    {
+        return DeviceIterator{std::get<0>(params)};
+    }
+
+    luisa::string desc() const
+    {
+        return "counting<" + luisa::string{compute::Type::of<T>()->description()} + ">";
+    }
+};
+
+// the same value at every index
+template <NumericT T>
+struct ConstantIterator
+{
+    using value_type = T;
+    using params     = ParamList<T>;
+
+    T value;
+
+    struct DeviceIterator
+    {
+        compute::Expr<T> value;
+
+        compute::Var<T> read(compute::Expr<uint>) const noexcept { return compute::def(value); }
+    };
+
+    auto args() const noexcept { return std::make_tuple(value); }
+
+    template <typename Tuple>
+    DeviceIterator bind(const Tuple& params) const noexcept
+    {
+        return DeviceIterator{std::get<0>(params)};
+    }
+
+    luisa::string desc() const
+    {
+        return "constant<" + luisa::string{compute::Type::of<T>()->description()} + ">";
+    }
+};
+
+// conversion_op(input[i]), e.g. a predicate applied while the scan loads its tile
+template <typename ValueT, typename ConversionOp, IteratorT InputIt>
+struct TransformInputIterator
+{
+    using value_type = ValueT;
+    using params     = concat_params_t<typename InputIt::params, ParamList<float4>>;
+    using BoundOpT = decltype(bind_op_params(std::declval<ConversionOp>(), std::declval<compute::Expr<float4>>()));
+
+    InputIt      input;
+    ConversionOp conversion_op;
+
+    struct DeviceIterator
+    {
+        typename InputIt::DeviceIterator input;
+        BoundOpT                         conversion_op;
+
+        compute::Var<ValueT> read(compute::Expr<uint> index) const noexcept
+        {
+            compute::Var<ValueT> value = conversion_op(input.read(index));
+            return value;
+        }
+    };
+
+    auto args() const noexcept { return std::tuple_cat(input.args(), std::make_tuple(op_params(conversion_op))); }
+
+    template <typename Tuple>
+    DeviceIterator bind(const Tuple& params) const noexcept
+    {
+        constexpr size_t NUM_INPUT_PARAMS = InputIt::params::size;
+        return DeviceIterator{input.bind(details::tuple_slice<0, NUM_INPUT_PARAMS>(params)),
+                              bind_op_params(conversion_op, std::get<NUM_INPUT_PARAMS>(params))};
+    }
+
+    luisa::string desc() const
+    {
+        return "transform<" + luisa::string{compute::Type::of<ValueT>()->description()} + ">("
+               + luisa::string{op_desc(conversion_op)} + "," + input.desc() + ")";
+    }
+};
+
+// output[i] = conversion_op(value), e.g. an exclusive sum written straight as float weights
+template <typename ValueT, typename ConversionOp, IteratorT OutputIt>
+struct TransformOutputIterator
+{
+    using value_type = ValueT;
+    using params     = concat_params_t<typename OutputIt::params, ParamList<float4>>;
+    using BoundOpT = decltype(bind_op_params(std::declval<ConversionOp>(), std::declval<compute::Expr<float4>>()));
+
+    OutputIt     output;
+    ConversionOp conversion_op;
+
+    struct DeviceIterator
+    {
+        typename OutputIt::DeviceIterator output;
+        BoundOpT                          conversion_op;
+
+        template <typename V>
+        void write(compute::Expr<uint> index, V&& value) const noexcept
+        {
+            compute::Var<ValueT> item = value;
+            output.write(index, conversion_op(item));
+        }
+    };
+
+    auto args() const noexcept
+    {
+        return std::tuple_cat(output.args(), std::make_tuple(op_params(conversion_op)));
+    }
+
+    template <typename Tuple>
+    DeviceIterator bind(const Tuple& params) const noexcept
+    {
+        constexpr size_t NUM_OUTPUT_PARAMS = OutputIt::params::size;
+        return DeviceIterator{output.bind(details::tuple_slice<0, NUM_OUTPUT_PARAMS>(params)),
+                              bind_op_params(conversion_op, std::get<NUM_OUTPUT_PARAMS>(params))};
+    }
+
+    luisa::string desc() const
+    {
+        return "transform_out<" + luisa::string{compute::Type::of<ValueT>()->description()} + ">("
+               + luisa::string{op_desc(conversion_op)} + "," + output.desc() + ")";
+    }
+};
+
+// drops every write, for outputs a caller does not need (the aggregates of a scan, the flags of a select)
+template <typename T>
+struct DiscardOutputIterator
+{
+    using value_type = T;
+    using params     = ParamList<>;
+
+    struct DeviceIterator
+    {
+        template <typename V>
+        void write(compute::Expr<uint>, V&&) const noexcept
+        {
+        }
+    };
+
+    auto args() const noexcept { return std::tuple<>{}; }
+
+    template <typename Tuple>
+    DeviceIterator bind(const Tuple&) const noexcept
+    {
+        return DeviceIterator{};
+    }
+
+    luisa::string desc() const
+    {
+        return "discard<" + luisa::string{compute::Type::of<T>()->description()} + ">";
+    }
+};
+
+// {first[i], second[i]} as a KeyValuePair, readable and writable when both sides are
+template <IteratorT FirstIt, IteratorT SecondIt>
+struct ZipIterator
+{
+    using value_type = KeyValuePair<typename FirstIt::value_type, typename SecondIt::value_type>;
+    using params     = concat_params_t<typename FirstIt::params, typename SecondIt::params>;
+
+    FirstIt  first;
+    SecondIt second;
+
+    struct DeviceIterator
+    {
+        typename FirstIt::DeviceIterator  first;
+        typename SecondIt::DeviceIterator second;
+
+        compute::Var<value_type> read(compute::Expr<uint> index) const noexcept
+        {
+            compute::Var<value_type> pair;
+            pair.key   = first.read(index);
+            pair.value = second.read(index);
+            return pair;
+        }
+
+        template <typename V>
+        void write(compute::Expr<uint> index, V&& value) const noexcept
+        {
+            compute::Var<value_type> pair = value;
+            first.write(index, pair.key);
+            second.write(index, pair.value);
+        }
+    };
+
+    auto args() const noexcept { return std::tuple_cat(first.args(), second.args()); }
+
+    template <typename Tuple>
+    DeviceIterator bind(const Tuple& params) const noexcept
+    {
+        constexpr size_t NUM_FIRST_PARAMS  = FirstIt::params::size;
+        constexpr size_t NUM_SECOND_PARAMS = SecondIt::params::size;
+        return DeviceIterator{first.bind(details::tuple_slice<0, NUM_FIRST_PARAMS>(params)),
+                              second.bind(details::tuple_slice<NUM_FIRST_PARAMS, NUM_SECOND_PARAMS>(params))};
+    }
+
+    luisa::string desc() const { return "zip(" + first.desc() + "," + second.desc() + ")"; }
+};
+
+
+// plain buffer views are accepted wherever an iterator is
+template <typename T>
+BufferIterator<T> as_iterator(compute::BufferView<T> view) noexcept
+{
+    return BufferIterator<T>{view};
+}
+
+template <typename T>
+BufferIterator<T> as_iterator(const compute::Buffer<T>& buffer) noexcept
+{
+    return BufferIterator<T>{buffer.view()};
+}
+
+template <IteratorT It>
+It as_iterator(It it) noexcept
+{
+    return it;
+}
+
+template <typename X>
+using as_iterator_t = decltype(as_iterator(std::declval<X>()));
+
+// the element type behind a plain buffer iterator, the iterator itself otherwise
+template <typename It>
+struct iterator_source
+{
+    using type = It;
+};
+
+template <typename T>
+struct iterator_source<BufferIterator<T>>
+{
+    using type = T;
+};
+
+template <typename It>
+using iterator_source_t = typename iterator_source<It>::type;
+
+template <typename X>
+concept IteratorOrBufferT = requires(X x) {
+    { as_iterator(x) } -> IteratorT;
+};
+
+template <NumericT T>
+CountingIterator<T> make_counting_iterator(T base) noexcept
+{
+    return CountingIterator<T>{base};
+}
+
+template <NumericT T>
+ConstantIterator<T> make_constant_iterator(T value) noexcept
+{
+    return ConstantIterator<T>{value};
+}
+
+template <typename ValueT, IteratorOrBufferT In, typename ConversionOp>
+auto make_transform_input_iterator(In input, ConversionOp conversion_op) noexcept
+{
+    return TransformInputIterator<ValueT, ConversionOp, as_iterator_t<In>>{as_iterator(input), conversion_op};
+}
+
+template <typename ValueT, IteratorOrBufferT Out, typename ConversionOp>
+auto make_transform_output_iterator(Out output, ConversionOp conversion_op) noexcept
+{
+    return TransformOutputIterator<ValueT, ConversionOp, as_iterator_t<Out>>{as_iterator(output), conversion_op};
+}
+
+// the items of a narrow buffer converted to AccumT as they load, a buffer already holding AccumT stays a plain buffer
+template <typename AccumT, typename T>
+auto make_cast_input_iterator(compute::BufferView<T> view) noexcept
+{
+    if constexpr(std::is_same_v<AccumT, T>)
+    {
+        return as_iterator(view);
+    }
+    else
+    {
+        return make_transform_input_iterator<AccumT>(view, CastOp<AccumT>{});
+    }
+}
+
+template <typename T>
+DiscardOutputIterator<T> make_discard_output_iterator() noexcept
+{
+    return DiscardOutputIterator<T>{};
+}
+
+template <IteratorOrBufferT First, IteratorOrBufferT Second>
+auto make_zip_iterator(First first, Second second) noexcept
+{
+    return ZipIterator<as_iterator_t<First>, as_iterator_t<Second>>{as_iterator(first), as_iterator(second)};
+}
+
+// suffix of the persistent cache key, empty when every iterator is a plain buffer so those shaders keep their names
+template <IteratorT... Its>
+luisa::string iterator_desc(const Its&... its)
+{
+    if constexpr((std::is_same_v<Its, BufferIterator<typename Its::value_type>> && ...))
+    {
+        return {};
+    }
+    else
+    {
+        luisa::string desc;
+        ((desc += "+" + its.desc()), ...);
+        return desc;
+    }
+}
+}  // namespace luisa::parallel_primitive
@@ -6,6 +6,9 @@
  */
 
 #pragma once
+#include <concepts>
+#include <utility>
+#include <luisa/core/stl/string.h>
 #include <luisa/dsl/sugar.h>
 #include <luisa/dsl/func.h>
 #include <luisa/dsl/var.h>
@@ -16,9 +19,141 @@ namespace luisa::parallel_primitive
 {
 using namespace luisa::compute;
 
+/**
+ * @brief Operator with a stable name, e.g. static constexpr luisa::string_view name = "scaled_sum".
+ *
+ * The name keys its shaders instead of the compiler's type name, so the persistent shader cache
+ * finds them again across builds. Unnamed operators (lambdas) fall back to typeid.
+ */
+template <typename Op>
+concept NamedOpT = requires {
+    { Op::name } -> std::convertible_to<luisa::string_view>;
+};
+
+/**
+ * @brief Named operator with runtime parameters.
+ *
+ * params() is passed to the kernels as an argument and handed back as the last argument of
+ * operator(), so changing it (a per-frame scale factor) reuses the compiled shader instead of
+ * baking the value in.
+ */
+template <typename Op>
+concept ParameterizedOpT = NamedOpT<Op> && requires(const Op& op) {
+    { op.params() } -> std::convertible_to<float4>;
+};
+
+// an operator with its runtime parameters bound to the kernel argument
+template <typename Op>
+struct BoundOp
+{
+    Op           op;
+    Expr<float4> params;
+
+    // forwarded, so in-place operators (DeviceFor::ForEach) still get their item by reference
+    template <typename... Args>
+    auto operator()(Args&&... args) const noexcept
+    {
+        return op(std::forward<Args>(args)..., params);
+    }
+};
+
+template <typename Op>
+auto bind_op_params(const Op& op, Expr<float4> params) noexcept
+{
+    if constexpr(ParameterizedOpT<Op>)
+    {
+        return BoundOp<Op>{op, params};
+    }
+    else
+    {
+        return op;
+    }
+}
+
+// host side value of the parameter argument, unused by plain operators
+template <typename Op>
+float4 op_params(const Op& op) noexcept
+{
+    if constexpr(ParameterizedOpT<Op>)
+    {
+        return op.params();
+    }
+    else
+    {
+        return make_float4(0.0f);
+    }
+}
+
+struct SumOp
+{
+    static constexpr luisa::string_view name = "sum";
+
+    template <NumericT Type4Byte>
+    Var<Type4Byte> operator()(const Var<Type4Byte>& a, const Var<Type4Byte>& b) const noexcept
+    {
+        return a + b;
+    }
+};
+
+struct MinOp
+{
+    static constexpr luisa::string_view name = "min";
+
+    template <NumericT Type4Byte>
+    Var<Type4Byte> operator()(const Var<Type4Byte>& a, const Var<Type4Byte>& b) const noexcept
+    {
+        return luisa::compute::min(a, b);
+    }
+};
+
+struct MaxOp
+{
+    static constexpr luisa::string_view name = "max";
+
+    template <NumericT Type4Byte>
+    Var<Type4Byte> operator()(const Var<Type4Byte>& a, const Var<Type4Byte>& b) const noexcept
+    {
+        return luisa::compute::max(a, b);
+    }
+};
+
+struct BitOrOp
+{
+    static constexpr luisa::string_view name = "bit_or";
+
+    template <NumericT Type4Byte>
+    Var<Type4Byte> operator()(const Var<Type4Byte>& a, const Var<Type4Byte>& b) const noexcept
+    {
+        return a | b;
+    }
+};
+
+struct BitAndOp
+{
+    static constexpr luisa::string_view name = "bit_and";
+
+    template <NumericT Type4Byte>
+    Var<Type4Byte> operator()(const Var<Type4Byte>& a, const Var<Type4Byte>& b) const noexcept
+    {
+        return a & b;
+    }
+};
+
+struct BitXorOp
+{
+    static constexpr luisa::string_view name = "bit_xor";
+
+    template <NumericT Type4Byte>
+    Var<Type4Byte> operator()(const Var<Type4Byte>& a, const Var<Type4Byte>& b) const noexcept
+    {
+        return a ^ b;
+    }
+};
 
 struct ArgMaxOp
 {
+    static constexpr luisa::string_view name = "arg_max";
+
     template <NumericT Type4Byte>
     Var<IndexValuePairT<Type4Byte>> operator()(const Var<IndexValuePairT<Type4Byte>>& a,
                                                const Var<IndexValuePairT<Type4Byte>>& b) const noexcept
@@ -34,6 +169,8 @@ struct ArgMaxOp
 
 struct ArgMinOp
 {
+    static constexpr luisa::string_view name = "arg_min";
+
     template <NumericT Type4Byte>
     Var<IndexValuePairT<Type4Byte>> operator()(const Var<IndexValuePairT<Type4Byte>>& a,
                                                const Var<IndexValuePairT<Type4Byte>>& b) const noexcept
@@ -47,8 +184,52 @@ struct ArgMinOp
     }
 };
 
+// folds ReduceStats, the min, max, sum and count of both sides at once
+struct MinMaxSumOp
+{
+    static constexpr luisa::string_view name = "min_max_sum";
+
+    template <NumericT Type4Byte>
+    Var<ReduceStats<Type4Byte>> operator()(const Var<ReduceStats<Type4Byte>>& a,
+                                           const Var<ReduceStats<Type4Byte>>& b) const noexcept
+    {
+        Var<ReduceStats<Type4Byte>> result;
+        result.minimum = luisa::compute::min(a.minimum, b.minimum);
+        result.maximum = luisa::compute::max(a.maximum, b.maximum);
+        result.sum     = a.sum + b.sum;
+        result.count   = a.count + b.count;
+        return result;
+    }
+};
+
+// merges two WelfordStats with Chan's update, so long float ranges keep their precision
+struct WelfordOp
+{
+    static constexpr luisa::string_view name = "welford";
+
+    template <NumericT Type4Byte>
+    Var<WelfordStats<Type4Byte>> operator()(const Var<WelfordStats<Type4Byte>>& a,
+                                            const Var<WelfordStats<Type4Byte>>& b) const noexcept
+    {
+        UInt           count   = a.count + b.count;
+        Var<Type4Byte> a_count = cast<Type4Byte>(a.count);
+        Var<Type4Byte> b_count = cast<Type4Byte>(b.count);
+        // two empty sides stay empty instead of dividing by zero
+        Var<Type4Byte> b_weight = select(b_count / cast<Type4Byte>(count), Type4Byte(0), count == 0u);
+        Var<Type4Byte> delta    = b.mean - a.mean;
+
+        Var<WelfordStats<Type4Byte>> result;
+        result.mean  = a.mean + delta * b_weight;
+        result.m2    = a.m2 + b.m2 + delta * delta * a_count * b_weight;
+        result.count = count;
+        return result;
+    }
+};
+
 struct IdentityOp
 {
+    static constexpr luisa::string_view name = "identity";
+
     template <typename TypeData>
     Var<TypeData> operator()(const Var<TypeData>& data) const noexcept
     {
@@ -56,6 +237,19 @@ struct IdentityOp
     }
 };
 
+// widens a narrow input into the accumulator type, e.g. ushort counts summed as uint or half values as float
+template <typename AccumT>
+struct CastOp
+{
+    static constexpr luisa::string_view name = "cast";
+
+    template <typename TypeData>
+    Var<AccumT> operator()(const Var<TypeData>& data) const noexcept
+    {
+        return cast<AccumT>(data);
+    }
+};
+
 template <typename ReduceOpT>
 struct ReduceBySegmentOp
 {
@@ -100,6 +294,19 @@ struct ScanBySegmentOp
     }
 };
 
+// adds keys and values independently, e.g. the two part counts of a three-way partition
+struct PairSumOp
+{
+    template <KeyValuePairType KeyValuePairT>
+    Var<KeyValuePairT> operator()(const Var<KeyValuePairT>& a, const Var<KeyValuePairT>& b) const noexcept
+    {
+        Var<KeyValuePairT> result;
+        result.key   = a.key + b.key;
+        result.value = a.value + b.value;
+        return result;
+    }
+};
+
 
 template <typename ReduceOpT>
 struct ReduceByKeyOp
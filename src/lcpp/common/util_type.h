@@ -52,6 +52,53 @@ concept NumericTOrKeyValuePairT = NumericT<T> || KeyValuePairType<T>;
 template <NumericT Type4Byte>
 using IndexValuePairT = KeyValuePair<luisa::uint, Type4Byte>;
 
+// min, max, sum and count of a range, accumulated together in one pass (DeviceReduce::MinMaxSum)
+template <NumericT Type4Byte>
+struct ReduceStats
+{
+    Type4Byte   minimum;
+    Type4Byte   maximum;
+    Type4Byte   sum;
+    luisa::uint count;
+};
+
+template <typename T>
+struct is_reduce_stats : std::false_type
+{
+};
+
+// count, mean and sum of squared deviations (m2), merged with Chan's parallel update (DeviceReduce::MeanVariance)
+template <NumericT Type4Byte>
+struct WelfordStats
+{
+    Type4Byte   mean;
+    Type4Byte   m2;
+    luisa::uint count;
+
+    [[nodiscard]] Type4Byte variance() const noexcept { return count > 0 ? m2 / Type4Byte(count) : Type4Byte(0); }
+    [[nodiscard]] Type4Byte sample_variance() const noexcept
+    {
+        return count > 1 ? m2 / Type4Byte(count - 1) : Type4Byte(0);
+    }
+};
+
+template <typename T>
+struct is_reduce_stats<luisa::parallel_primitive::ReduceStats<T>> : std::true_type
+{
+};
+
+template <typename T>
+struct is_reduce_stats<luisa::parallel_primitive::WelfordStats<T>> : std::true_type
+{
+};
+
+template <typename T>
+concept ReduceStatsType = is_reduce_stats<T>::value;
+
+// what the reduce agents accumulate: plain values, index value pairs or composite statistics
+template <typename T>
+concept ReduceAccumulatorT = NumericTOrKeyValuePairT<T> || ReduceStatsType<T>;
+
 
 // Double Buffer(device) for Ping-Pong Buffering
 template <typename T>
@@ -248,3 +295,10 @@ using Traits = NumericTraits<std::remove_cv_t<T>>;
 #define LUISA_KEY_VALUE_PAIR_TEMPLATE() template <NumericT KeyType, NumericT ValueType>
 #define LUISA_KEY_VALUE_PAIR() luisa::parallel_primitive::KeyValuePair<KeyType, ValueType>
 LUISA_TEMPLATE_STRUCT(LUISA_KEY_VALUE_PAIR_TEMPLATE, LUISA_KEY_VALUE_PAIR, key, value){};
+
+#define LUISA_REDUCE_STATS_TEMPLATE() template <NumericT Type4Byte>
+#define LUISA_REDUCE_STATS() luisa::parallel_primitive::ReduceStats<Type4Byte>
+LUISA_TEMPLATE_STRUCT(LUISA_REDUCE_STATS_TEMPLATE, LUISA_REDUCE_STATS, minimum, maximum, sum, count){};
+
+#define LUISA_WELFORD_STATS() luisa::parallel_primitive::WelfordStats<Type4Byte>
+LUISA_TEMPLATE_STRUCT(LUISA_REDUCE_STATS_TEMPLATE, LUISA_WELFORD_STATS, mean, m2, count){};
@@ -13,6 +13,7 @@
 #include <luisa/dsl/builtin.h>
 #include <luisa/dsl/var.h>
 #include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
 #include <lcpp/runtime/core.h>
 
 namespace luisa::parallel_primitive
@@ -65,11 +66,25 @@ struct Log2<N, 0, COUNT>
 };
 
 
+// the operator's name when it has one, the compiler's type name otherwise
+template <typename Op>
+luisa::string_view op_desc(const Op& op)
+{
+    if constexpr(NamedOpT<Op>)
+    {
+        return Op::name;
+    }
+    else
+    {
+        return std::type_index(typeid(op)).name();
+    }
+}
+
 template <NumericT Type4Byte, typename ReduceOp>
 luisa::string get_type_and_op_desc(ReduceOp op)
 {
     luisa::string_view key_desc       = luisa::compute::Type::of<Type4Byte>()->description();
-    luisa::string_view reduce_op_desc = std::type_index(typeid(op)).name();
+    luisa::string_view reduce_op_desc = op_desc(op);
 
     return luisa::string(key_desc) + "+" + luisa::string(reduce_op_desc);
 }
@@ -79,7 +94,16 @@ luisa::string get_type_and_op_desc(ReduceOp op)
 {
     using ValueType                   = value_type_of_t<KeyValueType>;
     luisa::string_view key_desc       = luisa::compute::Type::of<ValueType>()->description();
-    luisa::string_view reduce_op_desc = std::type_index(typeid(op)).name();
+    luisa::string_view reduce_op_desc = op_desc(op);
+
+    return luisa::string(key_desc) + "+" + luisa::string(reduce_op_desc);
+}
+
+template <ReduceStatsType StatsType, typename ReduceOp>
+luisa::string get_type_and_op_desc(ReduceOp op)
+{
+    luisa::string_view key_desc       = luisa::compute::Type::of<StatsType>()->description();
+    luisa::string_view reduce_op_desc = op_desc(op);
 
     return luisa::string(key_desc) + "+" + luisa::string(reduce_op_desc);
 }
@@ -100,15 +124,15 @@ luisa::string get_type_and_op_desc(ReduceOp op)
     luisa::string_view value_desc = luisa::compute::Type::of<ValueType>()->description();
 
     return luisa::string(key_desc) + "+" + luisa::string(value_desc) + "+"
-           + std::type_index(typeid(op)).name();
+           + luisa::string(op_desc(op));
 }
 
-template <NumericT Type4Byte, typename ReduceOp, typename TransformOp>
+template <ReduceAccumulatorT Type4Byte, typename ReduceOp, typename TransformOp>
 luisa::string get_type_and_op_desc(ReduceOp op, TransformOp transform_op)
 {
-    luisa::string_view reduce_op_desc    = std::type_index(typeid(op)).name();
+    luisa::string_view reduce_op_desc    = op_desc(op);
     luisa::string_view key_desc          = luisa::compute::Type::of<Type4Byte>()->description();
-    luisa::string_view transform_op_desc = std::type_index(typeid(transform_op)).name();
+    luisa::string_view transform_op_desc = op_desc(transform_op);
 
     return luisa::string(key_desc) + "+" + luisa::string(reduce_op_desc) + "+" + luisa::string(transform_op_desc);
 }
@@ -0,0 +1,48 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-17 10:05:12
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-17 10:05:12
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <lcpp/runtime/core.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    // bounds-checked zero fill of a uint scratch buffer (bins, counters, look-back), so no host zeros are uploaded
+    template <size_t BLOCK_SIZE = details::BLOCK_SIZE>
+    class ClearModule : public LuisaModule
+    {
+      public:
+        using ClearKernel = Shader<1, Buffer<uint>, uint>;
+
+        U<ClearKernel> compile(Device& device)
+        {
+            U<ClearKernel> ms_clear_shader = nullptr;
+            lazy_compile(device,
+                         ms_clear_shader,
+                         [&](BufferVar<uint> d_buffer, UInt num_elements)
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             UInt global_id = block_id().x * block_size().x + thread_id().x;
+                             $if(global_id < num_elements)
+                             {
+                                 d_buffer.write(global_id, 0u);
+                             };
+                         });
+            return ms_clear_shader;
+        };
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
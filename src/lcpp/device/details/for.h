@@ -0,0 +1,163 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 17:32:18
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 17:32:18
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/runtime/core.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    class ForModule : public LuisaModule
+    {
+      public:
+        static constexpr uint TILE_ITEMS = BLOCK_SIZE * ITEMS_PER_THREAD;
+
+        // data, num items, then the runtime parameters of the operator
+        template <typename Type>
+        using ForEachKernel = Shader<1, Buffer<Type>, uint, float4>;
+        // num items, the runtime parameters of the operator, then the buffers it writes
+        template <typename... Ts>
+        using BulkKernel = Shader<1, uint, float4, Buffer<Ts>...>;
+        // extents, the runtime parameters of the operator, then the buffers it writes
+        template <typename... Ts>
+        using ExtentsKernel = Shader<1, uint3, float4, Buffer<Ts>...>;
+        // data, num items, fill value or first value of the sequence
+        template <typename Type>
+        using FillKernel = Shader<1, Buffer<Type>, uint, Type>;
+
+        /**
+         * @brief One tile of TILE_ITEMS per block, striped over the threads so that loads coalesce.
+         *
+         * Only the last tile can be partial, full tiles run the unrolled loop without bounds checks.
+         */
+        template <typename F>
+        static void ForTile(const UInt& num_items, F&& body)
+        {
+            UInt tile_offset = block_id().x * UInt(TILE_ITEMS);
+            $if(tile_offset + UInt(TILE_ITEMS) <= num_items)
+            {
+                for(auto i = 0u; i < ITEMS_PER_THREAD; ++i)
+                {
+                    body(tile_offset + UInt(i * BLOCK_SIZE) + thread_id().x);
+                }
+            }
+            $else
+            {
+                for(auto i = 0u; i < ITEMS_PER_THREAD; ++i)
+                {
+                    UInt index = tile_offset + UInt(i * BLOCK_SIZE) + thread_id().x;
+                    $if(index < num_items)
+                    {
+                        body(index);
+                    };
+                }
+            };
+        }
+
+        template <typename Type, typename ForOp>
+        U<ForEachKernel<Type>> compile_for_each(Device& device, ForOp op)
+        {
+            U<ForEachKernel<Type>> ms_for_each_shader = nullptr;
+            lazy_compile(device,
+                         ms_for_each_shader,
+                         [&](BufferVar<Type> d_data, UInt num_items, Float4 op_params) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             auto bound_op = bind_op_params(op, op_params);
+                             ForTile(num_items,
+                                     [&](const UInt& index)
+                                     {
+                                         Var<Type> item = d_data.read(index);
+                                         bound_op(item);
+                                         d_data.write(index, item);
+                                     });
+                         });
+            return ms_for_each_shader;
+        }
+
+        template <typename... Ts, typename ForOp>
+        U<BulkKernel<Ts...>> compile_bulk(Device& device, ForOp op)
+        {
+            U<BulkKernel<Ts...>> ms_bulk_shader = nullptr;
+            lazy_compile(device,
+                         ms_bulk_shader,
+                         [&](UInt num_items, Float4 op_params, BufferVar<Ts>... buffers) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             auto bound_op = bind_op_params(op, op_params);
+                             ForTile(num_items, [&](const UInt& index) { bound_op(index, buffers...); });
+                         });
+            return ms_bulk_shader;
+        }
+
+        template <typename... Ts, typename ForOp>
+        U<ExtentsKernel<Ts...>> compile_extents(Device& device, ForOp op)
+        {
+            U<ExtentsKernel<Ts...>> ms_extents_shader = nullptr;
+            lazy_compile(device,
+                         ms_extents_shader,
+                         [&](UInt3 extents, Float4 op_params, BufferVar<Ts>... buffers) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             auto bound_op = bind_op_params(op, op_params);
+                             ForTile(extents.x * extents.y * extents.z,
+                                     [&](const UInt& index)
+                                     {
+                                         // row major, x is the fastest dimension
+                                         UInt  plane = extents.x * extents.y;
+                                         UInt3 coord = make_uint3(index % extents.x, index % plane / extents.x, index / plane);
+                                         bound_op(index, coord, buffers...);
+                                     });
+                         });
+            return ms_extents_shader;
+        }
+
+        template <typename Type>
+        U<FillKernel<Type>> compile_fill(Device& device)
+        {
+            U<FillKernel<Type>> ms_fill_shader = nullptr;
+            lazy_compile(device,
+                         ms_fill_shader,
+                         [&](BufferVar<Type> d_data, UInt num_items, Var<Type> value) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             ForTile(num_items, [&](const UInt& index) { d_data.write(index, value); });
+                         });
+            return ms_fill_shader;
+        }
+
+        template <typename Type>
+        U<FillKernel<Type>> compile_sequence(Device& device)
+        {
+            U<FillKernel<Type>> ms_sequence_shader = nullptr;
+            lazy_compile(device,
+                         ms_sequence_shader,
+                         [&](BufferVar<Type> d_data, UInt num_items, Var<Type> init) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             ForTile(num_items,
+                                     [&](const UInt& index) { d_data.write(index, init + cast<Type>(index)); });
+                         });
+            return ms_sequence_shader;
+        }
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
@@ -0,0 +1,94 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 16:30:05
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 16:30:05
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <lcpp/agent/agent_histogram.h>
+#include <lcpp/agent/policy.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/device/details/clear.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    // per channel bin layout and levels, up to four channels
+    template <NumericT SampleT>
+    struct HistogramParams
+    {
+        uint               total_bins   = 0;
+        uint               total_levels = 0;
+        uint4              num_bins{};
+        uint4              bin_offsets{};
+        Vector<SampleT, 4> lower_levels{};
+        Vector<SampleT, 4> upper_levels{};
+        uint4              level_offsets{};
+    };
+
+    template <NumericT SampleT, size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t PIXELS_PER_THREAD = details::ITEMS_PER_THREAD>
+    class HistogramModule : public LuisaModule
+    {
+      public:
+        // 4096 counters (16KB) keep two blocks resident within the 48KB shared memory limit
+        static constexpr size_t PRIVATIZED_BINS = 4096;
+
+        using LevelVecT = Vector<SampleT, 4>;
+        // samples, levels (range bins only), bins, tile queue, num pixels, total bins, then HistogramParams
+        using HistogramKernel =
+            Shader<1, Buffer<SampleT>, Buffer<SampleT>, Buffer<uint>, Buffer<uint>, uint, uint, uint4, uint4, LevelVecT, LevelVecT, uint4>;
+
+        template <bool IS_EVEN, bool IS_RLE_COMPRESS, bool IS_WORK_STEALING>
+        U<HistogramKernel> compile(Device& device)
+        {
+            using HistogramPolicy = AgentHistogramPolicy<BLOCK_SIZE, PIXELS_PER_THREAD, IS_RLE_COMPRESS, IS_WORK_STEALING>;
+            using AgentT =
+                AgentHistogram<HistogramPolicy, SampleT, NUM_CHANNELS, NUM_ACTIVE_CHANNELS, IS_EVEN, PRIVATIZED_BINS>;
+
+            U<HistogramKernel> ms_histogram_shader = nullptr;
+            lazy_compile(device,
+                         ms_histogram_shader,
+                         [&](BufferVar<SampleT> d_samples,
+                             BufferVar<SampleT> d_levels,
+                             BufferVar<uint>    d_bins,
+                             BufferVar<uint>    d_tile_queue,
+                             UInt               num_pixels,
+                             UInt               total_bins,
+                             Var<uint4>         num_bins,
+                             Var<uint4>         bin_offsets,
+                             Var<LevelVecT>     lower_levels,
+                             Var<LevelVecT>     upper_levels,
+                             Var<uint4>         level_offsets) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             AgentT agent(d_samples,
+                                          d_levels,
+                                          d_bins,
+                                          d_tile_queue,
+                                          num_pixels,
+                                          total_bins,
+                                          num_bins,
+                                          bin_offsets,
+                                          lower_levels,
+                                          upper_levels,
+                                          level_offsets);
+                             agent.Process();
+                         });
+            return ms_histogram_shader;
+        }
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
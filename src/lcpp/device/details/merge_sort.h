@@ -0,0 +1,286 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 21:24:51
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 21:24:51
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/block/block_merge_sort.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    // keys and values may be any type the DSL can hold in a buffer, structs included
+    template <typename KeyType, typename ValueType, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    class MergeSortModule : public LuisaModule
+    {
+      public:
+        static constexpr uint TILE_ITEMS = BLOCK_SIZE * ITEMS_PER_THREAD;
+
+        // keys in, values in, keys out, values out, num items, comparator params
+        using BlockSortKernel = Shader<1, Buffer<KeyType>, Buffer<ValueType>, Buffer<KeyType>, Buffer<ValueType>, uint, float4>;
+        // keys, merge partitions, num items, num partitions, merged tiles per group after the pass, comparator params
+        using PartitionKernel = Shader<1, Buffer<KeyType>, Buffer<uint>, uint, uint, uint, float4>;
+        // keys in, values in, keys out, values out, merge partitions, num items, merged tiles per group, comparator params
+        using MergeKernel =
+            Shader<1, Buffer<KeyType>, Buffer<ValueType>, Buffer<KeyType>, Buffer<ValueType>, Buffer<uint>, uint, uint, float4>;
+
+        // sorts every tile on its own
+        template <bool KEYS_ONLY, typename CompareOp>
+        U<BlockSortKernel> compile_block_sort(Device& device, CompareOp compare_op)
+        {
+            U<BlockSortKernel> ms_block_sort_shader = nullptr;
+
+            lazy_compile(device,
+                         ms_block_sort_shader,
+                         [&](BufferVar<KeyType>   d_keys_in,
+                             BufferVar<ValueType> d_values_in,
+                             BufferVar<KeyType>   d_keys_out,
+                             BufferVar<ValueType> d_values_out,
+                             UInt                 num_item,
+                             Float4               compare_params) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             UInt thid        = thread_id().x;
+                             UInt tile_start  = block_id().x * UInt(TILE_ITEMS);
+                             UInt valid_items = min(num_item - tile_start, UInt(TILE_ITEMS));
+
+                             auto bound_compare_op = bind_op_params(compare_op, compare_params);
+
+                             ArrayVar<KeyType, ITEMS_PER_THREAD>   keys;
+                             ArrayVar<ValueType, ITEMS_PER_THREAD> values;
+                             for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                             {
+                                 UInt index = thid * UInt(ITEMS_PER_THREAD) + item;
+                                 $if(index < valid_items)
+                                 {
+                                     keys[item] = d_keys_in.read(tile_start + index);
+                                     if constexpr(!KEYS_ONLY)
+                                     {
+                                         values[item] = d_values_in.read(tile_start + index);
+                                     }
+                                 };
+                             };
+
+                             if constexpr(KEYS_ONLY)
+                             {
+                                 BlockMergeSort<KeyType, BLOCK_SIZE, ITEMS_PER_THREAD>().Sort(keys, bound_compare_op, valid_items);
+                             }
+                             else
+                             {
+                                 BlockMergeSort<KeyType, BLOCK_SIZE, ITEMS_PER_THREAD>().Sort(
+                                     keys, values, bound_compare_op, valid_items);
+                             }
+
+                             for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                             {
+                                 UInt index = thid * UInt(ITEMS_PER_THREAD) + item;
+                                 $if(index < valid_items)
+                                 {
+                                     d_keys_out.write(tile_start + index, keys[item]);
+                                     if constexpr(!KEYS_ONLY)
+                                     {
+                                         d_values_out.write(tile_start + index, values[item]);
+                                     }
+                                 };
+                             };
+                         });
+
+            return ms_block_sort_shader;
+        }
+
+        // one thread per tile boundary, finds where the merge path of the tile group crosses it
+        template <typename CompareOp>
+        U<PartitionKernel> compile_partition(Device& device, CompareOp compare_op)
+        {
+            U<PartitionKernel> ms_partition_shader = nullptr;
+
+            lazy_compile(device,
+                         ms_partition_shader,
+                         [&](BufferVar<KeyType> d_keys,
+                             BufferVar<uint>    d_merge_partitions,
+                             UInt               num_item,
+                             UInt               num_partitions,
+                             UInt               target_merged_tiles,
+                             Float4             compare_params) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             UInt partition_idx = dispatch_id().x;
+                             $if(partition_idx < num_partitions)
+                             {
+                                 auto bound_compare_op = bind_op_params(compare_op, compare_params);
+
+                                 UInt mask           = target_merged_tiles - 1u;
+                                 UInt start          = UInt(TILE_ITEMS) * (partition_idx & ~mask);
+                                 UInt size           = UInt(TILE_ITEMS) * (target_merged_tiles / 2u);
+                                 UInt local_tile_idx = partition_idx & mask;
+
+                                 UInt keys1_beg = min(num_item, start);
+                                 UInt keys1_end = min(num_item, start + size);
+                                 UInt keys2_beg = keys1_end;
+                                 UInt keys2_end = min(num_item, keys2_beg + size);
+
+                                 // the partition one past the last tile only closes the range of the last tile
+                                 $if(partition_idx + 1u == num_partitions)
+                                 {
+                                     d_merge_partitions.write(partition_idx, keys1_end);
+                                 }
+                                 $else
+                                 {
+                                     UInt partition_at   = min(keys2_end - keys1_beg, UInt(TILE_ITEMS) * local_tile_idx);
+                                     UInt partition_diag = MergePath(
+                                         [&](const UInt& i) -> Var<KeyType> { return d_keys.read(keys1_beg + i); },
+                                         [&](const UInt& i) -> Var<KeyType> { return d_keys.read(keys2_beg + i); },
+                                         keys1_end - keys1_beg,
+                                         keys2_end - keys2_beg,
+                                         partition_at,
+                                         bound_compare_op);
+                                     d_merge_partitions.write(partition_idx, keys1_beg + partition_diag);
+                                 };
+                             };
+                         });
+
+            return ms_partition_shader;
+        }
+
+        // every tile merges its slice of two sorted runs of the previous pass
+        template <bool KEYS_ONLY, typename CompareOp>
+        U<MergeKernel> compile_merge(Device& device, CompareOp compare_op)
+        {
+            U<MergeKernel> ms_merge_shader = nullptr;
+
+            lazy_compile(
+                device,
+                ms_merge_shader,
+                [&](BufferVar<KeyType>   d_keys_in,
+                    BufferVar<ValueType> d_values_in,
+                    BufferVar<KeyType>   d_keys_out,
+                    BufferVar<ValueType> d_values_out,
+                    BufferVar<uint>      d_merge_partitions,
+                    UInt                 num_item,
+                    UInt                 target_merged_tiles,
+                    Float4               compare_params) noexcept
+                {
+                    set_block_size(BLOCK_SIZE);
+                    UInt thid          = thread_id().x;
+                    UInt tile_idx      = block_id().x;
+                    UInt tile_base     = tile_idx * UInt(TILE_ITEMS);
+                    UInt items_in_tile = min(UInt(TILE_ITEMS), num_item - tile_base);
+
+                    auto bound_compare_op = bind_op_params(compare_op, compare_params);
+
+                    UInt partition_beg = d_merge_partitions.read(tile_idx);
+                    UInt partition_end = d_merge_partitions.read(tile_idx + 1u);
+
+                    UInt mask  = target_merged_tiles - 1u;
+                    UInt start = UInt(TILE_ITEMS) * (tile_idx & ~mask);
+                    UInt size  = UInt(TILE_ITEMS) * (target_merged_tiles / 2u);
+                    UInt diag  = tile_base - start;
+
+                    // keys1 and keys2 of this tile, relative to the start of the tile group
+                    UInt keys1_beg = partition_beg - start;
+                    UInt keys1_end = partition_end - start;
+                    UInt max_keys2 = select(0u, num_item - start - size, num_item - start > size);
+                    UInt keys2_beg = min(max_keys2, diag - keys1_beg);
+                    UInt keys2_end = min(max_keys2, diag + UInt(TILE_ITEMS) - keys1_end);
+                    $if((tile_idx & mask) == mask)
+                    {
+                        // the last tile of the group takes the rest of both runs
+                        keys1_end = min(num_item - start, size);
+                        keys2_end = min(max_keys2, size);
+                    };
+                    UInt num_keys1 = keys1_end - keys1_beg;
+                    UInt num_keys2 = keys2_end - keys2_beg;
+
+                    // one extra slot, the serial merge reads one key past its range
+                    SmemTypePtr<KeyType> s_keys = new SmemType<KeyType>{TILE_ITEMS + 1};
+                    for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                    {
+                        UInt index = UInt(item * BLOCK_SIZE) + thid;
+                        $if(index < num_keys1)
+                        {
+                            (*s_keys)[index] = d_keys_in.read(start + keys1_beg + index);
+                        }
+                        $elif(index < num_keys1 + num_keys2)
+                        {
+                            (*s_keys)[index] = d_keys_in.read(start + size + keys2_beg + index - num_keys1);
+                        };
+                    };
+                    sync_block();
+
+                    UInt diag_loc      = min(num_keys1 + num_keys2, thid * UInt(ITEMS_PER_THREAD));
+                    UInt keys1_beg_loc = MergePath([&](const UInt& i) -> Var<KeyType> { return (*s_keys)[i]; },
+                                                   [&](const UInt& i) -> Var<KeyType> { return (*s_keys)[num_keys1 + i]; },
+                                                   num_keys1,
+                                                   num_keys2,
+                                                   diag_loc,
+                                                   bound_compare_op);
+                    UInt keys2_beg_loc = diag_loc - keys1_beg_loc;
+
+                    ArrayVar<KeyType, ITEMS_PER_THREAD> keys;
+                    ArrayVar<uint, ITEMS_PER_THREAD>    indices;
+                    SerialMerge<KeyType, ITEMS_PER_THREAD>(s_keys,
+                                                           keys1_beg_loc,
+                                                           keys2_beg_loc + num_keys1,
+                                                           num_keys1 - keys1_beg_loc,
+                                                           num_keys2 - keys2_beg_loc,
+                                                           keys,
+                                                           indices,
+                                                           bound_compare_op);
+
+                    for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                    {
+                        UInt index = thid * UInt(ITEMS_PER_THREAD) + item;
+                        $if(index < items_in_tile)
+                        {
+                            d_keys_out.write(tile_base + index, keys[item]);
+                        };
+                    };
+
+                    if constexpr(!KEYS_ONLY)
+                    {
+                        // the values follow the keys through the merge indices
+                        SmemTypePtr<ValueType> s_values = new SmemType<ValueType>{TILE_ITEMS};
+                        for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                        {
+                            UInt index = UInt(item * BLOCK_SIZE) + thid;
+                            $if(index < num_keys1)
+                            {
+                                (*s_values)[index] = d_values_in.read(start + keys1_beg + index);
+                            }
+                            $elif(index < num_keys1 + num_keys2)
+                            {
+                                (*s_values)[index] = d_values_in.read(start + size + keys2_beg + index - num_keys1);
+                            };
+                        };
+                        sync_block();
+
+                        for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                        {
+                            UInt index = thid * UInt(ITEMS_PER_THREAD) + item;
+                            $if(index < items_in_tile)
+                            {
+                                d_values_out.write(tile_base + index, (*s_values)[indices[item]]);
+                            };
+                        };
+                    }
+                });
+
+            return ms_merge_shader;
+        }
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
@@ -0,0 +1,279 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 19:12:54
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 19:12:54
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/common/iterator.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/block/block_load.h>
+#include <lcpp/block/block_scan.h>
+#include <lcpp/device/details/single_pass_scan_operator.h>
+#include <lcpp/device/details/tile_look_back_scan.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    template <NumericT Type4Byte, NumericT FlagT = uint, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD, bool PACKED_TILE_STATE = true>
+    class PartitionModule : public LuisaModule
+    {
+      public:
+        // two-way: the look-back carries the number of selected items
+        using TwoWayTileState = ScanTileStateStorage<uint, PACKED_TILE_STATE>;
+        // three-way: key counts the first part, value the second part, one 128-bit word when packed
+        using ThreeWayCountT    = KeyValuePair<uint, uint>;
+        using ThreeWayTileState = ScanTileStateStorage<ThreeWayCountT, PACKED_TILE_STATE>;
+
+        using TwoWayTileStateInitKernel   = Shader<1, Buffer<TwoWayTileState>, int>;
+        using ThreeWayTileStateInitKernel = Shader<1, Buffer<ThreeWayTileState>, int>;
+
+        // only the flagged partition reads a flags buffer, If has no such argument
+        template <bool USE_FLAGS>
+        using FlagParams = std::conditional_t<USE_FLAGS, ParamList<Buffer<FlagT>>, ParamList<>>;
+
+        // tile states, items, flags (flagged only), partitioned items, num selected, num items, select op params
+        template <bool USE_FLAGS>
+        using PartitionKernel = ShaderOfParams<ParamList<Buffer<TwoWayTileState>, Buffer<Type4Byte>>,
+                                               FlagParams<USE_FLAGS>,
+                                               ParamList<Buffer<Type4Byte>, Buffer<uint>, uint, float4>>;
+        // tile states, items, first part, second part, unselected, num selected (two counts), num items, select op params
+        using ThreeWayPartitionKernel =
+            Shader<1, Buffer<ThreeWayTileState>, Buffer<Type4Byte>, Buffer<Type4Byte>, Buffer<Type4Byte>, Buffer<Type4Byte>, Buffer<uint>, uint, float4, float4>;
+
+        template <typename TileStateT>
+        U<Shader<1, Buffer<TileStateT>, int>> compile_scan_tile_state_init(Device& device)
+        {
+            U<Shader<1, Buffer<TileStateT>, int>> ms_scan_tile_state_init_shader = nullptr;
+
+            lazy_compile(device,
+                         ms_scan_tile_state_init_shader,
+                         [](BufferVar<TileStateT> tile_state, Int num_tiles) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             ScanTileStateViewer::InitializeWardStatus(tile_state, num_tiles);
+                         });
+
+            return ms_scan_tile_state_init_shader;
+        }
+
+        template <bool USE_FLAGS, typename DelayConstructorT = no_delay_constructor<uint>, typename SelectOp>
+        U<PartitionKernel<USE_FLAGS>> compile(Device& device, SelectOp select_op)
+        {
+            U<PartitionKernel<USE_FLAGS>> ms_partition_shader = nullptr;
+
+            [&]<typename... Flag>(ParamList<Flag...>)
+            {
+                lazy_compile(
+                    device,
+                    ms_partition_shader,
+                    [&](BufferVar<TwoWayTileState> tile_state,
+                        BufferVar<Type4Byte>       d_in,
+                        Var<Flag>...               d_flags,
+                        BufferVar<Type4Byte>       d_out,
+                        BufferVar<uint>            d_num_selected_out,
+                        UInt                       num_item,
+                        Float4                     select_params) noexcept
+                    {
+                        set_block_size(BLOCK_SIZE);
+                        UInt thid       = thread_id().x;
+                        UInt tile_id    = block_id().x;
+                        UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+                        UInt tile_start = tile_id * tile_items;
+
+                        UInt num_remaining = num_item - tile_start;
+                        Bool is_last_tile  = num_remaining <= tile_items;
+
+                        ArrayVar<Type4Byte, ITEMS_PER_THREAD> local_items;
+                        LoadTile(d_in, local_items, tile_start, num_remaining, is_last_tile);
+
+                        ArrayVar<uint, ITEMS_PER_THREAD> selection_flags;
+                        if constexpr(USE_FLAGS)
+                        {
+                            ArrayVar<FlagT, ITEMS_PER_THREAD> local_flags;
+                            LoadTile(d_flags..., local_flags, tile_start, num_remaining, is_last_tile);
+                            for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                            {
+                                selection_flags[item] = 0u;
+                                $if(local_flags[item] != FlagT(0))
+                                {
+                                    selection_flags[item] = 1u;
+                                };
+                            };
+                        }
+                        else
+                        {
+                            auto bound_select_op = bind_op_params(select_op, select_params);
+                            for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                            {
+                                selection_flags[item] = 0u;
+                                $if(thid * UInt(ITEMS_PER_THREAD) + item < num_remaining)
+                                {
+                                    $if(bound_select_op(local_items[item]))
+                                    {
+                                        selection_flags[item] = 1u;
+                                    };
+                                };
+                            };
+                        }
+
+                        // global rank of every selected item and the selected count through this tile
+                        ArrayVar<uint, ITEMS_PER_THREAD> selection_indices;
+                        Var<uint>                        num_selected;
+                        TileLookBackScan<uint, BLOCK_SIZE, ITEMS_PER_THREAD>::template ExclusiveScan<DelayConstructorT>(
+                            tile_state, selection_flags, selection_indices, num_selected, SumOp(), tile_id, is_last_tile, def(0u));
+
+                        for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                        {
+                            UInt index = tile_start + thid * UInt(ITEMS_PER_THREAD) + item;
+                            $if(index < num_item)
+                            {
+                                $if(selection_flags[item] == 1u)
+                                {
+                                    d_out.write(selection_indices[item], local_items[item]);
+                                }
+                                $else
+                                {
+                                    // rejected items fill the tail back to front
+                                    UInt num_rejected_before = index - selection_indices[item];
+                                    d_out.write(num_item - 1u - num_rejected_before, local_items[item]);
+                                };
+                            };
+                        };
+
+                        $if(is_last_tile & thid == 0)
+                        {
+                            d_num_selected_out.write(0, num_selected);
+                        };
+                    });
+            }(FlagParams<USE_FLAGS>{});
+
+            return ms_partition_shader;
+        }
+
+        template <typename DelayConstructorT = no_delay_constructor<ThreeWayCountT>, typename SelectFirstPartOp, typename SelectSecondPartOp>
+        U<ThreeWayPartitionKernel> compile_three_way(Device& device, SelectFirstPartOp select_first_part_op, SelectSecondPartOp select_second_part_op)
+        {
+            U<ThreeWayPartitionKernel> ms_three_way_partition_shader = nullptr;
+
+            lazy_compile(
+                device,
+                ms_three_way_partition_shader,
+                [&](BufferVar<ThreeWayTileState> tile_state,
+                    BufferVar<Type4Byte>         d_in,
+                    BufferVar<Type4Byte>         d_first_part_out,
+                    BufferVar<Type4Byte>         d_second_part_out,
+                    BufferVar<Type4Byte>         d_unselected_out,
+                    BufferVar<uint>              d_num_selected_out,
+                    UInt                         num_item,
+                    Float4                       first_part_params,
+                    Float4                       second_part_params) noexcept
+                {
+                    set_block_size(BLOCK_SIZE);
+                    UInt thid       = thread_id().x;
+                    UInt tile_id    = block_id().x;
+                    UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+                    UInt tile_start = tile_id * tile_items;
+
+                    UInt num_remaining = num_item - tile_start;
+                    Bool is_last_tile  = num_remaining <= tile_items;
+
+                    ArrayVar<Type4Byte, ITEMS_PER_THREAD> local_items;
+                    LoadTile(d_in, local_items, tile_start, num_remaining, is_last_tile);
+
+                    auto bound_first_part_op  = bind_op_params(select_first_part_op, first_part_params);
+                    auto bound_second_part_op = bind_op_params(select_second_part_op, second_part_params);
+
+                    // an item goes to the first part that selects it
+                    ArrayVar<ThreeWayCountT, ITEMS_PER_THREAD> part_flags;
+                    for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                    {
+                        part_flags[item].key   = 0u;
+                        part_flags[item].value = 0u;
+                        $if(thid * UInt(ITEMS_PER_THREAD) + item < num_remaining)
+                        {
+                            $if(bound_first_part_op(local_items[item]))
+                            {
+                                part_flags[item].key = 1u;
+                            }
+                            $elif(bound_second_part_op(local_items[item]))
+                            {
+                                part_flags[item].value = 1u;
+                            };
+                        };
+                    };
+
+                    Var<ThreeWayCountT> zero;
+                    zero.key   = 0u;
+                    zero.value = 0u;
+
+                    ArrayVar<ThreeWayCountT, ITEMS_PER_THREAD> part_indices;
+                    Var<ThreeWayCountT>                        num_selected;
+                    TileLookBackScan<ThreeWayCountT, BLOCK_SIZE, ITEMS_PER_THREAD>::template ExclusiveScan<DelayConstructorT>(
+                        tile_state, part_flags, part_indices, num_selected, PairSumOp(), tile_id, is_last_tile, zero);
+
+                    for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                    {
+                        UInt index = tile_start + thid * UInt(ITEMS_PER_THREAD) + item;
+                        $if(index < num_item)
+                        {
+                            $if(part_flags[item].key == 1u)
+                            {
+                                d_first_part_out.write(part_indices[item].key, local_items[item]);
+                            }
+                            $elif(part_flags[item].value == 1u)
+                            {
+                                d_second_part_out.write(part_indices[item].value, local_items[item]);
+                            }
+                            $else
+                            {
+                                d_unselected_out.write(index - part_indices[item].key - part_indices[item].value,
+                                                       local_items[item]);
+                            };
+                        };
+                    };
+
+                    $if(is_last_tile & thid == 0)
+                    {
+                        d_num_selected_out.write(0, num_selected.key);
+                        d_num_selected_out.write(1, num_selected.value);
+                    };
+                });
+
+            return ms_three_way_partition_shader;
+        }
+
+      private:
+        template <typename T>
+        static void LoadTile(const BufferVar<T>&            d_in,
+                             ArrayVar<T, ITEMS_PER_THREAD>& items,
+                             const UInt&                    tile_start,
+                             const UInt&                    num_remaining,
+                             const Bool&                    is_last_tile)
+        {
+            // blocked arrangement, out of range items are loaded as zero
+            $if(is_last_tile)
+            {
+                BlockLoad<T, BLOCK_SIZE, ITEMS_PER_THREAD>().Load(d_in, items, tile_start, num_remaining);
+            }
+            $else
+            {
+                BlockLoad<T, BLOCK_SIZE, ITEMS_PER_THREAD>().Load(d_in, items, tile_start);
+            };
+        }
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
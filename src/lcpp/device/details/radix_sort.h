@@ -24,6 +24,7 @@
 #include <lcpp/common/type_trait.h>
 #include <lcpp/runtime/core.h>
 #include <lcpp/block/block_scan.h>
+#include <lcpp/device/details/clear.h>
 
 namespace luisa::parallel_primitive
 {
@@ -11,10 +11,13 @@
 #include <luisa/dsl/func.h>
 #include <luisa/dsl/var.h>
 #include <luisa/dsl/builtin.h>
+#include <lcpp/agent/agent_reduce.h>
+#include <lcpp/common/grid_even_shared.h>
 #include <lcpp/common/util_type.h>
 #include <lcpp/common/utils.h>
 #include <lcpp/common/thread_operators.h>
 #include <lcpp/common/type_trait.h>
+#include <lcpp/common/iterator.h>
 #include <lcpp/runtime/core.h>
 
 namespace luisa::parallel_primitive
@@ -27,29 +30,9 @@ namespace details
     class ArgReduce : public LuisaModule
     {
       public:
-        using ArgConstructShaderT = Shader<1, Buffer<Type4Byte>, Buffer<IndexValuePairT<Type4Byte>>>;
-
         using ArgAssignShaderT =
             Shader<1, Buffer<IndexValuePairT<Type4Byte>>, Buffer<Type4Byte>, Buffer<uint>>;
 
-        U<ArgConstructShaderT> compile_arg_construct_shader(Device& device)
-        {
-            U<ArgConstructShaderT> ms_arg_construct_shader = nullptr;
-            lazy_compile(device,
-                         ms_arg_construct_shader,
-                         [&](BufferVar<Type4Byte> arr_in, BufferVar<IndexValuePairT<Type4Byte>> g_kv_out)
-                         {
-                             set_block_size(BLOCK_SIZE);
-                             Int global_id = Int(block_id().x * block_size().x + thread_id().x);
-
-                             Var<IndexValuePairT<Type4Byte>> initial{0, 0};
-                             initial.key   = global_id;
-                             initial.value = arr_in.read(global_id);
-                             g_kv_out.write(global_id, initial);
-                         });
-            return ms_arg_construct_shader;
-        }
-
         U<ArgAssignShaderT> compile_arg_assign_shader(Device& device)
         {
             U<ArgAssignShaderT> ms_arg_assign_shader = nullptr;
@@ -71,106 +54,225 @@ namespace details
     };
 
 
-    template <NumericTOrKeyValuePairT DataType, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    // largest tile of the deterministic reduction, 8KB of float
+    inline constexpr uint DETERMINISTIC_REDUCE_TILE_ITEMS = 2048u;
+    // shared memory a deterministic tile may hold, the smallest block budget of the supported backends (Metal)
+    inline constexpr size_t DETERMINISTIC_REDUCE_SMEM_BYTES = 32u * 1024u;
+
+    // tile size of the deterministic reduction for one accumulator type, a constant of the type alone
+    // so the tree does not follow BLOCK_SIZE, the grid or the device; wide accumulators (double stats) get smaller tiles
+    template <typename T>
+    constexpr uint deterministic_reduce_tile_items()
+    {
+        uint tile_items = DETERMINISTIC_REDUCE_TILE_ITEMS;
+        while(tile_items > 1u && tile_items * sizeof(T) > DETERMINISTIC_REDUCE_SMEM_BYTES)
+        {
+            tile_items /= 2u;
+        }
+        return tile_items;
+    }
+
+    // element inputs are read from a buffer, iterator inputs bring their own kernel arguments
+    template <typename InputT>
+    struct reduce_input_traits
+    {
+        using params      = ParamList<Buffer<InputT>>;
+        using AgentInputT = InputT;
+    };
+
+    template <IteratorT InputT>
+    struct reduce_input_traits<InputT>
+    {
+        using params      = typename InputT::params;
+        using AgentInputT = typename InputT::DeviceIterator;
+    };
+
+    template <ReduceAccumulatorT DataType, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD, size_t WARP_SIZE = details::WARP_SIZE, typename InputT = DataType>
     class ReduceModule : public LuisaModule
     {
       public:
-        using ReduceShaderKernel = Shader<1, Buffer<DataType>, Buffer<DataType>, uint, uint, uint, DataType>;
+        // grid pass: every block reduces its even share of the input into one partial
+        // the trailing float4 arguments are the runtime parameters of the reduce and transform operators
+        // an InputT other than DataType is lifted while loading (values into index value pairs for arg reductions),
+        // a host iterator InputT is rebound inside the kernel from its own arguments
+        using InputParams = typename reduce_input_traits<InputT>::params;
+        using ReduceShaderKernel =
+            ShaderOfParams<InputParams, ParamList<Buffer<DataType>, GridEvenShared, float4, float4>>;
+        // final pass: one block folds the partials and the initial value
+        using ReduceSingleTileKernel = Shader<1, Buffer<DataType>, Buffer<DataType>, uint, DataType, float4>;
+        // deterministic pass: one partial per deterministic_reduce_tile_items<DataType>() tile, folded by a pairwise tree
+        // that only depends on the item indices, the uint flag folds the initial value into the last pass
+        using DeterministicReduceKernel =
+            ShaderOfParams<InputParams, ParamList<Buffer<DataType>, uint, DataType, uint, float4, float4>>;
+
+        template <typename ReduceOp, typename TransformOp = IdentityOp, typename AgentInputT = DataType>
+        using AgentReduceT =
+            AgentReduce<DataType, ReduceOp, TransformOp, BLOCK_SIZE, ITEMS_PER_THREAD, WARP_SIZE, AgentInputT>;
+
+        ReduceModule() = default;
+        explicit ReduceModule(InputT input)
+            requires IteratorT<InputT>
+            : m_input(input)
+        {
+        }
 
         template <typename ReduceOp, typename TransformOp>
         U<ReduceShaderKernel> compile(Device& device, size_t shared_mem_size, ReduceOp reduce_op, TransformOp transform_op)
         {
-            // for reduce
-            auto load_shared_chunk_from_mem = [&](SmemTypePtr<DataType>& s_data,
-                                                  BufferVar<DataType>&   g_idata,
-                                                  UInt                   n,
-                                                  UInt                   baseIndex,
-                                                  Var<DataType>          initial_value)
-            {
-                UInt thread_id_x = thread_id().x;
-                UInt block_id_x  = block_id().x;
-                UInt block_dim_x = block_size_x();
-
-                for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
-                {
-                    UInt          shared_idx = thread_id_x + item * block_dim_x;
-                    UInt          global_idx = baseIndex + shared_idx;
-                    Var<DataType> data       = initial_value;
-                    $if(global_idx < n)
-                    {
-                        data = g_idata.read(global_idx);
-                    };
-
-                    Int bank_offset                     = conflict_free_offset(shared_idx);
-                    (*s_data)[shared_idx + bank_offset] = transform_op(data);
-                };
-            };
-
-            auto reduce_block = [&](SmemTypePtr<DataType>& s_data, BufferVar<DataType>& block_sums, UInt block_index)
-            {
-                $if(block_index == 0)
-                {
-                    block_index = block_id().x;
-                };
-                // build the op in place up the tree
-                UInt thid   = thread_id().x;
-                UInt stride = def(1);
-                // build the sum in place up the tree
-                UInt d = block_size_x();
-                $while(d > 0)
-                {
-                    sync_block();
-                    $if(thid < d)
-                    {
-                        UInt i  = (stride * 2) * thid;
-                        UInt ai = i + stride - 1;
-                        UInt bi = ai + stride;
-
-                        ai += conflict_free_offset(ai);
-                        bi += conflict_free_offset(bi);
-                        $if(bi < UInt(shared_mem_size) & ai < UInt(shared_mem_size))
-                        {
-                            (*s_data)[bi] = reduce_op((*s_data)[ai], (*s_data)[bi]);
-                        };
-                    };
-                    stride *= 2;
-                    d = d >> 1;
-                };
-
-                $if(thid == 0)
-                {
-                    UInt index = block_size_x() * UInt(ITEMS_PER_THREAD) - 1;
-                    index += conflict_free_offset(index);
-                    block_sums.write(block_index, (*s_data)[index]);
-                };
-            };
-
-            //  reduce
+            using AgentInputT = typename reduce_input_traits<InputT>::AgentInputT;
+
             U<ReduceShaderKernel> ms_reduce_shader = nullptr;
+            [&]<typename... In>(ParamList<In...>)
+            {
+                lazy_compile(device,
+                             ms_reduce_shader,
+                             [&](Var<In>... in_params,
+                                 BufferVar<DataType> d_block_out,
+                                 Var<GridEvenShared> even_share,
+                                 Float4              reduce_params,
+                                 Float4              transform_params) noexcept
+                             {
+                                 set_block_size(BLOCK_SIZE);
+                                 even_share->BlockInit<BLOCK_SIZE * ITEMS_PER_THREAD>();
+
+                                 auto bound_reduce_op    = bind_op_params(reduce_op, reduce_params);
+                                 auto bound_transform_op = bind_op_params(transform_op, transform_params);
+                                 decltype(auto) d_in     = bind_input(in_params...);
+
+                                 SmemTypePtr<DataType> s_data = new SmemType<DataType>{shared_mem_size};
+                                 Var<DataType>         block_aggregate =
+                                     AgentReduceT<decltype(bound_reduce_op), decltype(bound_transform_op), AgentInputT>(
+                                         s_data, d_in, bound_reduce_op, bound_transform_op)
+                                         .ConsumeRange(even_share);
+
+                                 $if(thread_id().x == 0)
+                                 {
+                                     d_block_out.write(block_id().x, block_aggregate);
+                                 };
+                             });
+            }(InputParams{});
+            return ms_reduce_shader;
+        }
+
+        template <typename ReduceOp>
+        U<ReduceSingleTileKernel> compile_single_tile(Device& device, size_t shared_mem_size, ReduceOp reduce_op)
+        {
+            U<ReduceSingleTileKernel> ms_reduce_single_tile_shader = nullptr;
             lazy_compile(device,
-                         ms_reduce_shader,
-                         [&](BufferVar<DataType> g_idata,
-                             BufferVar<DataType> g_block_sums,
-                             UInt                num_elements,
-                             UInt                block_index,
-                             UInt                base_index,
-                             Var<DataType>       initial_value) noexcept
+                         ms_reduce_single_tile_shader,
+                         [&](BufferVar<DataType> d_in,
+                             BufferVar<DataType> d_out,
+                             UInt                num_items,
+                             Var<DataType>       initial_value,
+                             Float4              reduce_params) noexcept
                          {
                              set_block_size(BLOCK_SIZE);
-                             UInt                  block_id_x  = block_id().x;
-                             UInt                  block_dim_x = block_size_x();
+                             auto bound_reduce_op = bind_op_params(reduce_op, reduce_params);
+                             $if(num_items == 0)
+                             {
+                                 $if(thread_id().x == 0)
+                                 {
+                                     d_out.write(0u, initial_value);
+                                 };
+                                 return;
+                             };
+
                              SmemTypePtr<DataType> s_data = new SmemType<DataType>{shared_mem_size};
+                             Var<DataType>         block_aggregate =
+                                 AgentReduceT<decltype(bound_reduce_op)>(s_data, d_in, bound_reduce_op).ConsumeRange(UInt(0u), num_items);
 
-                             $if(base_index == 0)
+                             $if(thread_id().x == 0)
                              {
-                                 base_index = block_id_x * (block_dim_x * UInt(ITEMS_PER_THREAD));
+                                 d_out.write(0u, bound_reduce_op(initial_value, block_aggregate));
                              };
-                             load_shared_chunk_from_mem(s_data, g_idata, num_elements, base_index, initial_value);
-                             reduce_block(s_data, g_block_sums, block_index);
                          });
+            return ms_reduce_single_tile_shader;
+        }
 
-            return ms_reduce_shader;
+        template <typename ReduceOp, typename TransformOp>
+        U<DeterministicReduceKernel> compile_deterministic(Device& device, ReduceOp reduce_op, TransformOp transform_op)
+        {
+            using AgentInputT         = typename reduce_input_traits<InputT>::AgentInputT;
+            constexpr uint TILE_ITEMS = deterministic_reduce_tile_items<DataType>();
+            static_assert(TILE_ITEMS * sizeof(DataType) <= DETERMINISTIC_REDUCE_SMEM_BYTES,
+                          "deterministic reduce tile exceeds the shared memory budget");
+
+            U<DeterministicReduceKernel> ms_deterministic_reduce_shader = nullptr;
+            [&]<typename... In>(ParamList<In...>)
+            {
+                lazy_compile(device,
+                             ms_deterministic_reduce_shader,
+                             [&](Var<In>... in_params,
+                                 BufferVar<DataType> d_out,
+                                 UInt                num_items,
+                                 Var<DataType>       initial_value,
+                                 UInt                fold_initial_value,
+                                 Float4              reduce_params,
+                                 Float4              transform_params) noexcept
+                             {
+                                 set_block_size(BLOCK_SIZE);
+                                 auto bound_reduce_op    = bind_op_params(reduce_op, reduce_params);
+                                 auto bound_transform_op = bind_op_params(transform_op, transform_params);
+                                 decltype(auto) d_in     = bind_input(in_params...);
+
+                                 ReduceInput<DataType, AgentInputT> input{d_in};
+                                 SmemTypePtr<DataType>              s_data = new SmemType<DataType>{TILE_ITEMS};
+
+                                 UInt tile_offset = block_id().x * UInt(TILE_ITEMS);
+                                 UInt valid_items = min(num_items - tile_offset, UInt(TILE_ITEMS));
+                                 $for(i, thread_id().x, valid_items, UInt(BLOCK_SIZE))
+                                 {
+                                     (*s_data)[i] = bound_transform_op(input.read(tile_offset + i));
+                                 };
+
+                                 // item i absorbs item i + stride at every level, threads only decide who does the work
+                                 for(uint stride = 1u; stride < TILE_ITEMS; stride *= 2u)
+                                 {
+                                     sync_block();
+                                     $for(i, thread_id().x * (2u * stride), valid_items, UInt(BLOCK_SIZE * 2u * stride))
+                                     {
+                                         $if(i + stride < valid_items)
+                                         {
+                                             (*s_data)[i] = bound_reduce_op((*s_data)[i], (*s_data)[i + stride]);
+                                         };
+                                     };
+                                 }
+                                 sync_block();
+
+                                 $if(thread_id().x == 0)
+                                 {
+                                     Var<DataType> tile_aggregate = (*s_data)[0];
+                                     $if(valid_items == 0)
+                                     {
+                                         tile_aggregate = initial_value;
+                                     }
+                                     $elif(fold_initial_value != 0u)
+                                     {
+                                         tile_aggregate = bound_reduce_op(initial_value, tile_aggregate);
+                                     };
+                                     d_out.write(block_id().x, tile_aggregate);
+                                 };
+                             });
+            }(InputParams{});
+            return ms_deterministic_reduce_shader;
         }
+
+      private:
+        template <typename... In>
+        decltype(auto) bind_input(Var<In>&... in_params)
+        {
+            if constexpr(IteratorT<InputT>)
+            {
+                return m_input.bind(param_exprs_t<InputParams>{in_params...});
+            }
+            else
+            {
+                return (in_params, ...);
+            }
+        }
+
+        // the host iterator the grid pass rebinds, unused for buffer inputs
+        InputT m_input{};
     };
 };  // namespace details
 }  // namespace luisa::parallel_primitive
\ No newline at end of file
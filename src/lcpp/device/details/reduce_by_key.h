@@ -29,11 +29,11 @@ namespace details
 {
     using namespace luisa::compute;
 
-    template <NumericT KeyType, NumericT ValueType, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    template <NumericT KeyType, NumericT ValueType, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD, bool PACKED_TILE_STATE = true>
     class ReduceByKeyModule : public LuisaModule
     {
       public:
-        using ScanTileState = ScanTileState<KeyValuePair<int, ValueType>>;
+        using ScanTileState = ScanTileStateStorage<KeyValuePair<int, ValueType>, PACKED_TILE_STATE>;
 
         using ReduceByKeyKernel =
             Shader<1, Buffer<ScanTileState>, Buffer<KeyType>, Buffer<ValueType>, Buffer<KeyType>, Buffer<ValueType>, Buffer<uint>, uint>;
@@ -56,13 +56,13 @@ namespace details
             return ms_scan_tile_state_init_shader;
         }
 
-        template <typename ReduceOp>
+        template <typename DelayConstructorT = no_delay_constructor<KeyValuePair<int, ValueType>>, typename ReduceOp>
         U<ReduceByKeyKernel> compile(Device& device, size_t shared_mem_size, ReduceOp reduce_op)
         {
             ReduceBySegmentOp scan_op{reduce_op};
 
             using TilePrefixOpT =
-                TilePrefixCallbackOp<KeyValuePair<int, ValueType>, ReduceBySegmentOp<ReduceOp>>;
+                TilePrefixCallbackOp<KeyValuePair<int, ValueType>, ReduceBySegmentOp<ReduceOp>, ScanTileState, DelayConstructorT>;
 
             auto scatter = [&](const ArrayVar<KeyValuePair<int, ValueType>, ITEMS_PER_THREAD> scatter_items,
                                const ArrayVar<int, ITEMS_PER_THREAD> segment_flags,
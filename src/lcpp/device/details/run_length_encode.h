@@ -0,0 +1,201 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 20:14:05
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 20:14:05
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/block/block_load.h>
+#include <lcpp/block/block_discontinuity.h>
+#include <lcpp/block/block_scan.h>
+#include <lcpp/device/details/single_pass_scan_operator.h>
+#include <lcpp/device/details/tile_look_back_scan.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    enum class RunLengthMode : uint
+    {
+        ENCODE,            // every run: its value and length
+        NON_TRIVIAL_RUNS,  // runs longer than one item: their offset and length
+    };
+
+    template <NumericT Type4Byte, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD, bool PACKED_TILE_STATE = true>
+    class RunLengthEncodeModule : public LuisaModule
+    {
+      public:
+        // key counts the runs started so far, value the length of the current run
+        using RunCountT     = KeyValuePair<uint, uint>;
+        using ScanTileState = ScanTileStateStorage<RunCountT, PACKED_TILE_STATE>;
+
+        using ScanTileStateInitKernel = Shader<1, Buffer<ScanTileState>, int>;
+
+        // tile states, items, unique values (ENCODE), offsets (NON_TRIVIAL_RUNS), lengths, num runs, num items
+        using RunLengthEncodeKernel =
+            Shader<1, Buffer<ScanTileState>, Buffer<Type4Byte>, Buffer<Type4Byte>, Buffer<uint>, Buffer<uint>, Buffer<uint>, uint>;
+
+        U<ScanTileStateInitKernel> compile_scan_tile_state_init(Device& device)
+        {
+            U<ScanTileStateInitKernel> ms_scan_tile_state_init_shader = nullptr;
+
+            lazy_compile(device,
+                         ms_scan_tile_state_init_shader,
+                         [](BufferVar<ScanTileState> tile_state, Int num_tiles) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             ScanTileStateViewer::InitializeWardStatus(tile_state, num_tiles);
+                         });
+
+            return ms_scan_tile_state_init_shader;
+        }
+
+        template <RunLengthMode MODE, typename DelayConstructorT = no_delay_constructor<RunCountT>>
+        U<RunLengthEncodeKernel> compile(Device& device)
+        {
+            using ScanOp = ReduceBySegmentOp<SumOp>;
+
+            U<RunLengthEncodeKernel> ms_run_length_encode_shader = nullptr;
+
+            lazy_compile(
+                device,
+                ms_run_length_encode_shader,
+                [&](BufferVar<ScanTileState> tile_state,
+                    BufferVar<Type4Byte>     d_in,
+                    BufferVar<Type4Byte>     d_unique_out,
+                    BufferVar<uint>          d_offsets_out,
+                    BufferVar<uint>          d_lengths_out,
+                    BufferVar<uint>          d_num_runs_out,
+                    UInt                     num_item) noexcept
+                {
+                    set_block_size(BLOCK_SIZE);
+                    UInt thid       = thread_id().x;
+                    UInt tile_id    = block_id().x;
+                    UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+                    UInt tile_start = tile_id * tile_items;
+
+                    UInt num_remaining = num_item - tile_start;
+                    Bool is_last_tile  = num_remaining <= tile_items;
+
+                    ArrayVar<Type4Byte, ITEMS_PER_THREAD> local_items;
+                    $if(is_last_tile)
+                    {
+                        BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>().Load(d_in, local_items, tile_start, num_remaining);
+                    }
+                    $else
+                    {
+                        BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>().Load(d_in, local_items, tile_start);
+                    };
+
+                    Var<Type4Byte> tile_predecessor = local_items[0];
+                    Var<Type4Byte> tile_successor   = local_items[ITEMS_PER_THREAD - 1];
+                    $if(thid == 0 & tile_id > 0)
+                    {
+                        tile_predecessor = d_in.read(tile_start - 1u);
+                    };
+                    $if(thid == block_size_x() - 1u & !is_last_tile)
+                    {
+                        tile_successor = d_in.read(tile_start + tile_items);
+                    };
+
+                    ArrayVar<int, ITEMS_PER_THREAD> head_flags;
+                    ArrayVar<int, ITEMS_PER_THREAD> tail_flags;
+                    BlockDiscontinuity<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>().FlagHeadsAndTails(
+                        head_flags,
+                        tile_predecessor,
+                        tail_flags,
+                        tile_successor,
+                        local_items,
+                        [&](const Var<Type4Byte>& a, const Var<Type4Byte>& b) { return a != b; });
+
+                    // blocked arrangement, the first and the last item of the input close their runs
+                    ArrayVar<RunCountT, ITEMS_PER_THREAD> run_items;
+                    for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                    {
+                        UInt index = tile_start + thid * UInt(ITEMS_PER_THREAD) + item;
+                        $if(index == 0u)
+                        {
+                            head_flags[item] = 1;
+                        };
+                        $if(index == num_item - 1u)
+                        {
+                            tail_flags[item] = 1;
+                        };
+
+                        run_items[item].key   = 0u;
+                        run_items[item].value = 0u;
+                        $if(index < num_item)
+                        {
+                            if constexpr(MODE == RunLengthMode::ENCODE)
+                            {
+                                run_items[item].key   = select(0u, 1u, head_flags[item] != 0);
+                                run_items[item].value = 1u;
+                            }
+                            else
+                            {
+                                // single item runs add nothing, the length restarts at every non-trivial run
+                                Bool is_trivial       = head_flags[item] != 0 & tail_flags[item] != 0;
+                                run_items[item].key   = select(0u, 1u, head_flags[item] != 0 & !is_trivial);
+                                run_items[item].value = select(1u, 0u, is_trivial);
+                            }
+                        };
+                    };
+
+                    Var<RunCountT> zero;
+                    zero.key   = 0u;
+                    zero.value = 0u;
+
+                    ArrayVar<RunCountT, ITEMS_PER_THREAD> run_prefix;
+                    Var<RunCountT>                        total_aggregate;
+                    TileLookBackScan<RunCountT, BLOCK_SIZE, ITEMS_PER_THREAD>::template ExclusiveScan<DelayConstructorT>(
+                        tile_state, run_items, run_prefix, total_aggregate, ScanOp(), tile_id, is_last_tile, zero);
+
+                    // a run start writes its value or offset, the end of the run its length
+                    for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                    {
+                        UInt index = tile_start + thid * UInt(ITEMS_PER_THREAD) + item;
+                        $if(index < num_item)
+                        {
+                            Var<RunCountT> run_inclusive = ScanOp()(run_prefix[item], run_items[item]);
+                            $if(run_items[item].key == 1u)
+                            {
+                                if constexpr(MODE == RunLengthMode::ENCODE)
+                                {
+                                    d_unique_out.write(run_prefix[item].key, local_items[item]);
+                                }
+                                else
+                                {
+                                    d_offsets_out.write(run_prefix[item].key, index);
+                                }
+                            };
+                            $if(tail_flags[item] != 0 & run_items[item].value > 0u)
+                            {
+                                d_lengths_out.write(run_inclusive.key - 1u, run_inclusive.value);
+                            };
+                        };
+                    };
+
+                    $if(is_last_tile & thid == 0)
+                    {
+                        d_num_runs_out.write(0, total_aggregate.key);
+                    };
+                });
+
+            return ms_run_length_encode_shader;
+        }
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
@@ -8,6 +8,7 @@
 #pragma once
 #include "luisa/dsl/stmt.h"
 #include <cstddef>
+#include <type_traits>
 #include <luisa/dsl/sugar.h>
 #include <luisa/dsl/func.h>
 #include <luisa/dsl/var.h>
@@ -16,6 +17,7 @@
 #include <lcpp/common/utils.h>
 #include <lcpp/common/thread_operators.h>
 #include <lcpp/common/type_trait.h>
+#include <lcpp/common/iterator.h>
 #include <lcpp/runtime/core.h>
 #include <lcpp/block/block_scan.h>
 #include <lcpp/block/block_load.h>
@@ -28,18 +30,40 @@ namespace details
 {
     using namespace luisa::compute;
 
-    template <NumericT Type4Byte, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    // the tile loads read through InputIt and the stores write through OutputIt, buffers by default
+    template <NumericT Type4Byte,
+              size_t BLOCK_SIZE       = details::BLOCK_SIZE,
+              size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD,
+              IteratorT InputIt       = BufferIterator<Type4Byte>,
+              IteratorT OutputIt      = BufferIterator<Type4Byte>,
+              bool PACKED_TILE_STATE  = true>
     class ScanModule : public LuisaModule
     {
       public:
-        using TileState = ScanTileState<Type4Byte>;
+        using TileState    = ScanTileStateStorage<Type4Byte, PACKED_TILE_STATE>;
+        using InputParams  = typename InputIt::params;
+        using OutputParams = typename OutputIt::params;
 
         using ScanTileStateInitKernel = Shader<1, Buffer<TileState>, int>;
 
-        using ScanKernel = Shader<1, Buffer<TileState>, Buffer<Type4Byte>, Buffer<Type4Byte>, Type4Byte, uint>;
+        using ScanKernel =
+            ShaderOfParams<ParamList<Buffer<TileState>>, InputParams, OutputParams, ParamList<Type4Byte, uint>>;
+
+        // reduce-then-scan: tile aggregates, spine scan over them, then a downsweep seeded per tile
+        using ReduceTileKernel = ShaderOfParams<InputParams, ParamList<Buffer<Type4Byte>>>;
+        using SpineScanKernel  = Shader<1, Buffer<Type4Byte>, Type4Byte, uint>;
+        using DownsweepKernel =
+            ShaderOfParams<ParamList<Buffer<Type4Byte>>, InputParams, OutputParams, ParamList<Type4Byte, uint>>;
+
+        ScanModule() = default;
+        ScanModule(InputIt input, OutputIt output)
+            : m_input(input)
+            , m_output(output)
+        {
+        }
 
         template <typename ScanOP>
-        using TilePrefixOpT = TilePrefixCallbackOp<Type4Byte, ScanOP>;
+        using TilePrefixOpT = TilePrefixCallbackOp<Type4Byte, ScanOP, TileState>;
 
         U<ScanTileStateInitKernel> compile_scan_tile_state_init(Device& device)
         {
@@ -51,91 +75,218 @@ namespace details
             return scan_tile_state_init_shader;
         }
 
-        template <bool is_inclusive, typename ScanOp>
+        template <bool is_inclusive, typename DelayConstructorT = no_delay_constructor<Type4Byte>, typename ScanOp>
         U<ScanKernel> compile(Device& device, size_t shared_mem_size, ScanOp scan_op)
         {
-            U<ScanKernel> scan_shader = nullptr;
-            lazy_compile(
-                device,
-                scan_shader,
-                [&](BufferVar<TileState> tile_state,
-                    BufferVar<Type4Byte> d_in,
-                    BufferVar<Type4Byte> d_out,
-                    Var<Type4Byte>       init_value,
-                    UInt                 num_elements)
-                {
-                    set_block_size(BLOCK_SIZE);
-                    UInt thid       = thread_id().x;
-                    UInt tile_id    = block_id().x;
-                    UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
-                    UInt tile_start = tile_id * tile_items;
-
-                    UInt num_remaining = num_elements - tile_start;
-                    Bool is_last_tile  = num_remaining <= tile_items;
-
-                    ArrayVar<Type4Byte, ITEMS_PER_THREAD> items;
-                    SmemTypePtr<Type4Byte> s_data = new SmemType<Type4Byte>{shared_mem_size};
-                    $if(is_last_tile)
-                    {
-                        BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Load(
-                            d_in, items, tile_start, num_remaining);
-                    }
-                    $else
-                    {
-                        BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Load(d_in, items, tile_start);
-                    };
-                    sync_block();
+            return compile_tile_scan<is_inclusive, false, DelayConstructorT>(device, shared_mem_size, scan_op);
+        }
+
+        template <bool is_inclusive, typename ScanOp>
+        U<DownsweepKernel> compile_downsweep(Device& device, size_t shared_mem_size, ScanOp scan_op)
+        {
+            return compile_tile_scan<is_inclusive, true, no_delay_constructor<Type4Byte>>(device, shared_mem_size, scan_op);
+        }
+
+        template <typename ScanOp>
+        U<ReduceTileKernel> compile_reduce_tile(Device& device, size_t shared_mem_size, ScanOp scan_op)
+        {
+            U<ReduceTileKernel> reduce_tile_shader = nullptr;
+            [&]<typename... In>(ParamList<In...>)
+            {
+                lazy_compile(device,
+                             reduce_tile_shader,
+                             [&](Var<In>... in_params, BufferVar<Type4Byte> d_tile_aggregates)
+                             {
+                                 // only full tiles are dispatched, the last tile never feeds a prefix
+                                 set_block_size(BLOCK_SIZE);
+                                 auto d_in = m_input.bind(param_exprs_t<InputParams>{in_params...});
+                                 UInt tile_id    = block_id().x;
+                                 UInt tile_start = tile_id * UInt(ITEMS_PER_THREAD) * block_size_x();
+
+                                 ArrayVar<Type4Byte, ITEMS_PER_THREAD> items;
+                                 SmemTypePtr<Type4Byte> s_data = new SmemType<Type4Byte>{shared_mem_size};
+                                 BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Load(d_in, items, tile_start);
+                                 sync_block();
+
+                                 ArrayVar<Type4Byte, ITEMS_PER_THREAD> output_items;
+                                 Var<Type4Byte>                        tile_aggregate;
+                                 BlockScan<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>().InclusiveScan(
+                                     items, output_items, tile_aggregate, scan_op);
+                                 $if(thread_id().x == 0)
+                                 {
+                                     d_tile_aggregates.write(tile_id, tile_aggregate);
+                                 };
+                             });
+            }(InputParams{});
+            return reduce_tile_shader;
+        }
+
+        template <typename ScanOp>
+        U<SpineScanKernel> compile_spine(Device& device, ScanOp scan_op)
+        {
+            U<SpineScanKernel> spine_shader = nullptr;
+            lazy_compile(device,
+                         spine_shader,
+                         [&](BufferVar<Type4Byte> d_tile_prefix, Var<Type4Byte> init_value, UInt num_tiles)
+                         {
+                             // a single block turns the tile aggregates into exclusive tile prefixes, in place
+                             set_block_size(BLOCK_SIZE);
+                             UInt thid       = thread_id().x;
+                             UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+
+                             Var<Type4Byte> carry       = init_value;
+                             UInt           chunk_start = def(0u);
+                             $while(chunk_start < num_tiles)
+                             {
+                                 ArrayVar<Type4Byte, ITEMS_PER_THREAD> items;
+                                 for(auto i = 0u; i < ITEMS_PER_THREAD; ++i)
+                                 {
+                                     UInt index = chunk_start + thid * UInt(ITEMS_PER_THREAD) + i;
+                                     items[i]   = init_value;
+                                     $if(index + 1u < num_tiles)
+                                     {
+                                         items[i] = d_tile_prefix.read(index);
+                                     };
+                                 }
+                                 sync_block();
+
+                                 ArrayVar<Type4Byte, ITEMS_PER_THREAD> output_items;
+                                 Var<Type4Byte>                        chunk_aggregate;
+                                 BlockScan<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>().ExclusiveScan(
+                                     items, output_items, chunk_aggregate, scan_op, carry);
+                                 for(auto i = 0u; i < ITEMS_PER_THREAD; ++i)
+                                 {
+                                     UInt index = chunk_start + thid * UInt(ITEMS_PER_THREAD) + i;
+                                     $if(index < num_tiles)
+                                     {
+                                         d_tile_prefix.write(index, output_items[i]);
+                                     };
+                                 }
+                                 carry = scan_op(carry, chunk_aggregate);
+                                 chunk_start += tile_items;
+                             };
+                         });
+            return spine_shader;
+        }
+
+      private:
+        template <bool is_inclusive, bool REDUCE_THEN_SCAN, typename DelayConstructorT, typename ScanOp>
+        auto compile_tile_scan(Device& device, size_t shared_mem_size, ScanOp scan_op)
+        {
+            // decoupled look-back reads tile states, reduce-then-scan reads the spine prefixes
+            using PrefixT      = std::conditional_t<REDUCE_THEN_SCAN, Type4Byte, TileState>;
+            using TileScanKernel = std::conditional_t<REDUCE_THEN_SCAN, DownsweepKernel, ScanKernel>;
 
-                    ArrayVar<Type4Byte, ITEMS_PER_THREAD> output_items;
-                    $if(tile_id == 0)
+            U<TileScanKernel> scan_shader = nullptr;
+            [&]<typename... In, typename... Out>(ParamList<In...>, ParamList<Out...>)
+            {
+                lazy_compile(
+                    device,
+                    scan_shader,
+                    [&](BufferVar<PrefixT> tile_state,
+                        Var<In>... in_params,
+                        Var<Out>... out_params,
+                        Var<Type4Byte> init_value,
+                        UInt           num_elements)
                     {
-                        Var<Type4Byte>                                     block_aggregate;
-                        BlockScan<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD> block_scan;
-                        if constexpr(is_inclusive)
+                        set_block_size(BLOCK_SIZE);
+                        auto d_in  = m_input.bind(param_exprs_t<InputParams>{in_params...});
+                        auto d_out = m_output.bind(param_exprs_t<OutputParams>{out_params...});
+                        UInt thid       = thread_id().x;
+                        UInt tile_id    = block_id().x;
+                        UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+                        UInt tile_start = tile_id * tile_items;
+
+                        UInt num_remaining = num_elements - tile_start;
+                        Bool is_last_tile  = num_remaining <= tile_items;
+
+                        ArrayVar<Type4Byte, ITEMS_PER_THREAD> items;
+                        SmemTypePtr<Type4Byte> s_data = new SmemType<Type4Byte>{shared_mem_size};
+                        $if(is_last_tile)
                         {
-                            block_scan.InclusiveScan(items, output_items, block_aggregate, scan_op, init_value);
-                            block_aggregate = scan_op(block_aggregate, init_value);
+                            BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Load(
+                                d_in, items, tile_start, num_remaining);
                         }
-                        else
+                        $else
                         {
-                            block_scan.ExclusiveScan(items, output_items, block_aggregate, scan_op, init_value);
-                            block_aggregate = scan_op(block_aggregate, init_value);
+                            BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Load(d_in, items, tile_start);
+                        };
+                        sync_block();
+
+                        ArrayVar<Type4Byte, ITEMS_PER_THREAD> output_items;
+                        $if(tile_id == 0)
+                        {
+                            Var<Type4Byte>                                     block_aggregate;
+                            BlockScan<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD> block_scan;
+                            if constexpr(is_inclusive)
+                            {
+                                block_scan.InclusiveScan(items, output_items, block_aggregate, scan_op, init_value);
+                                block_aggregate = scan_op(block_aggregate, init_value);
+                            }
+                            else
+                            {
+                                block_scan.ExclusiveScan(items, output_items, block_aggregate, scan_op, init_value);
+                                block_aggregate = scan_op(block_aggregate, init_value);
+                            }
+                            if constexpr(!REDUCE_THEN_SCAN)
+                            {
+                                $if(!is_last_tile & thread_id().x == 0)
+                                {
+                                    // first tile
+                                    ScanTileStateViewer::SetInclusive(tile_state, 0, block_aggregate);
+                                };
+                            }
                         }
-                        $if(!is_last_tile & thread_id().x == 0)
+                        $else
                         {
-                            // first tile
-                            ScanTileStateViewer::SetInclusive(tile_state, 0, block_aggregate);
+                            BlockScan<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD> block_scan;
+                            if constexpr(REDUCE_THEN_SCAN)
+                            {
+                                TilePrefixValueOp<Type4Byte> prefix_op{tile_state.read(tile_id)};
+                                if constexpr(is_inclusive)
+                                {
+                                    block_scan.InclusiveScan(items, output_items, scan_op, prefix_op);
+                                }
+                                else
+                                {
+                                    block_scan.ExclusiveScan(items, output_items, scan_op, prefix_op);
+                                }
+                            }
+                            else
+                            {
+                                auto temp_storage = new SmemType<TilePrefixTempStorage<Type4Byte>>{1};
+                                TilePrefixCallbackOp<Type4Byte, ScanOp, TileState, DelayConstructorT> prefix_op(
+                                    tile_state, temp_storage, scan_op, tile_id);
+                                if constexpr(is_inclusive)
+                                {
+                                    block_scan.InclusiveScan(items, output_items, scan_op, prefix_op);
+                                }
+                                else
+                                {
+                                    block_scan.ExclusiveScan(items, output_items, scan_op, prefix_op);
+                                }
+                            }
                         };
-                    }
-                    $else
-                    {
-                        auto temp_storage = new SmemType<TilePrefixTempStorage<Type4Byte>>{1};
-                        TilePrefixCallbackOp prefix_op(tile_state, temp_storage, scan_op, tile_id);
-                        BlockScan<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD> block_scan;
-                        if constexpr(is_inclusive)
+
+                        sync_block();
+                        $if(is_last_tile)
                         {
-                            block_scan.InclusiveScan(items, output_items, scan_op, prefix_op);
+                            BlockStore<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Store(
+                                output_items, d_out, tile_start, num_remaining);
                         }
-                        else
+                        $else
                         {
-                            block_scan.ExclusiveScan(items, output_items, scan_op, prefix_op);
-                        }
-                    };
-
-                    sync_block();
-                    $if(is_last_tile)
-                    {
-                        BlockStore<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Store(
-                            output_items, d_out, tile_start, num_remaining);
-                    }
-                    $else
-                    {
-                        BlockStore<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Store(output_items, d_out, tile_start);
-                    };
-                });
+                            BlockStore<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_data).Store(output_items, d_out, tile_start);
+                        };
+                    });
+            }(InputParams{}, OutputParams{});
 
             return scan_shader;
         }
+
+        // host descriptions the kernels rebind from their arguments
+        InputIt  m_input;
+        OutputIt m_output;
     };
 };  // namespace details
 }  // namespace luisa::parallel_primitive
\ No newline at end of file
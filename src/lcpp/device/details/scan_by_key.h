@@ -9,6 +9,7 @@
 #include "luisa/core/mathematics.h"
 #include "luisa/dsl/stmt.h"
 #include <cstddef>
+#include <type_traits>
 #include <luisa/dsl/sugar.h>
 #include <luisa/dsl/func.h>
 #include <luisa/dsl/var.h>
@@ -31,13 +32,13 @@ namespace details
 {
     using namespace luisa::compute;
 
-    template <NumericT KeyType, NumericT ValueType, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    template <NumericT KeyType, NumericT ValueType, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD, bool PACKED_TILE_STATE = true>
     class ScanByKeyModule : public LuisaModule
     {
       public:
         using FlagValuePairT = KeyValuePair<int, ValueType>;
 
-        using ScanTileState = ScanTileState<FlagValuePairT>;
+        using ScanTileState = ScanTileStateStorage<FlagValuePairT, PACKED_TILE_STATE>;
 
         using ScanByKeyKernel =
             Shader<1, Buffer<ScanTileState>, Buffer<KeyType>, Buffer<KeyType>, Buffer<ValueType>, Buffer<ValueType>, ValueType, uint>;
@@ -45,6 +46,14 @@ namespace details
         using ScanTileStateInitKernel =
             Shader<1, Buffer<ScanTileState>, Buffer<KeyType>, Buffer<KeyType>, int>;
 
+        // reduce-then-scan: tile aggregates, spine scan over them, then a downsweep seeded per tile
+        using PrevKeysKernel = Shader<1, Buffer<KeyType>, Buffer<KeyType>, int>;
+        using ReduceTileKernel =
+            Shader<1, Buffer<KeyType>, Buffer<KeyType>, Buffer<ValueType>, Buffer<FlagValuePairT>>;
+        using SpineScanKernel = Shader<1, Buffer<FlagValuePairT>, uint>;
+        using DownsweepKernel =
+            Shader<1, Buffer<FlagValuePairT>, Buffer<KeyType>, Buffer<KeyType>, Buffer<ValueType>, Buffer<ValueType>, ValueType, uint>;
+
 
         U<ScanTileStateInitKernel> compile_scan_tile_state_init(Device& device)
         {
@@ -71,12 +80,180 @@ namespace details
             return ms_scan_tile_state_init_shader;
         }
 
-        template <bool is_inclusive, typename ScanOp>
+        U<PrevKeysKernel> compile_prev_keys(Device& device)
+        {
+            U<PrevKeysKernel> prev_keys_shader = nullptr;
+            lazy_compile(device,
+                         prev_keys_shader,
+                         [](BufferVar<KeyType> d_keys_in, BufferVar<KeyType> d_prev_keys_output, Int num_tiles) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             UInt tid        = dispatch_id().x;
+                             UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+                             UInt tile_start = tid * tile_items;
+
+                             $if(tid > 0 & tid < num_tiles)
+                             {
+                                 d_prev_keys_output.write(tid, d_keys_in.read(tile_start - 1));
+                             };
+                         });
+            return prev_keys_shader;
+        }
+
+        template <typename ScanOp>
+        U<ReduceTileKernel> compile_reduce_tile(Device& device, size_t shared_mem_size, ScanOp scan_op)
+        {
+            ScanBySegmentOp<ScanOp> pair_scan_op{scan_op};
+
+            U<ReduceTileKernel> reduce_tile_shader = nullptr;
+            lazy_compile(
+                device,
+                reduce_tile_shader,
+                [&](BufferVar<KeyType>        d_keys_in,
+                    BufferVar<KeyType>        d_prev_keys_in,
+                    BufferVar<ValueType>      d_values_in,
+                    BufferVar<FlagValuePairT> d_tile_aggregates) noexcept
+                {
+                    // only full tiles are dispatched, the last tile never feeds a prefix
+                    set_block_size(BLOCK_SIZE);
+                    UInt tile_id    = block_id().x;
+                    UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+                    UInt tile_start = tile_id * tile_items;
+
+                    SmemTypePtr<KeyType>   s_keys   = new SmemType<KeyType>{shared_mem_size};
+                    SmemTypePtr<ValueType> s_values = new SmemType<ValueType>{shared_mem_size};
+
+                    ArrayVar<KeyType, ITEMS_PER_THREAD>   local_keys;
+                    ArrayVar<ValueType, ITEMS_PER_THREAD> local_values;
+                    BlockLoad<KeyType, BLOCK_SIZE, ITEMS_PER_THREAD>(s_keys).Load(d_keys_in, local_keys, tile_start);
+                    BlockLoad<ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>(s_values).Load(d_values_in, local_values, tile_start);
+                    sync_block();
+
+                    ArrayVar<int, ITEMS_PER_THREAD>     local_segment_flags;
+                    ArrayVar<KeyType, ITEMS_PER_THREAD> local_prev_keys;
+                    $if(tile_id == 0)
+                    {
+                        BlockDiscontinuity<KeyType, BLOCK_SIZE, ITEMS_PER_THREAD>().FlagHeads(
+                            local_segment_flags,
+                            local_prev_keys,
+                            local_keys,
+                            [](const Var<KeyType>& a, const Var<KeyType>& b) { return a != b; });
+                    }
+                    $else
+                    {
+                        Var<KeyType> tile_pred_key =
+                            select(KeyType(0), d_prev_keys_in.read(tile_id), thread_id().x == 0);
+                        BlockDiscontinuity<KeyType, BLOCK_SIZE, ITEMS_PER_THREAD>().FlagHeads(
+                            local_segment_flags,
+                            local_prev_keys,
+                            local_keys,
+                            [](const Var<KeyType>& a, const Var<KeyType>& b) { return a != b; },
+                            tile_pred_key);
+                    };
+
+                    ArrayVar<FlagValuePairT, ITEMS_PER_THREAD> local_scan_items;
+                    for(auto item = 0; item < ITEMS_PER_THREAD; item++)
+                    {
+                        local_scan_items[item].key   = local_segment_flags[item];
+                        local_scan_items[item].value = local_values[item];
+                    }
+
+                    ArrayVar<FlagValuePairT, ITEMS_PER_THREAD> output_scan_items;
+                    Var<FlagValuePairT>                        tile_aggregate;
+                    BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().InclusiveScan(
+                        local_scan_items, output_scan_items, tile_aggregate, pair_scan_op);
+                    $if(thread_id().x == 0)
+                    {
+                        d_tile_aggregates.write(tile_id, tile_aggregate);
+                    };
+                });
+            return reduce_tile_shader;
+        }
+
+        template <typename ScanOp>
+        U<SpineScanKernel> compile_spine(Device& device, ScanOp scan_op)
+        {
+            ScanBySegmentOp<ScanOp> pair_scan_op{scan_op};
+
+            U<SpineScanKernel> spine_shader = nullptr;
+            lazy_compile(
+                device,
+                spine_shader,
+                [&](BufferVar<FlagValuePairT> d_tile_prefix, UInt num_tiles) noexcept
+                {
+                    // a single block turns the tile aggregates into exclusive tile prefixes, in place.
+                    // slot 0 has no prefix and is never read by the downsweep
+                    set_block_size(BLOCK_SIZE);
+                    UInt thid       = thread_id().x;
+                    UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+
+                    Var<FlagValuePairT> carry;
+                    UInt                chunk_start = def(0u);
+                    $while(chunk_start < num_tiles)
+                    {
+                        ArrayVar<FlagValuePairT, ITEMS_PER_THREAD> items;
+                        for(auto i = 0u; i < ITEMS_PER_THREAD; ++i)
+                        {
+                            UInt index = chunk_start + thid * UInt(ITEMS_PER_THREAD) + i;
+                            // the padding only reaches outputs past the last tile
+                            items[i] = d_tile_prefix.read(select(0u, index, index + 1u < num_tiles));
+                        }
+                        sync_block();
+
+                        ArrayVar<FlagValuePairT, ITEMS_PER_THREAD> output_items;
+                        Var<FlagValuePairT>                        chunk_aggregate;
+                        $if(chunk_start == 0u)
+                        {
+                            BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().ExclusiveScan(
+                                items, output_items, chunk_aggregate, pair_scan_op);
+                            carry = chunk_aggregate;
+                        }
+                        $else
+                        {
+                            BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().ExclusiveScan(
+                                items, output_items, chunk_aggregate, pair_scan_op, carry);
+                            carry = pair_scan_op(carry, chunk_aggregate);
+                        };
+                        sync_block();
+                        for(auto i = 0u; i < ITEMS_PER_THREAD; ++i)
+                        {
+                            UInt index = chunk_start + thid * UInt(ITEMS_PER_THREAD) + i;
+                            $if(index < num_tiles)
+                            {
+                                d_tile_prefix.write(index, output_items[i]);
+                            };
+                        }
+                        chunk_start += tile_items;
+                    };
+                });
+            return spine_shader;
+        }
+
+        template <bool is_inclusive, typename DelayConstructorT = no_delay_constructor<FlagValuePairT>, typename ScanOp>
         U<ScanByKeyKernel> compile(Device& device, size_t shared_mem_size, ScanOp scan_op)
         {
+            return compile_tile_scan<is_inclusive, false, DelayConstructorT>(device, shared_mem_size, scan_op);
+        }
+
+        template <bool is_inclusive, typename ScanOp>
+        U<DownsweepKernel> compile_downsweep(Device& device, size_t shared_mem_size, ScanOp scan_op)
+        {
+            return compile_tile_scan<is_inclusive, true, no_delay_constructor<FlagValuePairT>>(
+                device, shared_mem_size, scan_op);
+        }
+
+      private:
+        template <bool is_inclusive, bool REDUCE_THEN_SCAN, typename DelayConstructorT, typename ScanOp>
+        auto compile_tile_scan(Device& device, size_t shared_mem_size, ScanOp scan_op)
+        {
+            // decoupled look-back reads tile states, reduce-then-scan reads the spine prefixes
+            using PrefixT = std::conditional_t<REDUCE_THEN_SCAN, FlagValuePairT, ScanTileState>;
+            using TileScanKernel = std::conditional_t<REDUCE_THEN_SCAN, DownsweepKernel, ScanByKeyKernel>;
+
             ScanBySegmentOp<ScanOp> pair_scan_op{scan_op};
 
-            using TilePrefixOpT = TilePrefixCallbackOp<FlagValuePairT, ScanBySegmentOp<ScanOp>>;
+            using TilePrefixOpT =
+                TilePrefixCallbackOp<FlagValuePairT, ScanBySegmentOp<ScanOp>, ScanTileState, DelayConstructorT>;
 
             Callable ZipValueAndFlags = [](UInt num_remaining,
                                            const ArrayVar<ValueType, ITEMS_PER_THREAD>& values,
@@ -121,11 +298,11 @@ namespace details
                 }
             };
 
-            U<ScanByKeyKernel> scan_by_key_shader = nullptr;
+            U<TileScanKernel> scan_by_key_shader = nullptr;
             lazy_compile(
                 device,
                 scan_by_key_shader,
-                [&](BufferVar<ScanTileState> tile_state,
+                [&](BufferVar<PrefixT>       tile_state,
                     BufferVar<KeyType>       d_keys_in,
                     BufferVar<KeyType>       d_prev_keys_in,
                     BufferVar<ValueType>     d_values_in,
@@ -191,11 +368,14 @@ namespace details
                         }
                         $if(thread_id().x == 0)
                         {
-                            $if(!is_last_tile)
+                            if constexpr(!REDUCE_THEN_SCAN)
                             {
-                                // first tile
-                                ScanTileStateViewer::SetInclusive(tile_state, 0, tile_aggregate);
-                            };
+                                $if(!is_last_tile)
+                                {
+                                    // first tile
+                                    ScanTileStateViewer::SetInclusive(tile_state, 0, tile_aggregate);
+                                };
+                            }
                             output_scan_items[0].key = 0;
                         };
                     }
@@ -212,19 +392,36 @@ namespace details
 
                         ZipValueAndFlags(num_remaining, local_values, local_segment_flags, local_scan_items, is_last_tile);
 
-                        auto temp_storage = new SmemType<TilePrefixTempStorage<FlagValuePairT>>{1};
-                        TilePrefixOpT prefix_op(tile_state, temp_storage, pair_scan_op, tile_id);
-                        if constexpr(is_inclusive)
+                        if constexpr(REDUCE_THEN_SCAN)
                         {
-                            BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().InclusiveScan(
-                                local_scan_items, output_scan_items, pair_scan_op, prefix_op);
-                            tile_aggregate = prefix_op.GetBlockAggregate();
+                            TilePrefixValueOp<FlagValuePairT> prefix_op{tile_state.read(tile_id)};
+                            if constexpr(is_inclusive)
+                            {
+                                BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().InclusiveScan(
+                                    local_scan_items, output_scan_items, pair_scan_op, prefix_op);
+                            }
+                            else
+                            {
+                                BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().ExclusiveScan(
+                                    local_scan_items, output_scan_items, pair_scan_op, prefix_op);
+                            }
                         }
                         else
                         {
-                            BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().ExclusiveScan(
-                                local_scan_items, output_scan_items, pair_scan_op, prefix_op);
-                            tile_aggregate = prefix_op.GetBlockAggregate();
+                            auto temp_storage = new SmemType<TilePrefixTempStorage<FlagValuePairT>>{1};
+                            TilePrefixOpT prefix_op(tile_state, temp_storage, pair_scan_op, tile_id);
+                            if constexpr(is_inclusive)
+                            {
+                                BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().InclusiveScan(
+                                    local_scan_items, output_scan_items, pair_scan_op, prefix_op);
+                                tile_aggregate = prefix_op.GetBlockAggregate();
+                            }
+                            else
+                            {
+                                BlockScan<FlagValuePairT, BLOCK_SIZE, ITEMS_PER_THREAD>().ExclusiveScan(
+                                    local_scan_items, output_scan_items, pair_scan_op, prefix_op);
+                                tile_aggregate = prefix_op.GetBlockAggregate();
+                            }
                         }
                     };
 
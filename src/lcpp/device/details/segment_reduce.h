@@ -26,19 +26,20 @@ namespace luisa::parallel_primitive
 namespace details
 {
     using namespace luisa::compute;
-    template <typename Type4Byte, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_SIZE = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    // an InputT other than Type4Byte is lifted while loading (values into index value pairs for arg reductions)
+    template <typename Type4Byte, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_SIZE = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD, typename InputT = Type4Byte>
     class SegmentReduceModule : public LuisaModule
     {
       public:
         using SegmentReduceKernel =
-            Shader<1, Buffer<Type4Byte>, Buffer<Type4Byte>, Buffer<uint>, Buffer<uint>, uint, Type4Byte>;
+            Shader<1, Buffer<InputT>, Buffer<Type4Byte>, Buffer<uint>, Buffer<uint>, uint, Type4Byte>;
 
         using FixedSizeSegmentReduceKernel =
-            Shader<1, Buffer<Type4Byte>, Buffer<Type4Byte>, uint, uint, Type4Byte>;
+            Shader<1, Buffer<InputT>, Buffer<Type4Byte>, uint, uint, Type4Byte>;
 
         template <typename ReduceOp, typename TransformOp = IdentityOp>
         using AgentReduceT =
-            AgentReduce<Type4Byte, ReduceOp, TransformOp, BLOCK_SIZE, ITEMS_PER_THREAD, WARP_SIZE>;
+            AgentReduce<Type4Byte, ReduceOp, TransformOp, BLOCK_SIZE, ITEMS_PER_THREAD, WARP_SIZE, InputT>;
 
         template <typename ReduceOp>
         U<SegmentReduceKernel> compile(Device& device, size_t shared_mem_size, ReduceOp reduce_op)
@@ -47,7 +48,7 @@ namespace details
 
             lazy_compile(device,
                          ms_segment_reduce_shader,
-                         [&](BufferVar<Type4Byte> d_arr_in,
+                         [&](BufferVar<InputT>    d_arr_in,
                              BufferVar<Type4Byte> d_arr_out,
                              BufferVar<uint>      d_begin_offsets,
                              BufferVar<uint>      d_end_offsets,
@@ -96,7 +97,7 @@ namespace details
 
         template <typename ReduceOp, typename TransformOp = IdentityOp>
         using AgentSmallReduceT =
-            AgentWarpReduce<Type4Byte, ReduceOp, TransformOp, small_threads_per_warp, ITEMS_PER_THREAD>;
+            AgentWarpReduce<Type4Byte, ReduceOp, TransformOp, small_threads_per_warp, ITEMS_PER_THREAD, InputT>;
 
 
         template <typename ReduceOp>
@@ -107,7 +108,7 @@ namespace details
             lazy_compile(
                 device,
                 ms_fixed_size_segment_reduce_shader,
-                [&](BufferVar<Type4Byte> d_arr_in,
+                [&](BufferVar<InputT>    d_arr_in,
                     BufferVar<Type4Byte> d_arr_out,
                     UInt                 d_num_segments,
                     UInt                 d_segment_size,
@@ -171,8 +172,6 @@ namespace details
     class ArgSegmentReduceModule : public LuisaModule
     {
       public:
-        using ArgConstructShaderT = Shader<1, Buffer<Type4Byte>, Buffer<IndexValuePairT<Type4Byte>>>;
-
         using ArgAssignShaderT =
             Shader<1, Buffer<IndexValuePairT<Type4Byte>>, Buffer<uint>, Buffer<uint>, Buffer<Type4Byte>>;
 
@@ -180,24 +179,6 @@ namespace details
             Shader<1, Buffer<IndexValuePairT<Type4Byte>>, uint, Buffer<uint>, Buffer<Type4Byte>>;
 
 
-        U<ArgConstructShaderT> compile_arg_construct_shader(Device& device)
-        {
-            U<ArgConstructShaderT> ms_arg_construct_shader = nullptr;
-            lazy_compile(device,
-                         ms_arg_construct_shader,
-                         [&](BufferVar<Type4Byte> arr_in, BufferVar<IndexValuePairT<Type4Byte>> g_kv_out)
-                         {
-                             set_block_size(BLOCK_SIZE);
-                             UInt global_id = block_id().x * block_size().x + thread_id().x;
-
-                             Var<IndexValuePairT<Type4Byte>> initial{0, 0};
-                             initial.key   = global_id;
-                             initial.value = arr_in.read(global_id);
-                             g_kv_out.write(global_id, initial);
-                         });
-            return ms_arg_construct_shader;
-        }
-
         U<ArgAssignShaderT> compile_arg_assign_shader(Device& device)
         {
             U<ArgAssignShaderT> ms_arg_assign_shader = nullptr;
@@ -0,0 +1,319 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 22:31:18
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 22:31:18
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <luisa/runtime/byte_buffer.h>
+#include <lcpp/agent/radix_rank_sort_operations.h>
+#include <lcpp/block/block_load.h>
+#include <lcpp/block/block_store.h>
+#include <lcpp/block/block_scan.h>
+#include <lcpp/block/block_radix_rank.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/runtime/core.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    // one block per segment, small segments are sorted in one dispatch, oversized ones one digit per dispatch
+    template <NumericT KeyType, typename ValueType, bool KEYS_ONLY, size_t RADIX_BITS = 8u, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_SIZE = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    class SegmentedRadixSortModule : public LuisaModule
+    {
+      public:
+        static constexpr uint TILE_ITEMS      = BLOCK_SIZE * ITEMS_PER_THREAD;
+        static constexpr uint PASS_BITS       = RADIX_BITS;
+        static constexpr uint RADIX_DIGITS    = 1 << RADIX_BITS;
+        static constexpr uint BINS_PER_THREAD = (RADIX_DIGITS + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        static constexpr bool FULL_BINS       = BINS_PER_THREAD * BLOCK_SIZE == RADIX_DIGITS;
+        static constexpr uint END_BIT         = sizeof(KeyType) * 8;
+        static constexpr uint NUM_PASSES      = (END_BIT + RADIX_BITS - 1) / RADIX_BITS;
+
+        using bit_ordered_type  = typename radix::traits_t<KeyType>::bit_ordered_type;
+        using digit_extractor_t = ShiftDigitExtractor<KeyType>;
+        using Twiddle           = RadixSortTwiddle<false, KeyType>;
+        using BlockRadixRankT =
+            BlockRadixRankMatchEarlyCounts<BLOCK_SIZE, RADIX_BITS, false, WarpMatchAlgorithm::WARP_MATCH_ANY, 1u, ITEMS_PER_THREAD, WARP_SIZE>;
+
+        // keys in, keys out, values in, values out, segment begin offsets, segment end offsets
+        using SegmentedSortSmallKernel =
+            Shader<1, ByteBuffer, ByteBuffer, Buffer<ValueType>, Buffer<ValueType>, Buffer<uint>, Buffer<uint>>;
+        // same, plus the bit the pass starts at and its number of bits
+        using SegmentedSortLargeKernel =
+            Shader<1, ByteBuffer, ByteBuffer, Buffer<ValueType>, Buffer<ValueType>, Buffer<uint>, Buffer<uint>, uint, uint>;
+
+        // keeps the per digit item counts of the tile the rank reports early
+        struct TileCountsCallback
+        {
+            ArrayVar<uint, BINS_PER_THREAD>& counts;
+            void operator()(const ArrayVar<uint, BINS_PER_THREAD>& bins)
+            {
+                for(auto u = 0u; u < BINS_PER_THREAD; ++u)
+                {
+                    counts[u] = bins[u];
+                }
+            }
+        };
+
+        // segments of at most one tile, all digit passes stay in registers and shared memory
+        U<SegmentedSortSmallKernel> compile_small(Device& device)
+        {
+            U<SegmentedSortSmallKernel> ms_segmented_sort_small_shader = nullptr;
+
+            lazy_compile(
+                device,
+                ms_segmented_sort_small_shader,
+                [&](ByteBufferVar        d_keys_in,
+                    ByteBufferVar        d_keys_out,
+                    BufferVar<ValueType> d_values_in,
+                    BufferVar<ValueType> d_values_out,
+                    BufferVar<uint>      d_begin_offsets,
+                    BufferVar<uint>      d_end_offsets) noexcept
+                {
+                    set_block_size(BLOCK_SIZE);
+                    set_warp_size(WARP_SIZE);
+                    UInt segment_begin = d_begin_offsets.read(block_id().x);
+                    UInt segment_end   = d_end_offsets.read(block_id().x);
+                    UInt num_items     = select(0u, segment_end - segment_begin, segment_end > segment_begin);
+
+                    $if(num_items > 0u & num_items <= UInt(TILE_ITEMS))
+                    {
+                        SmemTypePtr<bit_ordered_type> s_keys   = new SmemType<bit_ordered_type>{TILE_ITEMS};
+                        SmemTypePtr<ValueType>        s_values = KEYS_ONLY ? nullptr : new SmemType<ValueType>{TILE_ITEMS};
+
+                        // padding takes the largest key so it ranks behind the segment in every pass
+                        ArrayVar<bit_ordered_type, ITEMS_PER_THREAD> keys;
+                        ArrayVar<ValueType, ITEMS_PER_THREAD>        values;
+                        LoadDirectWarpStriped<bit_ordered_type, ITEMS_PER_THREAD, WARP_SIZE>(
+                            thread_id().x, d_keys_in, segment_begin, keys, num_items, Twiddle::DefaultKey());
+                        for(auto u = 0u; u < ITEMS_PER_THREAD; ++u)
+                        {
+                            keys[u] = Twiddle::In(keys[u]);
+                        }
+                        if constexpr(!KEYS_ONLY)
+                        {
+                            LoadDirectWarpStriped<ValueType, ITEMS_PER_THREAD, WARP_SIZE>(
+                                thread_id().x, d_values_in, segment_begin, values, num_items);
+                        }
+
+                        UInt warp_offset = (thread_id().x / UInt(WARP_SIZE)) * UInt(WARP_SIZE * ITEMS_PER_THREAD);
+                        UInt lane        = thread_id().x % UInt(WARP_SIZE);
+                        $for(current_bit, 0u, UInt(END_BIT), UInt(RADIX_BITS))
+                        {
+                            UInt num_bits = min(UInt(RADIX_BITS), UInt(END_BIT) - current_bit);
+
+                            ArrayVar<uint, ITEMS_PER_THREAD> ranks;
+                            ArrayVar<uint, BINS_PER_THREAD>  exclusive_digit_prefix;
+                            BlockRadixRankT().template RankKeys<bit_ordered_type, ITEMS_PER_THREAD, digit_extractor_t>(
+                                keys, ranks, digit_extractor_t(current_bit, num_bits), exclusive_digit_prefix);
+
+                            // the rank is stable in warp-striped order, so reload the tile in that order
+                            sync_block();
+                            for(auto u = 0u; u < ITEMS_PER_THREAD; ++u)
+                            {
+                                (*s_keys)[ranks[u]] = keys[u];
+                                if constexpr(!KEYS_ONLY)
+                                {
+                                    (*s_values)[ranks[u]] = values[u];
+                                }
+                            }
+                            sync_block();
+                            for(auto u = 0u; u < ITEMS_PER_THREAD; ++u)
+                            {
+                                UInt idx = warp_offset + UInt(u * WARP_SIZE) + lane;
+                                keys[u]  = (*s_keys)[idx];
+                                if constexpr(!KEYS_ONLY)
+                                {
+                                    values[u] = (*s_values)[idx];
+                                }
+                            }
+                        };
+
+                        for(auto u = 0u; u < ITEMS_PER_THREAD; ++u)
+                        {
+                            keys[u] = Twiddle::Out(keys[u]);
+                        }
+                        StoreDirectWarpStriped<bit_ordered_type, ITEMS_PER_THREAD, WARP_SIZE>(
+                            thread_id().x, d_keys_out, segment_begin, keys, num_items);
+                        if constexpr(!KEYS_ONLY)
+                        {
+                            StoreDirectWarpStriped<ValueType, ITEMS_PER_THREAD, WARP_SIZE>(
+                                thread_id().x, d_values_out, segment_begin, values, num_items);
+                        }
+                    };
+                });
+            return ms_segmented_sort_small_shader;
+        }
+
+        // one digit pass of the segments longer than a tile: a segment histogram, then the block walks its tiles,
+        // ranks each with BlockRadixRankMatchEarlyCounts and scatters it behind the previous tiles
+        U<SegmentedSortLargeKernel> compile_large(Device& device)
+        {
+            U<SegmentedSortLargeKernel> ms_segmented_sort_large_shader = nullptr;
+
+            lazy_compile(
+                device,
+                ms_segmented_sort_large_shader,
+                [&](ByteBufferVar        d_keys_in,
+                    ByteBufferVar        d_keys_out,
+                    BufferVar<ValueType> d_values_in,
+                    BufferVar<ValueType> d_values_out,
+                    BufferVar<uint>      d_begin_offsets,
+                    BufferVar<uint>      d_end_offsets,
+                    UInt                 current_bit,
+                    UInt                 num_bits) noexcept
+                {
+                    set_block_size(BLOCK_SIZE);
+                    set_warp_size(WARP_SIZE);
+                    UInt thid          = thread_id().x;
+                    UInt segment_begin = d_begin_offsets.read(block_id().x);
+                    UInt segment_end   = d_end_offsets.read(block_id().x);
+                    UInt num_items     = select(0u, segment_end - segment_begin, segment_end > segment_begin);
+
+                    $if(num_items > UInt(TILE_ITEMS))
+                    {
+                        SmemTypePtr<bit_ordered_type> s_keys   = new SmemType<bit_ordered_type>{TILE_ITEMS};
+                        SmemTypePtr<ValueType>        s_values = KEYS_ONLY ? nullptr : new SmemType<ValueType>{TILE_ITEMS};
+                        // where the next item of every digit goes, and where the digit starts in the ranked tile
+                        SmemTypePtr<uint> s_digit_offsets = new SmemType<uint>{RADIX_DIGITS};
+                        SmemTypePtr<uint> s_tile_prefix   = new SmemType<uint>{RADIX_DIGITS};
+
+                        digit_extractor_t digit_extractor(current_bit, num_bits);
+
+                        for(auto u = 0u; u < BINS_PER_THREAD; ++u)
+                        {
+                            UInt bin = thid * UInt(BINS_PER_THREAD) + u;
+                            $if(FULL_BINS | bin < UInt(RADIX_DIGITS))
+                            {
+                                (*s_digit_offsets)[bin] = 0u;
+                            };
+                        }
+                        sync_block();
+
+                        $for(tile_offset, 0u, num_items, UInt(TILE_ITEMS))
+                        {
+                            for(auto u = 0u; u < ITEMS_PER_THREAD; ++u)
+                            {
+                                UInt idx = tile_offset + UInt(u * BLOCK_SIZE) + thid;
+                                $if(idx < num_items)
+                                {
+                                    Var<bit_ordered_type> key = Twiddle::In(
+                                        d_keys_in.read<bit_ordered_type>((segment_begin + idx) * (uint)sizeof(bit_ordered_type)));
+                                    s_digit_offsets->atomic(digit_extractor.Digit(key)).fetch_add(1u);
+                                };
+                            }
+                        };
+                        sync_block();
+
+                        ArrayVar<uint, BINS_PER_THREAD> bins;
+                        for(auto u = 0u; u < BINS_PER_THREAD; ++u)
+                        {
+                            bins[u]  = 0u;
+                            UInt bin = thid * UInt(BINS_PER_THREAD) + u;
+                            $if(FULL_BINS | bin < UInt(RADIX_DIGITS))
+                            {
+                                bins[u] = (*s_digit_offsets)[bin];
+                            };
+                        }
+                        BlockScan<uint, BLOCK_SIZE, BINS_PER_THREAD, WARP_SIZE>().ExclusiveSum(bins, bins);
+                        sync_block();
+                        for(auto u = 0u; u < BINS_PER_THREAD; ++u)
+                        {
+                            UInt bin = thid * UInt(BINS_PER_THREAD) + u;
+                            $if(FULL_BINS | bin < UInt(RADIX_DIGITS))
+                            {
+                                (*s_digit_offsets)[bin] = bins[u];
+                            };
+                        }
+                        sync_block();
+
+                        $for(tile_offset, 0u, num_items, UInt(TILE_ITEMS))
+                        {
+                            UInt tile_items = min(num_items - tile_offset, UInt(TILE_ITEMS));
+
+                            ArrayVar<bit_ordered_type, ITEMS_PER_THREAD> keys;
+                            ArrayVar<ValueType, ITEMS_PER_THREAD>        values;
+                            LoadDirectWarpStriped<bit_ordered_type, ITEMS_PER_THREAD, WARP_SIZE>(
+                                thid, d_keys_in, segment_begin + tile_offset, keys, tile_items, Twiddle::DefaultKey());
+                            for(auto u = 0u; u < ITEMS_PER_THREAD; ++u)
+                            {
+                                keys[u] = Twiddle::In(keys[u]);
+                            }
+                            if constexpr(!KEYS_ONLY)
+                            {
+                                LoadDirectWarpStriped<ValueType, ITEMS_PER_THREAD, WARP_SIZE>(
+                                    thid, d_values_in, segment_begin + tile_offset, values, tile_items);
+                            }
+
+                            ArrayVar<uint, ITEMS_PER_THREAD> ranks;
+                            ArrayVar<uint, BINS_PER_THREAD>  exclusive_digit_prefix;
+                            ArrayVar<uint, BINS_PER_THREAD>  tile_counts;
+                            BlockRadixRankT().template RankKeys<bit_ordered_type, ITEMS_PER_THREAD, digit_extractor_t, TileCountsCallback>(
+                                keys, ranks, digit_extractor, exclusive_digit_prefix, TileCountsCallback{tile_counts});
+
+                            for(auto u = 0u; u < BINS_PER_THREAD; ++u)
+                            {
+                                UInt bin = thid * UInt(BINS_PER_THREAD) + u;
+                                $if(FULL_BINS | bin < UInt(RADIX_DIGITS))
+                                {
+                                    (*s_tile_prefix)[bin] = exclusive_digit_prefix[u];
+                                };
+                            }
+                            sync_block();
+                            for(auto u = 0u; u < ITEMS_PER_THREAD; ++u)
+                            {
+                                (*s_keys)[ranks[u]] = keys[u];
+                                if constexpr(!KEYS_ONLY)
+                                {
+                                    (*s_values)[ranks[u]] = values[u];
+                                }
+                            }
+                            sync_block();
+
+                            // the padding of a partial tile ranks last, past tile_items
+                            for(auto u = 0u; u < ITEMS_PER_THREAD; ++u)
+                            {
+                                UInt idx = UInt(u * BLOCK_SIZE) + thid;
+                                $if(idx < tile_items)
+                                {
+                                    Var<bit_ordered_type> key   = (*s_keys)[idx];
+                                    UInt                  digit = digit_extractor.Digit(key);
+                                    UInt dst = segment_begin + (*s_digit_offsets)[digit] + idx - (*s_tile_prefix)[digit];
+                                    d_keys_out.write(dst * (uint)sizeof(bit_ordered_type), Twiddle::Out(key));
+                                    if constexpr(!KEYS_ONLY)
+                                    {
+                                        d_values_out.write(dst, (*s_values)[idx]);
+                                    }
+                                };
+                            }
+                            sync_block();
+
+                            for(auto u = 0u; u < BINS_PER_THREAD; ++u)
+                            {
+                                UInt bin = thid * UInt(BINS_PER_THREAD) + u;
+                                $if(FULL_BINS | bin < UInt(RADIX_DIGITS))
+                                {
+                                    (*s_digit_offsets)[bin] = (*s_digit_offsets)[bin] + tile_counts[u];
+                                };
+                            }
+                            sync_block();
+                        };
+                    };
+                });
+            return ms_segmented_sort_large_shader;
+        }
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
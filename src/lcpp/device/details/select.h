@@ -0,0 +1,230 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 18:20:37
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 18:20:37
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/common/iterator.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/block/block_load.h>
+#include <lcpp/block/block_discontinuity.h>
+#include <lcpp/block/block_scan.h>
+#include <lcpp/device/details/single_pass_scan_operator.h>
+#include <lcpp/device/details/tile_look_back_scan.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    enum class SelectMode : uint
+    {
+        IF,       // select_op(item)
+        FLAGGED,  // d_flags[i] != 0
+        UNIQUE,   // first item of every run of equal items
+    };
+
+    template <NumericT Type4Byte, NumericT FlagT = uint, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD, bool PACKED_TILE_STATE = true>
+    class SelectModule : public LuisaModule
+    {
+      public:
+        // the look-back carries the number of selected items
+        using ScanTileState = ScanTileStateStorage<uint, PACKED_TILE_STATE>;
+
+        using ScanTileStateInitKernel = Shader<1, Buffer<ScanTileState>, int>;
+
+        // only FLAGGED reads a flags buffer, the other modes have no such argument
+        template <SelectMode MODE>
+        using FlagParams = std::conditional_t<MODE == SelectMode::FLAGGED, ParamList<Buffer<FlagT>>, ParamList<>>;
+
+        // tile states, items, flags (FLAGGED only), selected items, num selected, num items, select op params
+        template <SelectMode MODE>
+        using SelectKernel = ShaderOfParams<ParamList<Buffer<ScanTileState>, Buffer<Type4Byte>>,
+                                            FlagParams<MODE>,
+                                            ParamList<Buffer<Type4Byte>, Buffer<uint>, uint, float4>>;
+
+        U<ScanTileStateInitKernel> compile_scan_tile_state_init(Device& device)
+        {
+            U<ScanTileStateInitKernel> ms_scan_tile_state_init_shader = nullptr;
+
+            lazy_compile(device,
+                         ms_scan_tile_state_init_shader,
+                         [](BufferVar<ScanTileState> tile_state, Int num_tiles) noexcept
+                         {
+                             set_block_size(BLOCK_SIZE);
+                             ScanTileStateViewer::InitializeWardStatus(tile_state, num_tiles);
+                         });
+
+            return ms_scan_tile_state_init_shader;
+        }
+
+        template <SelectMode MODE, typename DelayConstructorT = no_delay_constructor<uint>, typename SelectOp>
+        U<SelectKernel<MODE>> compile(Device& device, size_t shared_mem_size, SelectOp select_op)
+        {
+            U<SelectKernel<MODE>> ms_select_shader = nullptr;
+
+            [&]<typename... Flag>(ParamList<Flag...>)
+            {
+                lazy_compile(
+                    device,
+                    ms_select_shader,
+                    [&](BufferVar<ScanTileState> tile_state,
+                        BufferVar<Type4Byte>     d_in,
+                        Var<Flag>...             d_flags,
+                        BufferVar<Type4Byte>     d_selected_out,
+                        BufferVar<uint>          d_num_selected_out,
+                        UInt                     num_item,
+                        Float4                   select_params) noexcept
+                    {
+                        set_block_size(BLOCK_SIZE);
+                        UInt thid       = thread_id().x;
+                        UInt tile_id    = block_id().x;
+                        UInt tile_items = UInt(ITEMS_PER_THREAD) * block_size_x();
+                        UInt tile_start = tile_id * tile_items;
+
+                        UInt num_remaining = num_item - tile_start;
+                        Bool is_last_tile  = num_remaining <= tile_items;
+
+                        SmemTypePtr<Type4Byte> s_items = new SmemType<Type4Byte>{shared_mem_size};
+
+                        ArrayVar<Type4Byte, ITEMS_PER_THREAD> local_items;
+                        $if(is_last_tile)
+                        {
+                            BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_items).Load(
+                                d_in, local_items, tile_start, num_remaining);
+                        }
+                        $else
+                        {
+                            BlockLoad<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>(s_items).Load(d_in, local_items, tile_start);
+                        };
+
+                        // blocked arrangement, item i of this thread is tile item thid * ITEMS_PER_THREAD + i
+                        ArrayVar<uint, ITEMS_PER_THREAD> selection_flags;
+                        if constexpr(MODE == SelectMode::IF)
+                        {
+                            auto bound_select_op = bind_op_params(select_op, select_params);
+                            for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                            {
+                                selection_flags[item] = 0u;
+                                $if(thid * UInt(ITEMS_PER_THREAD) + item < num_remaining)
+                                {
+                                    $if(bound_select_op(local_items[item]))
+                                    {
+                                        selection_flags[item] = 1u;
+                                    };
+                                };
+                            };
+                        }
+                        else if constexpr(MODE == SelectMode::FLAGGED)
+                        {
+                            ArrayVar<FlagT, ITEMS_PER_THREAD> local_flags;
+                            $if(is_last_tile)
+                            {
+                                BlockLoad<FlagT, BLOCK_SIZE, ITEMS_PER_THREAD>().Load(d_flags..., local_flags, tile_start, num_remaining);
+                            }
+                            $else
+                            {
+                                BlockLoad<FlagT, BLOCK_SIZE, ITEMS_PER_THREAD>().Load(d_flags..., local_flags, tile_start);
+                            };
+                            for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                            {
+                                // out of range flags were loaded as zero
+                                selection_flags[item] = 0u;
+                                $if(local_flags[item] != FlagT(0))
+                                {
+                                    selection_flags[item] = 1u;
+                                };
+                            };
+                        }
+                        else
+                        {
+                            Var<Type4Byte> tile_predecessor = local_items[0];
+                            $if(thid == 0 & tile_id > 0)
+                            {
+                                tile_predecessor = d_in.read(tile_start - 1u);
+                            };
+
+                            ArrayVar<int, ITEMS_PER_THREAD> head_flags;
+                            BlockDiscontinuity<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>().FlagHeads(
+                                head_flags,
+                                local_items,
+                                [&](const Var<Type4Byte>& a, const Var<Type4Byte>& b) { return a != b; },
+                                tile_predecessor);
+
+                            $if(thid == 0 & tile_id == 0)
+                            {
+                                head_flags[0] = 1;
+                            };
+                            for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                            {
+                                selection_flags[item] = 0u;
+                                $if(head_flags[item] != 0 & thid * UInt(ITEMS_PER_THREAD) + item < num_remaining)
+                                {
+                                    selection_flags[item] = 1u;
+                                };
+                            };
+                        }
+
+                        Var<uint>                        num_selected_prefix;
+                        Var<uint>                        num_tile_selected;
+                        ArrayVar<uint, ITEMS_PER_THREAD> selection_indices;
+                        TileLookBackScan<uint, BLOCK_SIZE, ITEMS_PER_THREAD>::template ExclusiveScan<DelayConstructorT>(
+                            tile_state, selection_flags, selection_indices, num_tile_selected, num_selected_prefix,
+                            SumOp(), tile_id, is_last_tile, def(0u));
+
+                        $if(Int(ITEMS_PER_THREAD) > 1 & num_tile_selected > UInt(BLOCK_SIZE))
+                        {
+                            // two phase scatter, compact the tile in shared memory then store it coalesced
+                            sync_block();
+                            for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                            {
+                                $if(selection_flags[item] == 1u)
+                                {
+                                    (*s_items)[selection_indices[item] - num_selected_prefix] = local_items[item];
+                                };
+                            };
+                            sync_block();
+
+                            UInt item = thid;
+                            $while(item < num_tile_selected)
+                            {
+                                d_selected_out.write(num_selected_prefix + item, (*s_items)[item]);
+                                item += block_size_x();
+                            };
+                        }
+                        $else
+                        {
+                            // direct scatter, few selected items
+                            for(auto item = 0u; item < ITEMS_PER_THREAD; ++item)
+                            {
+                                $if(selection_flags[item] == 1u)
+                                {
+                                    d_selected_out.write(selection_indices[item], local_items[item]);
+                                };
+                            };
+                        };
+
+                        $if(is_last_tile & thid == 0)
+                        {
+                            d_num_selected_out.write(0, num_selected_prefix + num_tile_selected);
+                        };
+                    });
+            }(FlagParams<MODE>{});
+
+            return ms_select_shader;
+        }
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
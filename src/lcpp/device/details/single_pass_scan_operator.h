@@ -6,6 +6,7 @@
  */
 #pragma once
 #include <cstddef>
+#include <type_traits>
 #include <luisa/dsl/sugar.h>
 #include <luisa/dsl/func.h>
 #include <luisa/dsl/var.h>
@@ -13,6 +14,7 @@
 #include <luisa/core/basic_traits.h>
 #include <luisa/dsl/resource.h>
 #include <luisa/dsl/struct.h>
+#include <luisa/runtime/device.h>
 #include <lcpp/common/type_trait.h>
 #include <lcpp/common/util_type.h>
 #include <lcpp/common/thread_operators.h>
@@ -43,6 +45,119 @@ struct no_delay_constructor
     [[nodiscard]] delay_t operator()() const noexcept { return delay_t{}; };
 };
 
+// the DSL has no clock or nanosleep, a delay is a counted spin between two polls. a loop without side
+// effects may be deleted by nvcc, DXC or LLVM (every policy would then compile to NO_DELAY), so each
+// iteration bumps a shared counter; atomics are kept and stay on chip, away from the polled tile states
+inline void spin_delay(SmemTypePtr<compute::uint> sink, compute::UInt iterations) noexcept
+{
+    compute::UInt i = compute::def(0u);
+    $while(i < iterations)
+    {
+        sink->atomic(0u).fetch_add(1u);
+        i += 1u;
+    };
+}
+
+template <typename T, compute::uint DELAY = 128>
+struct fixed_delay_constructor
+{
+    SmemTypePtr<compute::uint> sink = new SmemType<compute::uint>{1};
+
+    fixed_delay_constructor(compute::UInt) noexcept {};
+
+    struct delay_t
+    {
+        SmemTypePtr<compute::uint> sink;
+
+        void operator()() const noexcept { spin_delay(sink, compute::UInt(DELAY)); };
+    };
+
+    [[nodiscard]] delay_t operator()() const noexcept { return delay_t{sink}; };
+};
+
+// doubles the wait after every unsuccessful poll, up to MAX_DELAY
+template <typename T, compute::uint INITIAL_DELAY = 16, compute::uint MAX_DELAY = 2048>
+struct exponential_backoff_constructor
+{
+    SmemTypePtr<compute::uint> sink = new SmemType<compute::uint>{1};
+
+    exponential_backoff_constructor(compute::UInt) noexcept {};
+
+    struct delay_t
+    {
+        SmemTypePtr<compute::uint> sink;
+        compute::UInt              delay = compute::def(INITIAL_DELAY);
+
+        void operator()() noexcept
+        {
+            spin_delay(sink, delay);
+            delay = compute::min(delay * 2u, compute::UInt(MAX_DELAY));
+        };
+    };
+
+    [[nodiscard]] delay_t operator()() const noexcept { return delay_t{sink}; };
+};
+
+// staggers neighbouring tiles so their polls do not hit the predecessors in lockstep
+template <typename T, compute::uint DELAY = 32>
+struct tile_index_delay_constructor
+{
+    compute::UInt              tile_index;
+    SmemTypePtr<compute::uint> sink = new SmemType<compute::uint>{1};
+
+    tile_index_delay_constructor(compute::UInt tile_index) noexcept
+        : tile_index{tile_index} {};
+
+    struct delay_t
+    {
+        SmemTypePtr<compute::uint> sink;
+        compute::UInt              delay;
+
+        void operator()() const noexcept { spin_delay(sink, delay); };
+    };
+
+    [[nodiscard]] delay_t operator()() const noexcept
+    {
+        return delay_t{sink, (tile_index % compute::UInt(details::WARP_SIZE) + 1u) * DELAY};
+    };
+};
+
+enum class LookBackDelayPolicy
+{
+    NO_DELAY,
+    FIXED,
+    EXPONENTIAL_BACKOFF,
+    TILE_INDEX
+};
+
+// calls f with std::type_identity of the delay constructor selected by policy
+template <typename T, typename F>
+decltype(auto) visit_delay_constructor(LookBackDelayPolicy policy, F&& f)
+{
+    switch(policy)
+    {
+        case LookBackDelayPolicy::FIXED:
+            return f(std::type_identity<fixed_delay_constructor<T>>{});
+        case LookBackDelayPolicy::EXPONENTIAL_BACKOFF:
+            return f(std::type_identity<exponential_backoff_constructor<T>>{});
+        case LookBackDelayPolicy::TILE_INDEX:
+            return f(std::type_identity<tile_index_delay_constructor<T>>{});
+        default: return f(std::type_identity<no_delay_constructor<T>>{});
+    }
+}
+
+// suffix for shader cache keys, kernels differ per delay policy
+inline const char* look_back_delay_desc(LookBackDelayPolicy policy) noexcept
+{
+    switch(policy)
+    {
+        case LookBackDelayPolicy::FIXED: return "_fixed_delay";
+        case LookBackDelayPolicy::EXPONENTIAL_BACKOFF: return "_exponential_backoff";
+        case LookBackDelayPolicy::TILE_INDEX: return "_tile_index_delay";
+        default: return "";
+    }
+}
+
 
 template <typename T>
 struct ScanTileState
@@ -51,6 +166,71 @@ struct ScanTileState
     T             value;
 };
 
+// status and value packed into one word so a single access publishes or observes both: a 64-bit word
+// (status in the low half) for 4-byte values, a 128-bit word for 4-byte key-value pairs. only used where
+// an aligned access of that width is one transaction (see packed_tile_state_supported), a plain volatile
+// load then polls the word and no atomic read-modify-write is needed
+template <typename T>
+struct packed_tile_word
+{
+    using type = void;
+};
+
+template <NumericT T>
+    requires(sizeof(T) == 4)
+struct packed_tile_word<T>
+{
+    using type = compute::ulong;
+};
+
+template <NumericT KeyType, NumericT ValueType>
+    requires(sizeof(KeyType) == 4 && sizeof(ValueType) == 4)
+struct packed_tile_word<KeyValuePair<KeyType, ValueType>>
+{
+    using type = compute::uint4;
+};
+
+template <typename T>
+concept PackedTileT = !std::is_void_v<typename packed_tile_word<T>::type>;
+
+template <typename T>
+struct PackedScanTileState
+{
+    typename packed_tile_word<T>::type word;
+};
+
+// tile state used by decoupled look-back, packed when the backend allows it and T fits
+template <typename T, bool PACKED = true>
+using ScanTileStateStorage = std::conditional_t<PACKED && PackedTileT<T>, PackedScanTileState<T>, ScanTileState<T>>;
+
+// whether aligned 64-bit and 128-bit buffer accesses are single transactions on this backend (ld/st.v2/v4
+// on CUDA). metal, dx and the cpu backends give no such guarantee, there the status and value keep
+// separate words in ScanTileState
+inline bool packed_tile_state_supported(const compute::Device& device) noexcept
+{
+    return device.backend_name() == "cuda";
+}
+
+// calls f with std::bool_constant of the tile state layout, packed or not
+template <typename F>
+decltype(auto) visit_tile_state_layout(bool packed, F&& f)
+{
+    return packed ? f(std::true_type{}) : f(std::false_type{});
+}
+
+// bytes of one tile state of T in the chosen layout
+template <typename T>
+size_t scan_tile_state_size(bool packed) noexcept
+{
+    return packed ? sizeof(ScanTileStateStorage<T, true>) : sizeof(ScanTileStateStorage<T, false>);
+}
+
+// suffix for shader cache keys, kernels differ per tile state layout
+inline const char* tile_state_layout_desc(bool packed) noexcept
+{
+    return packed ? "_packed" : "";
+}
+
 
 struct ScanTileStateViewer
 {
@@ -196,14 +376,169 @@ struct ScanTileStateViewer
         out_value.value = curr_tile_state.value.value;
     };
 
-    template <typename T>
+    template <typename T, typename DelayT>
     static compute::Var<T> LoadValid(compute::BufferVar<ScanTileState<T>>& tile_state,
                                      compute::Int                          tile_index,
-                                     auto                                  delay) noexcept
+                                     DelayT                                delay) noexcept
     {
-        auto state = tile_state.volatile_read(compute::Int(TILE_STATUS_PADDING) + tile_index);
+        compute::Var<ScanTileState<T>> state = tile_state.volatile_read(compute::Int(TILE_STATUS_PADDING) + tile_index);
+        $while(state.status == StatusWordT(ScanTileStatus::SCAN_TILE_INVALID))
+        {
+            delay();
+            state = tile_state.volatile_read(compute::Int(TILE_STATUS_PADDING) + tile_index);
+        };
         return state.value;
     };
+
+    // packed tile state
+    template <typename T>
+    static void InitializeWardStatus(compute::BufferVar<PackedScanTileState<T>>& tile_state,
+                                     compute::UInt                               num_tile) noexcept
+    {
+        compute::UInt tile_idx = compute::dispatch_id().x;
+
+        compute::Var<PackedScanTileState<T>> state;
+
+        $if(tile_idx < num_tile)
+        {
+            state.word = pack_status<T>(compute::def(StatusWordT(ScanTileStatus::SCAN_TILE_INVALID)));
+            tile_state.write(compute::UInt(TILE_STATUS_PADDING) + tile_idx, state);
+        };
+        $if(compute::block_id().x == 0 & compute::thread_x() < compute::UInt(TILE_STATUS_PADDING))
+        {
+            state.word = pack_status<T>(compute::def(StatusWordT(ScanTileStatus::SCAN_TILE_OBB)));
+            tile_state.write(compute::thread_x(), state);
+        };
+    };
+
+    template <typename T>
+    static void SetInclusive(compute::BufferVar<PackedScanTileState<T>>& tile_state,
+                             compute::Int                                tile_index,
+                             const compute::Var<T>&                      tile_prefix) noexcept
+    {
+        store_word<T>(tile_state,
+                      compute::Int(TILE_STATUS_PADDING) + tile_index,
+                      pack_word<T>(compute::def(StatusWordT(ScanTileStatus::SCAN_TILE_INCLUSIVE)), tile_prefix));
+    };
+
+    template <typename T>
+    static void SetPartial(compute::BufferVar<PackedScanTileState<T>>& tile_state,
+                           compute::Int                                tile_index,
+                           const compute::Var<T>&                      tile_partial) noexcept
+    {
+        store_word<T>(tile_state,
+                      compute::Int(TILE_STATUS_PADDING) + tile_index,
+                      pack_word<T>(compute::def(StatusWordT(ScanTileStatus::SCAN_TILE_PARTIAL)), tile_partial));
+    };
+
+    template <typename T, typename DelayT>
+    static void WaitForValid(compute::BufferVar<PackedScanTileState<T>>& tile_state,
+                             compute::Int                                tile_index,
+                             compute::Var<StatusWordT>&                  out_status,
+                             compute::Var<T>&                            out_value,
+                             DelayT                                      delay) noexcept
+    {
+        auto word = load_word<T>(tile_state, compute::Int(TILE_STATUS_PADDING) + tile_index);
+        $while(compute::warp_active_any(unpack_status<T>(word) == StatusWordT(ScanTileStatus::SCAN_TILE_INVALID)))
+        {
+            delay();
+            word = load_word<T>(tile_state, compute::Int(TILE_STATUS_PADDING) + tile_index);
+        };
+        out_status = unpack_status<T>(word);
+        out_value  = unpack_value<T>(word);
+    };
+
+    template <typename T, typename DelayT>
+    static compute::Var<T> LoadValid(compute::BufferVar<PackedScanTileState<T>>& tile_state,
+                                     compute::Int                                tile_index,
+                                     DelayT                                      delay) noexcept
+    {
+        auto word = load_word<T>(tile_state, compute::Int(TILE_STATUS_PADDING) + tile_index);
+        $while(unpack_status<T>(word) == StatusWordT(ScanTileStatus::SCAN_TILE_INVALID))
+        {
+            delay();
+            word = load_word<T>(tile_state, compute::Int(TILE_STATUS_PADDING) + tile_index);
+        };
+        return unpack_value<T>(word);
+    };
+
+  private:
+    using PackedWordT = compute::ulong;
+
+    // one aligned volatile access of the whole word, a single transaction where packing is enabled
+    template <typename T>
+    static void store_word(compute::BufferVar<PackedScanTileState<T>>&             tile_state,
+                           compute::Int                                            index,
+                           const compute::Var<typename packed_tile_word<T>::type>& word) noexcept
+    {
+        compute::Var<PackedScanTileState<T>> state;
+        state.word = word;
+        tile_state.volatile_write(index, state);
+    }
+
+    template <typename T>
+    static compute::Var<typename packed_tile_word<T>::type> load_word(compute::BufferVar<PackedScanTileState<T>>& tile_state,
+                                                                      compute::Int                                index) noexcept
+    {
+        return tile_state.volatile_read(index).word;
+    }
+
+    template <typename T>
+    static auto pack_status(const compute::Var<StatusWordT>& status) noexcept
+    {
+        if constexpr(KeyValuePairType<T>)
+        {
+            return compute::make_uint4(status, 0u, 0u, 0u);
+        }
+        else
+        {
+            return compute::cast<PackedWordT>(status);
+        }
+    }
+
+    template <typename T>
+    static compute::Var<StatusWordT> unpack_status(const compute::Var<typename packed_tile_word<T>::type>& word) noexcept
+    {
+        if constexpr(KeyValuePairType<T>)
+        {
+            return word.x;
+        }
+        else
+        {
+            return compute::cast<StatusWordT>(word & PackedWordT(0xffffffffu));
+        }
+    }
+
+    template <typename T>
+    static auto pack_word(const compute::Var<StatusWordT>& status, const compute::Var<T>& value) noexcept
+    {
+        if constexpr(KeyValuePairType<T>)
+        {
+            return compute::make_uint4(
+                status, compute::as<compute::uint>(value.key), compute::as<compute::uint>(value.value), 0u);
+        }
+        else
+        {
+            return compute::cast<PackedWordT>(status)
+                   | (compute::cast<PackedWordT>(compute::as<compute::uint>(value)) << PackedWordT(32u));
+        }
+    }
+
+    template <typename T>
+    static compute::Var<T> unpack_value(const compute::Var<typename packed_tile_word<T>::type>& word) noexcept
+    {
+        compute::Var<T> value;
+        if constexpr(KeyValuePairType<T>)
+        {
+            value.key   = compute::as<decltype(T::key)>(word.y);
+            value.value = compute::as<decltype(T::value)>(word.z);
+        }
+        else
+        {
+            value = compute::as<T>(compute::cast<compute::uint>(word >> PackedWordT(32u)));
+        }
+        return value;
+    }
 };
 
 template <typename T>
@@ -216,7 +551,7 @@ struct TilePrefixTempStorage
 
 // Decoupled look-back(warp)
 // only device
-template <typename T, typename ScanOpT, typename ScanTileStateT = ScanTileState<T>, typename DelayConstructorT = no_delay_constructor<T>>
+template <typename T, typename ScanOpT, typename ScanTileStateT = ScanTileStateStorage<T>, typename DelayConstructorT = no_delay_constructor<T>>
 class TilePrefixCallbackOp : public LuisaModule
 {
   public:
@@ -328,6 +663,15 @@ class TilePrefixCallbackOp : public LuisaModule
     }
 };
 
+// block prefix callback for reduce-then-scan, the tile prefix was already computed by the spine pass
+template <typename T>
+struct TilePrefixValueOp
+{
+    Var<T> prefix;
+
+    Var<T> operator()(const Var<T>& block_aggregate) { return prefix; }
+};
+
 }  // namespace luisa::parallel_primitive
 
 #define LUISA_T_TEMPLATE() template <typename U>
@@ -335,6 +679,9 @@ class TilePrefixCallbackOp : public LuisaModule
 #define LUISA_SCANTILESTATE_TRUE_NAME() luisa::parallel_primitive::ScanTileState<U>
 LUISA_TEMPLATE_STRUCT(LUISA_T_TEMPLATE, LUISA_SCANTILESTATE_TRUE_NAME, status, value){};
 
+#define LUISA_PACKEDSCANTILESTATE_NAME() luisa::parallel_primitive::PackedScanTileState<U>
+LUISA_TEMPLATE_STRUCT(LUISA_T_TEMPLATE, LUISA_PACKEDSCANTILESTATE_NAME, word){};
+
 
 #define LUISA_TILEPREFIXTEMPSTORAGE_NAME() luisa::parallel_primitive::TilePrefixTempStorage<U>
 LUISA_TEMPLATE_STRUCT(LUISA_T_TEMPLATE, LUISA_TILEPREFIXTEMPSTORAGE_NAME, exclusive_prefix, inclusive_prefix, block_aggregate){};
\ No newline at end of file
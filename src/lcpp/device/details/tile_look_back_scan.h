@@ -0,0 +1,87 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-17 11:20:37
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-17 11:20:37
+ */
+
+#pragma once
+#include <cstddef>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/var.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/block/block_scan.h>
+#include <lcpp/device/details/single_pass_scan_operator.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    using namespace luisa::compute;
+
+    // exclusive scan of one tile seeded by decoupled look-back, shared by select, partition and run-length encode
+    // tile 0 scans from zero and publishes its aggregate, later tiles resolve their prefix through TilePrefixCallbackOp
+    template <typename ScanT, size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+    struct TileLookBackScan
+    {
+        // block_aggregate is the tile total, exclusive_prefix the total of all previous tiles (zero for tile 0)
+        template <typename DelayConstructorT, typename ScanOp, typename TileStateT>
+        static void ExclusiveScan(BufferVar<TileStateT>&                   tile_state,
+                                  const ArrayVar<ScanT, ITEMS_PER_THREAD>& items,
+                                  ArrayVar<ScanT, ITEMS_PER_THREAD>&       exclusive_output,
+                                  Var<ScanT>&                              block_aggregate,
+                                  Var<ScanT>&                              exclusive_prefix,
+                                  ScanOp                                   scan_op,
+                                  const UInt&                              tile_id,
+                                  const Bool&                              is_last_tile,
+                                  const Var<ScanT>&                        zero)
+        {
+            $if(tile_id == 0)
+            {
+                BlockScan<ScanT, BLOCK_SIZE, ITEMS_PER_THREAD>().ExclusiveScan(
+                    items, exclusive_output, block_aggregate, scan_op, zero);
+                exclusive_prefix = zero;
+
+                $if(!is_last_tile & thread_id().x == 0)
+                {
+                    // first tile
+                    ScanTileStateViewer::SetInclusive(tile_state, 0, block_aggregate);
+                };
+            }
+            $else
+            {
+                auto temp_storage = new SmemType<TilePrefixTempStorage<ScanT>>{1};
+                TilePrefixCallbackOp<ScanT, ScanOp, TileStateT, DelayConstructorT> prefix_op(
+                    tile_state, temp_storage, scan_op, tile_id);
+
+                BlockScan<ScanT, BLOCK_SIZE, ITEMS_PER_THREAD>().ExclusiveScan(items, exclusive_output, scan_op, prefix_op);
+                sync_block();
+
+                block_aggregate  = prefix_op.GetBlockAggregate();
+                exclusive_prefix = prefix_op.GetExclusivePrefix();
+            };
+        }
+
+        // same scan when only the inclusive prefix through this tile is needed
+        template <typename DelayConstructorT, typename ScanOp, typename TileStateT>
+        static void ExclusiveScan(BufferVar<TileStateT>&                   tile_state,
+                                  const ArrayVar<ScanT, ITEMS_PER_THREAD>& items,
+                                  ArrayVar<ScanT, ITEMS_PER_THREAD>&       exclusive_output,
+                                  Var<ScanT>&                              inclusive_prefix,
+                                  ScanOp                                   scan_op,
+                                  const UInt&                              tile_id,
+                                  const Bool&                              is_last_tile,
+                                  const Var<ScanT>&                        zero)
+        {
+            Var<ScanT> block_aggregate;
+            Var<ScanT> exclusive_prefix;
+            ExclusiveScan<DelayConstructorT>(
+                tile_state, items, exclusive_output, block_aggregate, exclusive_prefix, scan_op, tile_id, is_last_tile, zero);
+            inclusive_prefix = scan_op(exclusive_prefix, block_aggregate);
+        }
+    };
+}  // namespace details
+}  // namespace luisa::parallel_primitive
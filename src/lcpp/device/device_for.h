@@ -1,72 +1,285 @@
 /*
- * @Author: Ligo 
- * @Date: 2025-09-19 23:06:17 
+ * @Author: Ligo
+ * @Date: 2025-09-19 23:06:17
  * @Last Modified by: Ligo
- * @Last Modified time: 2025-10-22 23:52:50
+ * @Last Modified time: 2026-10-16 17:46:02
  */
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+#include <luisa/ast/type.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/var.h>
 #include <lcpp/runtime/core.h>
 #include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/device/details/for.h>
 
 namespace luisa::parallel_primitive
 {
 using namespace luisa::compute;
+
+/**
+ * @brief Element-wise passes without hand-written kernels.
+ *
+ * Operators are compiled once per (type, operator type) and cached in the device's ShaderRegistry.
+ * Host values captured by a lambda are baked into the shader on first use, operators whose values
+ * change between calls should be named operators with params() (see ParameterizedOpT). Bulk and
+ * ForEachInExtents take the buffers they write as kernel arguments and reject capturing lambdas.
+ */
+template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
 class DeviceFor : public LuisaModule
 {
+  private:
+    uint m_block_size = BLOCK_SIZE;
+    uint m_warp_nums  = WARP_NUMS;
 
-    // using namespace luisa::compute;
-
-  public:
-    int  m_block_size    = 256;
-    int  m_num_banks     = 32;
-    int  m_log_mem_banks = 5;
-    bool m_created       = false;
+    Device m_device;
+    bool   m_created = false;
 
+    S<ShaderRegistry> m_shaders;
 
   public:
     DeviceFor()  = default;
     ~DeviceFor() = default;
 
-
     void create(Device& device)
     {
-        int num_elements_per_block = m_block_size * 2;
-        int extra_space            = num_elements_per_block / m_num_banks;
-        m_created                  = true;
+        m_device  = device;
+        m_shaders = ShaderRegistry::shared(device);
+        m_created = true;
+    }
+
+    // compiles ahead of time ForEach for these operators plus Fill and Sequence of Type
+    template <NumericT Type, typename... ForOps>
+    void Warmup(ForOps... ops)
+    {
+        fill_shader<Type>();
+        sequence_shader<Type>();
+        (for_each_shader<Type>(ops), ...);
+    }
+
+    /**
+     * @brief Calls op(Var<Type>& item) on the first num_items items of d_data and writes the items
+     * back, e.g. [](Var<float>& x) { x = clamp(x, 0.0f, 1.0f); }.
+     */
+    template <NumericT Type, typename ForOp>
+    void ForEachN(CommandList& cmdlist, BufferView<Type> d_data, size_t num_items, ForOp op)
+    {
+        if(num_items == 0)
+        {
+            return;
+        }
+        auto ms_for_each_ptr = for_each_shader<Type>(op);
+        cmdlist << (*ms_for_each_ptr)(d_data, static_cast<uint>(num_items), op_params(op)).dispatch(grid_threads(num_items));
     }
 
+    template <NumericT Type, typename ForOp>
+    void ForEachN(CommandList& cmdlist, Stream& stream, BufferView<Type> d_data, size_t num_items, ForOp op)
+    {
+        ForEachN(cmdlist, d_data, num_items, op);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type, typename ForOp>
+    void ForEach(CommandList& cmdlist, BufferView<Type> d_data, ForOp op)
+    {
+        ForEachN(cmdlist, d_data, d_data.size(), op);
+    }
+
+    template <NumericT Type, typename ForOp>
+    void ForEach(CommandList& cmdlist, Stream& stream, BufferView<Type> d_data, ForOp op)
+    {
+        ForEachN(cmdlist, stream, d_data, d_data.size(), op);
+    }
+
+    /**
+     * @brief Calls op(UInt index, BufferVar<Ts>&... buffers) for every index in [0, num_items).
+     *
+     * The buffers are kernel arguments, so the same operator can target other buffers on the next
+     * call, e.g. Bulk(cmdlist, n, [](const UInt& i, BufferVar<uint>& out) { out.write(i, i); }, d_out).
+     */
+    template <typename ForOp, typename... Ts>
+    void Bulk(CommandList& cmdlist, size_t num_items, ForOp op, BufferView<Ts>... buffers)
+    {
+        if(num_items == 0)
+        {
+            return;
+        }
+        auto ms_bulk_ptr = bulk_shader<Ts...>(op);
+        cmdlist << (*ms_bulk_ptr)(static_cast<uint>(num_items), op_params(op), buffers...).dispatch(grid_threads(num_items));
+    }
+
+    template <typename ForOp, typename... Ts>
+    void Bulk(CommandList& cmdlist, Stream& stream, size_t num_items, ForOp op, BufferView<Ts>... buffers)
+    {
+        Bulk(cmdlist, num_items, op, buffers...);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    // calls op(UInt index, UInt3 coord, BufferVar<Ts>&... buffers) for every coord within extents, x the fastest dimension
+    template <typename ForOp, typename... Ts>
+    void ForEachInExtents(CommandList& cmdlist, uint3 extents, ForOp op, BufferView<Ts>... buffers)
+    {
+        size_t num_items = static_cast<size_t>(extents.x) * extents.y * extents.z;
+        if(num_items == 0)
+        {
+            return;
+        }
+        auto ms_extents_ptr = extents_shader<Ts...>(op);
+        cmdlist << (*ms_extents_ptr)(extents, op_params(op), buffers...).dispatch(grid_threads(num_items));
+    }
+
+    template <typename ForOp, typename... Ts>
+    void ForEachInExtents(CommandList& cmdlist, Stream& stream, uint3 extents, ForOp op, BufferView<Ts>... buffers)
+    {
+        ForEachInExtents(cmdlist, extents, op, buffers...);
+        stream << cmdlist.commit() << synchronize();
+    }
 
-    template <NumericT Type4Byte>
-    void for_each(CommandList&          cmdlist,
-                  BufferView<Type4Byte> temp_buffer,
-                  size_t                num_item,
-                  Callable<Type4Byte>   op)
+    // d_data[i] = value, the value is a kernel argument
+    template <NumericT Type>
+    void Fill(CommandList& cmdlist, BufferView<Type> d_data, Type value)
     {
+        if(d_data.size() == 0)
+        {
+            return;
+        }
+        auto ms_fill_ptr = fill_shader<Type>();
+        cmdlist << (*ms_fill_ptr)(d_data, static_cast<uint>(d_data.size()), value).dispatch(grid_threads(d_data.size()));
     }
 
-    template <NumericT Type4Byte>
-    void for_each_n(CommandList&          cmdlist,
-                    BufferView<Type4Byte> temp_buffer,
-                    size_t                num_item,
-                    Callable<Type4Byte>   op)
+    template <NumericT Type>
+    void Fill(CommandList& cmdlist, Stream& stream, BufferView<Type> d_data, Type value)
     {
+        Fill(cmdlist, d_data, value);
+        stream << cmdlist.commit() << synchronize();
     }
 
+    // d_data[i] = init + i, like std::iota
+    template <NumericT Type>
+    void Sequence(CommandList& cmdlist, BufferView<Type> d_data, Type init = Type{0})
+    {
+        if(d_data.size() == 0)
+        {
+            return;
+        }
+        auto ms_sequence_ptr = sequence_shader<Type>();
+        cmdlist << (*ms_sequence_ptr)(d_data, static_cast<uint>(d_data.size()), init).dispatch(grid_threads(d_data.size()));
+    }
 
-    template <NumericT Type4Byte>
-    void for_each_extents(CommandList&          cmdlist,
-                          BufferView<Type4Byte> temp_buffer,
-                          size_t                num_item,
-                          Callable<Type4Byte>   op)
+    template <NumericT Type>
+    void Sequence(CommandList& cmdlist, Stream& stream, BufferView<Type> d_data, Type init = Type{0})
     {
+        Sequence(cmdlist, d_data, init);
+        stream << cmdlist.commit() << synchronize();
     }
 
   private:
-    template <NumericT Type4Byte>
-    void compile(Device& device)
+    using ForShader = details::ForModule<BLOCK_SIZE, ITEMS_PER_THREAD>;
+
+    // the shader is cached per operator type, whatever a lambda captures would be baked into the
+    // first compile and silently reused, only the params() of named operators may vary per call
+    template <typename ForOp>
+    static constexpr bool STATELESS_OP = std::is_empty_v<ForOp> || ParameterizedOpT<ForOp>;
+
+    template <typename... Ts, typename ForOp>
+    static luisa::string buffers_op_desc(ForOp op)
+    {
+        luisa::string desc{op_desc(op)};
+        ((desc += luisa::string{"+"} + luisa::string{luisa::compute::Type::of<Ts>()->description()}), ...);
+        return desc;
+    }
+
+    // one block per tile of BLOCK_SIZE * ITEMS_PER_THREAD items
+    uint grid_threads(size_t num_items) const noexcept
+    {
+        return ceil_div(static_cast<uint>(num_items), ForShader::TILE_ITEMS) * m_block_size;
+    }
+
+    template <NumericT Type, typename ForOp>
+    auto for_each_shader(ForOp op)
+    {
+        using ForEachKernel = ForShader::template ForEachKernel<Type>;
+
+        constexpr auto key = shader_key<"for_each", DeviceFor, ForShader, Type, ForOp>();
+        return m_shaders->get_or_compile<ForEachKernel>(key, [&]
+        {
+            auto desc    = get_type_and_op_desc<Type>(op);
+            auto compile = [device = m_device, op]() mutable
+            { return ForShader().template compile_for_each<Type>(device, op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <typename... Ts, typename ForOp>
+    auto bulk_shader(ForOp op)
+    {
+        static_assert(STATELESS_OP<ForOp>, "Bulk operators must not capture, pass the buffers they write as arguments.");
+        using BulkKernel = ForShader::template BulkKernel<Ts...>;
+
+        constexpr auto key = shader_key<"bulk", DeviceFor, ForShader, ForOp, Ts...>();
+        return m_shaders->get_or_compile<BulkKernel>(key, [&]
+        {
+            auto compile = [device = m_device, op]() mutable { return ForShader().template compile_bulk<Ts...>(device, op); };
+            return compile_async(shader_cache_module(key.name), buffers_op_desc<Ts...>(op), std::move(compile));
+        });
+    }
+
+    template <typename... Ts, typename ForOp>
+    auto extents_shader(ForOp op)
+    {
+        static_assert(STATELESS_OP<ForOp>,
+                      "ForEachInExtents operators must not capture, pass the buffers they write as arguments.");
+        using ExtentsKernel = ForShader::template ExtentsKernel<Ts...>;
+
+        constexpr auto key = shader_key<"for_each_in_extents", DeviceFor, ForShader, ForOp, Ts...>();
+        return m_shaders->get_or_compile<ExtentsKernel>(key, [&]
+        {
+            auto compile = [device = m_device, op]() mutable
+            { return ForShader().template compile_extents<Ts...>(device, op); };
+            return compile_async(shader_cache_module(key.name), buffers_op_desc<Ts...>(op), std::move(compile));
+        });
+    }
+
+    template <NumericT Type>
+    auto fill_shader()
+    {
+        using FillKernel = ForShader::template FillKernel<Type>;
+
+        constexpr auto key = shader_key<"fill", DeviceFor, ForShader, Type>();
+        return m_shaders->get_or_compile<FillKernel>(key, [&]
+        {
+            auto desc    = luisa::string{luisa::compute::Type::of<Type>()->description()};
+            auto compile = [device = m_device]() mutable { return ForShader().template compile_fill<Type>(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type>
+    auto sequence_shader()
+    {
+        using SequenceKernel = ForShader::template FillKernel<Type>;
+
+        constexpr auto key = shader_key<"sequence", DeviceFor, ForShader, Type>();
+        return m_shaders->get_or_compile<SequenceKernel>(key, [&]
+        {
+            auto desc    = luisa::string{luisa::compute::Type::of<Type>()->description()};
+            auto compile = [device = m_device]() mutable { return ForShader().template compile_sequence<Type>(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
     {
-        const auto n_blocks = m_block_size;
+        return luisa::format("DeviceFor<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
     }
 };
-}  // namespace luisa::parallel_primitive
\ No newline at end of file
+}  // namespace luisa::parallel_primitive
@@ -1,12 +1,14 @@
 /*
- * @Author: Ligo 
- * @Date: 2025-11-12 14:42:25 
+ * @Author: Ligo
+ * @Date: 2025-11-12 14:42:25
  * @Last Modified by: Ligo
- * @Last Modified time: 2025-11-12 16:43:49
+ * @Last Modified time: 2026-10-16 16:48:12
  */
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <span>
 #include <luisa/core/mathematics.h>
 #include <luisa/dsl/local.h>
 #include <limits>
@@ -16,24 +18,548 @@
 #include <luisa/dsl/struct.h>
 #include <luisa/core/logging.h>
 #include <luisa/core/stl/memory.h>
+#include <luisa/core/stl/format.h>
 #include <luisa/dsl/builtin.h>
 #include <luisa/dsl/resource.h>
 #include <luisa/dsl/sugar.h>
 #include <luisa/dsl/var.h>
 #include <cstddef>
 #include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
 #include <lcpp/common/type_trait.h>
 #include <lcpp/common/util_type.h>
 #include <lcpp/common/thread_operators.h>
 #include <lcpp/common/utils.h>
 #include <lcpp/agent/policy.h>
+#include <lcpp/device/details/histogram.h>
 
 namespace luisa::parallel_primitive
 {
 
 using namespace luisa::compute;
 template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
-class DeviceDeviceHistogram : public LuisaModule
+class DeviceHistogram : public LuisaModule
 {
+  private:
+    uint m_block_size = BLOCK_SIZE;
+    uint m_warp_nums  = WARP_NUMS;
+
+    Device m_device;
+    bool   m_created = false;
+
+    bool m_rle_compress  = false;
+    bool m_work_stealing = false;
+
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
+  public:
+    DeviceHistogram()  = default;
+    ~DeviceHistogram() = default;
+
+    void create(Device& device)
+    {
+        m_device    = device;
+        m_allocator = CachingAllocator::shared(device);
+        m_shaders   = ShaderRegistry::shared(device);
+        m_created   = true;
+    }
+
+    // count runs of equal bins per thread before the atomics, pays off on smooth images (luminance, depth)
+    void set_rle_compress(bool enable) noexcept { m_rle_compress = enable; }
+
+    [[nodiscard]] bool rle_compress() const noexcept { return m_rle_compress; }
+
+    // blocks dequeue tiles from a global counter instead of striding, evens out uneven tile costs
+    void set_work_stealing(bool enable) noexcept { m_work_stealing = enable; }
+
+    [[nodiscard]] bool work_stealing() const noexcept { return m_work_stealing; }
+
+    /**
+     * @brief Compiles ahead of time the even and range histogram shaders for this sample type and
+     * channel layout under the current RLE and work-stealing settings.
+     */
+    template <NumericT SampleT, size_t NUM_CHANNELS = 1, size_t NUM_ACTIVE_CHANNELS = 1>
+    void Warmup()
+    {
+        histogram_clear_shader();
+        histogram_shader<SampleT, NUM_CHANNELS, NUM_ACTIVE_CHANNELS, true>();
+        histogram_shader<SampleT, NUM_CHANNELS, NUM_ACTIVE_CHANNELS, false>();
+    }
+
+    /**
+     * @brief num_levels - 1 equal-width bins over [lower_level, upper_level), samples outside are
+     * ignored. d_histogram is overwritten.
+     */
+    template <NumericT SampleT>
+    void HistogramEven(CommandList&        cmdlist,
+                       ByteBufferView      temp_storage,
+                       size_t&             temp_storage_bytes,
+                       BufferView<SampleT> d_samples,
+                       BufferView<uint>    d_histogram,
+                       int                 num_levels,
+                       SampleT             lower_level,
+                       SampleT             upper_level,
+                       size_t              num_samples)
+    {
+        MultiHistogramEven<1, 1, SampleT>(
+            cmdlist, temp_storage, temp_storage_bytes, d_samples, {d_histogram}, {num_levels}, {lower_level}, {upper_level}, num_samples);
+    }
+
+    template <NumericT SampleT>
+    void HistogramEven(CommandList&        cmdlist,
+                       Stream&             stream,
+                       ByteBufferView      temp_storage,
+                       size_t&             temp_storage_bytes,
+                       BufferView<SampleT> d_samples,
+                       BufferView<uint>    d_histogram,
+                       int                 num_levels,
+                       SampleT             lower_level,
+                       SampleT             upper_level,
+                       size_t              num_samples)
+    {
+        HistogramEven(
+            cmdlist, temp_storage, temp_storage_bytes, d_samples, d_histogram, num_levels, lower_level, upper_level, num_samples);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT SampleT>
+    void HistogramEven(CommandList&        cmdlist,
+                       BufferView<SampleT> d_samples,
+                       BufferView<uint>    d_histogram,
+                       int                 num_levels,
+                       SampleT             lower_level,
+                       SampleT             upper_level,
+                       size_t              num_samples)
+    {
+        size_t temp_storage_bytes = 0;
+        HistogramEven(
+            cmdlist, temp_storage_query(), temp_storage_bytes, d_samples, d_histogram, num_levels, lower_level, upper_level, num_samples);
+        HistogramEven(cmdlist,
+                      m_allocator->allocate(cmdlist, temp_storage_bytes),
+                      temp_storage_bytes,
+                      d_samples,
+                      d_histogram,
+                      num_levels,
+                      lower_level,
+                      upper_level,
+                      num_samples);
+    }
+
+    template <NumericT SampleT>
+    void HistogramEven(CommandList&        cmdlist,
+                       Stream&             stream,
+                       BufferView<SampleT> d_samples,
+                       BufferView<uint>    d_histogram,
+                       int                 num_levels,
+                       SampleT             lower_level,
+                       SampleT             upper_level,
+                       size_t              num_samples)
+    {
+        HistogramEven(cmdlist, d_samples, d_histogram, num_levels, lower_level, upper_level, num_samples);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    /**
+     * @brief num_levels - 1 bins, bin i counts samples in [d_levels[i], d_levels[i + 1]); the bin of
+     * a sample is found by binary search over the ascending levels.
+     */
+    template <NumericT SampleT>
+    void HistogramRange(CommandList&        cmdlist,
+                        ByteBufferView      temp_storage,
+                        size_t&             temp_storage_bytes,
+                        BufferView<SampleT> d_samples,
+                        BufferView<uint>    d_histogram,
+                        int                 num_levels,
+                        BufferView<SampleT> d_levels,
+                        size_t              num_samples)
+    {
+        MultiHistogramRange<1, 1, SampleT>(
+            cmdlist, temp_storage, temp_storage_bytes, d_samples, {d_histogram}, {num_levels}, {d_levels}, num_samples);
+    }
+
+    template <NumericT SampleT>
+    void HistogramRange(CommandList&        cmdlist,
+                        Stream&             stream,
+                        ByteBufferView      temp_storage,
+                        size_t&             temp_storage_bytes,
+                        BufferView<SampleT> d_samples,
+                        BufferView<uint>    d_histogram,
+                        int                 num_levels,
+                        BufferView<SampleT> d_levels,
+                        size_t              num_samples)
+    {
+        HistogramRange(cmdlist, temp_storage, temp_storage_bytes, d_samples, d_histogram, num_levels, d_levels, num_samples);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT SampleT>
+    void HistogramRange(CommandList&        cmdlist,
+                        BufferView<SampleT> d_samples,
+                        BufferView<uint>    d_histogram,
+                        int                 num_levels,
+                        BufferView<SampleT> d_levels,
+                        size_t              num_samples)
+    {
+        size_t temp_storage_bytes = 0;
+        HistogramRange(cmdlist, temp_storage_query(), temp_storage_bytes, d_samples, d_histogram, num_levels, d_levels, num_samples);
+        HistogramRange(cmdlist,
+                       m_allocator->allocate(cmdlist, temp_storage_bytes),
+                       temp_storage_bytes,
+                       d_samples,
+                       d_histogram,
+                       num_levels,
+                       d_levels,
+                       num_samples);
+    }
+
+    template <NumericT SampleT>
+    void HistogramRange(CommandList&        cmdlist,
+                        Stream&             stream,
+                        BufferView<SampleT> d_samples,
+                        BufferView<uint>    d_histogram,
+                        int                 num_levels,
+                        BufferView<SampleT> d_levels,
+                        size_t              num_samples)
+    {
+        HistogramRange(cmdlist, d_samples, d_histogram, num_levels, d_levels, num_samples);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    /**
+     * @brief Even histograms of the first NUM_ACTIVE_CHANNELS channels of pixels stored as
+     * NUM_CHANNELS interleaved samples, e.g. MultiHistogramEven<4, 3> for the RGB of RGBA.
+     */
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, NumericT SampleT>
+    void MultiHistogramEven(CommandList&                                             cmdlist,
+                            ByteBufferView                                           temp_storage,
+                            size_t&                                                  temp_storage_bytes,
+                            BufferView<SampleT>                                      d_samples,
+                            const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>& d_histogram,
+                            const std::array<int, NUM_ACTIVE_CHANNELS>&              num_levels,
+                            const std::array<SampleT, NUM_ACTIVE_CHANNELS>&          lower_level,
+                            const std::array<SampleT, NUM_ACTIVE_CHANNELS>&          upper_level,
+                            size_t                                                   num_pixels)
+    {
+        auto params = histogram_params<SampleT, NUM_ACTIVE_CHANNELS>(num_levels);
+        for(size_t channel = 0; channel < NUM_ACTIVE_CHANNELS; channel++)
+        {
+            params.lower_levels[channel] = lower_level[channel];
+            params.upper_levels[channel] = upper_level[channel];
+        }
+        histogram_array<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, true, SampleT>(
+            cmdlist, temp_storage, temp_storage_bytes, d_samples, d_histogram, {}, params, num_pixels);
+    }
+
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, NumericT SampleT>
+    void MultiHistogramEven(CommandList&                                             cmdlist,
+                            Stream&                                                  stream,
+                            ByteBufferView                                           temp_storage,
+                            size_t&                                                  temp_storage_bytes,
+                            BufferView<SampleT>                                      d_samples,
+                            const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>& d_histogram,
+                            const std::array<int, NUM_ACTIVE_CHANNELS>&              num_levels,
+                            const std::array<SampleT, NUM_ACTIVE_CHANNELS>&          lower_level,
+                            const std::array<SampleT, NUM_ACTIVE_CHANNELS>&          upper_level,
+                            size_t                                                   num_pixels)
+    {
+        MultiHistogramEven<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, SampleT>(
+            cmdlist, temp_storage, temp_storage_bytes, d_samples, d_histogram, num_levels, lower_level, upper_level, num_pixels);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, NumericT SampleT>
+    void MultiHistogramEven(CommandList&                                             cmdlist,
+                            BufferView<SampleT>                                      d_samples,
+                            const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>& d_histogram,
+                            const std::array<int, NUM_ACTIVE_CHANNELS>&              num_levels,
+                            const std::array<SampleT, NUM_ACTIVE_CHANNELS>&          lower_level,
+                            const std::array<SampleT, NUM_ACTIVE_CHANNELS>&          upper_level,
+                            size_t                                                   num_pixels)
+    {
+        size_t temp_storage_bytes = 0;
+        MultiHistogramEven<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, SampleT>(
+            cmdlist, temp_storage_query(), temp_storage_bytes, d_samples, d_histogram, num_levels, lower_level, upper_level, num_pixels);
+        MultiHistogramEven<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, SampleT>(cmdlist,
+                                                                      m_allocator->allocate(cmdlist, temp_storage_bytes),
+                                                                      temp_storage_bytes,
+                                                                      d_samples,
+                                                                      d_histogram,
+                                                                      num_levels,
+                                                                      lower_level,
+                                                                      upper_level,
+                                                                      num_pixels);
+    }
+
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, NumericT SampleT>
+    void MultiHistogramEven(CommandList&                                             cmdlist,
+                            Stream&                                                  stream,
+                            BufferView<SampleT>                                      d_samples,
+                            const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>& d_histogram,
+                            const std::array<int, NUM_ACTIVE_CHANNELS>&              num_levels,
+                            const std::array<SampleT, NUM_ACTIVE_CHANNELS>&          lower_level,
+                            const std::array<SampleT, NUM_ACTIVE_CHANNELS>&          upper_level,
+                            size_t                                                   num_pixels)
+    {
+        MultiHistogramEven<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, SampleT>(
+            cmdlist, d_samples, d_histogram, num_levels, lower_level, upper_level, num_pixels);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    // range histograms of the first NUM_ACTIVE_CHANNELS interleaved channels, one level array per channel
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, NumericT SampleT>
+    void MultiHistogramRange(CommandList&                                                cmdlist,
+                             ByteBufferView                                              temp_storage,
+                             size_t&                                                     temp_storage_bytes,
+                             BufferView<SampleT>                                         d_samples,
+                             const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>&    d_histogram,
+                             const std::array<int, NUM_ACTIVE_CHANNELS>&                 num_levels,
+                             const std::array<BufferView<SampleT>, NUM_ACTIVE_CHANNELS>& d_levels,
+                             size_t                                                      num_pixels)
+    {
+        auto params = histogram_params<SampleT, NUM_ACTIVE_CHANNELS>(num_levels);
+        histogram_array<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, false, SampleT>(
+            cmdlist, temp_storage, temp_storage_bytes, d_samples, d_histogram, d_levels, params, num_pixels);
+    }
+
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, NumericT SampleT>
+    void MultiHistogramRange(CommandList&                                                cmdlist,
+                             Stream&                                                     stream,
+                             ByteBufferView                                              temp_storage,
+                             size_t&                                                     temp_storage_bytes,
+                             BufferView<SampleT>                                         d_samples,
+                             const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>&    d_histogram,
+                             const std::array<int, NUM_ACTIVE_CHANNELS>&                 num_levels,
+                             const std::array<BufferView<SampleT>, NUM_ACTIVE_CHANNELS>& d_levels,
+                             size_t                                                      num_pixels)
+    {
+        MultiHistogramRange<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, SampleT>(
+            cmdlist, temp_storage, temp_storage_bytes, d_samples, d_histogram, num_levels, d_levels, num_pixels);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, NumericT SampleT>
+    void MultiHistogramRange(CommandList&                                                cmdlist,
+                             BufferView<SampleT>                                         d_samples,
+                             const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>&    d_histogram,
+                             const std::array<int, NUM_ACTIVE_CHANNELS>&                 num_levels,
+                             const std::array<BufferView<SampleT>, NUM_ACTIVE_CHANNELS>& d_levels,
+                             size_t                                                      num_pixels)
+    {
+        size_t temp_storage_bytes = 0;
+        MultiHistogramRange<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, SampleT>(
+            cmdlist, temp_storage_query(), temp_storage_bytes, d_samples, d_histogram, num_levels, d_levels, num_pixels);
+        MultiHistogramRange<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, SampleT>(cmdlist,
+                                                                       m_allocator->allocate(cmdlist, temp_storage_bytes),
+                                                                       temp_storage_bytes,
+                                                                       d_samples,
+                                                                       d_histogram,
+                                                                       num_levels,
+                                                                       d_levels,
+                                                                       num_pixels);
+    }
+
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, NumericT SampleT>
+    void MultiHistogramRange(CommandList&                                                cmdlist,
+                             Stream&                                                     stream,
+                             BufferView<SampleT>                                         d_samples,
+                             const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>&    d_histogram,
+                             const std::array<int, NUM_ACTIVE_CHANNELS>&                 num_levels,
+                             const std::array<BufferView<SampleT>, NUM_ACTIVE_CHANNELS>& d_levels,
+                             size_t                                                      num_pixels)
+    {
+        MultiHistogramRange<NUM_CHANNELS, NUM_ACTIVE_CHANNELS, SampleT>(
+            cmdlist, d_samples, d_histogram, num_levels, d_levels, num_pixels);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+  private:
+    static constexpr uint TILE_PIXELS = BLOCK_SIZE * ITEMS_PER_THREAD;
+    // enough blocks to fill the device, few enough that flushing the private bins stays cheap
+    static constexpr uint HISTOGRAM_MAX_GRID_SIZE = 1024;
+
+    template <NumericT SampleT, size_t NUM_ACTIVE_CHANNELS>
+    details::HistogramParams<SampleT> histogram_params(const std::array<int, NUM_ACTIVE_CHANNELS>& num_levels)
+    {
+        details::HistogramParams<SampleT> params;
+        for(size_t channel = 0; channel < NUM_ACTIVE_CHANNELS; channel++)
+        {
+            auto bins                     = static_cast<uint>(std::max(num_levels[channel] - 1, 0));
+            params.num_bins[channel]      = bins;
+            params.bin_offsets[channel]   = params.total_bins;
+            params.level_offsets[channel] = params.total_levels;
+            params.total_bins += bins;
+            params.total_levels += bins + 1;
+        }
+        return params;
+    }
+
+    template <NumericT SampleT, size_t NUM_ACTIVE_CHANNELS, bool IS_EVEN>
+    TempStorageLayout<3> histogram_temp_storage_layout(const details::HistogramParams<SampleT>& params)
+    {
+        // a single channel counts straight into d_histogram and searches the caller's levels
+        constexpr bool STAGED = NUM_ACTIVE_CHANNELS > 1;
+        return TempStorageLayout<3>{{
+            // work-stealing tile counter
+            sizeof(uint),
+            // channel histograms back to back
+            STAGED ? params.total_bins * sizeof(uint) : 0u,
+            // channel levels back to back
+            STAGED && !IS_EVEN ? params.total_levels * sizeof(SampleT) : 0u,
+        }};
+    }
+
+    template <size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, bool IS_EVEN, NumericT SampleT>
+    void histogram_array(CommandList&                                             cmdlist,
+                         ByteBufferView                                           temp_storage,
+                         size_t&                                                  temp_storage_bytes,
+                         BufferView<SampleT>                                      d_samples,
+                         const std::array<BufferView<uint>, NUM_ACTIVE_CHANNELS>& d_histogram,
+                         std::span<const BufferView<SampleT>>                     d_levels,
+                         const details::HistogramParams<SampleT>&                 params,
+                         size_t                                                   num_pixels)
+    {
+        constexpr bool STAGED = NUM_ACTIVE_CHANNELS > 1;
+
+        auto layout = histogram_temp_storage_layout<SampleT, NUM_ACTIVE_CHANNELS, IS_EVEN>(params);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+
+        auto ms_histogram_clear_ptr = histogram_clear_shader();
+        auto ms_histogram_ptr       = histogram_shader<SampleT, NUM_CHANNELS, NUM_ACTIVE_CHANNELS, IS_EVEN>();
+
+        auto d_tile_queue = layout.get<uint>(temp_storage, 0);
+        auto d_bins       = STAGED ? layout.get<uint>(temp_storage, 1) : d_histogram[0];
+        // even bins never read the levels, any buffer of the sample type binds the argument
+        auto d_level_view = d_samples;
+        if constexpr(!IS_EVEN)
+        {
+            if constexpr(STAGED)
+            {
+                d_level_view = layout.get<SampleT>(temp_storage, 2);
+                for(size_t channel = 0; channel < NUM_ACTIVE_CHANNELS; channel++)
+                {
+                    uint channel_levels = params.num_bins[channel] + 1;
+                    if(params.num_bins[channel] > 0)
+                    {
+                        cmdlist << d_level_view.subview(params.level_offsets[channel], channel_levels)
+                                       .copy_from(d_levels[channel].subview(0, channel_levels));
+                    }
+                }
+            }
+            else
+            {
+                d_level_view = d_levels[0];
+            }
+        }
+
+        if(m_work_stealing)
+        {
+            cmdlist << (*ms_histogram_clear_ptr)(d_tile_queue, 1u).dispatch(m_block_size);
+        }
+        if(params.total_bins == 0)
+        {
+            return;
+        }
+        cmdlist << (*ms_histogram_clear_ptr)(d_bins, params.total_bins)
+                       .dispatch(ceil_div(params.total_bins, m_block_size) * m_block_size);
+
+        uint num_tiles = ceil_div(static_cast<uint>(num_pixels), TILE_PIXELS);
+        uint grid_size = std::min(num_tiles, HISTOGRAM_MAX_GRID_SIZE);
+        if(grid_size > 0)
+        {
+            cmdlist << (*ms_histogram_ptr)(d_samples,
+                                           d_level_view,
+                                           d_bins,
+                                           d_tile_queue,
+                                           static_cast<uint>(num_pixels),
+                                           params.total_bins,
+                                           params.num_bins,
+                                           params.bin_offsets,
+                                           params.lower_levels,
+                                           params.upper_levels,
+                                           params.level_offsets)
+                           .dispatch(grid_size * m_block_size);
+        }
+
+        if constexpr(STAGED)
+        {
+            for(size_t channel = 0; channel < NUM_ACTIVE_CHANNELS; channel++)
+            {
+                uint channel_bins = params.num_bins[channel];
+                if(channel_bins > 0)
+                {
+                    cmdlist << d_histogram[channel].subview(0, channel_bins)
+                                   .copy_from(d_bins.subview(params.bin_offsets[channel], channel_bins));
+                }
+            }
+        }
+    }
+
+    auto histogram_clear_shader()
+    {
+        using ClearShader = details::ClearModule<BLOCK_SIZE>;
+        using ClearKernel = ClearShader::ClearKernel;
+
+        // keyed by the module alone, radix sort and histogram share one clear shader per device
+        constexpr auto key = shader_key<"clear", ClearShader>();
+        return m_shaders->get_or_compile<ClearKernel>(key, [&]
+        {
+            auto compile = [device = m_device]() mutable { return ClearShader().compile(device); };
+            return compile_async(shader_cache_module(key.name), "uint", std::move(compile));
+        });
+    }
+
+    template <NumericT SampleT, size_t NUM_CHANNELS, size_t NUM_ACTIVE_CHANNELS, bool IS_EVEN>
+    auto histogram_shader()
+    {
+        using HistogramShader =
+            details::HistogramModule<SampleT, NUM_CHANNELS, NUM_ACTIVE_CHANNELS, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using HistogramKernel = HistogramShader::HistogramKernel;
+
+        const auto key = shader_key<"histogram", DeviceHistogram, HistogramShader, std::bool_constant<IS_EVEN>>(
+            static_cast<uint64_t>(m_rle_compress) | static_cast<uint64_t>(m_work_stealing) << 1);
+        return m_shaders->get_or_compile<HistogramKernel>(key, [&]
+        {
+            auto desc = luisa::format("{}+{}/{}{}{}{}",
+                                      luisa::compute::Type::of<SampleT>()->description(),
+                                      NUM_CHANNELS,
+                                      NUM_ACTIVE_CHANNELS,
+                                      IS_EVEN ? "_even" : "_range",
+                                      m_rle_compress ? "_rle" : "",
+                                      m_work_stealing ? "_work_stealing" : "");
+            auto compile = [device = m_device, rle_compress = m_rle_compress, work_stealing = m_work_stealing]() mutable
+            {
+                HistogramShader module;
+                if(rle_compress)
+                {
+                    return work_stealing ? module.template compile<IS_EVEN, true, true>(device) :
+                                           module.template compile<IS_EVEN, true, false>(device);
+                }
+                return work_stealing ? module.template compile<IS_EVEN, false, true>(device) :
+                                       module.template compile<IS_EVEN, false, false>(device);
+            };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceHistogram<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
 };
-}  // namespace luisa::parallel_primitive
\ No newline at end of file
+}  // namespace luisa::parallel_primitive
@@ -0,0 +1,523 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 21:47:10
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 21:47:10
+ */
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+#include <luisa/core/basic_traits.h>
+#include <luisa/ast/type.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/memory.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/var.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/device/details/merge_sort.h>
+
+namespace luisa::parallel_primitive
+{
+
+using namespace luisa::compute;
+
+/**
+ * @brief Comparison sort for keys radix sort can not handle, structs or custom orders: every tile
+ * is sorted by BlockMergeSort, then log2(num_tiles) passes merge pairs of sorted runs, each pass
+ * splitting the merge evenly over the tiles by merge path partitions. The sort is stable.
+ */
+template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+class DeviceMergeSort : public LuisaModule
+{
+  private:
+    uint m_block_size = BLOCK_SIZE;
+    uint m_warp_nums  = WARP_NUMS;
+
+    Device m_device;
+    bool   m_created = false;
+
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
+  public:
+    DeviceMergeSort()  = default;
+    ~DeviceMergeSort() = default;
+
+    void create(Device& device)
+    {
+        m_device    = device;
+        m_allocator = CachingAllocator::shared(device);
+        m_shaders   = ShaderRegistry::shared(device);
+        m_created   = true;
+    }
+
+    // compiles ahead of time SortKeys of KeyType for these comparators
+    template <typename KeyType, typename... CompareOps>
+    void Warmup(CompareOps... compare_ops)
+    {
+        ((block_sort_shader<true, KeyType, KeyType>(compare_ops),
+          merge_partition_shader<KeyType>(compare_ops),
+          merge_shader<true, KeyType, KeyType>(compare_ops)),
+         ...);
+    }
+
+    /**
+     * @brief Sorts the keys with compare_op(a, b), true when a goes before b, and moves the values along,
+     * e.g. hits by material then depth: a.material < b.material | (a.material == b.material & a.depth < b.depth).
+     */
+    template <typename KeyType, typename ValueType, typename CompareOp>
+    void SortPairs(CommandList&          cmdlist,
+                   ByteBufferView        temp_storage,
+                   size_t&               temp_storage_bytes,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   size_t                num_items,
+                   CompareOp             compare_op)
+    {
+        merge_sort<false, KeyType, ValueType>(
+            cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, d_values_in, d_values_out, num_items, compare_op);
+    }
+
+    template <typename KeyType, typename ValueType, typename CompareOp>
+    void SortPairs(CommandList&          cmdlist,
+                   Stream&               stream,
+                   ByteBufferView        temp_storage,
+                   size_t&               temp_storage_bytes,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   size_t                num_items,
+                   CompareOp             compare_op)
+    {
+        SortPairs(cmdlist,
+                  temp_storage,
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items,
+                  compare_op);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <typename KeyType, typename ValueType, typename CompareOp>
+    void SortPairs(CommandList&          cmdlist,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   size_t                num_items,
+                   CompareOp             compare_op)
+    {
+        size_t temp_storage_bytes = 0;
+        SortPairs(cmdlist,
+                  temp_storage_query(),
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items,
+                  compare_op);
+        SortPairs(cmdlist,
+                  m_allocator->allocate(cmdlist, temp_storage_bytes),
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items,
+                  compare_op);
+    }
+
+    template <typename KeyType, typename ValueType, typename CompareOp>
+    void SortPairs(CommandList&          cmdlist,
+                   Stream&               stream,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   size_t                num_items,
+                   CompareOp             compare_op)
+    {
+        SortPairs(cmdlist, d_keys_in, d_keys_out, d_values_in, d_values_out, num_items, compare_op);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    // sorts the keys with compare_op(a, b), true when a goes before b
+    template <typename KeyType, typename CompareOp>
+    void SortKeys(CommandList&        cmdlist,
+                  ByteBufferView      temp_storage,
+                  size_t&             temp_storage_bytes,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  size_t              num_items,
+                  CompareOp           compare_op)
+    {
+        merge_sort<true, KeyType, KeyType>(
+            cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, d_keys_in, d_keys_out, num_items, compare_op);
+    }
+
+    template <typename KeyType, typename CompareOp>
+    void SortKeys(CommandList&        cmdlist,
+                  Stream&             stream,
+                  ByteBufferView      temp_storage,
+                  size_t&             temp_storage_bytes,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  size_t              num_items,
+                  CompareOp           compare_op)
+    {
+        SortKeys(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, num_items, compare_op);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <typename KeyType, typename CompareOp>
+    void SortKeys(CommandList&        cmdlist,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  size_t              num_items,
+                  CompareOp           compare_op)
+    {
+        size_t temp_storage_bytes = 0;
+        SortKeys(cmdlist, temp_storage_query(), temp_storage_bytes, d_keys_in, d_keys_out, num_items, compare_op);
+        SortKeys(cmdlist,
+                 m_allocator->allocate(cmdlist, temp_storage_bytes),
+                 temp_storage_bytes,
+                 d_keys_in,
+                 d_keys_out,
+                 num_items,
+                 compare_op);
+    }
+
+    template <typename KeyType, typename CompareOp>
+    void SortKeys(CommandList&        cmdlist,
+                  Stream&             stream,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  size_t              num_items,
+                  CompareOp           compare_op)
+    {
+        SortKeys(cmdlist, d_keys_in, d_keys_out, num_items, compare_op);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    // SortPairs keeps the input order of equal keys already, the stable entry points say so at the call site
+    template <typename KeyType, typename ValueType, typename CompareOp>
+    void StableSortPairs(CommandList&          cmdlist,
+                         ByteBufferView        temp_storage,
+                         size_t&               temp_storage_bytes,
+                         BufferView<KeyType>   d_keys_in,
+                         BufferView<KeyType>   d_keys_out,
+                         BufferView<ValueType> d_values_in,
+                         BufferView<ValueType> d_values_out,
+                         size_t                num_items,
+                         CompareOp             compare_op)
+    {
+        SortPairs(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, d_values_in, d_values_out, num_items, compare_op);
+    }
+
+    template <typename KeyType, typename ValueType, typename CompareOp>
+    void StableSortPairs(CommandList&          cmdlist,
+                         Stream&               stream,
+                         ByteBufferView        temp_storage,
+                         size_t&               temp_storage_bytes,
+                         BufferView<KeyType>   d_keys_in,
+                         BufferView<KeyType>   d_keys_out,
+                         BufferView<ValueType> d_values_in,
+                         BufferView<ValueType> d_values_out,
+                         size_t                num_items,
+                         CompareOp             compare_op)
+    {
+        StableSortPairs(cmdlist,
+                        temp_storage,
+                        temp_storage_bytes,
+                        d_keys_in,
+                        d_keys_out,
+                        d_values_in,
+                        d_values_out,
+                        num_items,
+                        compare_op);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <typename KeyType, typename ValueType, typename CompareOp>
+    void StableSortPairs(CommandList&          cmdlist,
+                         BufferView<KeyType>   d_keys_in,
+                         BufferView<KeyType>   d_keys_out,
+                         BufferView<ValueType> d_values_in,
+                         BufferView<ValueType> d_values_out,
+                         size_t                num_items,
+                         CompareOp             compare_op)
+    {
+        size_t temp_storage_bytes = 0;
+        StableSortPairs(cmdlist,
+                        temp_storage_query(),
+                        temp_storage_bytes,
+                        d_keys_in,
+                        d_keys_out,
+                        d_values_in,
+                        d_values_out,
+                        num_items,
+                        compare_op);
+        StableSortPairs(cmdlist,
+                        m_allocator->allocate(cmdlist, temp_storage_bytes),
+                        temp_storage_bytes,
+                        d_keys_in,
+                        d_keys_out,
+                        d_values_in,
+                        d_values_out,
+                        num_items,
+                        compare_op);
+    }
+
+    template <typename KeyType, typename ValueType, typename CompareOp>
+    void StableSortPairs(CommandList&          cmdlist,
+                         Stream&               stream,
+                         BufferView<KeyType>   d_keys_in,
+                         BufferView<KeyType>   d_keys_out,
+                         BufferView<ValueType> d_values_in,
+                         BufferView<ValueType> d_values_out,
+                         size_t                num_items,
+                         CompareOp             compare_op)
+    {
+        StableSortPairs(cmdlist, d_keys_in, d_keys_out, d_values_in, d_values_out, num_items, compare_op);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <typename KeyType, typename CompareOp>
+    void StableSortKeys(CommandList&        cmdlist,
+                        ByteBufferView      temp_storage,
+                        size_t&             temp_storage_bytes,
+                        BufferView<KeyType> d_keys_in,
+                        BufferView<KeyType> d_keys_out,
+                        size_t              num_items,
+                        CompareOp           compare_op)
+    {
+        SortKeys(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, num_items, compare_op);
+    }
+
+    template <typename KeyType, typename CompareOp>
+    void StableSortKeys(CommandList&        cmdlist,
+                        Stream&             stream,
+                        ByteBufferView      temp_storage,
+                        size_t&             temp_storage_bytes,
+                        BufferView<KeyType> d_keys_in,
+                        BufferView<KeyType> d_keys_out,
+                        size_t              num_items,
+                        CompareOp           compare_op)
+    {
+        StableSortKeys(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, num_items, compare_op);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <typename KeyType, typename CompareOp>
+    void StableSortKeys(CommandList&        cmdlist,
+                        BufferView<KeyType> d_keys_in,
+                        BufferView<KeyType> d_keys_out,
+                        size_t              num_items,
+                        CompareOp           compare_op)
+    {
+        size_t temp_storage_bytes = 0;
+        StableSortKeys(cmdlist, temp_storage_query(), temp_storage_bytes, d_keys_in, d_keys_out, num_items, compare_op);
+        StableSortKeys(cmdlist,
+                       m_allocator->allocate(cmdlist, temp_storage_bytes),
+                       temp_storage_bytes,
+                       d_keys_in,
+                       d_keys_out,
+                       num_items,
+                       compare_op);
+    }
+
+    template <typename KeyType, typename CompareOp>
+    void StableSortKeys(CommandList&        cmdlist,
+                        Stream&             stream,
+                        BufferView<KeyType> d_keys_in,
+                        BufferView<KeyType> d_keys_out,
+                        size_t              num_items,
+                        CompareOp           compare_op)
+    {
+        StableSortKeys(cmdlist, d_keys_in, d_keys_out, num_items, compare_op);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+  private:
+    using MergeSortTile = details::MergeSortModule<uint, uint, BLOCK_SIZE, ITEMS_PER_THREAD>;
+
+    template <bool KEYS_ONLY, typename KeyType, typename ValueType, typename CompareOp>
+    void merge_sort(CommandList&          cmdlist,
+                    ByteBufferView        temp_storage,
+                    size_t&               temp_storage_bytes,
+                    BufferView<KeyType>   d_keys_in,
+                    BufferView<KeyType>   d_keys_out,
+                    BufferView<ValueType> d_values_in,
+                    BufferView<ValueType> d_values_out,
+                    size_t                num_items,
+                    CompareOp             compare_op)
+    {
+        uint num_tiles  = ceil_div(static_cast<uint>(num_items), MergeSortTile::TILE_ITEMS);
+        uint num_passes = 0;
+        while((1u << num_passes) < num_tiles)
+        {
+            num_passes++;
+        }
+
+        TempStorageLayout<3> layout{{
+            // merge partitions, one per tile plus the end
+            (num_tiles + 1) * sizeof(uint),
+            // ping-pong keys
+            num_passes > 0 ? num_items * sizeof(KeyType) : 0u,
+            // ping-pong values
+            (!KEYS_ONLY && num_passes > 0) ? num_items * sizeof(ValueType) : 0u,
+        }};
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        if(num_items == 0)
+        {
+            return;
+        }
+
+        auto d_merge_partitions = layout.get<uint>(temp_storage, 0);
+        auto d_keys_tmp         = layout.get<KeyType>(temp_storage, 1);
+        auto d_values_tmp       = layout.get<ValueType>(temp_storage, 2);
+        if constexpr(KEYS_ONLY)
+        {
+            // keys only, the values arguments are unused and follow the keys
+            d_values_tmp = d_keys_tmp;
+        }
+
+        auto ms_block_sort_ptr      = block_sort_shader<KEYS_ONLY, KeyType, ValueType>(compare_op);
+        auto ms_merge_partition_ptr = merge_partition_shader<KeyType>(compare_op);
+        auto ms_merge_ptr           = merge_shader<KEYS_ONLY, KeyType, ValueType>(compare_op);
+
+        // the block sort writes where the last merge pass ends up in d_keys_out
+        bool                  sort_to_out  = num_passes % 2 == 0;
+        BufferView<KeyType>   d_keys_src   = sort_to_out ? d_keys_out : d_keys_tmp;
+        BufferView<KeyType>   d_keys_dst   = sort_to_out ? d_keys_tmp : d_keys_out;
+        BufferView<ValueType> d_values_src = sort_to_out ? d_values_out : d_values_tmp;
+        BufferView<ValueType> d_values_dst = sort_to_out ? d_values_tmp : d_values_out;
+
+        float4 compare_params = op_params(compare_op);
+        cmdlist << (*ms_block_sort_ptr)(d_keys_in, d_values_in, d_keys_src, d_values_src, static_cast<uint>(num_items), compare_params)
+                       .dispatch(num_tiles * m_block_size);
+
+        uint num_partitions = num_tiles + 1;
+        for(uint pass = 0; pass < num_passes; ++pass)
+        {
+            uint target_merged_tiles = 2u << pass;
+            cmdlist << (*ms_merge_partition_ptr)(d_keys_src,
+                                                 d_merge_partitions,
+                                                 static_cast<uint>(num_items),
+                                                 num_partitions,
+                                                 target_merged_tiles,
+                                                 compare_params)
+                           .dispatch(ceil_div(num_partitions, m_block_size) * m_block_size);
+            cmdlist << (*ms_merge_ptr)(d_keys_src,
+                                       d_values_src,
+                                       d_keys_dst,
+                                       d_values_dst,
+                                       d_merge_partitions,
+                                       static_cast<uint>(num_items),
+                                       target_merged_tiles,
+                                       compare_params)
+                           .dispatch(num_tiles * m_block_size);
+            std::swap(d_keys_src, d_keys_dst);
+            std::swap(d_values_src, d_values_dst);
+        }
+    }
+
+    // keys-only shaders leave the value type out, so they never share a cache entry with a pairs sort
+    template <bool KEYS_ONLY, typename KeyType, typename ValueType, typename CompareOp>
+    luisa::string merge_sort_desc(CompareOp compare_op) const
+    {
+        auto key_desc = luisa::string{luisa::compute::Type::of<KeyType>()->description()};
+        return KEYS_ONLY ? key_desc + "+" + luisa::string{op_desc(compare_op)} :
+                           key_desc + "+" + luisa::string{luisa::compute::Type::of<ValueType>()->description()} + "+"
+                               + luisa::string{op_desc(compare_op)};
+    }
+
+    template <bool KEYS_ONLY, typename KeyType, typename ValueType, typename CompareOp>
+    auto block_sort_shader(CompareOp compare_op)
+    {
+        using MergeSortShader = details::MergeSortModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using BlockSortKernel = MergeSortShader::BlockSortKernel;
+
+        constexpr auto key = shader_key<"block_sort", DeviceMergeSort, MergeSortShader, std::bool_constant<KEYS_ONLY>, CompareOp>();
+        return m_shaders->get_or_compile<BlockSortKernel>(key, [&]
+        {
+            auto desc = merge_sort_desc<KEYS_ONLY, KeyType, ValueType>(compare_op);
+            LUISA_INFO("Compiling BlockSort shader for key: {}", desc);
+            auto compile = [device = m_device, compare_op]() mutable
+            { return MergeSortShader().template compile_block_sort<KEYS_ONLY>(device, compare_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <typename KeyType, typename CompareOp>
+    auto merge_partition_shader(CompareOp compare_op)
+    {
+        using MergeSortShader = details::MergeSortModule<KeyType, KeyType, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using PartitionKernel = MergeSortShader::PartitionKernel;
+
+        constexpr auto key = shader_key<"merge_partition", DeviceMergeSort, MergeSortShader, CompareOp>();
+        return m_shaders->get_or_compile<PartitionKernel>(key, [&]
+        {
+            auto desc    = merge_sort_desc<true, KeyType, KeyType>(compare_op);
+            auto compile = [device = m_device, compare_op]() mutable
+            { return MergeSortShader().compile_partition(device, compare_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <bool KEYS_ONLY, typename KeyType, typename ValueType, typename CompareOp>
+    auto merge_shader(CompareOp compare_op)
+    {
+        using MergeSortShader = details::MergeSortModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using MergeKernel     = MergeSortShader::MergeKernel;
+
+        constexpr auto key = shader_key<"merge", DeviceMergeSort, MergeSortShader, std::bool_constant<KEYS_ONLY>, CompareOp>();
+        return m_shaders->get_or_compile<MergeKernel>(key, [&]
+        {
+            auto desc = merge_sort_desc<KEYS_ONLY, KeyType, ValueType>(compare_op);
+            LUISA_INFO("Compiling Merge shader for key: {}", desc);
+            auto compile = [device = m_device, compare_op]() mutable
+            { return MergeSortShader().template compile_merge<KEYS_ONLY>(device, compare_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceMergeSort<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
+};
+}  // namespace luisa::parallel_primitive
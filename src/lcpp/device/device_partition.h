@@ -0,0 +1,526 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 19:36:20
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 19:36:20
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <luisa/core/basic_traits.h>
+#include <luisa/ast/type.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/memory.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/var.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/device/details/partition.h>
+
+namespace luisa::parallel_primitive
+{
+
+using namespace luisa::compute;
+
+/**
+ * @brief Partitions in one pass with decoupled look-back, like DeviceSelect but every item is
+ * written: the two-way split puts the selected items first and the rejected ones reversed at
+ * the tail, the three-way split fills three outputs with their counts in d_num_selected_out[0..1].
+ */
+template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+class DevicePartition : public LuisaModule
+{
+  private:
+    uint m_block_size = BLOCK_SIZE;
+    uint m_warp_nums  = WARP_NUMS;
+
+    Device m_device;
+    bool   m_created = false;
+
+    LookBackDelayPolicy m_look_back_delay   = LookBackDelayPolicy::NO_DELAY;
+    bool                m_packed_tile_state = false;
+
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
+  public:
+    DevicePartition()  = default;
+    ~DevicePartition() = default;
+
+    void create(Device& device)
+    {
+        m_device            = device;
+        m_allocator         = CachingAllocator::shared(device);
+        m_shaders           = ShaderRegistry::shared(device);
+        m_packed_tile_state = packed_tile_state_supported(device);
+        m_created           = true;
+    }
+
+    // compiles ahead of time Flagged (uint flags) and the two-way If for these select operators
+    template <NumericT Type4Byte, typename... SelectOps>
+    void Warmup(SelectOps... select_ops)
+    {
+        visit_tile_state_layout(m_packed_tile_state,
+                                [&]<bool PACKED>(std::bool_constant<PACKED>)
+                                {
+                                    partition_tile_state_init_shader<PACKED, false>();
+                                    partition_shader<PACKED, true, Type4Byte, uint>(IdentityOp());
+                                    (partition_shader<PACKED, false, Type4Byte, uint>(select_ops), ...);
+                                });
+    }
+
+    template <NumericT Type4Byte, typename SelectFirstPartOp, typename SelectSecondPartOp>
+    void WarmupThreeWay(SelectFirstPartOp select_first_part_op, SelectSecondPartOp select_second_part_op)
+    {
+        visit_tile_state_layout(m_packed_tile_state,
+                                [&]<bool PACKED>(std::bool_constant<PACKED>)
+                                {
+                                    partition_tile_state_init_shader<PACKED, true>();
+                                    three_way_partition_shader<PACKED, Type4Byte>(select_first_part_op, select_second_part_op);
+                                });
+    }
+
+    // how tiles wait on their predecessors during look-back
+    void set_look_back_delay(LookBackDelayPolicy policy) noexcept { m_look_back_delay = policy; }
+
+    [[nodiscard]] LookBackDelayPolicy look_back_delay() const noexcept { return m_look_back_delay; }
+
+    // items with a non-zero flag first in order, the others reversed at the tail of d_out
+    template <NumericT Type4Byte, NumericT FlagT>
+    void Flagged(CommandList&          cmdlist,
+                 ByteBufferView        temp_storage,
+                 size_t&               temp_storage_bytes,
+                 BufferView<Type4Byte> d_in,
+                 BufferView<FlagT>     d_flags,
+                 BufferView<Type4Byte> d_out,
+                 BufferView<uint>      d_num_selected_out,
+                 size_t                num_items)
+    {
+        auto layout = partition_temp_storage_layout<false>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        partition_array<true, Type4Byte, FlagT>(
+            cmdlist, layout.get_bytes(temp_storage, 0), d_in, d_out, d_num_selected_out, num_items, IdentityOp(), d_flags);
+    }
+
+    template <NumericT Type4Byte, NumericT FlagT>
+    void Flagged(CommandList&          cmdlist,
+                 Stream&               stream,
+                 ByteBufferView        temp_storage,
+                 size_t&               temp_storage_bytes,
+                 BufferView<Type4Byte> d_in,
+                 BufferView<FlagT>     d_flags,
+                 BufferView<Type4Byte> d_out,
+                 BufferView<uint>      d_num_selected_out,
+                 size_t                num_items)
+    {
+        Flagged(cmdlist, temp_storage, temp_storage_bytes, d_in, d_flags, d_out, d_num_selected_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, NumericT FlagT>
+    void Flagged(CommandList&          cmdlist,
+                 BufferView<Type4Byte> d_in,
+                 BufferView<FlagT>     d_flags,
+                 BufferView<Type4Byte> d_out,
+                 BufferView<uint>      d_num_selected_out,
+                 size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        Flagged(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_flags, d_out, d_num_selected_out, num_items);
+        Flagged(cmdlist,
+                m_allocator->allocate(cmdlist, temp_storage_bytes),
+                temp_storage_bytes,
+                d_in,
+                d_flags,
+                d_out,
+                d_num_selected_out,
+                num_items);
+    }
+
+    template <NumericT Type4Byte, NumericT FlagT>
+    void Flagged(CommandList&          cmdlist,
+                 Stream&               stream,
+                 BufferView<Type4Byte> d_in,
+                 BufferView<FlagT>     d_flags,
+                 BufferView<Type4Byte> d_out,
+                 BufferView<uint>      d_num_selected_out,
+                 size_t                num_items)
+    {
+        Flagged(cmdlist, d_in, d_flags, d_out, d_num_selected_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    // items for which select_op(item) is true first in order, the others reversed at the tail of d_out
+    template <NumericT Type4Byte, typename SelectOp>
+    void If(CommandList&          cmdlist,
+            ByteBufferView        temp_storage,
+            size_t&               temp_storage_bytes,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectOp              select_op)
+    {
+        auto layout = partition_temp_storage_layout<false>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        partition_array<false, Type4Byte, uint>(
+            cmdlist, layout.get_bytes(temp_storage, 0), d_in, d_out, d_num_selected_out, num_items, select_op);
+    }
+
+    template <NumericT Type4Byte, typename SelectOp>
+    void If(CommandList&          cmdlist,
+            Stream&               stream,
+            ByteBufferView        temp_storage,
+            size_t&               temp_storage_bytes,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectOp              select_op)
+    {
+        If(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, d_num_selected_out, num_items, select_op);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename SelectOp>
+    void If(CommandList&          cmdlist,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectOp              select_op)
+    {
+        size_t temp_storage_bytes = 0;
+        If(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, d_num_selected_out, num_items, select_op);
+        If(cmdlist,
+           m_allocator->allocate(cmdlist, temp_storage_bytes),
+           temp_storage_bytes,
+           d_in,
+           d_out,
+           d_num_selected_out,
+           num_items,
+           select_op);
+    }
+
+    template <NumericT Type4Byte, typename SelectOp>
+    void If(CommandList&          cmdlist,
+            Stream&               stream,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectOp              select_op)
+    {
+        If(cmdlist, d_in, d_out, d_num_selected_out, num_items, select_op);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    /**
+     * @brief Three-way split: items selected by select_first_part_op go to d_first_part_out, the
+     * remaining ones selected by select_second_part_op to d_second_part_out, the rest to
+     * d_unselected_out, all in order. d_num_selected_out holds the two part counts.
+     */
+    template <NumericT Type4Byte, typename SelectFirstPartOp, typename SelectSecondPartOp>
+    void If(CommandList&          cmdlist,
+            ByteBufferView        temp_storage,
+            size_t&               temp_storage_bytes,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_first_part_out,
+            BufferView<Type4Byte> d_second_part_out,
+            BufferView<Type4Byte> d_unselected_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectFirstPartOp     select_first_part_op,
+            SelectSecondPartOp    select_second_part_op)
+    {
+        auto layout = partition_temp_storage_layout<true>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        three_way_partition_array<Type4Byte>(cmdlist,
+                                             layout.get_bytes(temp_storage, 0),
+                                             d_in,
+                                             d_first_part_out,
+                                             d_second_part_out,
+                                             d_unselected_out,
+                                             d_num_selected_out,
+                                             num_items,
+                                             select_first_part_op,
+                                             select_second_part_op);
+    }
+
+    template <NumericT Type4Byte, typename SelectFirstPartOp, typename SelectSecondPartOp>
+    void If(CommandList&          cmdlist,
+            Stream&               stream,
+            ByteBufferView        temp_storage,
+            size_t&               temp_storage_bytes,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_first_part_out,
+            BufferView<Type4Byte> d_second_part_out,
+            BufferView<Type4Byte> d_unselected_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectFirstPartOp     select_first_part_op,
+            SelectSecondPartOp    select_second_part_op)
+    {
+        If(cmdlist,
+           temp_storage,
+           temp_storage_bytes,
+           d_in,
+           d_first_part_out,
+           d_second_part_out,
+           d_unselected_out,
+           d_num_selected_out,
+           num_items,
+           select_first_part_op,
+           select_second_part_op);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename SelectFirstPartOp, typename SelectSecondPartOp>
+    void If(CommandList&          cmdlist,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_first_part_out,
+            BufferView<Type4Byte> d_second_part_out,
+            BufferView<Type4Byte> d_unselected_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectFirstPartOp     select_first_part_op,
+            SelectSecondPartOp    select_second_part_op)
+    {
+        size_t temp_storage_bytes = 0;
+        If(cmdlist,
+           temp_storage_query(),
+           temp_storage_bytes,
+           d_in,
+           d_first_part_out,
+           d_second_part_out,
+           d_unselected_out,
+           d_num_selected_out,
+           num_items,
+           select_first_part_op,
+           select_second_part_op);
+        If(cmdlist,
+           m_allocator->allocate(cmdlist, temp_storage_bytes),
+           temp_storage_bytes,
+           d_in,
+           d_first_part_out,
+           d_second_part_out,
+           d_unselected_out,
+           d_num_selected_out,
+           num_items,
+           select_first_part_op,
+           select_second_part_op);
+    }
+
+    template <NumericT Type4Byte, typename SelectFirstPartOp, typename SelectSecondPartOp>
+    void If(CommandList&          cmdlist,
+            Stream&               stream,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_first_part_out,
+            BufferView<Type4Byte> d_second_part_out,
+            BufferView<Type4Byte> d_unselected_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectFirstPartOp     select_first_part_op,
+            SelectSecondPartOp    select_second_part_op)
+    {
+        If(cmdlist,
+           d_in,
+           d_first_part_out,
+           d_second_part_out,
+           d_unselected_out,
+           d_num_selected_out,
+           num_items,
+           select_first_part_op,
+           select_second_part_op);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+  private:
+    template <bool PACKED, bool THREE_WAY>
+    using PartitionTileState =
+        std::conditional_t<THREE_WAY,
+                           typename details::PartitionModule<uint, uint, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>::ThreeWayTileState,
+                           typename details::PartitionModule<uint, uint, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>::TwoWayTileState>;
+
+    uint partition_num_tiles(size_t num_items) const noexcept
+    {
+        return std::max(1u, ceil_div(static_cast<uint>(num_items), static_cast<uint>(ITEMS_PER_THREAD * BLOCK_SIZE)));
+    }
+
+    template <bool THREE_WAY>
+    TempStorageLayout<1> partition_temp_storage_layout(size_t num_items) const noexcept
+    {
+        using CountT = std::conditional_t<THREE_WAY, details::PartitionModule<uint>::ThreeWayCountT, uint>;
+        // tile states behind the warp of out-of-bounds padding read by the first tiles' look-back
+        size_t tile_state_size = scan_tile_state_size<CountT>(m_packed_tile_state);
+        return TempStorageLayout<1>{{(details::WARP_SIZE + partition_num_tiles(num_items)) * tile_state_size}};
+    }
+
+    // d_flags is the flags buffer of the flagged partition, If passes none
+    template <bool USE_FLAGS, NumericT Type4Byte, NumericT FlagT, typename SelectOp, typename... FlagViews>
+    void partition_array(CommandList&          cmdlist,
+                         ByteBufferView        tile_state_bytes,
+                         BufferView<Type4Byte> d_in,
+                         BufferView<Type4Byte> d_out,
+                         BufferView<uint>      d_num_selected_out,
+                         size_t                num_items,
+                         SelectOp              select_op,
+                         FlagViews...          d_flags)
+    {
+        static_assert(sizeof...(FlagViews) == (USE_FLAGS ? 1 : 0));
+        // an empty input still runs one tile, it writes zero to d_num_selected_out
+        uint num_tiles = partition_num_tiles(num_items);
+        visit_tile_state_layout(
+            m_packed_tile_state,
+            [&]<bool PACKED>(std::bool_constant<PACKED>)
+            {
+                auto tile_states = details::reinterpret_view<PartitionTileState<PACKED, false>>(tile_state_bytes);
+                auto ms_partition_tile_state_init_ptr = partition_tile_state_init_shader<PACKED, false>();
+                auto ms_partition_ptr = partition_shader<PACKED, USE_FLAGS, Type4Byte, FlagT>(select_op);
+
+                cmdlist << (*ms_partition_tile_state_init_ptr)(tile_states, static_cast<int>(num_tiles)).dispatch(num_tiles * m_block_size);
+                cmdlist << (*ms_partition_ptr)(
+                               tile_states, d_in, d_flags..., d_out, d_num_selected_out, static_cast<uint>(num_items), op_params(select_op))
+                               .dispatch(num_tiles * m_block_size);
+            });
+    }
+
+    template <NumericT Type4Byte, typename SelectFirstPartOp, typename SelectSecondPartOp>
+    void three_way_partition_array(CommandList&          cmdlist,
+                                   ByteBufferView        tile_state_bytes,
+                                   BufferView<Type4Byte> d_in,
+                                   BufferView<Type4Byte> d_first_part_out,
+                                   BufferView<Type4Byte> d_second_part_out,
+                                   BufferView<Type4Byte> d_unselected_out,
+                                   BufferView<uint>      d_num_selected_out,
+                                   size_t                num_items,
+                                   SelectFirstPartOp     select_first_part_op,
+                                   SelectSecondPartOp    select_second_part_op)
+    {
+        uint num_tiles = partition_num_tiles(num_items);
+        visit_tile_state_layout(
+            m_packed_tile_state,
+            [&]<bool PACKED>(std::bool_constant<PACKED>)
+            {
+                auto tile_states = details::reinterpret_view<PartitionTileState<PACKED, true>>(tile_state_bytes);
+                auto ms_partition_tile_state_init_ptr = partition_tile_state_init_shader<PACKED, true>();
+                auto ms_three_way_partition_ptr =
+                    three_way_partition_shader<PACKED, Type4Byte>(select_first_part_op, select_second_part_op);
+
+                cmdlist << (*ms_partition_tile_state_init_ptr)(tile_states, static_cast<int>(num_tiles)).dispatch(num_tiles * m_block_size);
+                cmdlist << (*ms_three_way_partition_ptr)(tile_states,
+                                                         d_in,
+                                                         d_first_part_out,
+                                                         d_second_part_out,
+                                                         d_unselected_out,
+                                                         d_num_selected_out,
+                                                         static_cast<uint>(num_items),
+                                                         op_params(select_first_part_op),
+                                                         op_params(select_second_part_op))
+                               .dispatch(num_tiles * m_block_size);
+            });
+    }
+
+    template <bool PACKED, bool THREE_WAY>
+    auto partition_tile_state_init_shader()
+    {
+        using PartitionShader = details::PartitionModule<uint, uint, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using TileState       = PartitionTileState<PACKED, THREE_WAY>;
+        using PartitionTileStateInitKernel = Shader<1, Buffer<TileState>, int>;
+
+        constexpr auto key = shader_key<"partition_tile_state_init", DevicePartition, PartitionShader, TileState>();
+        return m_shaders->get_or_compile<PartitionTileStateInitKernel>(key, [&]
+        {
+            auto compile = [device = m_device]() mutable
+            { return PartitionShader().template compile_scan_tile_state_init<TileState>(device); };
+            auto desc = luisa::string{THREE_WAY ? "three_way" : "two_way"} + tile_state_layout_desc(PACKED);
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <bool PACKED, bool USE_FLAGS, NumericT Type4Byte, NumericT FlagT, typename SelectOp>
+    auto partition_shader(SelectOp select_op)
+    {
+        using PartitionShader = details::PartitionModule<Type4Byte, FlagT, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using PartitionKernel = PartitionShader::template PartitionKernel<USE_FLAGS>;
+
+        const auto key = shader_key<"partition", DevicePartition, PartitionShader, std::bool_constant<USE_FLAGS>, SelectOp>(
+            static_cast<uint64_t>(m_look_back_delay));
+        return m_shaders->get_or_compile<PartitionKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(select_op) + (USE_FLAGS ? "_flagged" : "_if")
+                        + look_back_delay_desc(m_look_back_delay) + tile_state_layout_desc(PACKED);
+            LUISA_INFO("Compiling Partition shader for key: {}", desc);
+            auto compile = [device = m_device, look_back_delay = m_look_back_delay, select_op]() mutable
+            {
+                return visit_delay_constructor<uint>(
+                    look_back_delay,
+                    [&]<typename DelayConstructorT>(std::type_identity<DelayConstructorT>) {
+                        return PartitionShader().template compile<USE_FLAGS, DelayConstructorT>(device, select_op);
+                    });
+            };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <bool PACKED, NumericT Type4Byte, typename SelectFirstPartOp, typename SelectSecondPartOp>
+    auto three_way_partition_shader(SelectFirstPartOp select_first_part_op, SelectSecondPartOp select_second_part_op)
+    {
+        using PartitionShader         = details::PartitionModule<Type4Byte, uint, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using ThreeWayPartitionKernel = PartitionShader::ThreeWayPartitionKernel;
+        using ThreeWayCountT          = PartitionShader::ThreeWayCountT;
+
+        const auto key =
+            shader_key<"three_way_partition", DevicePartition, PartitionShader, SelectFirstPartOp, SelectSecondPartOp>(
+                static_cast<uint64_t>(m_look_back_delay));
+        return m_shaders->get_or_compile<ThreeWayPartitionKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(select_first_part_op, select_second_part_op)
+                        + look_back_delay_desc(m_look_back_delay) + tile_state_layout_desc(PACKED);
+            LUISA_INFO("Compiling ThreeWayPartition shader for key: {}", desc);
+            auto compile = [device = m_device, look_back_delay = m_look_back_delay, select_first_part_op, select_second_part_op]() mutable
+            {
+                return visit_delay_constructor<ThreeWayCountT>(
+                    look_back_delay,
+                    [&]<typename DelayConstructorT>(std::type_identity<DelayConstructorT>) {
+                        return PartitionShader().template compile_three_way<DelayConstructorT>(
+                            device, select_first_part_op, select_second_part_op);
+                    });
+            };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DevicePartition<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
+};
+}  // namespace luisa::parallel_primitive
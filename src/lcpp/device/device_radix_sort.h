@@ -23,6 +23,7 @@
 #include <luisa/dsl/var.h>
 #include <cstddef>
 #include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
 #include <lcpp/common/type_trait.h>
 #include <lcpp/common/util_type.h>
 #include <lcpp/common/thread_operators.h>
@@ -49,6 +50,9 @@ class DeviceRadixSort : public LuisaModule
     uint   m_shared_mem_size = 0;
     Device m_device;
 
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
   public:
     DeviceRadixSort()  = default;
     ~DeviceRadixSort() = default;
@@ -59,11 +63,14 @@ class DeviceRadixSort : public LuisaModule
         int num_elements_per_block = m_block_size * ITEMS_PER_THREAD;
         int extra_space            = num_elements_per_block / m_warp_nums;
         m_shared_mem_size          = (num_elements_per_block + extra_space);
+        m_allocator                = CachingAllocator::shared(device);
+        m_shaders                  = ShaderRegistry::shared(device);
     }
 
     template <NumericT KeyType, NumericT ValueType>
     void SortPairs(CommandList&          cmdlist,
-                   Stream&               stream,
+                   ByteBufferView        temp_storage,
+                   size_t&               temp_storage_bytes,
                    BufferView<KeyType>   d_keys_in,
                    BufferView<KeyType>   d_keys_out,
                    BufferView<ValueType> d_values_in,
@@ -73,22 +80,135 @@ class DeviceRadixSort : public LuisaModule
         DoubleBuffer<KeyType>   d_keys(d_keys_in, d_keys_out);
         DoubleBuffer<ValueType> d_values(d_values_in, d_values_out);
         onesweep_radix_sort<KeyType, ValueType, false, false>(
-            cmdlist, stream, d_keys, d_values, 0, sizeof(KeyType) * 8, num_items, false);
-    };
+            cmdlist, temp_storage, temp_storage_bytes, d_keys, d_values, 0, sizeof(KeyType) * 8, num_items, false);
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairs(CommandList&          cmdlist,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   uint                  num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        SortPairs(cmdlist,
+                  temp_storage_query(),
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items);
+        SortPairs(cmdlist,
+                  m_allocator->allocate(cmdlist, temp_storage_bytes),
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items);
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairs(CommandList&          cmdlist,
+                   Stream&               stream,
+                   ByteBufferView        temp_storage,
+                   size_t&               temp_storage_bytes,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   uint                  num_items)
+    {
+        SortPairs(cmdlist,
+                  temp_storage,
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairs(CommandList&          cmdlist,
+                   Stream&               stream,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   uint                  num_items)
+    {
+        SortPairs(cmdlist, d_keys_in, d_keys_out, d_values_in, d_values_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
 
     template <NumericT KeyType>
-    void SortKeys(CommandList& cmdlist, Stream& stream, BufferView<KeyType> d_keys_in, BufferView<KeyType> d_keys_out, uint num_items)
+    void SortKeys(CommandList&        cmdlist,
+                  ByteBufferView      temp_storage,
+                  size_t&             temp_storage_bytes,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  uint                num_items)
     {
         DoubleBuffer<KeyType> d_keys(d_keys_in, d_keys_out);
         DoubleBuffer<KeyType> d_values(d_keys_in, d_keys_out);  // dummy
         onesweep_radix_sort<KeyType, KeyType, true, false>(
-            cmdlist, stream, d_keys, d_values, 0, sizeof(KeyType) * 8, num_items, false);
-    };
+            cmdlist, temp_storage, temp_storage_bytes, d_keys, d_values, 0, sizeof(KeyType) * 8, num_items, false);
+    }
+
+    template <NumericT KeyType>
+    void SortKeys(CommandList&        cmdlist,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  uint                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        SortKeys(cmdlist, temp_storage_query(), temp_storage_bytes, d_keys_in, d_keys_out, num_items);
+        SortKeys(cmdlist,
+                 m_allocator->allocate(cmdlist, temp_storage_bytes),
+                 temp_storage_bytes,
+                 d_keys_in,
+                 d_keys_out,
+                 num_items);
+    }
+
+    template <NumericT KeyType>
+    void SortKeys(CommandList&        cmdlist,
+                  Stream&             stream,
+                  ByteBufferView      temp_storage,
+                  size_t&             temp_storage_bytes,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  uint                num_items)
+    {
+        SortKeys(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
+    template <NumericT KeyType>
+    void SortKeys(CommandList&        cmdlist,
+                  Stream&             stream,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  uint                num_items)
+    {
+        SortKeys(cmdlist, d_keys_in, d_keys_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
 
     template <NumericT KeyType, NumericT ValueType>
     void SortPairsDescending(CommandList&          cmdlist,
-                             Stream&               stream,
+                             ByteBufferView        temp_storage,
+                             size_t&               temp_storage_bytes,
                              BufferView<KeyType>   d_keys_in,
                              BufferView<KeyType>   d_keys_out,
                              BufferView<ValueType> d_values_in,
@@ -98,12 +218,78 @@ class DeviceRadixSort : public LuisaModule
         DoubleBuffer<KeyType>   d_keys(d_keys_in, d_keys_out);
         DoubleBuffer<ValueType> d_values(d_values_in, d_values_out);
         onesweep_radix_sort<KeyType, ValueType, false, true>(
-            cmdlist, stream, d_keys, d_values, 0, sizeof(KeyType) * 8, num_items, false);
-    };
+            cmdlist, temp_storage, temp_storage_bytes, d_keys, d_values, 0, sizeof(KeyType) * 8, num_items, false);
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairsDescending(CommandList&          cmdlist,
+                             BufferView<KeyType>   d_keys_in,
+                             BufferView<KeyType>   d_keys_out,
+                             BufferView<ValueType> d_values_in,
+                             BufferView<ValueType> d_values_out,
+                             uint                  num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        SortPairsDescending(cmdlist,
+                            temp_storage_query(),
+                            temp_storage_bytes,
+                            d_keys_in,
+                            d_keys_out,
+                            d_values_in,
+                            d_values_out,
+                            num_items);
+        SortPairsDescending(cmdlist,
+                            m_allocator->allocate(cmdlist, temp_storage_bytes),
+                            temp_storage_bytes,
+                            d_keys_in,
+                            d_keys_out,
+                            d_values_in,
+                            d_values_out,
+                            num_items);
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairsDescending(CommandList&          cmdlist,
+                             Stream&               stream,
+                             ByteBufferView        temp_storage,
+                             size_t&               temp_storage_bytes,
+                             BufferView<KeyType>   d_keys_in,
+                             BufferView<KeyType>   d_keys_out,
+                             BufferView<ValueType> d_values_in,
+                             BufferView<ValueType> d_values_out,
+                             uint                  num_items)
+    {
+        SortPairsDescending(cmdlist,
+                            temp_storage,
+                            temp_storage_bytes,
+                            d_keys_in,
+                            d_keys_out,
+                            d_values_in,
+                            d_values_out,
+                            num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairsDescending(CommandList&          cmdlist,
+                             Stream&               stream,
+                             BufferView<KeyType>   d_keys_in,
+                             BufferView<KeyType>   d_keys_out,
+                             BufferView<ValueType> d_values_in,
+                             BufferView<ValueType> d_values_out,
+                             uint                  num_items)
+    {
+        SortPairsDescending(cmdlist, d_keys_in, d_keys_out, d_values_in, d_values_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
 
     template <NumericT KeyType>
     void SortKeysDescending(CommandList&        cmdlist,
-                            Stream&             stream,
+                            ByteBufferView      temp_storage,
+                            size_t&             temp_storage_bytes,
                             BufferView<KeyType> d_keys_in,
                             BufferView<KeyType> d_keys_out,
                             uint                num_items)
@@ -111,13 +297,74 @@ class DeviceRadixSort : public LuisaModule
         DoubleBuffer<KeyType> d_keys(d_keys_in, d_keys_out);
         DoubleBuffer<KeyType> d_values(d_keys_in, d_keys_out);  // dummy
         onesweep_radix_sort<KeyType, KeyType, true, true>(
-            cmdlist, stream, d_keys, d_values, 0, sizeof(KeyType) * 8, num_items, false);
-    };
+            cmdlist, temp_storage, temp_storage_bytes, d_keys, d_values, 0, sizeof(KeyType) * 8, num_items, false);
+    }
+
+    template <NumericT KeyType>
+    void SortKeysDescending(CommandList&        cmdlist,
+                            BufferView<KeyType> d_keys_in,
+                            BufferView<KeyType> d_keys_out,
+                            uint                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        SortKeysDescending(cmdlist, temp_storage_query(), temp_storage_bytes, d_keys_in, d_keys_out, num_items);
+        SortKeysDescending(cmdlist,
+                           m_allocator->allocate(cmdlist, temp_storage_bytes),
+                           temp_storage_bytes,
+                           d_keys_in,
+                           d_keys_out,
+                           num_items);
+    }
+
+    template <NumericT KeyType>
+    void SortKeysDescending(CommandList&        cmdlist,
+                            Stream&             stream,
+                            ByteBufferView      temp_storage,
+                            size_t&             temp_storage_bytes,
+                            BufferView<KeyType> d_keys_in,
+                            BufferView<KeyType> d_keys_out,
+                            uint                num_items)
+    {
+        SortKeysDescending(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT KeyType>
+    void SortKeysDescending(CommandList&        cmdlist,
+                            Stream&             stream,
+                            BufferView<KeyType> d_keys_in,
+                            BufferView<KeyType> d_keys_out,
+                            uint                num_items)
+    {
+        SortKeysDescending(cmdlist, d_keys_in, d_keys_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    /**
+     * @brief Compiles ahead of time the ascending and descending onesweep shaders, Warmup<uint>()
+     * for SortKeys and Warmup<uint, float>() for SortPairs. With the persistent shader cache
+     * enabled (shader_cache_config()) the binaries are written to disk and reloaded by later processes.
+     */
+    template <NumericT KeyType>
+    void Warmup()
+    {
+        warmup_radix_sort<KeyType, KeyType, true>();
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void Warmup()
+    {
+        warmup_radix_sort<KeyType, ValueType, false>();
+    }
 
   private:
     template <NumericT KeyType, typename ValueType, bool KEY_ONLY, bool IS_DESCENDING>
     void onesweep_radix_sort(CommandList&             cmdlist,
-                             Stream&                  stream,
+                             ByteBufferView           temp_storage,
+                             size_t&                  temp_storage_bytes,
                              DoubleBuffer<KeyType>&   d_keys,
                              DoubleBuffer<ValueType>& d_values,
                              uint                     begin_bit,
@@ -137,50 +384,46 @@ class DeviceRadixSort : public LuisaModule
         auto num_portions   = ceil_div(num_items, PORTION_SIZE);
         auto max_num_blocks = ceil_div(std::min(num_items, PORTION_SIZE), ONESWEEP_TILE_ITEMS);
 
-        size_t value_size         = 0;
-        size_t allocation_sizes[] = {
+        TempStorageLayout<5> layout{{
             // bins
-            num_portions * num_passes * RADIX_DIGITS,
+            num_portions * num_passes * RADIX_DIGITS * sizeof(uint),
             // lookback
-            max_num_blocks * RADIX_DIGITS,
-            // extra key buffer
-            num_items,
+            max_num_blocks * RADIX_DIGITS * sizeof(uint),
             // counters
-            num_portions * num_passes,
-        };
-
-        auto              d_bins_buffer     = m_device.create_buffer<uint>(allocation_sizes[0]);
-        auto              d_lookback_buffer = m_device.create_buffer<uint>(allocation_sizes[1]);
-        Buffer<KeyType>   d_keys_tmp2_buffer;
-        Buffer<ValueType> d_values_tmp2_buffer;
-        if(!is_overwrite_okay && num_passes > 1)
+            num_portions * num_passes * sizeof(uint),
+            // extra key buffer
+            (!is_overwrite_okay && num_passes > 1) ? num_items * sizeof(KeyType) : 0u,
+            // extra value buffer
+            (!KEY_ONLY && !is_overwrite_okay && num_passes > 1) ? num_items * sizeof(ValueType) : 0u,
+        }};
+        if(layout.query(temp_storage, temp_storage_bytes))
         {
-            d_keys_tmp2_buffer   = m_device.create_buffer<KeyType>(allocation_sizes[2]);
-            d_values_tmp2_buffer = m_device.create_buffer<ValueType>(allocation_sizes[2]);
+            return;
         }
-        auto d_ctrs_buffer = m_device.create_buffer<uint>(allocation_sizes[3]);
 
-        // TODO: Reset buffers on device
-        luisa::vector<uint> zeros_bins(allocation_sizes[0], 0u);
-        luisa::vector<uint> zeros_lookback(allocation_sizes[1], 0u);
-        luisa::vector<uint> zeros_ctrs(allocation_sizes[3], 0u);
-        stream << d_bins_buffer.copy_from(zeros_bins.data()) << d_ctrs_buffer.copy_from(zeros_ctrs.data());
+        auto d_bins_buffer        = layout.get<uint>(temp_storage, 0);
+        auto d_lookback_buffer    = layout.get<uint>(temp_storage, 1);
+        auto d_ctrs_buffer        = layout.get<uint>(temp_storage, 2);
+        auto d_keys_tmp2_buffer   = layout.get<KeyType>(temp_storage, 3);
+        auto d_values_tmp2_buffer = layout.get<ValueType>(temp_storage, 4);
 
-        auto radix_sort_key = get_type_and_op_desc<KeyType, ValueType>()
-                              + luisa::string(IS_DESCENDING ? "_desc" : "_asc");
-        // radix sort histogram
-        using RadixSortHistogram =
-            details::RadixSortHistogramModule<KeyType, IS_DESCENDING, RADIX_BITS, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD>;
-        using RadixSortHistogramKernel  = RadixSortHistogram::RadixSortHistogramKernel;
-        auto ms_radix_sort_histogram_it = ms_radix_sort_histogram_map.find(radix_sort_key);
-        if(ms_radix_sort_histogram_it == ms_radix_sort_histogram_map.end())
+        // queue every pass before the first dispatch waits on one
+        auto ms_radix_sort_clear_ptr     = radix_sort_clear_shader();
+        auto ms_radix_sort_histogram_ptr = radix_sort_histogram_shader<KeyType, ValueType, KEY_ONLY, IS_DESCENDING>();
+        auto ms_radix_sort_exclusive_sum_ptr =
+            radix_sort_exclusive_sum_shader<KeyType, ValueType, KEY_ONLY, IS_DESCENDING>();
+        auto ms_radix_sort_onesweep_ptr = radix_sort_onesweep_shader<KeyType, ValueType, KEY_ONLY, IS_DESCENDING>();
+
+        // reset bins, counters and lookback on device
+        auto clear_buffer = [&](BufferView<uint> buffer, uint num_elements)
         {
-            auto shader = RadixSortHistogram().compile(m_device);
-            ms_radix_sort_histogram_map.try_emplace(radix_sort_key, std::move(shader));
-            ms_radix_sort_histogram_it = ms_radix_sort_histogram_map.find(radix_sort_key);
-        }
-        auto ms_radix_sort_histogram_ptr =
-            reinterpret_cast<RadixSortHistogramKernel*>(&(*ms_radix_sort_histogram_it->second));
+            cmdlist << (*ms_radix_sort_clear_ptr)(buffer, num_elements)
+                           .dispatch(std::max(ceil_div(num_elements, m_block_size), 1u) * m_block_size);
+        };
+        clear_buffer(d_bins_buffer, d_bins_buffer.size());
+        clear_buffer(d_ctrs_buffer, d_ctrs_buffer.size());
+
+        // radix sort histogram
         const auto num_sms             = BLOCK_SIZE;
         const auto histo_blocks_per_sm = 1;
         // LUISA_INFO("max_num_blocks * num_portions: {} * {} = {},num_items:{}",
@@ -190,9 +433,8 @@ class DeviceRadixSort : public LuisaModule
         //            num_items);
         // LUISA_INFO("bins size: num_portions:{}, num_passes: {}, RADIX_DIGITS: {}", num_portions, num_passes, RADIX_DIGITS);
         cmdlist << (*ms_radix_sort_histogram_ptr)(
-                       d_bins_buffer.view(), ByteBufferView{d_keys.current()}, num_items, begin_bit, end_bit)
+                       d_bins_buffer, ByteBufferView{d_keys.current()}, num_items, begin_bit, end_bit)
                        .dispatch(num_sms * histo_blocks_per_sm * m_block_size);
-        stream << cmdlist.commit() << synchronize();
 
         // luisa::vector<uint> host_bins(d_bins_buffer.size());
         // stream << d_bins_buffer.copy_to(host_bins.data()) << synchronize();
@@ -213,20 +455,7 @@ class DeviceRadixSort : public LuisaModule
 
 
         // exclusive scan
-        using RadixSortExclusiveSum = details::RadixSortExclusiveSumModule<RADIX_DIGITS, BLOCK_SIZE, WARP_NUMS>;
-        using RadixSortExclusiveSumKernel   = RadixSortExclusiveSum::RadixSortExclusiveSumKernel;
-        auto ms_radix_sort_exclusive_sum_it = ms_radix_sort_exclusive_sum_map.find(radix_sort_key);
-        if(ms_radix_sort_exclusive_sum_it == ms_radix_sort_exclusive_sum_map.end())
-        {
-            auto shader = RadixSortExclusiveSum().compile(m_device);
-            ms_radix_sort_exclusive_sum_map.try_emplace(radix_sort_key, std::move(shader));
-            ms_radix_sort_exclusive_sum_it = ms_radix_sort_exclusive_sum_map.find(radix_sort_key);
-        }
-        auto ms_radix_sort_exclusive_sum_ptr =
-            reinterpret_cast<RadixSortExclusiveSumKernel*>(&(*ms_radix_sort_exclusive_sum_it->second));
-
-        cmdlist << (*ms_radix_sort_exclusive_sum_ptr)(d_bins_buffer.view()).dispatch(num_passes * m_block_size);
-        stream << cmdlist.commit() << synchronize();
+        cmdlist << (*ms_radix_sort_exclusive_sum_ptr)(d_bins_buffer).dispatch(num_passes * m_block_size);
 
         //show
         // stream << d_bins_buffer.copy_to(host_bins.data()) << synchronize();
@@ -250,24 +479,10 @@ class DeviceRadixSort : public LuisaModule
         auto d_values_tmp = d_values.alternate();
         if(!is_overwrite_okay && num_passes % 2 == 0)
         {
-            d_keys.d_buffer[1]   = d_keys_tmp2_buffer.view();
-            d_values.d_buffer[1] = d_values_tmp2_buffer.view();
+            d_keys.d_buffer[1]   = d_keys_tmp2_buffer;
+            d_values.d_buffer[1] = d_values_tmp2_buffer;
         }
 
-        using RadixSortOneSweep =
-            details::RadixSortOneSweepModule<KeyType, ValueType, KEY_ONLY, IS_DESCENDING, RADIX_BITS, BLOCK_SIZE, WARP_NUMS, ONESWEEP_ITMES_PER_THREADS>;
-        using RadixSortOneSweepKernel = RadixSortOneSweep::RadixSortOneSweepKernel;
-
-        auto ms_radix_sort_onesweep_it = ms_radix_sort_one_sweep_map.find(radix_sort_key);
-        if(ms_radix_sort_onesweep_it == ms_radix_sort_one_sweep_map.end())
-        {
-            auto shader = RadixSortOneSweep().compile(m_device);
-            ms_radix_sort_one_sweep_map.try_emplace(radix_sort_key, std::move(shader));
-            ms_radix_sort_onesweep_it = ms_radix_sort_one_sweep_map.find(radix_sort_key);
-        }
-        auto ms_radix_sort_onesweep_ptr =
-            reinterpret_cast<RadixSortOneSweepKernel*>(&(*ms_radix_sort_onesweep_it->second));
-
         for(uint current_bit = begin_bit, pass = 0; current_bit < end_bit; current_bit += RADIX_BITS, ++pass)
         {
             uint num_bit = std::min(end_bit - current_bit, RADIX_BITS);
@@ -280,17 +495,17 @@ class DeviceRadixSort : public LuisaModule
                 // LUISA_INFO("  Pass {}, Portion {}, portion_num_items: {}, num_blocks: {}", pass, portion, portion_num_items, num_blocks);
 
                 // Clear lookback buffer before each onesweep dispatch
-                stream << d_lookback_buffer.copy_from(zeros_lookback.data());
+                clear_buffer(d_lookback_buffer, num_blocks * RADIX_DIGITS);
 
                 // dispatch
                 cmdlist
                     << (*ms_radix_sort_onesweep_ptr)(
-                           d_lookback_buffer.view(),
-                           d_ctrs_buffer.view(portion * num_passes + pass, 1),
-                           d_bins_buffer.view((portion * num_passes + pass) * RADIX_DIGITS, RADIX_DIGITS),
+                           d_lookback_buffer,
+                           d_ctrs_buffer.subview(portion * num_passes + pass, 1),
+                           d_bins_buffer.subview((portion * num_passes + pass) * RADIX_DIGITS, RADIX_DIGITS),
                            portion < num_portions - 1 ?
-                               d_bins_buffer.view(((portion + 1) * num_passes + pass) * RADIX_DIGITS, RADIX_DIGITS) :
-                               d_bins_buffer.view(0, 0),
+                               d_bins_buffer.subview(((portion + 1) * num_passes + pass) * RADIX_DIGITS, RADIX_DIGITS) :
+                               d_bins_buffer.subview(0, 0),
                            ByteBufferView{d_keys.current().subview(portion * PORTION_SIZE, portion_num_items)},
                            ByteBufferView{d_keys.alternate()},
                            KEY_ONLY ? d_values.current().subview(0, 0) :
@@ -301,34 +516,110 @@ class DeviceRadixSort : public LuisaModule
                            current_bit,
                            num_bit)
                            .dispatch(num_blocks * ONESWEEP_BLOCK_THREADS);
-                stream << cmdlist.commit() << synchronize();
             }
             if(!is_overwrite_okay && pass == 0)
             {
                 d_keys   = num_passes % 2 == 0 ?
-                               DoubleBuffer<KeyType>(d_keys_tmp, d_keys_tmp2_buffer.view()) :
-                               DoubleBuffer<KeyType>(d_keys_tmp2_buffer.view(), d_keys_tmp);
+                               DoubleBuffer<KeyType>(d_keys_tmp, d_keys_tmp2_buffer) :
+                               DoubleBuffer<KeyType>(d_keys_tmp2_buffer, d_keys_tmp);
                 d_values = num_passes % 2 == 0 ?
-                               DoubleBuffer<ValueType>(d_values_tmp, d_values_tmp2_buffer.view()) :
-                               DoubleBuffer<ValueType>(d_values_tmp2_buffer.view(), d_values_tmp);
+                               DoubleBuffer<ValueType>(d_values_tmp, d_values_tmp2_buffer) :
+                               DoubleBuffer<ValueType>(d_values_tmp2_buffer, d_values_tmp);
             }
             d_keys.selector ^= 1;
             d_values.selector ^= 1;
         }
+    }
 
-        d_bins_buffer.release();
-        d_lookback_buffer.release();
-        d_ctrs_buffer.release();
-        if(!is_overwrite_okay && num_passes > 1)
+    // shader lookups, compile on first use (or Warmup) and cache per key
+    template <NumericT KeyType, typename ValueType, bool KEY_ONLY, bool IS_DESCENDING>
+    luisa::string radix_sort_key() const
+    {
+        // key-only sorts run a different onesweep than pairs sorts with the key type as value
+        return (KEY_ONLY ? luisa::string{luisa::compute::Type::of<KeyType>()->description()} :
+                           get_type_and_op_desc<KeyType, ValueType>())
+               + luisa::string(IS_DESCENDING ? "_desc" : "_asc");
+    }
+
+    auto radix_sort_clear_shader()
+    {
+        using ClearShader = details::ClearModule<BLOCK_SIZE>;
+        using ClearKernel = ClearShader::ClearKernel;
+
+        // keyed by the module alone, radix sort and histogram share one clear shader per device
+        constexpr auto key = shader_key<"clear", ClearShader>();
+        return m_shaders->get_or_compile<ClearKernel>(key, [&]
         {
-            d_keys_tmp2_buffer.release();
-            d_values_tmp2_buffer.release();
-        }
+            auto compile = [device = m_device]() mutable { return ClearShader().compile(device); };
+            return compile_async(shader_cache_module(key.name), "uint", std::move(compile));
+        });
     }
 
-  private:
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_radix_sort_histogram_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_radix_sort_exclusive_sum_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_radix_sort_one_sweep_map;
+    template <NumericT KeyType, typename ValueType, bool KEY_ONLY, bool IS_DESCENDING>
+    auto radix_sort_histogram_shader()
+    {
+        constexpr uint RADIX_BITS = OneSweepSmallKeyTunedPolicy<KeyType>::ONESWEEP_RADIX_BITS;
+        using RadixSortHistogram =
+            details::RadixSortHistogramModule<KeyType, IS_DESCENDING, RADIX_BITS, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD>;
+        using RadixSortHistogramKernel = RadixSortHistogram::RadixSortHistogramKernel;
+
+        constexpr auto key = shader_key<"histogram", DeviceRadixSort, RadixSortHistogram>();
+        return m_shaders->get_or_compile<RadixSortHistogramKernel>(key, [&]
+        {
+            auto desc = radix_sort_key<KeyType, ValueType, KEY_ONLY, IS_DESCENDING>();
+            auto compile = [device = m_device]() mutable { return RadixSortHistogram().compile(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT KeyType, typename ValueType, bool KEY_ONLY, bool IS_DESCENDING>
+    auto radix_sort_exclusive_sum_shader()
+    {
+        constexpr uint RADIX_DIGITS = 1 << OneSweepSmallKeyTunedPolicy<KeyType>::ONESWEEP_RADIX_BITS;
+        using RadixSortExclusiveSum = details::RadixSortExclusiveSumModule<RADIX_DIGITS, BLOCK_SIZE, WARP_NUMS>;
+        using RadixSortExclusiveSumKernel = RadixSortExclusiveSum::RadixSortExclusiveSumKernel;
+
+        constexpr auto key = shader_key<"exclusive_sum", DeviceRadixSort, RadixSortExclusiveSum>();
+        return m_shaders->get_or_compile<RadixSortExclusiveSumKernel>(key, [&]
+        {
+            auto desc = radix_sort_key<KeyType, ValueType, KEY_ONLY, IS_DESCENDING>();
+            auto compile = [device = m_device]() mutable { return RadixSortExclusiveSum().compile(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT KeyType, typename ValueType, bool KEY_ONLY, bool IS_DESCENDING>
+    auto radix_sort_onesweep_shader()
+    {
+        constexpr uint RADIX_BITS = OneSweepSmallKeyTunedPolicy<KeyType>::ONESWEEP_RADIX_BITS;
+        using RadixSortOneSweep =
+            details::RadixSortOneSweepModule<KeyType, ValueType, KEY_ONLY, IS_DESCENDING, RADIX_BITS, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD>;
+        using RadixSortOneSweepKernel = RadixSortOneSweep::RadixSortOneSweepKernel;
+
+        constexpr auto key = shader_key<"onesweep", DeviceRadixSort, RadixSortOneSweep>();
+        return m_shaders->get_or_compile<RadixSortOneSweepKernel>(key, [&]
+        {
+            auto desc = radix_sort_key<KeyType, ValueType, KEY_ONLY, IS_DESCENDING>();
+            auto compile = [device = m_device]() mutable { return RadixSortOneSweep().compile(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT KeyType, typename ValueType, bool KEY_ONLY>
+    void warmup_radix_sort()
+    {
+        radix_sort_clear_shader();
+        radix_sort_histogram_shader<KeyType, ValueType, KEY_ONLY, false>();
+        radix_sort_exclusive_sum_shader<KeyType, ValueType, KEY_ONLY, false>();
+        radix_sort_onesweep_shader<KeyType, ValueType, KEY_ONLY, false>();
+        radix_sort_histogram_shader<KeyType, ValueType, KEY_ONLY, true>();
+        radix_sort_exclusive_sum_shader<KeyType, ValueType, KEY_ONLY, true>();
+        radix_sort_onesweep_shader<KeyType, ValueType, KEY_ONLY, true>();
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceRadixSort<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
 };
 }  // namespace luisa::parallel_primitive
\ No newline at end of file
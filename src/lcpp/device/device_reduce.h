@@ -8,6 +8,8 @@
 #pragma once
 #include <luisa/core/mathematics.h>
 #include <luisa/dsl/local.h>
+#include <algorithm>
+#include <concepts>
 #include <limits>
 #include <luisa/core/basic_traits.h>
 #include <luisa/ast/type.h>
@@ -20,10 +22,14 @@
 #include <luisa/dsl/sugar.h>
 #include <luisa/dsl/var.h>
 #include <cstddef>
+#include <tuple>
+#include <type_traits>
 #include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
 #include <lcpp/common/type_trait.h>
 #include <lcpp/common/util_type.h>
 #include <lcpp/common/thread_operators.h>
+#include <lcpp/common/iterator.h>
 #include <lcpp/block/block_reduce.h>
 #include <lcpp/block/block_scan.h>
 #include <lcpp/block/block_load.h>
@@ -36,6 +42,16 @@ namespace luisa::parallel_primitive
 {
 
 using namespace luisa::compute;
+
+enum class ReduceDeterminism
+{
+    // grid-stride partials and warp shuffles, the same bits for the same device, BLOCK_SIZE and input size
+    RUN_TO_RUN,
+    // a fixed pairwise tree over tiles sized by the accumulator type alone, the same bits for any BLOCK_SIZE,
+    // warp width, grid or device (as far as the backends round the operator the same way)
+    GPU_TO_GPU
+};
+
 template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
 class DeviceReduce : public LuisaModule
 {
@@ -47,6 +63,13 @@ class DeviceReduce : public LuisaModule
     Device m_device;
     bool   m_created = false;
 
+    LookBackDelayPolicy m_look_back_delay   = LookBackDelayPolicy::NO_DELAY;
+    ReduceDeterminism   m_determinism       = ReduceDeterminism::RUN_TO_RUN;
+    bool                m_packed_tile_state = false;
+
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
   public:
     DeviceReduce()  = default;
     ~DeviceReduce() = default;
@@ -57,24 +80,273 @@ class DeviceReduce : public LuisaModule
         int num_elements_per_block = m_block_size * ITEMS_PER_THREAD;
         int extra_space            = num_elements_per_block / m_warp_nums;
         m_shared_mem_size          = (num_elements_per_block + extra_space);
+        m_allocator                = CachingAllocator::shared(device);
+        m_shaders                  = ShaderRegistry::shared(device);
+        m_packed_tile_state        = packed_tile_state_supported(device);
         m_created                  = true;
     }
 
-    template <NumericT Type4Byte, typename ReduceOp>
+    /**
+     * @brief Compiles ahead of time what Reduce/Sum/Min/Max/MinMaxSum/MeanVariance/ArgMin/ArgMax need
+     * for these operators, e.g. Warmup<float>(SumOp{}, MaxOp{}, ArgMinOp{}, WelfordOp{}). With the
+     * persistent shader cache enabled (shader_cache_config()) the binaries are written to disk and
+     * reloaded by later processes. The compiles are queued on shader_compile_pool(), Warmup returns
+     * at once and a later call only waits for the shaders it dispatches. The operators are traced on
+     * the pool threads after Warmup returns: an operator lambda that captures by reference (e.g.
+     * [&scale]) needs shader_compile_pool().wait_idle() before those captures leave scope. The same
+     * holds for the Warmup of every device module.
+     */
+    template <NumericT Type4Byte, typename... ReduceOps>
+    void Warmup(ReduceOps... reduce_ops)
+    {
+        (warmup_reduce<Type4Byte>(reduce_ops), ...);
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp, typename TransformOp>
+    void WarmupTransformReduce(ReduceOp reduce_op, TransformOp transform_op)
+    {
+        reduce_shader<Type4Byte>(reduce_op, transform_op);
+        reduce_single_tile_shader<Type4Byte>(reduce_op);
+    }
+
+    template <NumericT KeyType, NumericT ValueType, typename... ReduceOps>
+    void WarmupReduceByKey(ReduceOps... reduce_ops)
+    {
+        visit_tile_state_layout(m_packed_tile_state,
+                                [&]<bool PACKED>(std::bool_constant<PACKED>)
+                                {
+                                    reduce_by_key_tile_state_init_shader<PACKED, KeyType, ValueType>();
+                                    (reduce_by_key_shader<PACKED, KeyType, ValueType>(reduce_ops), ...);
+                                });
+    }
+
+    // how ReduceByKey tiles wait on their predecessors during look-back
+    void set_look_back_delay(LookBackDelayPolicy policy) noexcept { m_look_back_delay = policy; }
+
+    [[nodiscard]] LookBackDelayPolicy look_back_delay() const noexcept { return m_look_back_delay; }
+
+    /**
+     * @brief Selects how Reduce/Sum/TransformReduce/MinMaxSum/MeanVariance associate the items. GPU_TO_GPU
+     * trades the grid pass for one read of the input into fixed tiles and log_2048(n) small passes over the
+     * partials; the pairwise tree also keeps the float rounding error at O(log n). The temp storage size
+     * depends on the mode, query it after choosing one.
+     */
+    void set_determinism(ReduceDeterminism determinism) noexcept { m_determinism = determinism; }
+
+    [[nodiscard]] ReduceDeterminism determinism() const noexcept { return m_determinism; }
+
+    /**
+     * @brief Type4Byte is the accumulator: the block reduce, the partials and d_out hold it. A narrower
+     * InputT (ushort/uchar counts, half values) is converted while loading, e.g. Sum of a
+     * BufferView<ushort> into a BufferView<uint>, so no widened copy of the input is written.
+     */
+    template <NumericT Type4Byte, typename ReduceOp, typename InputT = Type4Byte>
+    void Reduce(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<InputT>    d_in,
+                BufferView<Type4Byte> d_out,
+                size_t                num_item,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        auto layout = reduce_temp_storage_layout<Type4Byte>(num_item);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        reduce_array<Type4Byte>(cmdlist,
+                                layout.get<Type4Byte>(temp_storage, 0),
+                                make_cast_input_iterator<Type4Byte>(d_in),
+                                d_out,
+                                num_item,
+                                reduce_op,
+                                IdentityOp(),
+                                initial_value);
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp, typename InputT = Type4Byte>
+    void Reduce(CommandList&          cmdlist,
+                BufferView<InputT>    d_in,
+                BufferView<Type4Byte> d_out,
+                size_t                num_item,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        size_t temp_storage_bytes = 0;
+        Reduce(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_item, reduce_op, initial_value);
+        Reduce(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               num_item,
+               reduce_op,
+               initial_value);
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp, typename InputT = Type4Byte>
     void Reduce(CommandList&          cmdlist,
                 Stream&               stream,
-                BufferView<Type4Byte> d_in,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<InputT>    d_in,
                 BufferView<Type4Byte> d_out,
                 size_t                num_item,
                 ReduceOp              reduce_op,
                 Type4Byte             initial_value)
     {
-        size_t temp_storage_size = 0;
-        get_temp_size_scan(temp_storage_size, m_block_size, ITEMS_PER_THREAD, num_item);
-        Buffer<Type4Byte> temp_buffer = m_device.create_buffer<Type4Byte>(temp_storage_size);
-        reduce_array_recursive<Type4Byte>(cmdlist, temp_buffer.view(), d_in, d_out, num_item, 0, 0, reduce_op, initial_value);
+        Reduce(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_item, reduce_op, initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp, typename InputT = Type4Byte>
+    void Reduce(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<InputT>    d_in,
+                BufferView<Type4Byte> d_out,
+                size_t                num_item,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        Reduce(cmdlist, d_in, d_out, num_item, reduce_op, initial_value);
         stream << cmdlist.commit() << synchronize();
-        temp_buffer.release();
+    }
+
+
+    /**
+     * @brief Reduce reading through an iterator, e.g. a TransformInputIterator or a CountingIterator,
+     * the transformed values are folded as they load and never written to memory.
+     */
+    template <IteratorT InputIt, typename ReduceOp>
+    void Reduce(CommandList&                             cmdlist,
+                ByteBufferView                           temp_storage,
+                size_t&                                  temp_storage_bytes,
+                InputIt                                  d_in,
+                BufferView<typename InputIt::value_type> d_out,
+                size_t                                   num_item,
+                ReduceOp                                 reduce_op,
+                typename InputIt::value_type             initial_value)
+    {
+        using ValueT = typename InputIt::value_type;
+        auto layout  = reduce_temp_storage_layout<ValueT>(num_item);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        reduce_array<ValueT>(
+            cmdlist, layout.get<ValueT>(temp_storage, 0), d_in, d_out, num_item, reduce_op, IdentityOp(), initial_value);
+    }
+
+    template <IteratorT InputIt, typename ReduceOp>
+    void Reduce(CommandList&                             cmdlist,
+                InputIt                                  d_in,
+                BufferView<typename InputIt::value_type> d_out,
+                size_t                                   num_item,
+                ReduceOp                                 reduce_op,
+                typename InputIt::value_type             initial_value)
+    {
+        size_t temp_storage_bytes = 0;
+        Reduce(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_item, reduce_op, initial_value);
+        Reduce(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               num_item,
+               reduce_op,
+               initial_value);
+    }
+
+    template <IteratorT InputIt, typename ReduceOp>
+    void Reduce(CommandList&                             cmdlist,
+                Stream&                                  stream,
+                ByteBufferView                           temp_storage,
+                size_t&                                  temp_storage_bytes,
+                InputIt                                  d_in,
+                BufferView<typename InputIt::value_type> d_out,
+                size_t                                   num_item,
+                ReduceOp                                 reduce_op,
+                typename InputIt::value_type             initial_value)
+    {
+        Reduce(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_item, reduce_op, initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <IteratorT InputIt, typename ReduceOp>
+    void Reduce(CommandList&                             cmdlist,
+                Stream&                                  stream,
+                InputIt                                  d_in,
+                BufferView<typename InputIt::value_type> d_out,
+                size_t                                   num_item,
+                ReduceOp                                 reduce_op,
+                typename InputIt::value_type             initial_value)
+    {
+        Reduce(cmdlist, d_in, d_out, num_item, reduce_op, initial_value);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&                           cmdlist,
+                ByteBufferView                         temp_storage,
+                size_t&                                temp_storage_bytes,
+                BufferView<IndexValuePairT<Type4Byte>> d_in,
+                BufferView<IndexValuePairT<Type4Byte>> d_out,
+                size_t                                 num_item,
+                ReduceOp                               reduce_op,
+                IndexValuePairT<Type4Byte>             init)
+    {
+        auto layout = reduce_temp_storage_layout<IndexValuePairT<Type4Byte>>(num_item);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        reduce_array<IndexValuePairT<Type4Byte>>(
+            cmdlist, layout.get<IndexValuePairT<Type4Byte>>(temp_storage, 0), d_in, d_out, num_item, reduce_op, IdentityOp(), init);
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&                           cmdlist,
+                BufferView<IndexValuePairT<Type4Byte>> d_in,
+                BufferView<IndexValuePairT<Type4Byte>> d_out,
+                size_t                                 num_item,
+                ReduceOp                               reduce_op,
+                IndexValuePairT<Type4Byte>             init)
+    {
+        size_t temp_storage_bytes = 0;
+        Reduce(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_item, reduce_op, init);
+        Reduce(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               num_item,
+               reduce_op,
+               init);
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&                           cmdlist,
+                Stream&                                stream,
+                ByteBufferView                         temp_storage,
+                size_t&                                temp_storage_bytes,
+                BufferView<IndexValuePairT<Type4Byte>> d_in,
+                BufferView<IndexValuePairT<Type4Byte>> d_out,
+                size_t                                 num_item,
+                ReduceOp                               reduce_op,
+                IndexValuePairT<Type4Byte>             init)
+    {
+        Reduce(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_item, reduce_op, init);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
     }
 
     template <NumericT Type4Byte, typename ReduceOp>
@@ -86,124 +358,530 @@ class DeviceReduce : public LuisaModule
                 ReduceOp                               reduce_op,
                 IndexValuePairT<Type4Byte>             init)
     {
-        size_t temp_storage_size = 0;
-        get_temp_size_scan(temp_storage_size, m_block_size, ITEMS_PER_THREAD, num_item);
-        Buffer<IndexValuePairT<Type4Byte>> temp_buffer =
-            m_device.create_buffer<IndexValuePairT<Type4Byte>>(temp_storage_size);
-        reduce_array_recursive<IndexValuePairT<Type4Byte>>(
-            cmdlist, temp_buffer.view(), d_in, d_out, num_item, 0, 0, reduce_op, init);
+        Reduce(cmdlist, d_in, d_out, num_item, reduce_op, init);
         stream << cmdlist.commit() << synchronize();
-        temp_buffer.release();
     }
 
 
-    template <NumericT Type4Byte>
-    void Sum(CommandList& cmdlist, Stream& stream, BufferView<Type4Byte> d_in, BufferView<Type4Byte> d_out, size_t num_item)
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void Sum(CommandList&          cmdlist,
+             ByteBufferView        temp_storage,
+             size_t&               temp_storage_bytes,
+             BufferView<InputT>    d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
     {
         Reduce(
             cmdlist,
-            stream,
+            temp_storage,
+            temp_storage_bytes,
             d_in,
             d_out,
             num_item,
-            [](const Var<Type4Byte>& a, Var<Type4Byte>& b) { return a + b; },
+            SumOp{},
             Type4Byte(0));
     }
 
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void Sum(CommandList&          cmdlist,
+             BufferView<InputT>    d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        size_t temp_storage_bytes = 0;
+        Sum(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_item);
+        Sum(cmdlist, m_allocator->allocate(cmdlist, temp_storage_bytes), temp_storage_bytes, d_in, d_out, num_item);
+    }
+
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void Sum(CommandList&          cmdlist,
+             Stream&               stream,
+             ByteBufferView        temp_storage,
+             size_t&               temp_storage_bytes,
+             BufferView<InputT>    d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        Sum(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_item);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void Sum(CommandList&          cmdlist,
+             Stream&               stream,
+             BufferView<InputT>    d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        Sum(cmdlist, d_in, d_out, num_item);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+
     template <NumericT Type4Byte>
-    void Min(CommandList& cmdlist, Stream& stream, BufferView<Type4Byte> d_in, BufferView<Type4Byte> d_out, size_t num_item)
+    void Min(CommandList&          cmdlist,
+             ByteBufferView        temp_storage,
+             size_t&               temp_storage_bytes,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
     {
         Reduce(
             cmdlist,
-            stream,
+            temp_storage,
+            temp_storage_bytes,
             d_in,
             d_out,
             num_item,
-            [](const Var<Type4Byte>& a, Var<Type4Byte>& b) { return luisa::compute::min(a, b); },
+            MinOp{},
             std::numeric_limits<Type4Byte>::max());
     }
 
     template <NumericT Type4Byte>
-    void Max(CommandList& cmdlist, Stream& stream, BufferView<Type4Byte> d_in, BufferView<Type4Byte> d_out, size_t num_item)
+    void Min(CommandList&          cmdlist,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        size_t temp_storage_bytes = 0;
+        Min(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_item);
+        Min(cmdlist, m_allocator->allocate(cmdlist, temp_storage_bytes), temp_storage_bytes, d_in, d_out, num_item);
+    }
+
+    template <NumericT Type4Byte>
+    void Min(CommandList&          cmdlist,
+             Stream&               stream,
+             ByteBufferView        temp_storage,
+             size_t&               temp_storage_bytes,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        Min(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_item);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte>
+    void Min(CommandList&          cmdlist,
+             Stream&               stream,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        Min(cmdlist, d_in, d_out, num_item);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+
+    template <NumericT Type4Byte>
+    void Max(CommandList&          cmdlist,
+             ByteBufferView        temp_storage,
+             size_t&               temp_storage_bytes,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
     {
         Reduce(
             cmdlist,
-            stream,
+            temp_storage,
+            temp_storage_bytes,
             d_in,
             d_out,
             num_item,
-            [](const Var<Type4Byte>& a, Var<Type4Byte>& b) { return luisa::compute::max(a, b); },
-            std::numeric_limits<Type4Byte>::min());
+            MaxOp{},
+            std::numeric_limits<Type4Byte>::lowest());
+    }
+
+    template <NumericT Type4Byte>
+    void Max(CommandList&          cmdlist,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        size_t temp_storage_bytes = 0;
+        Max(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_item);
+        Max(cmdlist, m_allocator->allocate(cmdlist, temp_storage_bytes), temp_storage_bytes, d_in, d_out, num_item);
+    }
+
+    template <NumericT Type4Byte>
+    void Max(CommandList&          cmdlist,
+             Stream&               stream,
+             ByteBufferView        temp_storage,
+             size_t&               temp_storage_bytes,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        Max(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_item);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte>
+    void Max(CommandList&          cmdlist,
+             Stream&               stream,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             size_t                num_item)
+    {
+        Max(cmdlist, d_in, d_out, num_item);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+
+    /**
+     * @brief Min, max, sum and count of d_in in a single pass, written to d_out[0], instead of a Min,
+     * a Max and a Sum each reading the input again.
+     */
+    template <NumericT Type4Byte>
+    void MinMaxSum(CommandList&                       cmdlist,
+                   ByteBufferView                     temp_storage,
+                   size_t&                            temp_storage_bytes,
+                   BufferView<Type4Byte>              d_in,
+                   BufferView<ReduceStats<Type4Byte>> d_out,
+                   size_t                             num_item)
+    {
+        using StatsT = ReduceStats<Type4Byte>;
+        auto layout  = reduce_temp_storage_layout<StatsT>(num_item);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        reduce_array<StatsT>(cmdlist,
+                             layout.get<StatsT>(temp_storage, 0),
+                             d_in,
+                             d_out,
+                             num_item,
+                             MinMaxSumOp{},
+                             IdentityOp(),
+                             min_max_sum_identity<Type4Byte>());
+    }
+
+    template <NumericT Type4Byte>
+    void MinMaxSum(CommandList&                       cmdlist,
+                   BufferView<Type4Byte>              d_in,
+                   BufferView<ReduceStats<Type4Byte>> d_out,
+                   size_t                             num_item)
+    {
+        size_t temp_storage_bytes = 0;
+        MinMaxSum(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_item);
+        MinMaxSum(cmdlist, m_allocator->allocate(cmdlist, temp_storage_bytes), temp_storage_bytes, d_in, d_out, num_item);
+    }
+
+    template <NumericT Type4Byte>
+    void MinMaxSum(CommandList&                       cmdlist,
+                   Stream&                            stream,
+                   ByteBufferView                     temp_storage,
+                   size_t&                            temp_storage_bytes,
+                   BufferView<Type4Byte>              d_in,
+                   BufferView<ReduceStats<Type4Byte>> d_out,
+                   size_t                             num_item)
+    {
+        MinMaxSum(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_item);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte>
+    void MinMaxSum(CommandList&                       cmdlist,
+                   Stream&                            stream,
+                   BufferView<Type4Byte>              d_in,
+                   BufferView<ReduceStats<Type4Byte>> d_out,
+                   size_t                             num_item)
+    {
+        MinMaxSum(cmdlist, d_in, d_out, num_item);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+
+    /**
+     * @brief Mean and variance of d_in in a single pass, written to d_out[0] as WelfordStats (mean, m2,
+     * count; variance() = m2 / count). Partials are merged with Chan's update, which keeps its precision
+     * on long float ranges where a float sum and sum of squares do not.
+     */
+    template <std::floating_point Type4Byte>
+    void MeanVariance(CommandList&                        cmdlist,
+                      ByteBufferView                      temp_storage,
+                      size_t&                             temp_storage_bytes,
+                      BufferView<Type4Byte>               d_in,
+                      BufferView<WelfordStats<Type4Byte>> d_out,
+                      size_t                              num_item)
+    {
+        using StatsT = WelfordStats<Type4Byte>;
+        auto layout  = reduce_temp_storage_layout<StatsT>(num_item);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        reduce_array<StatsT>(
+            cmdlist, layout.get<StatsT>(temp_storage, 0), d_in, d_out, num_item, WelfordOp{}, IdentityOp(), StatsT{});
+    }
+
+    template <std::floating_point Type4Byte>
+    void MeanVariance(CommandList&                        cmdlist,
+                      BufferView<Type4Byte>               d_in,
+                      BufferView<WelfordStats<Type4Byte>> d_out,
+                      size_t                              num_item)
+    {
+        size_t temp_storage_bytes = 0;
+        MeanVariance(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_item);
+        MeanVariance(cmdlist, m_allocator->allocate(cmdlist, temp_storage_bytes), temp_storage_bytes, d_in, d_out, num_item);
+    }
+
+    template <std::floating_point Type4Byte>
+    void MeanVariance(CommandList&                        cmdlist,
+                      Stream&                             stream,
+                      ByteBufferView                      temp_storage,
+                      size_t&                             temp_storage_bytes,
+                      BufferView<Type4Byte>               d_in,
+                      BufferView<WelfordStats<Type4Byte>> d_out,
+                      size_t                              num_item)
+    {
+        MeanVariance(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_item);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <std::floating_point Type4Byte>
+    void MeanVariance(CommandList&                        cmdlist,
+                      Stream&                             stream,
+                      BufferView<Type4Byte>               d_in,
+                      BufferView<WelfordStats<Type4Byte>> d_out,
+                      size_t                              num_item)
+    {
+        MeanVariance(cmdlist, d_in, d_out, num_item);
+        stream << cmdlist.commit() << synchronize();
     }
 
+
     template <NumericT Type4Byte>
     void ArgMin(CommandList&          cmdlist,
-                Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
                 BufferView<Type4Byte> d_in,
                 BufferView<Type4Byte> d_out,
                 BufferView<uint>      d_index_out,
                 size_t                num_item)
     {
-        // key value pair reduce
-        Buffer<IndexValuePairT<Type4Byte>> d_in_kv =
-            m_device.create_buffer<IndexValuePairT<Type4Byte>>(d_in.size());
+        auto layout = arg_reduce_temp_storage_layout<Type4Byte>(num_item);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        arg_reduce<Type4Byte>(cmdlist,
+                              layout,
+                              temp_storage,
+                              d_in,
+                              d_out,
+                              d_index_out,
+                              num_item,
+                              ArgMinOp(),
+                              IndexValuePairT<Type4Byte>{0, std::numeric_limits<Type4Byte>::max()});
+    }
 
-        Buffer<IndexValuePairT<Type4Byte>> d_out_kv = m_device.create_buffer<IndexValuePairT<Type4Byte>>(1);
+    template <NumericT Type4Byte>
+    void ArgMin(CommandList&          cmdlist,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_index_out,
+                size_t                num_item)
+    {
+        size_t temp_storage_bytes = 0;
+        ArgMin(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, d_index_out, num_item);
+        ArgMin(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_item);
+    }
 
-        // construct key value pair
-        arg_construct<Type4Byte>(cmdlist, d_in, d_in_kv.view());
+    template <NumericT Type4Byte>
+    void ArgMin(CommandList&          cmdlist,
+                Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_index_out,
+                size_t                num_item)
+    {
+        ArgMin(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, d_index_out, num_item);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
-        Reduce(cmdlist,
-               stream,
-               d_in_kv.view(),
-               d_out_kv.view(),
-               num_item,
-               ArgMinOp(),
-               IndexValuePairT<Type4Byte>{0, std::numeric_limits<Type4Byte>::max()});
+    template <NumericT Type4Byte>
+    void ArgMin(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_index_out,
+                size_t                num_item)
+    {
+        ArgMin(cmdlist, d_in, d_out, d_index_out, num_item);
+        stream << cmdlist.commit() << synchronize();
+    }
 
-        // copy result to d_out and d_index_out
-        arg_assign<Type4Byte>(cmdlist, d_out_kv.view(), d_out, d_index_out);
 
-        stream << cmdlist.commit() << synchronize();
+    template <NumericT Type4Byte>
+    void ArgMax(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_index_out,
+                size_t                num_item)
+    {
+        auto layout = arg_reduce_temp_storage_layout<Type4Byte>(num_item);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        arg_reduce<Type4Byte>(cmdlist,
+                              layout,
+                              temp_storage,
+                              d_in,
+                              d_out,
+                              d_index_out,
+                              num_item,
+                              ArgMaxOp(),
+                              IndexValuePairT<Type4Byte>{0, std::numeric_limits<Type4Byte>::lowest()});
+    }
 
-        d_in_kv.release();
-        d_out_kv.release();
+    template <NumericT Type4Byte>
+    void ArgMax(CommandList&          cmdlist,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_index_out,
+                size_t                num_item)
+    {
+        size_t temp_storage_bytes = 0;
+        ArgMax(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, d_index_out, num_item);
+        ArgMax(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_item);
     }
 
     template <NumericT Type4Byte>
     void ArgMax(CommandList&          cmdlist,
                 Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
                 BufferView<Type4Byte> d_in,
                 BufferView<Type4Byte> d_out,
                 BufferView<uint>      d_index_out,
                 size_t                num_item)
     {
-        // key value pair reduce
-        Buffer<IndexValuePairT<Type4Byte>> d_in_kv =
-            m_device.create_buffer<IndexValuePairT<Type4Byte>>(d_in.size());
-        Buffer<IndexValuePairT<Type4Byte>> d_out_kv = m_device.create_buffer<IndexValuePairT<Type4Byte>>(1);
-
-        // construct key value pair
-        arg_construct<Type4Byte>(cmdlist, d_in, d_in_kv.view());
+        ArgMax(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, d_index_out, num_item);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
-        Reduce(cmdlist,
-               stream,
-               d_in_kv.view(),
-               d_out_kv.view(),
-               num_item,
-               ArgMaxOp(),
-               IndexValuePairT<Type4Byte>{0, std::numeric_limits<Type4Byte>::min()});
+    template <NumericT Type4Byte>
+    void ArgMax(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_index_out,
+                size_t                num_item)
+    {
+        ArgMax(cmdlist, d_in, d_out, d_index_out, num_item);
+        stream << cmdlist.commit() << synchronize();
+    }
 
 
-        // copy result to d_out and d_index_out
-        arg_assign<Type4Byte>(cmdlist, d_out_kv.view(), d_out, d_index_out);
-        stream << cmdlist.commit() << synchronize();
+    template <NumericT KeyType, NumericT ValueType, typename ReduceOp>
+    void ReduceByKey(CommandList&          cmdlist,
+                     ByteBufferView        temp_storage,
+                     size_t&               temp_storage_bytes,
+                     BufferView<KeyType>   d_keys_in,
+                     BufferView<ValueType> d_values_in,
+                     BufferView<KeyType>   d_unique_out,
+                     BufferView<ValueType> g_aggregates_out,
+                     BufferView<uint>      g_num_runs_out,
+                     ReduceOp              reduce_op,
+                     size_t                num_elements)
+    {
+        int    num_tiles       = imax(1, (int)ceil((float)num_elements / (ITEMS_PER_THREAD * m_block_size)));
+        size_t tile_state_size = scan_tile_state_size<KeyValuePair<int, ValueType>>(m_packed_tile_state);
+        // tilestate
+        TempStorageLayout<1> layout{{(details::WARP_SIZE + num_tiles) * tile_state_size}};
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        // num_runs_out is written by the last tile, no clear needed
+        reduce_by_key_array<KeyType, ValueType>(cmdlist,
+                                                layout.get_bytes(temp_storage, 0),
+                                                d_keys_in,
+                                                d_values_in,
+                                                d_unique_out,
+                                                g_aggregates_out,
+                                                g_num_runs_out,
+                                                reduce_op,
+                                                num_elements);
     }
 
+    template <NumericT KeyType, NumericT ValueType, typename ReduceOp>
+    void ReduceByKey(CommandList&          cmdlist,
+                     BufferView<KeyType>   d_keys_in,
+                     BufferView<ValueType> d_values_in,
+                     BufferView<KeyType>   d_unique_out,
+                     BufferView<ValueType> g_aggregates_out,
+                     BufferView<uint>      g_num_runs_out,
+                     ReduceOp              reduce_op,
+                     size_t                num_elements)
+    {
+        size_t temp_storage_bytes = 0;
+        ReduceByKey(cmdlist,
+                    temp_storage_query(),
+                    temp_storage_bytes,
+                    d_keys_in,
+                    d_values_in,
+                    d_unique_out,
+                    g_aggregates_out,
+                    g_num_runs_out,
+                    reduce_op,
+                    num_elements);
+        ReduceByKey(cmdlist,
+                    m_allocator->allocate(cmdlist, temp_storage_bytes),
+                    temp_storage_bytes,
+                    d_keys_in,
+                    d_values_in,
+                    d_unique_out,
+                    g_aggregates_out,
+                    g_num_runs_out,
+                    reduce_op,
+                    num_elements);
+    }
 
     template <NumericT KeyType, NumericT ValueType, typename ReduceOp>
     void ReduceByKey(CommandList&          cmdlist,
                      Stream&               stream,
+                     ByteBufferView        temp_storage,
+                     size_t&               temp_storage_bytes,
                      BufferView<KeyType>   d_keys_in,
                      BufferView<ValueType> d_values_in,
                      BufferView<KeyType>   d_unique_out,
@@ -212,22 +890,122 @@ class DeviceReduce : public LuisaModule
                      ReduceOp              reduce_op,
                      size_t                num_elements)
     {
-        luisa::vector<luisa::uint> zero_data(1, 0);
-        stream << g_num_runs_out.copy_from(zero_data.data()) << synchronize();
-        int num_tiles = imax(1, (int)ceil((float)num_elements / (ITEMS_PER_THREAD * m_block_size)));
-        // tilestate
-        using ReduceByKey = details::ReduceByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ReduceByKeyTileState = ReduceByKey::ScanTileState;
-        Buffer<ReduceByKeyTileState> tile_states =
-            m_device.create_buffer<ReduceByKeyTileState>(details::WARP_SIZE + num_tiles);
+        ReduceByKey(cmdlist,
+                    temp_storage,
+                    temp_storage_bytes,
+                    d_keys_in,
+                    d_values_in,
+                    d_unique_out,
+                    g_aggregates_out,
+                    g_num_runs_out,
+                    reduce_op,
+                    num_elements);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
-        reduce_by_key_array<KeyType, ValueType, ReduceByKeyTileState>(
-            cmdlist, tile_states.view(), d_keys_in, d_values_in, d_unique_out, g_aggregates_out, g_num_runs_out, reduce_op, num_elements);
+    template <NumericT KeyType, NumericT ValueType, typename ReduceOp>
+    void ReduceByKey(CommandList&          cmdlist,
+                     Stream&               stream,
+                     BufferView<KeyType>   d_keys_in,
+                     BufferView<ValueType> d_values_in,
+                     BufferView<KeyType>   d_unique_out,
+                     BufferView<ValueType> g_aggregates_out,
+                     BufferView<uint>      g_num_runs_out,
+                     ReduceOp              reduce_op,
+                     size_t                num_elements)
+    {
+        ReduceByKey(cmdlist,
+                    d_keys_in,
+                    d_values_in,
+                    d_unique_out,
+                    g_aggregates_out,
+                    g_num_runs_out,
+                    reduce_op,
+                    num_elements);
         stream << cmdlist.commit() << synchronize();
-        tile_states.release();
     }
 
 
+    template <typename Type4Byte, typename ReduceOp, typename TransformOp>
+    void TransformReduce(CommandList&          cmdlist,
+                         ByteBufferView        temp_storage,
+                         size_t&               temp_storage_bytes,
+                         BufferView<Type4Byte> d_in,
+                         BufferView<Type4Byte> d_out,
+                         size_t                num_item,
+                         ReduceOp              reduce_op,
+                         TransformOp           transform_op,
+                         Type4Byte             init)
+    {
+        auto layout = reduce_temp_storage_layout<Type4Byte>(num_item);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        reduce_array<Type4Byte>(
+            cmdlist, layout.get<Type4Byte>(temp_storage, 0), d_in, d_out, num_item, reduce_op, transform_op, init);
+    }
+
+    template <typename Type4Byte, typename ReduceOp, typename TransformOp>
+    void TransformReduce(CommandList&          cmdlist,
+                         BufferView<Type4Byte> d_in,
+                         BufferView<Type4Byte> d_out,
+                         size_t                num_item,
+                         ReduceOp              reduce_op,
+                         TransformOp           transform_op,
+                         Type4Byte             init)
+    {
+        size_t temp_storage_bytes = 0;
+        TransformReduce(cmdlist,
+                        temp_storage_query(),
+                        temp_storage_bytes,
+                        d_in,
+                        d_out,
+                        num_item,
+                        reduce_op,
+                        transform_op,
+                        init);
+        TransformReduce(cmdlist,
+                        m_allocator->allocate(cmdlist, temp_storage_bytes),
+                        temp_storage_bytes,
+                        d_in,
+                        d_out,
+                        num_item,
+                        reduce_op,
+                        transform_op,
+                        init);
+    }
+
+    template <typename Type4Byte, typename ReduceOp, typename TransformOp>
+    void TransformReduce(CommandList&          cmdlist,
+                         Stream&               stream,
+                         ByteBufferView        temp_storage,
+                         size_t&               temp_storage_bytes,
+                         BufferView<Type4Byte> d_in,
+                         BufferView<Type4Byte> d_out,
+                         size_t                num_item,
+                         ReduceOp              reduce_op,
+                         TransformOp           transform_op,
+                         Type4Byte             init)
+    {
+        TransformReduce(cmdlist,
+                        temp_storage,
+                        temp_storage_bytes,
+                        d_in,
+                        d_out,
+                        num_item,
+                        reduce_op,
+                        transform_op,
+                        init);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
     template <typename Type4Byte, typename ReduceOp, typename TransformOp>
     void TransformReduce(CommandList&          cmdlist,
                          Stream&               stream,
@@ -238,31 +1016,107 @@ class DeviceReduce : public LuisaModule
                          TransformOp           transform_op,
                          Type4Byte             init)
     {
-        size_t temp_storage_size = 0;
-        get_temp_size_scan(temp_storage_size, m_block_size, ITEMS_PER_THREAD, num_item);
-        Buffer<Type4Byte> temp_buffer = m_device.create_buffer<Type4Byte>(temp_storage_size);
-        reduce_transform_array_recursive<Type4Byte>(
-            cmdlist, temp_buffer.view(), d_in, d_out, num_item, 0, 0, reduce_op, transform_op, init);
+        TransformReduce(cmdlist, d_in, d_out, num_item, reduce_op, transform_op, init);
         stream << cmdlist.commit() << synchronize();
-        temp_buffer.release();
     }
 
   private:
+    // upper bound of the grid pass, the partials then fit into one tile of the final pass
+    static constexpr uint REDUCE_MAX_GRID_SIZE = BLOCK_SIZE * ITEMS_PER_THREAD;
+
+    GridEvenShared reduce_even_share(size_t num_item)
+    {
+        GridEvenShared even_share;
+        even_share.DispatchInit(static_cast<uint>(num_item), REDUCE_MAX_GRID_SIZE, BLOCK_SIZE * ITEMS_PER_THREAD);
+        return even_share;
+    }
+
+    template <typename Type>
+    TempStorageLayout<1> reduce_temp_storage_layout(size_t num_item)
+    {
+        if(m_determinism == ReduceDeterminism::GPU_TO_GPU)
+        {
+            // the partials of the first pass and of the second, later passes reuse the two in turn
+            uint num_tiles    = deterministic_num_tiles<Type>(num_item);
+            uint num_partials = num_tiles > 1 ? num_tiles + deterministic_num_tiles<Type>(num_tiles) : 1u;
+            return TempStorageLayout<1>{{num_partials * sizeof(Type)}};
+        }
+        // one partial per block of the grid pass
+        auto even_share = reduce_even_share(num_item);
+        return TempStorageLayout<1>{{std::max(even_share.grid_size, 1) * sizeof(Type)}};
+    }
+
+    template <typename Type>
+    static uint deterministic_num_tiles(size_t num_item)
+    {
+        return std::max(ceil_div(static_cast<uint>(num_item), details::deterministic_reduce_tile_items<Type>()), 1u);
+    }
+
     template <NumericT Type4Byte>
-    void arg_construct(CommandList& cmdlist, BufferView<Type4Byte> d_in, BufferView<IndexValuePairT<Type4Byte>> d_kv_out)
+    TempStorageLayout<2> arg_reduce_temp_storage_layout(size_t num_item)
     {
-        using ArgReduce          = details::ArgReduce<Type4Byte, BLOCK_SIZE>;
-        using ArgConstructShader = ArgReduce::ArgConstructShaderT;
-        auto key = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
-        auto ms_arg_construct_it = ms_arg_construct_map.find(key);
-        if(ms_arg_construct_it == ms_arg_construct_map.end())
+        using KeyValueT = IndexValuePairT<Type4Byte>;
+
+        // the pairs are built while loading, nothing here grows with the input
+        auto even_share = reduce_even_share(num_item);
+        return TempStorageLayout<2>{{
+            // reduced pair
+            sizeof(KeyValueT),
+            // reduce temp
+            std::max(even_share.grid_size, 1) * sizeof(KeyValueT),
+        }};
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp>
+    void arg_reduce(CommandList&                cmdlist,
+                    const TempStorageLayout<2>& layout,
+                    ByteBufferView              temp_storage,
+                    BufferView<Type4Byte>       d_in,
+                    BufferView<Type4Byte>       d_out,
+                    BufferView<uint>            d_index_out,
+                    size_t                      num_item,
+                    ReduceOp                    reduce_op,
+                    IndexValuePairT<Type4Byte>  init)
+    {
+        using KeyValueT = IndexValuePairT<Type4Byte>;
+        auto d_out_kv   = layout.get<KeyValueT>(temp_storage, 0);
+        auto d_temp_kv  = layout.get<KeyValueT>(temp_storage, 1);
+
+        // queue the three compiles before the first dispatch waits on one
+        auto ms_arg_reduce_ptr         = arg_reduce_shader<Type4Byte>(reduce_op);
+        auto ms_reduce_single_tile_ptr = reduce_single_tile_shader<KeyValueT>(reduce_op);
+        arg_assign_shader<Type4Byte>();
+
+        // grid pass over the values, each one is paired with its index on load
+        auto even_share = reduce_even_share(num_item);
+        if(even_share.grid_size > 0)
         {
-            auto shader = ArgReduce().compile_arg_construct_shader(m_device);
-            ms_arg_construct_map.try_emplace(key, std::move(shader));
-            ms_arg_construct_it = ms_arg_construct_map.find(key);
+            cmdlist << (*ms_arg_reduce_ptr)(d_in, d_temp_kv, even_share, op_params(reduce_op), op_params(IdentityOp()))
+                           .dispatch(even_share.grid_size * m_block_size);
         }
-        auto ms_arg_construct_ptr = reinterpret_cast<ArgConstructShader*>(&(*ms_arg_construct_it->second));
-        cmdlist << (*ms_arg_construct_ptr)(d_in, d_kv_out).dispatch(d_in.size());
+        cmdlist << (*ms_reduce_single_tile_ptr)(d_temp_kv, d_out_kv, even_share.grid_size, init, op_params(reduce_op))
+                       .dispatch(m_block_size);
+
+        // copy result to d_out and d_index_out
+        arg_assign<Type4Byte>(cmdlist, d_out_kv, d_out, d_index_out);
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp>
+    auto arg_reduce_shader(ReduceOp reduce_op)
+    {
+        using ReduceShader =
+            details::ReduceModule<IndexValuePairT<Type4Byte>, BLOCK_SIZE, ITEMS_PER_THREAD, WARP_NUMS, Type4Byte>;
+        using ReduceKernel = ReduceShader::ReduceShaderKernel;
+
+        constexpr auto key = shader_key<"arg_reduce", DeviceReduce, ReduceShader, ReduceOp>();
+        return m_shaders->get_or_compile<ReduceKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(reduce_op);
+            LUISA_INFO("Compiling ArgReduce shader for key: {}", desc);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, reduce_op]() mutable
+            { return ReduceShader().compile(device, shared_mem_size, reduce_op, IdentityOp()); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
     }
 
     template <NumericT Type4Byte>
@@ -270,221 +1124,193 @@ class DeviceReduce : public LuisaModule
                     BufferView<IndexValuePairT<Type4Byte>> d_kv_in,
                     BufferView<Type4Byte>                  d_value_out,
                     BufferView<uint>                       d_index_out)
+    {
+        auto ms_arg_assign_ptr = arg_assign_shader<Type4Byte>();
+        cmdlist << (*ms_arg_assign_ptr)(d_kv_in, d_value_out, d_index_out).dispatch(d_index_out.size());
+    }
+
+    template <NumericT Type4Byte>
+    auto arg_assign_shader()
     {
         using ArgReduce       = details::ArgReduce<Type4Byte, BLOCK_SIZE>;
         using ArgAssignShader = ArgReduce::ArgAssignShaderT;
-        auto key              = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
-        auto ms_arg_assign_it = ms_arg_assign_map.find(key);
-        if(ms_arg_assign_it == ms_arg_assign_map.end())
+        constexpr auto key = shader_key<"arg_assign", DeviceReduce, ArgReduce>();
+        return m_shaders->get_or_compile<ArgAssignShader>(key, [&]
         {
-            auto shader = ArgReduce().compile_arg_assign_shader(m_device);
-            ms_arg_assign_map.try_emplace(key, std::move(shader));
-            ms_arg_assign_it = ms_arg_assign_map.find(key);
-        }
-        auto ms_arg_assign_ptr = reinterpret_cast<ArgAssignShader*>(&(*ms_arg_assign_it->second));
-        cmdlist << (*ms_arg_assign_ptr)(d_kv_in, d_value_out, d_index_out).dispatch(d_index_out.size());
+            auto desc = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
+            auto compile = [device = m_device]() mutable
+            { return ArgReduce().compile_arg_assign_shader(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
     }
 
-    template <NumericTOrKeyValuePairT Type, typename ReduceOp>
-    void reduce_array_recursive(luisa::compute::CommandList& cmdlist,
-                                BufferView<Type>             temp_storage,
-                                BufferView<Type>             arr_in,
-                                BufferView<Type>             arr_out,
-                                int                          num_elements,
-                                int                          offset,
-                                int                          level,
-                                ReduceOp                     reduce_op,
-                                Type                         init) noexcept
+    template <ReduceAccumulatorT Type, IteratorOrBufferT In, typename ReduceOp, typename TransformOp>
+    void reduce_array(luisa::compute::CommandList& cmdlist,
+                      BufferView<Type>             temp_storage,
+                      In                           arr_in,
+                      BufferView<Type>             arr_out,
+                      size_t                       num_elements,
+                      ReduceOp                     reduce_op,
+                      TransformOp                  transform_op,
+                      Type                         init) noexcept
     {
-        int num_tiles = imax(1, (int)ceil((float)num_elements / (ITEMS_PER_THREAD * m_block_size)));
-        int num_threads;
-
-        if(num_tiles > 1)
-        {
-            num_threads = m_block_size;
-        }
-        else if(is_power_of_two(num_elements))
+        auto in_it = as_iterator(arr_in);
+        if(m_determinism == ReduceDeterminism::GPU_TO_GPU)
         {
-            num_threads = num_elements / ITEMS_PER_THREAD;
-        }
-        else
-        {
-            num_threads = floor_pow_2(num_elements);
+            deterministic_reduce_array<Type>(cmdlist, temp_storage, in_it, arr_out, num_elements, reduce_op, transform_op, init);
+            return;
         }
 
-        int num_elements_per_block  = num_threads * ITEMS_PER_THREAD;
-        int num_elements_last_block = num_elements - (num_tiles - 1) * num_elements_per_block;
-        int num_threads_last_block  = imax(1, num_elements_last_block);
-        int np2_last_block          = 0;
-        int shared_mem_last_block   = 0;
+        auto ms_reduce_ptr             = reduce_shader<Type>(reduce_op, transform_op, in_it);
+        auto ms_reduce_single_tile_ptr = reduce_single_tile_shader<Type>(reduce_op);
 
-        if(num_elements_last_block != num_elements_per_block)
+        // grid pass: a fixed number of blocks stride over the input, one partial per block
+        auto even_share = reduce_even_share(num_elements);
+        if(even_share.grid_size > 0)
         {
-            // NOT POWER OF 2
-            np2_last_block = 1;
-            if(!is_power_of_two(num_elements_last_block))
-            {
-                num_threads_last_block = floor_pow_2(num_elements_last_block);
-            }
+            std::apply(
+                [&](auto&&... in_args)
+                {
+                    cmdlist << (*ms_reduce_ptr)(in_args..., temp_storage, even_share, op_params(reduce_op), op_params(transform_op))
+                                   .dispatch(even_share.grid_size * m_block_size);
+                },
+                in_it.args());
         }
-        using ReduceShader = details::ReduceModule<Type, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ReduceKernel = ReduceShader::ReduceShaderKernel;
-
-        size_t           size_elements     = temp_storage.size() - offset;
-        BufferView<Type> temp_buffer_level = temp_storage.subview(offset, size_elements);
+        // final pass: fold the partials (at most one tile) and the initial value
+        cmdlist << (*ms_reduce_single_tile_ptr)(temp_storage, arr_out, even_share.grid_size, init, op_params(reduce_op))
+                       .dispatch(m_block_size);
+    };
 
-        auto key          = get_type_and_op_desc<Type>(reduce_op);
-        auto ms_reduce_it = ms_reduce_map.find(key);
-        if(ms_reduce_it == ms_reduce_map.end())
-        {
-            LUISA_INFO("Compiling Reduce shader for key: {}", key);
-            auto shader = ReduceShader().compile(m_device, m_shared_mem_size, reduce_op, IdentityOp());
-            ms_reduce_map.try_emplace(key, std::move(shader));
-            ms_reduce_it = ms_reduce_map.find(key);
-        }
-        auto ms_reduce_ptr = reinterpret_cast<ReduceKernel*>(&(*ms_reduce_it->second));
+    template <ReduceAccumulatorT Type, IteratorT InputIt, typename ReduceOp, typename TransformOp>
+    void deterministic_reduce_array(luisa::compute::CommandList& cmdlist,
+                                    BufferView<Type>             temp_storage,
+                                    InputIt                      in_it,
+                                    BufferView<Type>             arr_out,
+                                    size_t                       num_elements,
+                                    ReduceOp                     reduce_op,
+                                    TransformOp                  transform_op,
+                                    Type                         init) noexcept
+    {
+        auto ms_input_pass_ptr   = deterministic_reduce_shader<Type>(reduce_op, transform_op, in_it);
+        auto ms_partial_pass_ptr = deterministic_reduce_shader<Type>(reduce_op, IdentityOp());
 
-        if(num_tiles > 1)
-        {
-            cmdlist << (*ms_reduce_ptr)(arr_in, temp_buffer_level, num_elements, 0, 0, init)
-                           .dispatch(m_block_size * (num_tiles - np2_last_block));
-            if(np2_last_block)
+        // first pass over the input, the tile count only follows the input size
+        uint num_items       = static_cast<uint>(num_elements);
+        uint num_tiles       = deterministic_num_tiles<Type>(num_items);
+        uint first_num_tiles = num_tiles;
+        auto d_partials      = num_tiles == 1 ? arr_out : temp_storage.subview(0, num_tiles);
+        std::apply(
+            [&](auto&&... in_args)
             {
-                // Last Block
-                cmdlist << (*ms_reduce_ptr)(arr_in,
-                                            temp_buffer_level,
-                                            num_elements_last_block,
-                                            num_tiles - 1,
-                                            num_elements - num_elements_last_block,
-                                            init)
-                               .dispatch(m_block_size);
-            }
-            // recursive
-            reduce_array_recursive<Type>(
-                cmdlist, temp_buffer_level, temp_buffer_level, arr_out, num_tiles, num_tiles, level + 1, reduce_op, init);
-        }
-        else
-        {
-            // non-recursive
-            cmdlist << (*ms_reduce_ptr)(arr_in, temp_buffer_level, num_elements, 0, 0, init).dispatch(m_block_size);
-            cmdlist << arr_out.copy_from(temp_buffer_level);
-        }
-    };
+                cmdlist << (*ms_input_pass_ptr)(in_args...,
+                                                d_partials,
+                                                num_items,
+                                                init,
+                                                uint(num_tiles == 1),
+                                                op_params(reduce_op),
+                                                op_params(transform_op))
+                               .dispatch(num_tiles * m_block_size);
+            },
+            in_it.args());
 
-
-    template <NumericTOrKeyValuePairT Type, typename ReduceOp, typename TransformOp>
-    void reduce_transform_array_recursive(luisa::compute::CommandList& cmdlist,
-                                          BufferView<Type>             temp_storage,
-                                          BufferView<Type>             arr_in,
-                                          BufferView<Type>             arr_out,
-                                          int                          num_elements,
-                                          int                          offset,
-                                          int                          level,
-                                          ReduceOp                     reduce_op,
-                                          TransformOp                  transform_op,
-                                          Type                         init) noexcept
-    {
-        int num_tiles = imax(1, (int)ceil((float)num_elements / (ITEMS_PER_THREAD * m_block_size)));
-        int num_threads;
-        if(num_tiles > 1)
-        {
-            num_threads = m_block_size;
-        }
-        else if(is_power_of_two(num_elements))
+        // the partials ping-pong between the two halves of the temp storage until one tile is left
+        size_t partial_offset = 0;
+        while(num_tiles > 1)
         {
-            num_threads = num_elements / ITEMS_PER_THREAD;
-        }
-        else
-        {
-            num_threads = floor_pow_2(num_elements);
+            auto d_pass_in = temp_storage.subview(partial_offset, num_tiles);
+            num_items      = num_tiles;
+            num_tiles      = deterministic_num_tiles<Type>(num_items);
+            partial_offset = partial_offset == 0 ? first_num_tiles : 0;
+            d_partials     = num_tiles == 1 ? arr_out : temp_storage.subview(partial_offset, num_tiles);
+            cmdlist << (*ms_partial_pass_ptr)(d_pass_in,
+                                              d_partials,
+                                              num_items,
+                                              init,
+                                              uint(num_tiles == 1),
+                                              op_params(reduce_op),
+                                              op_params(IdentityOp()))
+                           .dispatch(num_tiles * m_block_size);
         }
+    }
 
-        int num_elements_per_block  = num_threads * ITEMS_PER_THREAD;
-        int num_elements_last_block = num_elements - (num_tiles - 1) * num_elements_per_block;
-        int num_threads_last_block  = imax(1, num_elements_last_block);
-        int np2_last_block          = 0;
-        int shared_mem_last_block   = 0;
+    template <ReduceAccumulatorT Type, typename ReduceOp, typename TransformOp, IteratorT InputIt = BufferIterator<Type>>
+    auto deterministic_reduce_shader(ReduceOp reduce_op, TransformOp transform_op, InputIt input = {})
+    {
+        using ModuleInputT              = iterator_source_t<InputIt>;
+        using ReduceShader              = details::ReduceModule<Type, BLOCK_SIZE, ITEMS_PER_THREAD, WARP_NUMS, ModuleInputT>;
+        using DeterministicReduceKernel = ReduceShader::DeterministicReduceKernel;
 
-        if(num_elements_last_block != num_elements_per_block)
+        constexpr auto key = shader_key<"deterministic_reduce", DeviceReduce, ReduceShader, ReduceOp, TransformOp>();
+        return m_shaders->get_or_compile<DeterministicReduceKernel>(key, [&]
         {
-            // NOT POWER OF 2
-            np2_last_block = 1;
-            if(!is_power_of_two(num_elements_last_block))
+            auto desc = get_type_and_op_desc<Type>(reduce_op, transform_op) + iterator_desc(input);
+            LUISA_INFO("Compiling DeterministicReduce shader for key: {}", desc);
+            auto compile = [device = m_device, reduce_op, transform_op, input]() mutable
             {
-                num_threads_last_block = floor_pow_2(num_elements_last_block);
-            }
-        }
-        using ReduceShader = details::ReduceModule<Type, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ReduceKernel = ReduceShader::ReduceShaderKernel;
+                if constexpr(IteratorT<ModuleInputT>)
+                {
+                    return ReduceShader(input).compile_deterministic(device, reduce_op, transform_op);
+                }
+                else
+                {
+                    return ReduceShader().compile_deterministic(device, reduce_op, transform_op);
+                }
+            };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
 
-        size_t           size_elements     = temp_storage.size() - offset;
-        BufferView<Type> temp_buffer_level = temp_storage.subview(offset, size_elements);
+    template <ReduceAccumulatorT Type, typename ReduceOp, typename TransformOp, IteratorT InputIt = BufferIterator<Type>>
+    auto reduce_shader(ReduceOp reduce_op, TransformOp transform_op, InputIt input = {})
+    {
+        // plain buffers are read as elements (lifted into Type on load when it differs) and keep their cached shaders
+        using ModuleInputT = iterator_source_t<InputIt>;
+        using ReduceShader = details::ReduceModule<Type, BLOCK_SIZE, ITEMS_PER_THREAD, WARP_NUMS, ModuleInputT>;
+        using ReduceKernel = ReduceShader::ReduceShaderKernel;
 
-        if(num_tiles > 1)
+        constexpr auto key = shader_key<"reduce", DeviceReduce, ReduceShader, ReduceOp, TransformOp>();
+        return m_shaders->get_or_compile<ReduceKernel>(key, [&]
         {
-            auto key          = get_type_and_op_desc<Type>(reduce_op, transform_op);
-            auto ms_transform = ms_transform_reduce_map.find(key);
-            if(ms_transform == ms_transform_reduce_map.end())
+            auto desc = get_type_and_op_desc<Type>(reduce_op, transform_op) + iterator_desc(input);
+            LUISA_INFO("Compiling Reduce shader for key: {}", desc);
+            auto compile = [device          = m_device,
+                            shared_mem_size = m_shared_mem_size,
+                            reduce_op,
+                            transform_op,
+                            input]() mutable
             {
-                auto shader = ReduceShader().compile(m_device, m_shared_mem_size, reduce_op, transform_op);
-                ms_transform_reduce_map.try_emplace(key, std::move(shader));
-                ms_transform = ms_transform_reduce_map.find(key);
-            }
-            auto ms_reduce_ptr = reinterpret_cast<ReduceKernel*>(&(*ms_transform->second));
+                if constexpr(IteratorT<ModuleInputT>)
+                {
+                    return ReduceShader(input).compile(device, shared_mem_size, reduce_op, transform_op);
+                }
+                else
+                {
+                    return ReduceShader().compile(device, shared_mem_size, reduce_op, transform_op);
+                }
+            };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
 
-            cmdlist << (*ms_reduce_ptr)(arr_in, temp_buffer_level, num_elements, 0, 0, init)
-                           .dispatch(m_block_size * (num_tiles - np2_last_block));
-            if(np2_last_block)
-            {
-                // Last Block
-                cmdlist << (*ms_reduce_ptr)(arr_in,
-                                            temp_buffer_level,
-                                            num_elements_last_block,
-                                            num_tiles - 1,
-                                            num_elements - num_elements_last_block,
-                                            init)
-                               .dispatch(m_block_size);
-            }
+    template <ReduceAccumulatorT Type, typename ReduceOp>
+    auto reduce_single_tile_shader(ReduceOp reduce_op)
+    {
+        using ReduceShader           = details::ReduceModule<Type, BLOCK_SIZE, ITEMS_PER_THREAD, WARP_NUMS>;
+        using ReduceSingleTileKernel = ReduceShader::ReduceSingleTileKernel;
 
-            // recursive
-            reduce_transform_array_recursive<Type>(
-                cmdlist, temp_buffer_level, temp_buffer_level, arr_out, num_tiles, num_tiles, level + 1, reduce_op, transform_op, init);
-        }
-        else if(level == 0)
+        constexpr auto key = shader_key<"reduce_single_tile", DeviceReduce, ReduceShader, ReduceOp>();
+        return m_shaders->get_or_compile<ReduceSingleTileKernel>(key, [&]
         {
-            auto key          = get_type_and_op_desc<Type>(reduce_op, transform_op);
-            auto ms_transform = ms_transform_reduce_map.find(key);
-            if(ms_transform == ms_transform_reduce_map.end())
-            {
-                auto shader = ReduceShader().compile(m_device, m_shared_mem_size, reduce_op, transform_op);
-                ms_transform_reduce_map.try_emplace(key, std::move(shader));
-                ms_transform = ms_transform_reduce_map.find(key);
-            }
-            auto ms_reduce_ptr = reinterpret_cast<ReduceKernel*>(&(*ms_transform->second));
-            // non-recursive
-            cmdlist << (*ms_reduce_ptr)(arr_in, temp_buffer_level, num_elements, 0, 0, init).dispatch(m_block_size);
-            cmdlist << arr_out.copy_from(temp_buffer_level);
-        }
-        else
-        {
-            auto key          = get_type_and_op_desc<Type>(reduce_op);
-            auto ms_reduce_it = ms_reduce_map.find(key);
-            if(ms_reduce_it == ms_reduce_map.end())
-            {
-                auto shader = ReduceShader().compile(m_device, m_shared_mem_size, reduce_op, IdentityOp());
-                ms_reduce_map.try_emplace(key, std::move(shader));
-                ms_reduce_it = ms_reduce_map.find(key);
-            }
-            auto ms_reduce_ptr = reinterpret_cast<ReduceKernel*>(&(*ms_reduce_it->second));
-            // non-recursive
-            cmdlist << (*ms_reduce_ptr)(arr_in, temp_buffer_level, num_elements, 0, 0, init).dispatch(m_block_size);
-            cmdlist << arr_out.copy_from(temp_buffer_level);
-        }
-    };
+            auto desc = get_type_and_op_desc<Type>(reduce_op);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, reduce_op]() mutable
+            { return ReduceShader().compile_single_tile(device, shared_mem_size, reduce_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
 
-    template <NumericT KeyType, NumericT ValueType, typename ScanTileState, typename ReduceOp>
+    template <NumericT KeyType, NumericT ValueType, typename ReduceOp>
     void reduce_by_key_array(luisa::compute::CommandList& cmdlist,
-                             BufferView<ScanTileState>    tile_states,
+                             ByteBufferView               tile_state_bytes,
                              BufferView<KeyType>          keys_in,
                              BufferView<ValueType>        values_in,
                              BufferView<KeyType>          unique_out,
@@ -524,48 +1350,106 @@ class DeviceReduce : public LuisaModule
             }
         }
 
-        using ReduceByKey = details::ReduceByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ReduceByKeyTileState           = ReduceByKey::ScanTileState;
+        visit_tile_state_layout(
+            m_packed_tile_state,
+            [&]<bool PACKED>(std::bool_constant<PACKED>)
+            {
+                using TileState = details::ReduceByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>::ScanTileState;
+                auto tile_states = details::reinterpret_view<TileState>(tile_state_bytes);
+                // init
+                auto ms_scan_tile_state_init_ptr = reduce_by_key_tile_state_init_shader<PACKED, KeyType, ValueType>();
+                auto ms_reduce_by_key_ptr        = reduce_by_key_shader<PACKED, KeyType, ValueType>(reduce_op);
+                cmdlist << (*ms_scan_tile_state_init_ptr)(tile_states, num_tiles).dispatch(num_tiles * m_block_size);
+                // reduce by key
+                cmdlist << (*ms_reduce_by_key_ptr)(tile_states, keys_in, values_in, unique_out, aggregated_out, num_runs_out, num_elements)
+                               .dispatch(m_block_size * num_tiles);
+            });
+    };
+
+    template <bool PACKED, NumericT KeyType, NumericT ValueType>
+    auto reduce_by_key_tile_state_init_shader()
+    {
+        using ReduceByKey = details::ReduceByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
         using ReduceByKeyTileStateInitKernel = ReduceByKey::ScanTileStateInitKernel;
-        using ReduceByKeyKernel              = ReduceByKey::ReduceByKeyKernel;
 
-        // init
-        auto init_key                   = get_type_and_op_desc<KeyType, ValueType>();
-        auto ms_scan_tile_state_init_it = ms_scan_tile_state_init_map.find(init_key);
-        if(ms_scan_tile_state_init_it == ms_scan_tile_state_init_map.end())
+        constexpr auto key = shader_key<"reduce_by_key_tile_state_init", DeviceReduce, ReduceByKey>();
+        return m_shaders->get_or_compile<ReduceByKeyTileStateInitKernel>(key, [&]
         {
-            auto shader = ReduceByKey().compile_scan_tile_state_init(m_device);
-            ms_scan_tile_state_init_map.try_emplace(init_key, std::move(shader));
-            ms_scan_tile_state_init_it = ms_scan_tile_state_init_map.find(init_key);
-        }
-        auto ms_scan_tile_state_init_ptr =
-            reinterpret_cast<ReduceByKeyTileStateInitKernel*>(&(*ms_scan_tile_state_init_it->second));
-        cmdlist << (*ms_scan_tile_state_init_ptr)(tile_states, num_tiles).dispatch(num_tiles * m_block_size);
-        // reduce by key
+            auto desc = get_type_and_op_desc<KeyType, ValueType>() + tile_state_layout_desc(PACKED);
+            auto compile = [device = m_device]() mutable
+            { return ReduceByKey().compile_scan_tile_state_init(device); };
+            auto module = shader_cache_module("reduce_by_key_tile_state_init");
+            return compile_async(module, desc, std::move(compile));
+        });
+    }
 
-        auto key                 = get_type_and_op_desc<KeyType, ValueType>(reduce_op);
-        auto ms_reduce_by_key_it = ms_reduce_by_key_map.find(key);
-        if(ms_reduce_by_key_it == ms_reduce_by_key_map.end())
+    template <bool PACKED, NumericT KeyType, NumericT ValueType, typename ReduceOp>
+    auto reduce_by_key_shader(ReduceOp reduce_op)
+    {
+        using ReduceByKey = details::ReduceByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using ReduceByKeyKernel = ReduceByKey::ReduceByKeyKernel;
+
+        const auto key = shader_key<"reduce_by_key", DeviceReduce, ReduceByKey, ReduceOp>(
+            static_cast<uint64_t>(m_look_back_delay));
+        return m_shaders->get_or_compile<ReduceByKeyKernel>(key, [&]
         {
-            LUISA_INFO("Compiling ReduceByKey shader for key: {}", key);
-            auto shader = ReduceByKey().compile(m_device, m_shared_mem_size, reduce_op);
-            ms_reduce_by_key_map.try_emplace(key, std::move(shader));
-            ms_reduce_by_key_it = ms_reduce_by_key_map.find(key);
-        }
-        auto ms_reduce_by_key_ptr = reinterpret_cast<ReduceByKeyKernel*>(&(*ms_reduce_by_key_it->second));
+            auto desc = get_type_and_op_desc<KeyType, ValueType>(reduce_op) + look_back_delay_desc(m_look_back_delay)
+                        + tile_state_layout_desc(PACKED);
+            LUISA_INFO("Compiling ReduceByKey shader for key: {}", desc);
+            auto compile = [device          = m_device,
+                            shared_mem_size = m_shared_mem_size,
+                            look_back_delay = m_look_back_delay,
+                            reduce_op]() mutable
+            {
+                return visit_delay_constructor<KeyValuePair<int, ValueType>>(
+                    look_back_delay,
+                    [&]<typename DelayConstructorT>(std::type_identity<DelayConstructorT>) {
+                        return ReduceByKey().template compile<DelayConstructorT>(device, shared_mem_size, reduce_op);
+                    });
+            };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
 
-        cmdlist << (*ms_reduce_by_key_ptr)(tile_states, keys_in, values_in, unique_out, aggregated_out, num_runs_out, num_elements)
-                       .dispatch(m_block_size * num_tiles);
-    };
+    // what an empty input reports: min and max at the opposite ends of the range, nothing summed or counted
+    template <NumericT Type4Byte>
+    static ReduceStats<Type4Byte> min_max_sum_identity() noexcept
+    {
+        return ReduceStats<Type4Byte>{std::numeric_limits<Type4Byte>::max(),
+                                      std::numeric_limits<Type4Byte>::lowest(),
+                                      Type4Byte(0),
+                                      0u};
+    }
 
+    template <NumericT Type4Byte, typename ReduceOp>
+    void warmup_reduce(ReduceOp reduce_op)
+    {
+        if constexpr(std::is_same_v<ReduceOp, ArgMinOp> || std::is_same_v<ReduceOp, ArgMaxOp>)
+        {
+            arg_reduce_shader<Type4Byte>(reduce_op);
+            reduce_single_tile_shader<IndexValuePairT<Type4Byte>>(reduce_op);
+            arg_assign_shader<Type4Byte>();
+        }
+        else if constexpr(std::is_same_v<ReduceOp, MinMaxSumOp>)
+        {
+            reduce_shader<ReduceStats<Type4Byte>>(reduce_op, IdentityOp(), BufferIterator<Type4Byte>{});
+            reduce_single_tile_shader<ReduceStats<Type4Byte>>(reduce_op);
+        }
+        else if constexpr(std::is_same_v<ReduceOp, WelfordOp>)
+        {
+            reduce_shader<WelfordStats<Type4Byte>>(reduce_op, IdentityOp(), BufferIterator<Type4Byte>{});
+            reduce_single_tile_shader<WelfordStats<Type4Byte>>(reduce_op);
+        }
+        else
+        {
+            reduce_shader<Type4Byte>(reduce_op, IdentityOp());
+            reduce_single_tile_shader<Type4Byte>(reduce_op);
+        }
+    }
 
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_reduce_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_transform_reduce_map;
-    // for arg reduce
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_arg_construct_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_arg_assign_map;
-    // for reduce by key
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_reduce_by_key_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_scan_tile_state_init_map;
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceReduce<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
 };
 }  // namespace luisa::parallel_primitive
\ No newline at end of file
@@ -0,0 +1,323 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 20:31:48
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 20:31:48
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <luisa/core/basic_traits.h>
+#include <luisa/ast/type.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/memory.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/var.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/device/details/run_length_encode.h>
+
+namespace luisa::parallel_primitive
+{
+
+using namespace luisa::compute;
+
+/**
+ * @brief Run-length encoding in one pass: head and tail flags of every run feed a segmented
+ * scan with decoupled look-back, run starts and run ends scatter directly, no value buffer is read.
+ */
+template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+class DeviceRunLengthEncode : public LuisaModule
+{
+  private:
+    uint m_block_size = BLOCK_SIZE;
+    uint m_warp_nums  = WARP_NUMS;
+
+    Device m_device;
+    bool   m_created = false;
+
+    LookBackDelayPolicy m_look_back_delay   = LookBackDelayPolicy::NO_DELAY;
+    bool                m_packed_tile_state = false;
+
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
+  public:
+    DeviceRunLengthEncode()  = default;
+    ~DeviceRunLengthEncode() = default;
+
+    void create(Device& device)
+    {
+        m_device            = device;
+        m_allocator         = CachingAllocator::shared(device);
+        m_shaders           = ShaderRegistry::shared(device);
+        m_packed_tile_state = packed_tile_state_supported(device);
+        m_created           = true;
+    }
+
+    // compiles ahead of time Encode and NonTrivialRuns of Type4Byte
+    template <NumericT Type4Byte>
+    void Warmup()
+    {
+        visit_tile_state_layout(m_packed_tile_state,
+                                [&]<bool PACKED>(std::bool_constant<PACKED>)
+                                {
+                                    run_length_tile_state_init_shader<PACKED>();
+                                    run_length_encode_shader<PACKED, details::RunLengthMode::ENCODE, Type4Byte>();
+                                    run_length_encode_shader<PACKED, details::RunLengthMode::NON_TRIVIAL_RUNS, Type4Byte>();
+                                });
+    }
+
+    // how tiles wait on their predecessors during look-back
+    void set_look_back_delay(LookBackDelayPolicy policy) noexcept { m_look_back_delay = policy; }
+
+    [[nodiscard]] LookBackDelayPolicy look_back_delay() const noexcept { return m_look_back_delay; }
+
+    /**
+     * @brief Writes the value of every run of equal consecutive items to d_unique_out and its
+     * length to d_counts_out, e.g. 1 1 2 3 3 3 gives 1 2 3, 2 1 3 and d_num_runs_out[0] = 3.
+     */
+    template <NumericT Type4Byte>
+    void Encode(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_unique_out,
+                BufferView<uint>      d_counts_out,
+                BufferView<uint>      d_num_runs_out,
+                size_t                num_items)
+    {
+        auto layout = run_length_temp_storage_layout(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        // the offsets argument is unused, d_counts_out binds it
+        run_length_encode_array<details::RunLengthMode::ENCODE, Type4Byte>(
+            cmdlist, layout.get_bytes(temp_storage, 0), d_in, d_unique_out, d_counts_out, d_counts_out, d_num_runs_out, num_items);
+    }
+
+    template <NumericT Type4Byte>
+    void Encode(CommandList&          cmdlist,
+                Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_unique_out,
+                BufferView<uint>      d_counts_out,
+                BufferView<uint>      d_num_runs_out,
+                size_t                num_items)
+    {
+        Encode(cmdlist, temp_storage, temp_storage_bytes, d_in, d_unique_out, d_counts_out, d_num_runs_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte>
+    void Encode(CommandList&          cmdlist,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_unique_out,
+                BufferView<uint>      d_counts_out,
+                BufferView<uint>      d_num_runs_out,
+                size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        Encode(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_unique_out, d_counts_out, d_num_runs_out, num_items);
+        Encode(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_unique_out,
+               d_counts_out,
+               d_num_runs_out,
+               num_items);
+    }
+
+    template <NumericT Type4Byte>
+    void Encode(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_unique_out,
+                BufferView<uint>      d_counts_out,
+                BufferView<uint>      d_num_runs_out,
+                size_t                num_items)
+    {
+        Encode(cmdlist, d_in, d_unique_out, d_counts_out, d_num_runs_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    /**
+     * @brief Writes the offset and the length of every run longer than one item,
+     * e.g. 1 1 2 3 3 3 gives offsets 0 3, lengths 2 3 and d_num_runs_out[0] = 2.
+     */
+    template <NumericT Type4Byte>
+    void NonTrivialRuns(CommandList&          cmdlist,
+                        ByteBufferView        temp_storage,
+                        size_t&               temp_storage_bytes,
+                        BufferView<Type4Byte> d_in,
+                        BufferView<uint>      d_offsets_out,
+                        BufferView<uint>      d_lengths_out,
+                        BufferView<uint>      d_num_runs_out,
+                        size_t                num_items)
+    {
+        auto layout = run_length_temp_storage_layout(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        // the unique values argument is unused and never written, d_in binds it
+        run_length_encode_array<details::RunLengthMode::NON_TRIVIAL_RUNS, Type4Byte>(
+            cmdlist, layout.get_bytes(temp_storage, 0), d_in, d_in, d_offsets_out, d_lengths_out, d_num_runs_out, num_items);
+    }
+
+    template <NumericT Type4Byte>
+    void NonTrivialRuns(CommandList&          cmdlist,
+                        Stream&               stream,
+                        ByteBufferView        temp_storage,
+                        size_t&               temp_storage_bytes,
+                        BufferView<Type4Byte> d_in,
+                        BufferView<uint>      d_offsets_out,
+                        BufferView<uint>      d_lengths_out,
+                        BufferView<uint>      d_num_runs_out,
+                        size_t                num_items)
+    {
+        NonTrivialRuns(cmdlist, temp_storage, temp_storage_bytes, d_in, d_offsets_out, d_lengths_out, d_num_runs_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte>
+    void NonTrivialRuns(CommandList&          cmdlist,
+                        BufferView<Type4Byte> d_in,
+                        BufferView<uint>      d_offsets_out,
+                        BufferView<uint>      d_lengths_out,
+                        BufferView<uint>      d_num_runs_out,
+                        size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        NonTrivialRuns(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_offsets_out, d_lengths_out, d_num_runs_out, num_items);
+        NonTrivialRuns(cmdlist,
+                       m_allocator->allocate(cmdlist, temp_storage_bytes),
+                       temp_storage_bytes,
+                       d_in,
+                       d_offsets_out,
+                       d_lengths_out,
+                       d_num_runs_out,
+                       num_items);
+    }
+
+    template <NumericT Type4Byte>
+    void NonTrivialRuns(CommandList&          cmdlist,
+                        Stream&               stream,
+                        BufferView<Type4Byte> d_in,
+                        BufferView<uint>      d_offsets_out,
+                        BufferView<uint>      d_lengths_out,
+                        BufferView<uint>      d_num_runs_out,
+                        size_t                num_items)
+    {
+        NonTrivialRuns(cmdlist, d_in, d_offsets_out, d_lengths_out, d_num_runs_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+  private:
+    uint run_length_num_tiles(size_t num_items) const noexcept
+    {
+        return std::max(1u, ceil_div(static_cast<uint>(num_items), static_cast<uint>(ITEMS_PER_THREAD * BLOCK_SIZE)));
+    }
+
+    TempStorageLayout<1> run_length_temp_storage_layout(size_t num_items) const noexcept
+    {
+        // tile states behind the warp of out-of-bounds padding read by the first tiles' look-back
+        size_t tile_state_size = scan_tile_state_size<details::RunLengthEncodeModule<uint>::RunCountT>(m_packed_tile_state);
+        return TempStorageLayout<1>{{(details::WARP_SIZE + run_length_num_tiles(num_items)) * tile_state_size}};
+    }
+
+    template <details::RunLengthMode MODE, NumericT Type4Byte>
+    void run_length_encode_array(CommandList&          cmdlist,
+                                 ByteBufferView        tile_state_bytes,
+                                 BufferView<Type4Byte> d_in,
+                                 BufferView<Type4Byte> d_unique_out,
+                                 BufferView<uint>      d_offsets_out,
+                                 BufferView<uint>      d_lengths_out,
+                                 BufferView<uint>      d_num_runs_out,
+                                 size_t                num_items)
+    {
+        // an empty input still runs one tile, it writes zero to d_num_runs_out
+        uint num_tiles = run_length_num_tiles(num_items);
+        visit_tile_state_layout(
+            m_packed_tile_state,
+            [&]<bool PACKED>(std::bool_constant<PACKED>)
+            {
+                using TileState = details::RunLengthEncodeModule<uint, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>::ScanTileState;
+                auto tile_states                       = details::reinterpret_view<TileState>(tile_state_bytes);
+                auto ms_run_length_tile_state_init_ptr = run_length_tile_state_init_shader<PACKED>();
+                auto ms_run_length_encode_ptr          = run_length_encode_shader<PACKED, MODE, Type4Byte>();
+
+                cmdlist << (*ms_run_length_tile_state_init_ptr)(tile_states, static_cast<int>(num_tiles)).dispatch(num_tiles * m_block_size);
+                cmdlist << (*ms_run_length_encode_ptr)(
+                               tile_states, d_in, d_unique_out, d_offsets_out, d_lengths_out, d_num_runs_out, static_cast<uint>(num_items))
+                               .dispatch(num_tiles * m_block_size);
+            });
+    }
+
+    template <bool PACKED>
+    auto run_length_tile_state_init_shader()
+    {
+        using RunLengthShader              = details::RunLengthEncodeModule<uint, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using RunLengthTileStateInitKernel = RunLengthShader::ScanTileStateInitKernel;
+
+        constexpr auto key = shader_key<"run_length_tile_state_init", DeviceRunLengthEncode, RunLengthShader>();
+        return m_shaders->get_or_compile<RunLengthTileStateInitKernel>(key, [&]
+        {
+            auto compile = [device = m_device]() mutable { return RunLengthShader().compile_scan_tile_state_init(device); };
+            return compile_async(shader_cache_module(key.name), luisa::string{"uint2"} + tile_state_layout_desc(PACKED), std::move(compile));
+        });
+    }
+
+    template <bool PACKED, details::RunLengthMode MODE, NumericT Type4Byte>
+    auto run_length_encode_shader()
+    {
+        using RunLengthShader       = details::RunLengthEncodeModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using RunLengthEncodeKernel = RunLengthShader::RunLengthEncodeKernel;
+        using RunCountT             = RunLengthShader::RunCountT;
+
+        const auto key =
+            shader_key<"run_length_encode", DeviceRunLengthEncode, RunLengthShader, std::integral_constant<details::RunLengthMode, MODE>>(
+                static_cast<uint64_t>(m_look_back_delay));
+        return m_shaders->get_or_compile<RunLengthEncodeKernel>(key, [&]
+        {
+            auto desc = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()}
+                        + (MODE == details::RunLengthMode::ENCODE ? "_encode" : "_non_trivial_runs")
+                        + look_back_delay_desc(m_look_back_delay) + tile_state_layout_desc(PACKED);
+            LUISA_INFO("Compiling RunLengthEncode shader for key: {}", desc);
+            auto compile = [device = m_device, look_back_delay = m_look_back_delay]() mutable
+            {
+                return visit_delay_constructor<RunCountT>(
+                    look_back_delay,
+                    [&]<typename DelayConstructorT>(std::type_identity<DelayConstructorT>) {
+                        return RunLengthShader().template compile<MODE, DelayConstructorT>(device);
+                    });
+            };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceRunLengthEncode<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
+};
+}  // namespace luisa::parallel_primitive
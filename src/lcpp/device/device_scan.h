@@ -8,6 +8,7 @@
 
 #pragma once
 #include <cstddef>
+#include <tuple>
 #include <luisa/runtime/stream.h>
 #include <luisa/dsl/struct.h>
 #include <luisa/core/logging.h>
@@ -17,9 +18,11 @@
 #include <luisa/dsl/sugar.h>
 #include <luisa/dsl/var.h>
 #include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
 #include <lcpp/common/type_trait.h>
 #include <lcpp/common/util_type.h>
 #include <lcpp/common/utils.h>
+#include <lcpp/common/iterator.h>
 #include <lcpp/block/block_reduce.h>
 #include <lcpp/warp/warp_reduce.h>
 #include <lcpp/device/details/scan.h>
@@ -30,6 +33,18 @@ namespace luisa::parallel_primitive
 {
 
 using namespace luisa::compute;
+
+enum class DeviceScanAlgorithm
+{
+    // decoupled look-back on GPU backends, reduce-then-scan where blocks may not run concurrently
+    AUTO,
+    // single pass, tiles spin on their predecessors' published state
+    DECOUPLED_LOOK_BACK,
+    // three passes (tile reduce, spine scan, downsweep), no inter-block waiting; tiles combine in a fixed
+    // order, so float scans are run-to-run reproducible (look-back folds whatever its predecessors published)
+    REDUCE_THEN_SCAN
+};
+
 template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
 class DeviceScan : public LuisaModule
 {
@@ -41,89 +56,592 @@ class DeviceScan : public LuisaModule
     Device m_device;
     bool   m_created = false;
 
+    DeviceScanAlgorithm m_algorithm         = DeviceScanAlgorithm::DECOUPLED_LOOK_BACK;
+    LookBackDelayPolicy m_look_back_delay   = LookBackDelayPolicy::NO_DELAY;
+    bool                m_packed_tile_state = false;
+
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
   public:
     DeviceScan()  = default;
     ~DeviceScan() = default;
 
-    void create(Device& device)
+    void create(Device& device, DeviceScanAlgorithm algorithm = DeviceScanAlgorithm::AUTO)
     {
         m_device                   = device;
         int num_elements_per_block = m_block_size * ITEMS_PER_THREAD;
         int extra_space            = num_elements_per_block / m_warp_nums;
         m_shared_mem_size          = (num_elements_per_block + extra_space);
+        m_allocator                = CachingAllocator::shared(device);
+        m_shaders                  = ShaderRegistry::shared(device);
+        m_algorithm                = resolve_algorithm(device, algorithm);
+        m_packed_tile_state        = packed_tile_state_supported(device);
         m_created                  = true;
     }
 
+    [[nodiscard]] DeviceScanAlgorithm algorithm() const noexcept { return m_algorithm; }
 
-    template <NumericT Type4Byte, typename ScanOp>
+    /**
+     * @brief Compiles ahead of time the exclusive and inclusive scan shaders of the selected
+     * algorithm for these operators, e.g. Warmup<uint>(SumOp{}). With the persistent shader cache
+     * enabled (shader_cache_config()) the binaries are written to disk and reloaded by later processes.
+     */
+    template <NumericT Type4Byte, typename... ScanOps>
+    void Warmup(ScanOps... scan_ops)
+    {
+        (warmup_scan<Type4Byte>(scan_ops), ...);
+    }
+
+    template <NumericT KeyType, NumericT ValueType, typename... ScanOps>
+    void WarmupByKey(ScanOps... scan_ops)
+    {
+        (warmup_scan_by_key<KeyType, ValueType>(scan_ops), ...);
+    }
+
+    // how look-back tiles wait on their predecessors, only used by DECOUPLED_LOOK_BACK
+    void set_look_back_delay(LookBackDelayPolicy policy) noexcept { m_look_back_delay = policy; }
+
+    [[nodiscard]] LookBackDelayPolicy look_back_delay() const noexcept { return m_look_back_delay; }
+
+
+    /**
+     * @brief Type4Byte is the accumulator of BlockScan, the tile state and d_out. A narrower InputT
+     * (ushort/uchar counts, half values) is converted as the tiles load, e.g. ExclusiveSum of a
+     * BufferView<ushort> into a BufferView<uint>, with no widened copy of the input.
+     */
+    template <NumericT Type4Byte, typename ScanOp, typename InputT = Type4Byte>
+    void ExclusiveScan(CommandList&          cmdlist,
+                       ByteBufferView        temp_storage,
+                       size_t&               temp_storage_bytes,
+                       BufferView<InputT>    d_in,
+                       BufferView<Type4Byte> d_out,
+                       size_t                num_items,
+                       ScanOp                scan_op,
+                       Type4Byte             initial_value)
+    {
+        auto layout = scan_temp_storage_layout<Type4Byte>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        scan_array<Type4Byte>(cmdlist,
+                              layout.get_bytes(temp_storage, 0),
+                              layout.get<Type4Byte>(temp_storage, 1),
+                              make_cast_input_iterator<Type4Byte>(d_in),
+                              d_out,
+                              num_items,
+                              scan_op,
+                              initial_value,
+                              false);
+    }
+
+    template <NumericT Type4Byte, typename ScanOp, typename InputT = Type4Byte>
+    void ExclusiveScan(CommandList&          cmdlist,
+                       BufferView<InputT>    d_in,
+                       BufferView<Type4Byte> d_out,
+                       size_t                num_items,
+                       ScanOp                scan_op,
+                       Type4Byte             initial_value)
+    {
+        size_t temp_storage_bytes = 0;
+        ExclusiveScan(cmdlist,
+                      temp_storage_query(),
+                      temp_storage_bytes,
+                      d_in,
+                      d_out,
+                      num_items,
+                      scan_op,
+                      initial_value);
+        ExclusiveScan(cmdlist,
+                      m_allocator->allocate(cmdlist, temp_storage_bytes),
+                      temp_storage_bytes,
+                      d_in,
+                      d_out,
+                      num_items,
+                      scan_op,
+                      initial_value);
+    }
+
+    template <NumericT Type4Byte, typename ScanOp, typename InputT = Type4Byte>
     void ExclusiveScan(CommandList&          cmdlist,
                        Stream&               stream,
-                       BufferView<Type4Byte> d_in,
+                       ByteBufferView        temp_storage,
+                       size_t&               temp_storage_bytes,
+                       BufferView<InputT>    d_in,
                        BufferView<Type4Byte> d_out,
                        size_t                num_items,
                        ScanOp                scan_op,
                        Type4Byte             initial_value)
     {
-        int num_tiles = imax(1, (int)ceil((float)num_items / (ITEMS_PER_THREAD * m_block_size)));
-        // tilestate
-        using ScanShaderT    = details::ScanModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ScanTileStateT = ScanShaderT::TileState;
-        Buffer<ScanTileStateT> tile_states =
-            m_device.create_buffer<ScanTileStateT>(details::WARP_SIZE + num_tiles);
-        scan_array<Type4Byte>(cmdlist, tile_states.view(), d_in, d_out, num_items, scan_op, initial_value, false);
+        ExclusiveScan(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_items, scan_op, initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename ScanOp, typename InputT = Type4Byte>
+    void ExclusiveScan(CommandList&          cmdlist,
+                       Stream&               stream,
+                       BufferView<InputT>    d_in,
+                       BufferView<Type4Byte> d_out,
+                       size_t                num_items,
+                       ScanOp                scan_op,
+                       Type4Byte             initial_value)
+    {
+        ExclusiveScan(cmdlist, d_in, d_out, num_items, scan_op, initial_value);
         stream << cmdlist.commit() << synchronize();
-        tile_states.release();
     }
 
-    template <NumericT Type4Byte, typename ScanOp>
+    template <NumericT Type4Byte, typename ScanOp, typename InputT = Type4Byte>
+    void InclusiveScan(CommandList&          cmdlist,
+                       ByteBufferView        temp_storage,
+                       size_t&               temp_storage_bytes,
+                       BufferView<InputT>    d_in,
+                       BufferView<Type4Byte> d_out,
+                       size_t                num_items,
+                       ScanOp                scan_op,
+                       Type4Byte             initial_value)
+    {
+        auto layout = scan_temp_storage_layout<Type4Byte>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        scan_array<Type4Byte>(cmdlist,
+                              layout.get_bytes(temp_storage, 0),
+                              layout.get<Type4Byte>(temp_storage, 1),
+                              make_cast_input_iterator<Type4Byte>(d_in),
+                              d_out,
+                              num_items,
+                              scan_op,
+                              initial_value,
+                              true);
+    }
+
+    template <NumericT Type4Byte, typename ScanOp, typename InputT = Type4Byte>
+    void InclusiveScan(CommandList&          cmdlist,
+                       BufferView<InputT>    d_in,
+                       BufferView<Type4Byte> d_out,
+                       size_t                num_items,
+                       ScanOp                scan_op,
+                       Type4Byte             initial_value)
+    {
+        size_t temp_storage_bytes = 0;
+        InclusiveScan(cmdlist,
+                      temp_storage_query(),
+                      temp_storage_bytes,
+                      d_in,
+                      d_out,
+                      num_items,
+                      scan_op,
+                      initial_value);
+        InclusiveScan(cmdlist,
+                      m_allocator->allocate(cmdlist, temp_storage_bytes),
+                      temp_storage_bytes,
+                      d_in,
+                      d_out,
+                      num_items,
+                      scan_op,
+                      initial_value);
+    }
+
+    template <NumericT Type4Byte, typename ScanOp, typename InputT = Type4Byte>
     void InclusiveScan(CommandList&          cmdlist,
                        Stream&               stream,
-                       BufferView<Type4Byte> d_in,
+                       ByteBufferView        temp_storage,
+                       size_t&               temp_storage_bytes,
+                       BufferView<InputT>    d_in,
                        BufferView<Type4Byte> d_out,
                        size_t                num_items,
                        ScanOp                scan_op,
                        Type4Byte             initial_value)
     {
-        int num_tiles = imax(1, (int)ceil((float)num_items / (ITEMS_PER_THREAD * m_block_size)));
-        // tilestate
-        using ScanShaderT    = details::ScanModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ScanTileStateT = ScanShaderT::TileState;
-        Buffer<ScanTileStateT> tile_states =
-            m_device.create_buffer<ScanTileStateT>(details::WARP_SIZE + num_tiles);
-        scan_array<Type4Byte>(cmdlist, tile_states.view(), d_in, d_out, num_items, scan_op, initial_value, true);
+        InclusiveScan(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_items, scan_op, initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename ScanOp, typename InputT = Type4Byte>
+    void InclusiveScan(CommandList&          cmdlist,
+                       Stream&               stream,
+                       BufferView<InputT>    d_in,
+                       BufferView<Type4Byte> d_out,
+                       size_t                num_items,
+                       ScanOp                scan_op,
+                       Type4Byte             initial_value)
+    {
+        InclusiveScan(cmdlist, d_in, d_out, num_items, scan_op, initial_value);
         stream << cmdlist.commit() << synchronize();
-        tile_states.release();
     }
 
-    template <NumericT Type4Byte>
-    void ExclusiveSum(CommandList& cmdlist, Stream& stream, BufferView<Type4Byte> d_in, BufferView<Type4Byte> d_out, size_t num_items)
+    /**
+     * @brief ExclusiveScan reading through an input iterator and/or writing through an output iterator,
+     * e.g. the running count of a predicate with make_transform_input_iterator<uint>(d_in, op) as one
+     * dispatch with no temporary. The scan type is the input iterator's value_type.
+     */
+    template <IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+        requires(IteratorT<In> || IteratorT<Out>)
+    void ExclusiveScan(CommandList&                           cmdlist,
+                       ByteBufferView                         temp_storage,
+                       size_t&                                temp_storage_bytes,
+                       In                                     d_in,
+                       Out                                    d_out,
+                       size_t                                 num_items,
+                       ScanOp                                 scan_op,
+                       typename as_iterator_t<In>::value_type initial_value)
+    {
+        using Type4Byte      = typename as_iterator_t<In>::value_type;
+        auto layout = scan_temp_storage_layout<Type4Byte>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        scan_array<Type4Byte>(cmdlist,
+                              layout.get_bytes(temp_storage, 0),
+                              layout.get<Type4Byte>(temp_storage, 1),
+                              d_in,
+                              d_out,
+                              num_items,
+                              scan_op,
+                              initial_value,
+                              false);
+    }
+
+    template <IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+        requires(IteratorT<In> || IteratorT<Out>)
+    void ExclusiveScan(CommandList&                           cmdlist,
+                       In                                     d_in,
+                       Out                                    d_out,
+                       size_t                                 num_items,
+                       ScanOp                                 scan_op,
+                       typename as_iterator_t<In>::value_type initial_value)
+    {
+        size_t temp_storage_bytes = 0;
+        ExclusiveScan(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_items, scan_op, initial_value);
+        ExclusiveScan(cmdlist,
+                      m_allocator->allocate(cmdlist, temp_storage_bytes),
+                      temp_storage_bytes,
+                      d_in,
+                      d_out,
+                      num_items,
+                      scan_op,
+                      initial_value);
+    }
+
+    template <IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+        requires(IteratorT<In> || IteratorT<Out>)
+    void ExclusiveScan(CommandList&                           cmdlist,
+                       Stream&                                stream,
+                       ByteBufferView                         temp_storage,
+                       size_t&                                temp_storage_bytes,
+                       In                                     d_in,
+                       Out                                    d_out,
+                       size_t                                 num_items,
+                       ScanOp                                 scan_op,
+                       typename as_iterator_t<In>::value_type initial_value)
+    {
+        ExclusiveScan(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_items, scan_op, initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+        requires(IteratorT<In> || IteratorT<Out>)
+    void ExclusiveScan(CommandList&                           cmdlist,
+                       Stream&                                stream,
+                       In                                     d_in,
+                       Out                                    d_out,
+                       size_t                                 num_items,
+                       ScanOp                                 scan_op,
+                       typename as_iterator_t<In>::value_type initial_value)
+    {
+        ExclusiveScan(cmdlist, d_in, d_out, num_items, scan_op, initial_value);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    /**
+     * @brief InclusiveScan reading through an input iterator and/or writing through an output iterator,
+     * e.g. the running count of a predicate with make_transform_input_iterator<uint>(d_in, op) as one
+     * dispatch with no temporary. The scan type is the input iterator's value_type.
+     */
+    template <IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+        requires(IteratorT<In> || IteratorT<Out>)
+    void InclusiveScan(CommandList&                           cmdlist,
+                       ByteBufferView                         temp_storage,
+                       size_t&                                temp_storage_bytes,
+                       In                                     d_in,
+                       Out                                    d_out,
+                       size_t                                 num_items,
+                       ScanOp                                 scan_op,
+                       typename as_iterator_t<In>::value_type initial_value)
+    {
+        using Type4Byte      = typename as_iterator_t<In>::value_type;
+        auto layout = scan_temp_storage_layout<Type4Byte>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        scan_array<Type4Byte>(cmdlist,
+                              layout.get_bytes(temp_storage, 0),
+                              layout.get<Type4Byte>(temp_storage, 1),
+                              d_in,
+                              d_out,
+                              num_items,
+                              scan_op,
+                              initial_value,
+                              true);
+    }
+
+    template <IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+        requires(IteratorT<In> || IteratorT<Out>)
+    void InclusiveScan(CommandList&                           cmdlist,
+                       In                                     d_in,
+                       Out                                    d_out,
+                       size_t                                 num_items,
+                       ScanOp                                 scan_op,
+                       typename as_iterator_t<In>::value_type initial_value)
+    {
+        size_t temp_storage_bytes = 0;
+        InclusiveScan(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_items, scan_op, initial_value);
+        InclusiveScan(cmdlist,
+                      m_allocator->allocate(cmdlist, temp_storage_bytes),
+                      temp_storage_bytes,
+                      d_in,
+                      d_out,
+                      num_items,
+                      scan_op,
+                      initial_value);
+    }
+
+    template <IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+        requires(IteratorT<In> || IteratorT<Out>)
+    void InclusiveScan(CommandList&                           cmdlist,
+                       Stream&                                stream,
+                       ByteBufferView                         temp_storage,
+                       size_t&                                temp_storage_bytes,
+                       In                                     d_in,
+                       Out                                    d_out,
+                       size_t                                 num_items,
+                       ScanOp                                 scan_op,
+                       typename as_iterator_t<In>::value_type initial_value)
+    {
+        InclusiveScan(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_items, scan_op, initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+        requires(IteratorT<In> || IteratorT<Out>)
+    void InclusiveScan(CommandList&                           cmdlist,
+                       Stream&                                stream,
+                       In                                     d_in,
+                       Out                                    d_out,
+                       size_t                                 num_items,
+                       ScanOp                                 scan_op,
+                       typename as_iterator_t<In>::value_type initial_value)
+    {
+        InclusiveScan(cmdlist, d_in, d_out, num_items, scan_op, initial_value);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void ExclusiveSum(CommandList&          cmdlist,
+                      ByteBufferView        temp_storage,
+                      size_t&               temp_storage_bytes,
+                      BufferView<InputT>    d_in,
+                      BufferView<Type4Byte> d_out,
+                      size_t                num_items)
     {
         ExclusiveScan(
             cmdlist,
-            stream,
+            temp_storage,
+            temp_storage_bytes,
             d_in,
             d_out,
             num_items,
-            [](const Var<Type4Byte>& a, const Var<Type4Byte>& b) { return a + b; },
+            SumOp{},
             Type4Byte(0));
     }
 
-    template <NumericT Type4Byte>
-    void InclusiveSum(CommandList& cmdlist, Stream& stream, BufferView<Type4Byte> d_in, BufferView<Type4Byte> d_out, size_t num_items)
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void ExclusiveSum(CommandList&          cmdlist,
+                      BufferView<InputT>    d_in,
+                      BufferView<Type4Byte> d_out,
+                      size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        ExclusiveSum(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_items);
+        ExclusiveSum(cmdlist,
+                     m_allocator->allocate(cmdlist, temp_storage_bytes),
+                     temp_storage_bytes,
+                     d_in,
+                     d_out,
+                     num_items);
+    }
+
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void ExclusiveSum(CommandList&          cmdlist,
+                      Stream&               stream,
+                      ByteBufferView        temp_storage,
+                      size_t&               temp_storage_bytes,
+                      BufferView<InputT>    d_in,
+                      BufferView<Type4Byte> d_out,
+                      size_t                num_items)
+    {
+        ExclusiveSum(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void ExclusiveSum(CommandList&          cmdlist,
+                      Stream&               stream,
+                      BufferView<InputT>    d_in,
+                      BufferView<Type4Byte> d_out,
+                      size_t                num_items)
+    {
+        ExclusiveSum(cmdlist, d_in, d_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void InclusiveSum(CommandList&          cmdlist,
+                      ByteBufferView        temp_storage,
+                      size_t&               temp_storage_bytes,
+                      BufferView<InputT>    d_in,
+                      BufferView<Type4Byte> d_out,
+                      size_t                num_items)
     {
         InclusiveScan(
             cmdlist,
-            stream,
+            temp_storage,
+            temp_storage_bytes,
             d_in,
             d_out,
             num_items,
-            [](const Var<Type4Byte>& a, const Var<Type4Byte>& b) { return a + b; },
+            SumOp{},
             Type4Byte(0));
     }
 
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void InclusiveSum(CommandList&          cmdlist,
+                      BufferView<InputT>    d_in,
+                      BufferView<Type4Byte> d_out,
+                      size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        InclusiveSum(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, num_items);
+        InclusiveSum(cmdlist,
+                     m_allocator->allocate(cmdlist, temp_storage_bytes),
+                     temp_storage_bytes,
+                     d_in,
+                     d_out,
+                     num_items);
+    }
+
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void InclusiveSum(CommandList&          cmdlist,
+                      Stream&               stream,
+                      ByteBufferView        temp_storage,
+                      size_t&               temp_storage_bytes,
+                      BufferView<InputT>    d_in,
+                      BufferView<Type4Byte> d_out,
+                      size_t                num_items)
+    {
+        InclusiveSum(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename InputT = Type4Byte>
+    void InclusiveSum(CommandList&          cmdlist,
+                      Stream&               stream,
+                      BufferView<InputT>    d_in,
+                      BufferView<Type4Byte> d_out,
+                      size_t                num_items)
+    {
+        InclusiveSum(cmdlist, d_in, d_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT KeyType, NumericT ValueType, typename ScanOp>
+    void ExclusiveScanByKey(CommandList&          cmdlist,
+                            ByteBufferView        temp_storage,
+                            size_t&               temp_storage_bytes,
+                            BufferView<KeyType>   d_keys_in,
+                            BufferView<ValueType> d_values_in,
+                            BufferView<ValueType> d_values_out,
+                            ScanOp                scan_op,
+                            size_t                num_items,
+                            ValueType             initial_value)
+    {
+        using FlagValuePairT =
+            details::ScanByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>::FlagValuePairT;
+        auto layout = scan_by_key_temp_storage_layout<KeyType, ValueType>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        scan_by_key_array<KeyType, ValueType>(cmdlist,
+                                              layout.get_bytes(temp_storage, 0),
+                                              layout.get<FlagValuePairT>(temp_storage, 2),
+                                              d_keys_in,
+                                              layout.get<KeyType>(temp_storage, 1),
+                                              d_values_in,
+                                              d_values_out,
+                                              num_items,
+                                              scan_op,
+                                              initial_value,
+                                              false);
+    }
+
+    template <NumericT KeyType, NumericT ValueType, typename ScanOp>
+    void ExclusiveScanByKey(CommandList&          cmdlist,
+                            BufferView<KeyType>   d_keys_in,
+                            BufferView<ValueType> d_values_in,
+                            BufferView<ValueType> d_values_out,
+                            ScanOp                scan_op,
+                            size_t                num_items,
+                            ValueType             initial_value)
+    {
+        size_t temp_storage_bytes = 0;
+        ExclusiveScanByKey(cmdlist,
+                           temp_storage_query(),
+                           temp_storage_bytes,
+                           d_keys_in,
+                           d_values_in,
+                           d_values_out,
+                           scan_op,
+                           num_items,
+                           initial_value);
+        ExclusiveScanByKey(cmdlist,
+                           m_allocator->allocate(cmdlist, temp_storage_bytes),
+                           temp_storage_bytes,
+                           d_keys_in,
+                           d_values_in,
+                           d_values_out,
+                           scan_op,
+                           num_items,
+                           initial_value);
+    }
+
     template <NumericT KeyType, NumericT ValueType, typename ScanOp>
     void ExclusiveScanByKey(CommandList&          cmdlist,
                             Stream&               stream,
+                            ByteBufferView        temp_storage,
+                            size_t&               temp_storage_bytes,
                             BufferView<KeyType>   d_keys_in,
                             BufferView<ValueType> d_values_in,
                             BufferView<ValueType> d_values_out,
@@ -131,24 +649,101 @@ class DeviceScan : public LuisaModule
                             size_t                num_items,
                             ValueType             initial_value)
     {
-        int num_tiles = imax(1, (int)ceil((float)num_items / (ITEMS_PER_THREAD * m_block_size)));
-        // tilestate
-        using ScanByKey = details::ScanByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ScanByKeyTileState = ScanByKey::ScanTileState;
-        Buffer<ScanByKeyTileState> tile_states =
-            m_device.create_buffer<ScanByKeyTileState>(details::WARP_SIZE + num_tiles);
+        ExclusiveScanByKey(cmdlist,
+                           temp_storage,
+                           temp_storage_bytes,
+                           d_keys_in,
+                           d_values_in,
+                           d_values_out,
+                           scan_op,
+                           num_items,
+                           initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
-        Buffer<KeyType> d_prev_keys_in = m_device.create_buffer<KeyType>(num_tiles);
-        scan_by_key_array<KeyType, ValueType>(
-            cmdlist, tile_states.view(), d_keys_in, d_prev_keys_in.view(), d_values_in, d_values_out, num_items, scan_op, initial_value, false);
+    template <NumericT KeyType, NumericT ValueType, typename ScanOp>
+    void ExclusiveScanByKey(CommandList&          cmdlist,
+                            Stream&               stream,
+                            BufferView<KeyType>   d_keys_in,
+                            BufferView<ValueType> d_values_in,
+                            BufferView<ValueType> d_values_out,
+                            ScanOp                scan_op,
+                            size_t                num_items,
+                            ValueType             initial_value)
+    {
+        ExclusiveScanByKey(cmdlist, d_keys_in, d_values_in, d_values_out, scan_op, num_items, initial_value);
         stream << cmdlist.commit() << synchronize();
-        tile_states.release();
-        d_prev_keys_in.release();
+    }
+
+    template <NumericT KeyType, NumericT ValueType, typename ScanOp>
+    void InclusiveScanByKey(CommandList&          cmdlist,
+                            ByteBufferView        temp_storage,
+                            size_t&               temp_storage_bytes,
+                            BufferView<KeyType>   d_keys_in,
+                            BufferView<ValueType> d_values_in,
+                            BufferView<ValueType> d_values_out,
+                            ScanOp                scan_op,
+                            size_t                num_items,
+                            ValueType             initial_value)
+    {
+        using FlagValuePairT =
+            details::ScanByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>::FlagValuePairT;
+        auto layout = scan_by_key_temp_storage_layout<KeyType, ValueType>(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        scan_by_key_array<KeyType, ValueType>(cmdlist,
+                                              layout.get_bytes(temp_storage, 0),
+                                              layout.get<FlagValuePairT>(temp_storage, 2),
+                                              d_keys_in,
+                                              layout.get<KeyType>(temp_storage, 1),
+                                              d_values_in,
+                                              d_values_out,
+                                              num_items,
+                                              scan_op,
+                                              initial_value,
+                                              true);
+    }
+
+    template <NumericT KeyType, NumericT ValueType, typename ScanOp>
+    void InclusiveScanByKey(CommandList&          cmdlist,
+                            BufferView<KeyType>   d_keys_in,
+                            BufferView<ValueType> d_values_in,
+                            BufferView<ValueType> d_values_out,
+                            ScanOp                scan_op,
+                            size_t                num_items,
+                            ValueType             initial_value)
+    {
+        size_t temp_storage_bytes = 0;
+        InclusiveScanByKey(cmdlist,
+                           temp_storage_query(),
+                           temp_storage_bytes,
+                           d_keys_in,
+                           d_values_in,
+                           d_values_out,
+                           scan_op,
+                           num_items,
+                           initial_value);
+        InclusiveScanByKey(cmdlist,
+                           m_allocator->allocate(cmdlist, temp_storage_bytes),
+                           temp_storage_bytes,
+                           d_keys_in,
+                           d_values_in,
+                           d_values_out,
+                           scan_op,
+                           num_items,
+                           initial_value);
     }
 
     template <NumericT KeyType, NumericT ValueType, typename ScanOp>
     void InclusiveScanByKey(CommandList&          cmdlist,
                             Stream&               stream,
+                            ByteBufferView        temp_storage,
+                            size_t&               temp_storage_bytes,
                             BufferView<KeyType>   d_keys_in,
                             BufferView<ValueType> d_values_in,
                             BufferView<ValueType> d_values_out,
@@ -156,25 +751,39 @@ class DeviceScan : public LuisaModule
                             size_t                num_items,
                             ValueType             initial_value)
     {
-        int num_tiles = imax(1, (int)ceil((float)num_items / (ITEMS_PER_THREAD * m_block_size)));
-        // tilestate
-        using ScanByKey = details::ScanByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ScanByKeyTileState = ScanByKey::ScanTileState;
-        Buffer<ScanByKeyTileState> tile_states =
-            m_device.create_buffer<ScanByKeyTileState>(details::WARP_SIZE + num_tiles);
+        InclusiveScanByKey(cmdlist,
+                           temp_storage,
+                           temp_storage_bytes,
+                           d_keys_in,
+                           d_values_in,
+                           d_values_out,
+                           scan_op,
+                           num_items,
+                           initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
-        Buffer<KeyType> d_prev_keys_in = m_device.create_buffer<KeyType>(num_tiles);
-        scan_by_key_array<KeyType, ValueType>(
-            cmdlist, tile_states.view(), d_keys_in, d_prev_keys_in.view(), d_values_in, d_values_out, num_items, scan_op, initial_value, true);
+    template <NumericT KeyType, NumericT ValueType, typename ScanOp>
+    void InclusiveScanByKey(CommandList&          cmdlist,
+                            Stream&               stream,
+                            BufferView<KeyType>   d_keys_in,
+                            BufferView<ValueType> d_values_in,
+                            BufferView<ValueType> d_values_out,
+                            ScanOp                scan_op,
+                            size_t                num_items,
+                            ValueType             initial_value)
+    {
+        InclusiveScanByKey(cmdlist, d_keys_in, d_values_in, d_values_out, scan_op, num_items, initial_value);
         stream << cmdlist.commit() << synchronize();
-        tile_states.release();
-        d_prev_keys_in.release();
     }
 
-
     template <NumericT Type4Byte>
     void ExclusiveSumByKey(CommandList&          cmdlist,
-                           Stream&               stream,
+                           ByteBufferView        temp_storage,
+                           size_t&               temp_storage_bytes,
                            BufferView<Type4Byte> d_keys_in,
                            BufferView<Type4Byte> d_values_in,
                            BufferView<Type4Byte> d_values_out,
@@ -182,18 +791,73 @@ class DeviceScan : public LuisaModule
     {
         ExclusiveScanByKey(
             cmdlist,
-            stream,
+            temp_storage,
+            temp_storage_bytes,
             d_keys_in,
             d_values_in,
             d_values_out,
-            [](const Var<Type4Byte>& a, const Var<Type4Byte>& b) { return a + b; },
+            SumOp{},
             num_items,
             Type4Byte(0));
     }
 
     template <NumericT Type4Byte>
-    void InclusiveSumByKey(CommandList&          cmdlist,
+    void ExclusiveSumByKey(CommandList&          cmdlist,
+                           BufferView<Type4Byte> d_keys_in,
+                           BufferView<Type4Byte> d_values_in,
+                           BufferView<Type4Byte> d_values_out,
+                           size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        ExclusiveSumByKey(cmdlist,
+                          temp_storage_query(),
+                          temp_storage_bytes,
+                          d_keys_in,
+                          d_values_in,
+                          d_values_out,
+                          num_items);
+        ExclusiveSumByKey(cmdlist,
+                          m_allocator->allocate(cmdlist, temp_storage_bytes),
+                          temp_storage_bytes,
+                          d_keys_in,
+                          d_values_in,
+                          d_values_out,
+                          num_items);
+    }
+
+    template <NumericT Type4Byte>
+    void ExclusiveSumByKey(CommandList&          cmdlist,
                            Stream&               stream,
+                           ByteBufferView        temp_storage,
+                           size_t&               temp_storage_bytes,
+                           BufferView<Type4Byte> d_keys_in,
+                           BufferView<Type4Byte> d_values_in,
+                           BufferView<Type4Byte> d_values_out,
+                           size_t                num_items)
+    {
+        ExclusiveSumByKey(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_values_in, d_values_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte>
+    void ExclusiveSumByKey(CommandList&          cmdlist,
+                           Stream&               stream,
+                           BufferView<Type4Byte> d_keys_in,
+                           BufferView<Type4Byte> d_values_in,
+                           BufferView<Type4Byte> d_values_out,
+                           size_t                num_items)
+    {
+        ExclusiveSumByKey(cmdlist, d_keys_in, d_values_in, d_values_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type4Byte>
+    void InclusiveSumByKey(CommandList&          cmdlist,
+                           ByteBufferView        temp_storage,
+                           size_t&               temp_storage_bytes,
                            BufferView<Type4Byte> d_keys_in,
                            BufferView<Type4Byte> d_values_in,
                            BufferView<Type4Byte> d_values_out,
@@ -201,135 +865,560 @@ class DeviceScan : public LuisaModule
     {
         InclusiveScanByKey(
             cmdlist,
-            stream,
+            temp_storage,
+            temp_storage_bytes,
             d_keys_in,
             d_values_in,
             d_values_out,
-            [](const Var<Type4Byte>& a, const Var<Type4Byte>& b) { return a + b; },
+            SumOp{},
             num_items,
             Type4Byte(0));
     }
 
+    template <NumericT Type4Byte>
+    void InclusiveSumByKey(CommandList&          cmdlist,
+                           BufferView<Type4Byte> d_keys_in,
+                           BufferView<Type4Byte> d_values_in,
+                           BufferView<Type4Byte> d_values_out,
+                           size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        InclusiveSumByKey(cmdlist,
+                          temp_storage_query(),
+                          temp_storage_bytes,
+                          d_keys_in,
+                          d_values_in,
+                          d_values_out,
+                          num_items);
+        InclusiveSumByKey(cmdlist,
+                          m_allocator->allocate(cmdlist, temp_storage_bytes),
+                          temp_storage_bytes,
+                          d_keys_in,
+                          d_values_in,
+                          d_values_out,
+                          num_items);
+    }
+
+    template <NumericT Type4Byte>
+    void InclusiveSumByKey(CommandList&          cmdlist,
+                           Stream&               stream,
+                           ByteBufferView        temp_storage,
+                           size_t&               temp_storage_bytes,
+                           BufferView<Type4Byte> d_keys_in,
+                           BufferView<Type4Byte> d_values_in,
+                           BufferView<Type4Byte> d_values_out,
+                           size_t                num_items)
+    {
+        InclusiveSumByKey(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_values_in, d_values_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte>
+    void InclusiveSumByKey(CommandList&          cmdlist,
+                           Stream&               stream,
+                           BufferView<Type4Byte> d_keys_in,
+                           BufferView<Type4Byte> d_values_in,
+                           BufferView<Type4Byte> d_values_out,
+                           size_t                num_items)
+    {
+        InclusiveSumByKey(cmdlist, d_keys_in, d_values_in, d_values_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
 
   private:
-    template <NumericT Type4Byte, typename ScanTileStateT, typename ScanOp>
-    void scan_array(CommandList&               cmdlist,
-                    BufferView<ScanTileStateT> tile_states,
-                    BufferView<Type4Byte>      d_in,
-                    BufferView<Type4Byte>      d_out,
-                    size_t                     num_items,
-                    ScanOp                     scan_op,
-                    Type4Byte                  initial_value,
-                    bool                       is_inclusive)
+    static DeviceScanAlgorithm resolve_algorithm(Device& device, DeviceScanAlgorithm algorithm)
+    {
+        if(algorithm != DeviceScanAlgorithm::AUTO)
+        {
+            return algorithm;
+        }
+        // look-back spins on tiles that a cpu backend may schedule after the waiting one
+        auto backend = device.backend_name();
+        return backend == "cpu" || backend == "fallback" ? DeviceScanAlgorithm::REDUCE_THEN_SCAN :
+                                                           DeviceScanAlgorithm::DECOUPLED_LOOK_BACK;
+    }
+
+    [[nodiscard]] bool is_reduce_then_scan() const noexcept
     {
+        return m_algorithm == DeviceScanAlgorithm::REDUCE_THEN_SCAN;
+    }
+
+    template <NumericT Type4Byte>
+    TempStorageLayout<2> scan_temp_storage_layout(size_t num_items)
+    {
+        size_t num_tiles       = imax(1, ceil_div(num_items, (ITEMS_PER_THREAD * m_block_size)));
+        size_t tile_state_size = scan_tile_state_size<Type4Byte>(m_packed_tile_state);
+        return TempStorageLayout<2>{{
+            // tilestate
+            is_reduce_then_scan() ? 0 : (details::WARP_SIZE + num_tiles) * tile_state_size,
+            // tile prefix
+            is_reduce_then_scan() ? num_tiles * sizeof(Type4Byte) : 0,
+        }};
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    TempStorageLayout<3> scan_by_key_temp_storage_layout(size_t num_items)
+    {
+        using ScanByKeyModule  = details::ScanByKeyModule<KeyType, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using FlagValuePairT   = ScanByKeyModule::FlagValuePairT;
+        size_t num_tiles       = imax(1, ceil_div(num_items, (ITEMS_PER_THREAD * m_block_size)));
+        size_t tile_state_size = scan_tile_state_size<FlagValuePairT>(m_packed_tile_state);
+        return TempStorageLayout<3>{{
+            // tilestate
+            is_reduce_then_scan() ? 0 : (details::WARP_SIZE + num_tiles) * tile_state_size,
+            // prev keys
+            num_tiles * sizeof(KeyType),
+            // tile prefix
+            is_reduce_then_scan() ? num_tiles * sizeof(FlagValuePairT) : 0,
+        }};
+    }
+
+    template <NumericT Type4Byte, IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+    void scan_array(CommandList&          cmdlist,
+                    ByteBufferView        tile_state_bytes,
+                    BufferView<Type4Byte> tile_prefix,
+                    In                    d_in,
+                    Out                   d_out,
+                    size_t                num_items,
+                    ScanOp                scan_op,
+                    Type4Byte             initial_value,
+                    bool                  is_inclusive)
+    {
+        if(is_reduce_then_scan())
+        {
+            reduce_then_scan_array<Type4Byte>(
+                cmdlist, tile_prefix, d_in, d_out, num_items, scan_op, initial_value, is_inclusive);
+            return;
+        }
         uint num_tiles = imax(1, ceil_div(num_items, (ITEMS_PER_THREAD * m_block_size)));
+        auto in_it     = as_iterator(d_in);
+        auto out_it    = as_iterator(d_out);
 
-        using ScanShader    = details::ScanModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ScanTileState = ScanShader::TileState;
-        using ScanTileStateInitKernel = ScanShader::ScanTileStateInitKernel;
-        using ScanShaderKernel        = ScanShader::ScanKernel;
+        size_t init_num_blocks = ceil_div(num_tiles, m_block_size);
+        visit_tile_state_layout(
+            m_packed_tile_state,
+            [&]<bool PACKED>(std::bool_constant<PACKED>)
+            {
+                using TileState                  = ScanTileStateStorage<Type4Byte, PACKED>;
+                auto tile_states                 = details::reinterpret_view<TileState>(tile_state_bytes);
+                auto ms_scan_tile_state_init_ptr = scan_tile_state_init_shader<PACKED, Type4Byte>();
+                auto ms_scan_ptr = scan_shader<PACKED, Type4Byte>(scan_op, is_inclusive, in_it, out_it);
+                cmdlist << (*ms_scan_tile_state_init_ptr)(tile_states, uint(num_tiles)).dispatch(m_block_size * init_num_blocks);
+
+                // scan, the iterators expand into their own kernel arguments
+                std::apply(
+                    [&](auto&&... it_args)
+                    {
+                        cmdlist << (*ms_scan_ptr)(tile_states, it_args..., initial_value, num_items).dispatch(m_block_size * num_tiles);
+                    },
+                    std::tuple_cat(in_it.args(), out_it.args()));
+            });
+    };
+
+    template <NumericT Type4Byte, IteratorOrBufferT In, IteratorOrBufferT Out, typename ScanOp>
+    void reduce_then_scan_array(CommandList&          cmdlist,
+                                BufferView<Type4Byte> tile_prefix,
+                                In                    d_in,
+                                Out                   d_out,
+                                size_t                num_items,
+                                ScanOp                scan_op,
+                                Type4Byte             initial_value,
+                                bool                  is_inclusive)
+    {
+        uint num_tiles = imax(1, ceil_div(num_items, (ITEMS_PER_THREAD * m_block_size)));
+        auto in_it     = as_iterator(d_in);
+        auto out_it    = as_iterator(d_out);
+
+        auto ms_downsweep_ptr = scan_downsweep_shader<Type4Byte>(scan_op, is_inclusive, in_it, out_it);
+        if(num_tiles > 1)
+        {
+            auto ms_reduce_tile_ptr = scan_reduce_tile_shader<Type4Byte>(scan_op, in_it);
+            auto ms_spine_ptr       = scan_spine_shader<Type4Byte>(scan_op);
+
+            // reduce every full tile, the aggregates land in the prefix slots
+            std::apply([&](auto&&... in_args)
+                       { cmdlist << (*ms_reduce_tile_ptr)(in_args..., tile_prefix).dispatch(m_block_size * (num_tiles - 1)); },
+                       in_it.args());
+
+            // spine
+            cmdlist << (*ms_spine_ptr)(tile_prefix, initial_value, num_tiles).dispatch(m_block_size);
+        }
+
+        // downsweep
+        std::apply(
+            [&](auto&&... it_args)
+            {
+                cmdlist << (*ms_downsweep_ptr)(tile_prefix, it_args..., initial_value, num_items).dispatch(m_block_size * num_tiles);
+            },
+            std::tuple_cat(in_it.args(), out_it.args()));
+    }
+
+
+    template <NumericT KeyValue, NumericT ValueType, typename ScanOp>
+    void scan_by_key_array(CommandList&                             cmdlist,
+                           ByteBufferView                           tile_state_bytes,
+                           BufferView<KeyValuePair<int, ValueType>> tile_prefix,
+                           BufferView<KeyValue>                     d_keys_in,
+                           BufferView<KeyValue>                     d_prev_keys_in,
+                           BufferView<ValueType>                    d_values_in,
+                           BufferView<ValueType>                    d_values_out,
+                           size_t                                   num_items,
+                           ScanOp                                   scan_op,
+                           ValueType                                initial_value,
+                           bool                                     is_inclusive)
+    {
+        if(is_reduce_then_scan())
+        {
+            reduce_then_scan_by_key_array<KeyValue, ValueType>(cmdlist,
+                                                               tile_prefix,
+                                                               d_keys_in,
+                                                               d_prev_keys_in,
+                                                               d_values_in,
+                                                               d_values_out,
+                                                               num_items,
+                                                               scan_op,
+                                                               initial_value,
+                                                               is_inclusive);
+            return;
+        }
+        uint num_tiles = imax(1, ceil_div(num_items, (ITEMS_PER_THREAD * m_block_size)));
 
         size_t init_num_blocks = ceil_div(num_tiles, m_block_size);
-        auto   init_key = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
-        auto   ms_tile_state_init_it = ms_scan_key.find(init_key);
-        if(ms_tile_state_init_it == ms_scan_key.end())
+        visit_tile_state_layout(
+            m_packed_tile_state,
+            [&]<bool PACKED>(std::bool_constant<PACKED>)
+            {
+                using TileState =
+                    details::ScanByKeyModule<KeyValue, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>::ScanTileState;
+                auto tile_states = details::reinterpret_view<TileState>(tile_state_bytes);
+                auto ms_scan_by_key_tile_state_init_ptr = scan_by_key_tile_state_init_shader<PACKED, KeyValue, ValueType>();
+                auto ms_scan_by_key_ptr = scan_by_key_shader<PACKED, KeyValue, ValueType>(scan_op, is_inclusive);
+                cmdlist << (*ms_scan_by_key_tile_state_init_ptr)(tile_states, d_keys_in, d_prev_keys_in, uint(num_tiles))
+                               .dispatch(m_block_size * init_num_blocks);
+
+                // scan
+                cmdlist << (*ms_scan_by_key_ptr)(tile_states, d_keys_in, d_prev_keys_in, d_values_in, d_values_out, initial_value, num_items)
+                               .dispatch(m_block_size * num_tiles);
+            });
+    }
+
+    template <NumericT KeyValue, NumericT ValueType, typename ScanOp>
+    void reduce_then_scan_by_key_array(CommandList&                             cmdlist,
+                                       BufferView<KeyValuePair<int, ValueType>> tile_prefix,
+                                       BufferView<KeyValue>                     d_keys_in,
+                                       BufferView<KeyValue>                     d_prev_keys_in,
+                                       BufferView<ValueType>                    d_values_in,
+                                       BufferView<ValueType>                    d_values_out,
+                                       size_t                                   num_items,
+                                       ScanOp                                   scan_op,
+                                       ValueType                                initial_value,
+                                       bool                                     is_inclusive)
+    {
+        uint num_tiles = imax(1, ceil_div(num_items, (ITEMS_PER_THREAD * m_block_size)));
+
+        size_t init_num_blocks  = ceil_div(num_tiles, m_block_size);
+        auto   ms_prev_keys_ptr = scan_by_key_prev_keys_shader<KeyValue, ValueType>();
+        auto   ms_downsweep_ptr = scan_by_key_downsweep_shader<KeyValue, ValueType>(scan_op, is_inclusive);
+        auto   ms_reduce_tile_ptr = scan_by_key_reduce_tile_shader<KeyValue, ValueType>(scan_op);
+        auto   ms_spine_ptr       = scan_by_key_spine_shader<KeyValue, ValueType>(scan_op);
+        cmdlist << (*ms_prev_keys_ptr)(d_keys_in, d_prev_keys_in, int(num_tiles)).dispatch(m_block_size * init_num_blocks);
+
+        if(num_tiles > 1)
         {
-            auto shader = ScanShader().compile_scan_tile_state_init(m_device);
-            ms_scan_key.try_emplace(init_key, std::move(shader));
-            ms_tile_state_init_it = ms_scan_key.find(init_key);
+            // reduce every full tile, the aggregates land in the prefix slots
+            cmdlist << (*ms_reduce_tile_ptr)(d_keys_in, d_prev_keys_in, d_values_in, tile_prefix)
+                           .dispatch(m_block_size * (num_tiles - 1));
+
+            // spine
+            cmdlist << (*ms_spine_ptr)(tile_prefix, num_tiles).dispatch(m_block_size);
         }
-        auto ms_scan_tile_state_init_ptr =
-            reinterpret_cast<ScanTileStateInitKernel*>(&(*ms_tile_state_init_it->second));
-        cmdlist << (*ms_scan_tile_state_init_ptr)(tile_states, uint(num_tiles)).dispatch(m_block_size * init_num_blocks);
 
-        // scan
-        auto key = get_type_and_op_desc<Type4Byte>(scan_op);
-        auto ms_scan_it = is_inclusive ? ms_inclusive_scan_map.find(key) : ms_exclusive_scan_map.find(key);
-        if(ms_scan_it == (is_inclusive ? ms_inclusive_scan_map : ms_exclusive_scan_map).end())
+        // downsweep
+        cmdlist << (*ms_downsweep_ptr)(tile_prefix, d_keys_in, d_prev_keys_in, d_values_in, d_values_out, initial_value, num_items)
+                       .dispatch(m_block_size * num_tiles);
+    }
+
+    // shader lookups, compile on first use (or Warmup) and cache per key
+    template <bool PACKED, NumericT Type4Byte>
+    auto scan_tile_state_init_shader()
+    {
+        using ScanShader = details::ScanModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD, BufferIterator<Type4Byte>, BufferIterator<Type4Byte>, PACKED>;
+        using ScanTileStateInitKernel = ScanShader::ScanTileStateInitKernel;
+
+        constexpr auto key = shader_key<"scan_tile_state_init", DeviceScan, ScanShader>();
+        return m_shaders->get_or_compile<ScanTileStateInitKernel>(key, [&]
         {
-            if(is_inclusive)
+            auto desc = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()} + tile_state_layout_desc(PACKED);
+            auto compile = [device = m_device]() mutable
+            { return ScanShader().compile_scan_tile_state_init(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <bool PACKED, NumericT Type4Byte, typename ScanOp, IteratorT InputIt = BufferIterator<Type4Byte>, IteratorT OutputIt = BufferIterator<Type4Byte>>
+    auto scan_shader(ScanOp scan_op, bool is_inclusive, InputIt input = {}, OutputIt output = {})
+    {
+        using ScanShader       = details::ScanModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD, InputIt, OutputIt, PACKED>;
+        using ScanShaderKernel = ScanShader::ScanKernel;
+
+        const auto key = shader_key<"scan", DeviceScan, ScanShader, ScanOp>(
+            static_cast<uint64_t>(m_look_back_delay) << 1 | is_inclusive);
+        return m_shaders->get_or_compile<ScanShaderKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(scan_op) + look_back_delay_desc(m_look_back_delay)
+                        + tile_state_layout_desc(PACKED) + iterator_desc(input, output);
+            auto compile = [device          = m_device,
+                            shared_mem_size = m_shared_mem_size,
+                            look_back_delay = m_look_back_delay,
+                            scan_op,
+                            is_inclusive,
+                            input,
+                            output]() mutable
             {
-                auto shader = ScanShader().template compile<true>(m_device, m_shared_mem_size, scan_op);
-                ms_inclusive_scan_map.try_emplace(key, std::move(shader));
-                ms_scan_it = ms_inclusive_scan_map.find(key);
-            }
-            else
+                return visit_delay_constructor<Type4Byte>(
+                    look_back_delay,
+                    [&]<typename DelayConstructorT>(std::type_identity<DelayConstructorT>)
+                    {
+                        return is_inclusive ?
+                                   ScanShader(input, output).template compile<true, DelayConstructorT>(
+                                       device, shared_mem_size, scan_op) :
+                                   ScanShader(input, output).template compile<false, DelayConstructorT>(
+                                       device, shared_mem_size, scan_op);
+                    });
+            };
+            auto module = shader_cache_module(is_inclusive ? "inclusive_scan" : "exclusive_scan");
+            return compile_async(module, desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type4Byte, typename ScanOp, IteratorT InputIt = BufferIterator<Type4Byte>>
+    auto scan_reduce_tile_shader(ScanOp scan_op, InputIt input = {})
+    {
+        using ScanShader       = details::ScanModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD, InputIt>;
+        using ReduceTileKernel = ScanShader::ReduceTileKernel;
+
+        constexpr auto key = shader_key<"scan_reduce_tile", DeviceScan, ScanShader, ScanOp>();
+        return m_shaders->get_or_compile<ReduceTileKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(scan_op) + iterator_desc(input);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, scan_op, input]() mutable
+            { return ScanShader(input, {}).compile_reduce_tile(device, shared_mem_size, scan_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type4Byte, typename ScanOp>
+    auto scan_spine_shader(ScanOp scan_op)
+    {
+        using ScanShader      = details::ScanModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using SpineScanKernel = ScanShader::SpineScanKernel;
+
+        constexpr auto key = shader_key<"scan_spine", DeviceScan, ScanShader, ScanOp>();
+        return m_shaders->get_or_compile<SpineScanKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(scan_op);
+            auto compile = [device = m_device, scan_op]() mutable
+            { return ScanShader().compile_spine(device, scan_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type4Byte, typename ScanOp, IteratorT InputIt = BufferIterator<Type4Byte>, IteratorT OutputIt = BufferIterator<Type4Byte>>
+    auto scan_downsweep_shader(ScanOp scan_op, bool is_inclusive, InputIt input = {}, OutputIt output = {})
+    {
+        using ScanShader      = details::ScanModule<Type4Byte, BLOCK_SIZE, ITEMS_PER_THREAD, InputIt, OutputIt>;
+        using DownsweepKernel = ScanShader::DownsweepKernel;
+
+        const auto key = shader_key<"scan_downsweep", DeviceScan, ScanShader, ScanOp>(is_inclusive);
+        return m_shaders->get_or_compile<DownsweepKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(scan_op) + iterator_desc(input, output);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, scan_op, is_inclusive, input, output]() mutable
             {
-                auto shader = ScanShader().template compile<false>(m_device, m_shared_mem_size, scan_op);
-                ms_exclusive_scan_map.try_emplace(key, std::move(shader));
-                ms_scan_it = ms_exclusive_scan_map.find(key);
-            }
-        }
-        auto ms_scan_ptr = reinterpret_cast<ScanShaderKernel*>(&(*ms_scan_it->second));
-        cmdlist << (*ms_scan_ptr)(tile_states, d_in, d_out, initial_value, num_items).dispatch(m_block_size * num_tiles);
-    };
+                return is_inclusive ?
+                           ScanShader(input, output).template compile_downsweep<true>(device, shared_mem_size, scan_op) :
+                           ScanShader(input, output).template compile_downsweep<false>(device, shared_mem_size, scan_op);
+            };
+            auto module     = shader_cache_module(is_inclusive ? "inclusive_scan_downsweep" : "exclusive_scan_downsweep");
+            return compile_async(module, desc, std::move(compile));
+        });
+    }
 
+    template <bool PACKED, NumericT KeyValue, NumericT ValueType>
+    auto scan_by_key_tile_state_init_shader()
+    {
+        using ScanByKeyShader = details::ScanByKeyModule<KeyValue, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using ScanByKeyTileStateInitKernel = ScanByKeyShader::ScanTileStateInitKernel;
+
+        constexpr auto key = shader_key<"scan_by_key_tile_state_init", DeviceScan, ScanByKeyShader>();
+        return m_shaders->get_or_compile<ScanByKeyTileStateInitKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<KeyValue, ValueType>() + tile_state_layout_desc(PACKED);
+            auto compile = [device = m_device]() mutable
+            { return ScanByKeyShader().compile_scan_tile_state_init(device); };
+            auto module = shader_cache_module("scan_by_key_tile_state_init");
+            return compile_async(module, desc, std::move(compile));
+        });
+    }
 
-    template <NumericT KeyValue, NumericT ValueType, typename ScanTileStateT, typename ScanOp>
-    void scan_by_key_array(CommandList&               cmdlist,
-                           BufferView<ScanTileStateT> tile_states,
-                           BufferView<KeyValue>       d_keys_in,
-                           BufferView<KeyValue>       d_prev_keys_in,
-                           BufferView<ValueType>      d_values_in,
-                           BufferView<ValueType>      d_values_out,
-                           size_t                     num_items,
-                           ScanOp                     scan_op,
-                           ValueType                  initial_value,
-                           bool                       is_inclusive)
+    template <bool PACKED, NumericT KeyValue, NumericT ValueType, typename ScanOp>
+    auto scan_by_key_shader(ScanOp scan_op, bool is_inclusive)
     {
-        uint num_tiles = imax(1, ceil_div(num_items, (ITEMS_PER_THREAD * m_block_size)));
+        using ScanByKeyShader = details::ScanByKeyModule<KeyValue, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using ScanByKeyShaderKernel = ScanByKeyShader::ScanByKeyKernel;
+        using FlagValuePairT        = ScanByKeyShader::FlagValuePairT;
+
+        const auto key = shader_key<"scan_by_key", DeviceScan, ScanByKeyShader, ScanOp>(
+            static_cast<uint64_t>(m_look_back_delay) << 1 | is_inclusive);
+        return m_shaders->get_or_compile<ScanByKeyShaderKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<KeyValue, ValueType>(scan_op) + look_back_delay_desc(m_look_back_delay)
+                        + tile_state_layout_desc(PACKED);
+            LUISA_INFO("Compiling Scan By Key shader for key: {}", desc);
+            auto compile = [device          = m_device,
+                            shared_mem_size = m_shared_mem_size,
+                            look_back_delay = m_look_back_delay,
+                            scan_op,
+                            is_inclusive]() mutable
+            {
+                return visit_delay_constructor<FlagValuePairT>(
+                    look_back_delay,
+                    [&]<typename DelayConstructorT>(std::type_identity<DelayConstructorT>)
+                    {
+                        return is_inclusive ? ScanByKeyShader().template compile<true, DelayConstructorT>(
+                                                  device, shared_mem_size, scan_op) :
+                                              ScanByKeyShader().template compile<false, DelayConstructorT>(
+                                                  device, shared_mem_size, scan_op);
+                    });
+            };
+            auto module   = shader_cache_module(is_inclusive ? "inclusive_scan_by_key" : "exclusive_scan_by_key");
+            return compile_async(module, desc, std::move(compile));
+        });
+    }
 
+    template <NumericT KeyValue, NumericT ValueType>
+    auto scan_by_key_prev_keys_shader()
+    {
         using ScanByKeyShader = details::ScanByKeyModule<KeyValue, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
-        using ScanByKeyTileState           = ScanByKeyShader::ScanTileState;
-        using ScanByKeyTileStateInitKernel = ScanByKeyShader::ScanTileStateInitKernel;
-        using ScanByKeyShaderKernel        = ScanByKeyShader::ScanByKeyKernel;
+        using PrevKeysKernel  = ScanByKeyShader::PrevKeysKernel;
 
-        size_t init_num_blocks                 = ceil_div(num_tiles, m_block_size);
-        auto   init_key                        = get_type_and_op_desc<KeyValue, ValueType>();
-        auto ms_scan_by_key_tile_state_init_it = ms_scan_by_key_tile_state_init_map.find(init_key);
-        if(ms_scan_by_key_tile_state_init_it == ms_scan_by_key_tile_state_init_map.end())
+        constexpr auto key = shader_key<"scan_by_key_prev_keys", DeviceScan, ScanByKeyShader>();
+        return m_shaders->get_or_compile<PrevKeysKernel>(key, [&]
         {
-            auto shader = ScanByKeyShader().compile_scan_tile_state_init(m_device);
-            ms_scan_by_key_tile_state_init_map.try_emplace(init_key, std::move(shader));
-            ms_scan_by_key_tile_state_init_it = ms_scan_by_key_tile_state_init_map.find(init_key);
-        }
-        auto ms_scan_by_key_tile_state_init_ptr =
-            reinterpret_cast<ScanByKeyTileStateInitKernel*>(&(*ms_scan_by_key_tile_state_init_it->second));
-        cmdlist << (*ms_scan_by_key_tile_state_init_ptr)(tile_states, d_keys_in, d_prev_keys_in, uint(num_tiles))
-                       .dispatch(m_block_size * init_num_blocks);
-
-        // scan
-        auto key           = get_type_and_op_desc<KeyValue, ValueType>(scan_op);
-        auto ms_scan_by_it = is_inclusive ? ms_inclusive_scan_by_key_map.find(key) :
-                                            ms_exclusive_scan_by_key_map.find(key);
-        if(ms_scan_by_it
-           == (is_inclusive ? ms_inclusive_scan_by_key_map : ms_exclusive_scan_by_key_map).end())
-        {
-            LUISA_INFO("Compiling Scan By Key shader for key: {}", key);
-            if(is_inclusive)
+            auto desc = get_type_and_op_desc<KeyValue, ValueType>();
+            auto compile = [device = m_device]() mutable
+            { return ScanByKeyShader().compile_prev_keys(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT KeyValue, NumericT ValueType, typename ScanOp>
+    auto scan_by_key_reduce_tile_shader(ScanOp scan_op)
+    {
+        using ScanByKeyShader  = details::ScanByKeyModule<KeyValue, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using ReduceTileKernel = ScanByKeyShader::ReduceTileKernel;
+
+        constexpr auto key = shader_key<"scan_by_key_reduce_tile", DeviceScan, ScanByKeyShader, ScanOp>();
+        return m_shaders->get_or_compile<ReduceTileKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<KeyValue, ValueType>(scan_op);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, scan_op]() mutable
+            { return ScanByKeyShader().compile_reduce_tile(device, shared_mem_size, scan_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT KeyValue, NumericT ValueType, typename ScanOp>
+    auto scan_by_key_spine_shader(ScanOp scan_op)
+    {
+        using ScanByKeyShader = details::ScanByKeyModule<KeyValue, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using SpineScanKernel = ScanByKeyShader::SpineScanKernel;
+
+        constexpr auto key = shader_key<"scan_by_key_spine", DeviceScan, ScanByKeyShader, ScanOp>();
+        return m_shaders->get_or_compile<SpineScanKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<KeyValue, ValueType>(scan_op);
+            auto compile = [device = m_device, scan_op]() mutable
+            { return ScanByKeyShader().compile_spine(device, scan_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT KeyValue, NumericT ValueType, typename ScanOp>
+    auto scan_by_key_downsweep_shader(ScanOp scan_op, bool is_inclusive)
+    {
+        using ScanByKeyShader = details::ScanByKeyModule<KeyValue, ValueType, BLOCK_SIZE, ITEMS_PER_THREAD>;
+        using DownsweepKernel = ScanByKeyShader::DownsweepKernel;
+
+        const auto key = shader_key<"scan_by_key_downsweep", DeviceScan, ScanByKeyShader, ScanOp>(is_inclusive);
+        return m_shaders->get_or_compile<DownsweepKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<KeyValue, ValueType>(scan_op);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, scan_op, is_inclusive]() mutable
+            {
+                return is_inclusive ?
+                           ScanByKeyShader().template compile_downsweep<true>(device, shared_mem_size, scan_op) :
+                           ScanByKeyShader().template compile_downsweep<false>(device, shared_mem_size, scan_op);
+            };
+            auto module     = shader_cache_module(is_inclusive ? "inclusive_scan_by_key_downsweep" : "exclusive_scan_by_key_downsweep");
+            return compile_async(module, desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type4Byte, typename ScanOp>
+    void warmup_scan(ScanOp scan_op)
+    {
+        for(bool is_inclusive : {false, true})
+        {
+            if(is_reduce_then_scan())
             {
-                auto shader = ScanByKeyShader().template compile<true>(m_device, m_shared_mem_size, scan_op);
-                ms_inclusive_scan_by_key_map.try_emplace(key, std::move(shader));
-                ms_scan_by_it = ms_inclusive_scan_by_key_map.find(key);
+                scan_reduce_tile_shader<Type4Byte>(scan_op);
+                scan_spine_shader<Type4Byte>(scan_op);
+                scan_downsweep_shader<Type4Byte>(scan_op, is_inclusive);
             }
             else
             {
-                auto shader = ScanByKeyShader().template compile<false>(m_device, m_shared_mem_size, scan_op);
-                ms_exclusive_scan_by_key_map.try_emplace(key, std::move(shader));
-                ms_scan_by_it = ms_exclusive_scan_by_key_map.find(key);
+                visit_tile_state_layout(m_packed_tile_state,
+                                        [&]<bool PACKED>(std::bool_constant<PACKED>)
+                                        {
+                                            scan_tile_state_init_shader<PACKED, Type4Byte>();
+                                            scan_shader<PACKED, Type4Byte>(scan_op, is_inclusive);
+                                        });
             }
         }
-        auto ms_scan_by_key_ptr = reinterpret_cast<ScanByKeyShaderKernel*>(&(*ms_scan_by_it->second));
-        cmdlist << (*ms_scan_by_key_ptr)(tile_states, d_keys_in, d_prev_keys_in, d_values_in, d_values_out, initial_value, num_items)
-                       .dispatch(m_block_size * num_tiles);
     }
 
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_scan_key;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_exclusive_scan_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_inclusive_scan_map;
+    template <NumericT KeyValue, NumericT ValueType, typename ScanOp>
+    void warmup_scan_by_key(ScanOp scan_op)
+    {
+        for(bool is_inclusive : {false, true})
+        {
+            if(is_reduce_then_scan())
+            {
+                scan_by_key_prev_keys_shader<KeyValue, ValueType>();
+                scan_by_key_reduce_tile_shader<KeyValue, ValueType>(scan_op);
+                scan_by_key_spine_shader<KeyValue, ValueType>(scan_op);
+                scan_by_key_downsweep_shader<KeyValue, ValueType>(scan_op, is_inclusive);
+            }
+            else
+            {
+                visit_tile_state_layout(m_packed_tile_state,
+                                        [&]<bool PACKED>(std::bool_constant<PACKED>)
+                                        {
+                                            scan_by_key_tile_state_init_shader<PACKED, KeyValue, ValueType>();
+                                            scan_by_key_shader<PACKED, KeyValue, ValueType>(scan_op, is_inclusive);
+                                        });
+            }
+        }
+    }
 
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_scan_by_key_tile_state_init_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_exclusive_scan_by_key_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_inclusive_scan_by_key_map;
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceScan<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
 };
 }  // namespace luisa::parallel_primitive
\ No newline at end of file
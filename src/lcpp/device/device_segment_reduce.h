@@ -13,6 +13,7 @@
 #include "luisa/core/logging.h"
 #include "luisa/runtime/buffer.h"
 #include <algorithm>
+#include <concepts>
 #include <cstddef>
 #include <cstdint>
 #include <luisa/dsl/sugar.h>
@@ -23,6 +24,7 @@
 #include <lcpp/common/util_type.h>
 #include <lcpp/common/thread_operators.h>
 #include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
 
 
 namespace luisa::parallel_primitive
@@ -39,6 +41,9 @@ class DeviceSegmentReduce : public LuisaModule
     Device m_device;
     bool   m_created = false;
 
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
   public:
     DeviceSegmentReduce()  = default;
     ~DeviceSegmentReduce() = default;
@@ -49,12 +54,13 @@ class DeviceSegmentReduce : public LuisaModule
         int num_elements_per_block = m_block_size * ITEMS_PER_THREAD;
         int extra_space            = num_elements_per_block / m_warp_nums;
         m_shared_mem_size          = (num_elements_per_block + extra_space);
+        m_allocator                = CachingAllocator::shared(device);
+        m_shaders                  = ShaderRegistry::shared(device);
         m_created                  = true;
     }
 
     template <typename Type4Byte, typename ReduceOp>
     void Reduce(CommandList&          cmdlist,
-                Stream&               stream,
                 BufferView<Type4Byte> d_in,
                 BufferView<Type4Byte> d_out,
                 uint                  num_segments,
@@ -65,12 +71,75 @@ class DeviceSegmentReduce : public LuisaModule
     {
         segment_reduce_array_recursive<Type4Byte>(
             cmdlist, d_in, d_out, num_segments, d_begin_offsets, d_end_offsets, reduce_op, initial_value);
-        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <typename Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        // segment reduce needs no scratch, kept for a uniform two-phase interface
+        TempStorageLayout<1> layout{{0u}};
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        Reduce(cmdlist, d_in, d_out, num_segments, d_begin_offsets, d_end_offsets, reduce_op, initial_value);
     }
 
     template <typename Type4Byte, typename ReduceOp>
     void Reduce(CommandList&          cmdlist,
                 Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        Reduce(cmdlist,
+               temp_storage,
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               num_segments,
+               d_begin_offsets,
+               d_end_offsets,
+               reduce_op,
+               initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <typename Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        Reduce(cmdlist, d_in, d_out, num_segments, d_begin_offsets, d_end_offsets, reduce_op, initial_value);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <typename Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&          cmdlist,
                 BufferView<Type4Byte> d_in,
                 BufferView<Type4Byte> d_out,
                 uint                  num_segments,
@@ -80,12 +149,70 @@ class DeviceSegmentReduce : public LuisaModule
     {
         fixed_segment_reduce_array_recursive<Type4Byte>(
             cmdlist, d_in, d_out, num_segments, segment_size, reduce_op, initial_value);
+    }
+
+    template <typename Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                uint                  num_segments,
+                uint                  segment_size,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        TempStorageLayout<1> layout{{0u}};
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        Reduce(cmdlist, d_in, d_out, num_segments, segment_size, reduce_op, initial_value);
+    }
+
+    template <typename Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&          cmdlist,
+                Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                uint                  num_segments,
+                uint                  segment_size,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        Reduce(cmdlist,
+               temp_storage,
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               num_segments,
+               segment_size,
+               reduce_op,
+               initial_value);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <typename Type4Byte, typename ReduceOp>
+    void Reduce(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                uint                  num_segments,
+                uint                  segment_size,
+                ReduceOp              reduce_op,
+                Type4Byte             initial_value)
+    {
+        Reduce(cmdlist, d_in, d_out, num_segments, segment_size, reduce_op, initial_value);
         stream << cmdlist.commit() << synchronize();
     }
 
     template <NumericT Type4Byte>
     void Sum(CommandList&          cmdlist,
-             Stream&               stream,
              BufferView<Type4Byte> d_in,
              BufferView<Type4Byte> d_out,
              uint                  num_segments,
@@ -94,34 +221,111 @@ class DeviceSegmentReduce : public LuisaModule
     {
         Reduce(
             cmdlist,
-            stream,
             d_in,
             d_out,
             num_segments,
             d_begin_offsets,
             d_end_offsets,
-            [](const Var<Type4Byte>& a, const Var<Type4Byte>& b) { return a + b; },
+            SumOp{},
             0);
     }
 
     template <NumericT Type4Byte>
-    void Sum(CommandList& cmdlist, Stream& stream, BufferView<Type4Byte> d_in, BufferView<Type4Byte> d_out, uint num_segments, uint segment_size)
+    void Sum(CommandList&          cmdlist,
+             Stream&               stream,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             BufferView<uint>      d_begin_offsets,
+             BufferView<uint>      d_end_offsets)
+    {
+        Sum(cmdlist, d_in, d_out, num_segments, d_begin_offsets, d_end_offsets);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type4Byte>
+    void Sum(CommandList&          cmdlist,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             uint                  segment_size)
     {
         Reduce(
             cmdlist,
-            stream,
             d_in,
             d_out,
             num_segments,
             segment_size,
-            [](const Var<Type4Byte>& a, const Var<Type4Byte>& b) { return a + b; },
+            SumOp{},
             0);
     }
 
+    template <NumericT Type4Byte>
+    void Sum(CommandList&          cmdlist,
+             Stream&               stream,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             uint                  segment_size)
+    {
+        Sum(cmdlist, d_in, d_out, num_segments, segment_size);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    /**
+     * @brief Mean and variance of every segment in one pass, as WelfordStats (mean, m2, count) per
+     * segment; empty segments report a zero count.
+     */
+    template <std::floating_point Type4Byte>
+    void MeanVariance(CommandList&                        cmdlist,
+                      BufferView<Type4Byte>               d_in,
+                      BufferView<WelfordStats<Type4Byte>> d_out,
+                      uint                                num_segments,
+                      BufferView<uint>                    d_begin_offsets,
+                      BufferView<uint>                    d_end_offsets)
+    {
+        segment_reduce_array_recursive<WelfordStats<Type4Byte>>(
+            cmdlist, d_in, d_out, num_segments, d_begin_offsets, d_end_offsets, WelfordOp{}, WelfordStats<Type4Byte>{});
+    }
+
+    template <std::floating_point Type4Byte>
+    void MeanVariance(CommandList&                        cmdlist,
+                      Stream&                             stream,
+                      BufferView<Type4Byte>               d_in,
+                      BufferView<WelfordStats<Type4Byte>> d_out,
+                      uint                                num_segments,
+                      BufferView<uint>                    d_begin_offsets,
+                      BufferView<uint>                    d_end_offsets)
+    {
+        MeanVariance(cmdlist, d_in, d_out, num_segments, d_begin_offsets, d_end_offsets);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <std::floating_point Type4Byte>
+    void MeanVariance(CommandList&                        cmdlist,
+                      BufferView<Type4Byte>               d_in,
+                      BufferView<WelfordStats<Type4Byte>> d_out,
+                      uint                                num_segments,
+                      uint                                segment_size)
+    {
+        fixed_segment_reduce_array_recursive<WelfordStats<Type4Byte>>(
+            cmdlist, d_in, d_out, num_segments, segment_size, WelfordOp{}, WelfordStats<Type4Byte>{});
+    }
+
+    template <std::floating_point Type4Byte>
+    void MeanVariance(CommandList&                        cmdlist,
+                      Stream&                             stream,
+                      BufferView<Type4Byte>               d_in,
+                      BufferView<WelfordStats<Type4Byte>> d_out,
+                      uint                                num_segments,
+                      uint                                segment_size)
+    {
+        MeanVariance(cmdlist, d_in, d_out, num_segments, segment_size);
+        stream << cmdlist.commit() << synchronize();
+    }
 
     template <NumericT Type4Byte>
     void Min(CommandList&          cmdlist,
-             Stream&               stream,
              BufferView<Type4Byte> d_in,
              BufferView<Type4Byte> d_out,
              uint                  num_segments,
@@ -129,25 +333,52 @@ class DeviceSegmentReduce : public LuisaModule
              BufferView<uint>      d_end_offsets)
     {
         Reduce(cmdlist,
-               stream,
                d_in,
                d_out,
                num_segments,
                d_begin_offsets,
                d_end_offsets,
-               compute::min,
+               MinOp{},
                std::numeric_limits<Type4Byte>::max());
     }
 
     template <NumericT Type4Byte>
-    void Min(CommandList& cmdlist, Stream& stream, BufferView<Type4Byte> d_in, BufferView<Type4Byte> d_out, uint num_segments, uint segment_size)
+    void Min(CommandList&          cmdlist,
+             Stream&               stream,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             BufferView<uint>      d_begin_offsets,
+             BufferView<uint>      d_end_offsets)
+    {
+        Min(cmdlist, d_in, d_out, num_segments, d_begin_offsets, d_end_offsets);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type4Byte>
+    void Min(CommandList&          cmdlist,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             uint                  segment_size)
     {
-        Reduce(cmdlist, stream, d_in, d_out, num_segments, segment_size, compute::min, std::numeric_limits<Type4Byte>::max());
+        Reduce(cmdlist, d_in, d_out, num_segments, segment_size, MinOp{}, std::numeric_limits<Type4Byte>::max());
     }
 
     template <NumericT Type4Byte>
-    void Max(CommandList&          cmdlist,
+    void Min(CommandList&          cmdlist,
              Stream&               stream,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             uint                  segment_size)
+    {
+        Min(cmdlist, d_in, d_out, num_segments, segment_size);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type4Byte>
+    void Max(CommandList&          cmdlist,
              BufferView<Type4Byte> d_in,
              BufferView<Type4Byte> d_out,
              uint                  num_segments,
@@ -155,26 +386,120 @@ class DeviceSegmentReduce : public LuisaModule
              BufferView<uint>      d_end_offsets)
     {
         Reduce(cmdlist,
-               stream,
                d_in,
                d_out,
                num_segments,
                d_begin_offsets,
                d_end_offsets,
-               compute::max,
+               MaxOp{},
+               std::numeric_limits<Type4Byte>::lowest());
+    }
+
+    template <NumericT Type4Byte>
+    void Max(CommandList&          cmdlist,
+             Stream&               stream,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             BufferView<uint>      d_begin_offsets,
+             BufferView<uint>      d_end_offsets)
+    {
+        Max(cmdlist, d_in, d_out, num_segments, d_begin_offsets, d_end_offsets);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT Type4Byte>
+    void Max(CommandList&          cmdlist,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             uint                  segment_size)
+    {
+        Reduce(cmdlist,
+               d_in,
+               d_out,
+               num_segments,
+               segment_size,
+               MaxOp{},
                std::numeric_limits<Type4Byte>::lowest());
     }
 
     template <NumericT Type4Byte>
-    void Max(CommandList& cmdlist, Stream& stream, BufferView<Type4Byte> d_in, BufferView<Type4Byte> d_out, uint num_segments, uint segment_size)
+    void Max(CommandList&          cmdlist,
+             Stream&               stream,
+             BufferView<Type4Byte> d_in,
+             BufferView<Type4Byte> d_out,
+             uint                  num_segments,
+             uint                  segment_size)
+    {
+        Max(cmdlist, d_in, d_out, num_segments, segment_size);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT ValueType>
+    void ArgMax(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets)
     {
-        Reduce(cmdlist, stream, d_in, d_out, num_segments, segment_size, compute::max, std::numeric_limits<Type4Byte>::lowest());
+        auto layout = arg_reduce_temp_storage_layout<ValueType>(num_segments);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        arg_segment_reduce<ValueType>(cmdlist,
+                                      layout,
+                                      temp_storage,
+                                      d_in,
+                                      d_out,
+                                      d_index_out,
+                                      num_segments,
+                                      d_begin_offsets,
+                                      d_end_offsets,
+                                      ArgMaxOp(),
+                                      IndexValuePairT<ValueType>{1, std::numeric_limits<ValueType>::lowest()});
     }
 
+    template <NumericT ValueType>
+    void ArgMax(CommandList&          cmdlist,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets)
+    {
+        size_t temp_storage_bytes = 0;
+        ArgMax(cmdlist,
+               temp_storage_query(),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_segments,
+               d_begin_offsets,
+               d_end_offsets);
+        ArgMax(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_segments,
+               d_begin_offsets,
+               d_end_offsets);
+    }
 
     template <NumericT ValueType>
     void ArgMax(CommandList&          cmdlist,
                 Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
                 BufferView<ValueType> d_in,
                 BufferView<ValueType> d_out,
                 BufferView<uint>      d_index_out,
@@ -182,73 +507,177 @@ class DeviceSegmentReduce : public LuisaModule
                 BufferView<uint>      d_begin_offsets,
                 BufferView<uint>      d_end_offsets)
     {
-        // key value pair reduce
-        Buffer<IndexValuePairT<ValueType>> d_in_kv =
-            m_device.create_buffer<IndexValuePairT<ValueType>>(d_in.size());
-        Buffer<IndexValuePairT<ValueType>> d_out_kv =
-            m_device.create_buffer<IndexValuePairT<ValueType>>(num_segments);
-
-        // construct key value pair
-        arg_construct(cmdlist, d_in, d_in_kv.view(), num_segments);
-
-        Reduce<IndexValuePairT<ValueType>>(cmdlist,
-                                           stream,
-                                           d_in_kv.view(),
-                                           d_out_kv.view(),
-                                           num_segments,
-                                           d_begin_offsets,
-                                           d_end_offsets,
-                                           ArgMaxOp(),
-                                           IndexValuePairT<ValueType>{1, std::numeric_limits<ValueType>::min()});
+        ArgMax(cmdlist,
+               temp_storage,
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_segments,
+               d_begin_offsets,
+               d_end_offsets);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
-        // copy result to d_out and d_index_out
-        arg_assign<ValueType>(cmdlist, d_out_kv.view(), d_begin_offsets, d_index_out, d_out, num_segments);
+    template <NumericT ValueType>
+    void ArgMax(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets)
+    {
+        ArgMax(cmdlist, d_in, d_out, d_index_out, num_segments, d_begin_offsets, d_end_offsets);
         stream << cmdlist.commit() << synchronize();
+    }
 
-        d_in_kv.release();
-        d_out_kv.release();
+    template <NumericT ValueType>
+    void ArgMax(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                uint                  segment_size)
+    {
+        auto layout = arg_reduce_temp_storage_layout<ValueType>(num_segments);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        arg_fixed_segment_reduce<ValueType>(cmdlist,
+                                            layout,
+                                            temp_storage,
+                                            d_in,
+                                            d_out,
+                                            d_index_out,
+                                            num_segments,
+                                            segment_size,
+                                            ArgMaxOp(),
+                                            IndexValuePairT<ValueType>{1, std::numeric_limits<ValueType>::lowest()});
     }
 
+    template <NumericT ValueType>
+    void ArgMax(CommandList&          cmdlist,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                uint                  segment_size)
+    {
+        size_t temp_storage_bytes = 0;
+        ArgMax(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, d_index_out, num_segments, segment_size);
+        ArgMax(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_segments,
+               segment_size);
+    }
 
     template <NumericT ValueType>
     void ArgMax(CommandList&          cmdlist,
                 Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
                 BufferView<ValueType> d_in,
                 BufferView<ValueType> d_out,
                 BufferView<uint>      d_index_out,
                 uint                  num_segments,
                 uint                  segment_size)
     {
-        // key value pair reduce
-        Buffer<IndexValuePairT<ValueType>> d_in_kv =
-            m_device.create_buffer<IndexValuePairT<ValueType>>(d_in.size());
-        Buffer<IndexValuePairT<ValueType>> d_out_kv =
-            m_device.create_buffer<IndexValuePairT<ValueType>>(num_segments);
-
-        // construct key value pair
-        arg_construct(cmdlist, d_in, d_in_kv.view(), num_segments);
-
-        Reduce<IndexValuePairT<ValueType>>(cmdlist,
-                                           stream,
-                                           d_in_kv.view(),
-                                           d_out_kv.view(),
-                                           num_segments,
-                                           segment_size,
-                                           ArgMaxOp(),
-                                           IndexValuePairT<ValueType>{1, std::numeric_limits<ValueType>::min()});
+        ArgMax(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, d_index_out, num_segments, segment_size);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
-        // copy result to d_out and d_index_out
-        arg_fixed_size_assign<ValueType>(cmdlist, d_out_kv.view(), d_index_out, d_out, num_segments, segment_size);
+    template <NumericT ValueType>
+    void ArgMax(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                uint                  segment_size)
+    {
+        ArgMax(cmdlist, d_in, d_out, d_index_out, num_segments, segment_size);
         stream << cmdlist.commit() << synchronize();
+    }
 
-        d_in_kv.release();
-        d_out_kv.release();
+    template <NumericT ValueType>
+    void Argmin(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets)
+    {
+        auto layout = arg_reduce_temp_storage_layout<ValueType>(num_segments);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        arg_segment_reduce<ValueType>(cmdlist,
+                                      layout,
+                                      temp_storage,
+                                      d_in,
+                                      d_out,
+                                      d_index_out,
+                                      num_segments,
+                                      d_begin_offsets,
+                                      d_end_offsets,
+                                      ArgMinOp(),
+                                      IndexValuePairT<ValueType>{1, std::numeric_limits<ValueType>::max()});
     }
 
+    template <NumericT ValueType>
+    void Argmin(CommandList&          cmdlist,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets)
+    {
+        size_t temp_storage_bytes = 0;
+        Argmin(cmdlist,
+               temp_storage_query(),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_segments,
+               d_begin_offsets,
+               d_end_offsets);
+        Argmin(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_segments,
+               d_begin_offsets,
+               d_end_offsets);
+    }
 
     template <NumericT ValueType>
     void Argmin(CommandList&          cmdlist,
                 Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
                 BufferView<ValueType> d_in,
                 BufferView<ValueType> d_out,
                 BufferView<uint>      d_index_out,
@@ -256,33 +685,99 @@ class DeviceSegmentReduce : public LuisaModule
                 BufferView<uint>      d_begin_offsets,
                 BufferView<uint>      d_end_offsets)
     {
-        // key value pair reduce
-        Buffer<IndexValuePairT<ValueType>> d_in_kv =
-            m_device.create_buffer<IndexValuePairT<ValueType>>(d_in.size());
-        Buffer<IndexValuePairT<ValueType>> d_out_kv =
-            m_device.create_buffer<IndexValuePairT<ValueType>>(num_segments);
-
-        // construct key value pair
-        arg_construct(cmdlist, d_in, d_in_kv.view(), num_segments);
-
-        Reduce<IndexValuePairT<ValueType>>(cmdlist,
-                                           stream,
-                                           d_in_kv.view(),
-                                           d_out_kv.view(),
-                                           num_segments,
-                                           d_begin_offsets,
-                                           d_end_offsets,
-                                           ArgMinOp(),
-                                           IndexValuePairT<ValueType>{1, std::numeric_limits<ValueType>::max()});
+        Argmin(cmdlist,
+               temp_storage,
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_segments,
+               d_begin_offsets,
+               d_end_offsets);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
-        // copy result to d_out and d_index_out
-        arg_assign<ValueType>(cmdlist, d_out_kv.view(), d_begin_offsets, d_index_out, d_out, num_segments);
+    template <NumericT ValueType>
+    void Argmin(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                BufferView<uint>      d_begin_offsets,
+                BufferView<uint>      d_end_offsets)
+    {
+        Argmin(cmdlist, d_in, d_out, d_index_out, num_segments, d_begin_offsets, d_end_offsets);
         stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT ValueType>
+    void ArgMin(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                uint                  segment_size)
+    {
+        auto layout = arg_reduce_temp_storage_layout<ValueType>(num_segments);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        arg_fixed_segment_reduce<ValueType>(cmdlist,
+                                            layout,
+                                            temp_storage,
+                                            d_in,
+                                            d_out,
+                                            d_index_out,
+                                            num_segments,
+                                            segment_size,
+                                            ArgMinOp(),
+                                            IndexValuePairT<ValueType>{1, std::numeric_limits<ValueType>::max()});
+    }
 
-        d_in_kv.release();
-        d_out_kv.release();
+    template <NumericT ValueType>
+    void ArgMin(CommandList&          cmdlist,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                uint                  segment_size)
+    {
+        size_t temp_storage_bytes = 0;
+        ArgMin(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, d_index_out, num_segments, segment_size);
+        ArgMin(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_index_out,
+               num_segments,
+               segment_size);
     }
 
+    template <NumericT ValueType>
+    void ArgMin(CommandList&          cmdlist,
+                Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<ValueType> d_in,
+                BufferView<ValueType> d_out,
+                BufferView<uint>      d_index_out,
+                uint                  num_segments,
+                uint                  segment_size)
+    {
+        ArgMin(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, d_index_out, num_segments, segment_size);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
 
     template <NumericT ValueType>
     void ArgMin(CommandList&          cmdlist,
@@ -293,37 +788,89 @@ class DeviceSegmentReduce : public LuisaModule
                 uint                  num_segments,
                 uint                  segment_size)
     {
-        // key value pair reduce
-        Buffer<IndexValuePairT<ValueType>> d_in_kv =
-            m_device.create_buffer<IndexValuePairT<ValueType>>(d_in.size());
-        Buffer<IndexValuePairT<ValueType>> d_out_kv =
-            m_device.create_buffer<IndexValuePairT<ValueType>>(num_segments);
+        ArgMin(cmdlist, d_in, d_out, d_index_out, num_segments, segment_size);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+
+    /**
+     * @brief Compiles ahead of time the variable and fixed size segment reduce shaders for these
+     * operators, e.g. Warmup<float>(SumOp{}, MaxOp{}). With the persistent shader cache enabled
+     * (shader_cache_config()) the binaries are written to disk and reloaded by later processes.
+     */
+    template <typename Type4Byte, typename... ReduceOps>
+    void Warmup(ReduceOps... reduce_ops)
+    {
+        ((segment_reduce_shader<Type4Byte>(reduce_ops), fixed_segment_reduce_shader<Type4Byte>(reduce_ops)), ...);
+    }
+
+  private:
+    template <NumericT ValueType>
+    TempStorageLayout<1> arg_reduce_temp_storage_layout(uint num_segments)
+    {
+        using KeyValueT = IndexValuePairT<ValueType>;
+        // the pairs are built while loading, only the reduced pairs are kept
+        return TempStorageLayout<1>{{num_segments * sizeof(KeyValueT)}};
+    }
 
-        // construct key value pair
-        arg_construct(cmdlist, d_in, d_in_kv.view(), num_segments);
+    template <NumericT ValueType, typename ReduceOp>
+    void arg_segment_reduce(CommandList&                cmdlist,
+                            const TempStorageLayout<1>& layout,
+                            ByteBufferView              temp_storage,
+                            BufferView<ValueType>       d_in,
+                            BufferView<ValueType>       d_out,
+                            BufferView<uint>            d_index_out,
+                            uint                        num_segments,
+                            BufferView<uint>            d_begin_offsets,
+                            BufferView<uint>            d_end_offsets,
+                            ReduceOp                    reduce_op,
+                            IndexValuePairT<ValueType>  init)
+    {
+        using KeyValueT = IndexValuePairT<ValueType>;
+        auto d_out_kv   = layout.get<KeyValueT>(temp_storage, 0);
 
-        Reduce<IndexValuePairT<ValueType>>(cmdlist,
-                                           stream,
-                                           d_in_kv.view(),
-                                           d_out_kv.view(),
-                                           num_segments,
-                                           segment_size,
-                                           ArgMinOp(),
-                                           IndexValuePairT<ValueType>{1, std::numeric_limits<ValueType>::max()});
+        // queue both compiles before the first dispatch waits on one
+        arg_segment_reduce_shader<ValueType>(reduce_op);
+        arg_assign_shader<ValueType>();
 
-        // copy result to d_out and d_index_out
-        arg_fixed_size_assign<ValueType>(cmdlist, d_out_kv.view(), d_index_out, d_out, num_segments, segment_size);
-        stream << cmdlist.commit() << synchronize();
+        // key value pair reduce, the values are paired with their index on load
+        segment_reduce_array_recursive<KeyValueT>(
+            cmdlist, d_in, d_out_kv, num_segments, d_begin_offsets, d_end_offsets, reduce_op, init);
 
-        d_in_kv.release();
-        d_out_kv.release();
+        // copy result to d_out and d_index_out
+        arg_assign<ValueType>(cmdlist, d_out_kv, d_begin_offsets, d_index_out, d_out, num_segments);
     }
 
+    template <NumericT ValueType, typename ReduceOp>
+    void arg_fixed_segment_reduce(CommandList&                cmdlist,
+                                  const TempStorageLayout<1>& layout,
+                                  ByteBufferView              temp_storage,
+                                  BufferView<ValueType>       d_in,
+                                  BufferView<ValueType>       d_out,
+                                  BufferView<uint>            d_index_out,
+                                  uint                        num_segments,
+                                  uint                        segment_size,
+                                  ReduceOp                    reduce_op,
+                                  IndexValuePairT<ValueType>  init)
+    {
+        using KeyValueT = IndexValuePairT<ValueType>;
+        auto d_out_kv   = layout.get<KeyValueT>(temp_storage, 0);
 
-  private:
-    template <typename Type, typename ReduceOp>
+        // queue both compiles before the first dispatch waits on one
+        arg_fixed_segment_reduce_shader<ValueType>(reduce_op);
+        arg_fixed_size_assign_shader<ValueType>();
+
+        // key value pair reduce, the values are paired with their index on load
+        fixed_segment_reduce_array_recursive<KeyValueT>(
+            cmdlist, d_in, d_out_kv, num_segments, segment_size, reduce_op, init);
+
+        // copy result to d_out and d_index_out
+        arg_fixed_size_assign<ValueType>(cmdlist, d_out_kv, d_index_out, d_out, num_segments, segment_size);
+    }
+
+    template <typename Type, typename ReduceOp, typename InputT>
     void segment_reduce_array_recursive(luisa::compute::CommandList& cmdlist,
-                                        BufferView<Type>             arr_in,
+                                        BufferView<InputT>           arr_in,
                                         BufferView<Type>             arr_out,
                                         size_t                       num_segments,
                                         BufferView<uint>             d_begin_offsets,
@@ -331,25 +878,24 @@ class DeviceSegmentReduce : public LuisaModule
                                         ReduceOp                     reduce_op,
                                         Type                         initial_value)
     {
-        using SegmentReduce = details::SegmentReduceModule<Type, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD>;
-        using SegmentReduceKernel = SegmentReduce::SegmentReduceKernel;
-
-        auto key                  = get_type_and_op_desc<Type>(reduce_op);
-        auto ms_segment_reduce_it = ms_segment_reduce_map.find(key);
-        if(ms_segment_reduce_it == ms_segment_reduce_map.end())
+        auto ms_segment_reduce_ptr = [&]
         {
-            auto shader = SegmentReduce().compile(m_device, m_shared_mem_size, reduce_op);
-            ms_segment_reduce_map.try_emplace(key, std::move(shader));
-            ms_segment_reduce_it = ms_segment_reduce_map.find(key);
-        }
-        auto ms_segment_reduce_ptr = reinterpret_cast<SegmentReduceKernel*>(&(*ms_segment_reduce_it->second));
+            if constexpr(KeyValuePairType<Type> && !std::is_same_v<InputT, Type>)
+            {
+                return arg_segment_reduce_shader<InputT>(reduce_op);
+            }
+            else
+            {
+                return segment_reduce_shader<Type, InputT>(reduce_op);
+            }
+        }();
         cmdlist << (*ms_segment_reduce_ptr)(arr_in, arr_out, d_begin_offsets, d_end_offsets, num_segments, initial_value)
                        .dispatch(num_segments * m_block_size);
     }
 
-    template <typename Type4Byte, typename ReduceOp>
+    template <typename Type4Byte, typename ReduceOp, typename InputT>
     void fixed_segment_reduce_array_recursive(luisa::compute::CommandList& cmdlist,
-                                              BufferView<Type4Byte>        arr_in,
+                                              BufferView<InputT>           arr_in,
                                               BufferView<Type4Byte>        arr_out,
                                               uint                         num_segments,
                                               uint                         segment_size,
@@ -358,7 +904,6 @@ class DeviceSegmentReduce : public LuisaModule
     {
 
         using SegmentReduce = details::SegmentReduceModule<Type4Byte, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD>;
-        using FixedSizeSegmentReduceKernel = SegmentReduce::FixedSizeSegmentReduceKernel;
 
         uint segment_per_block = 1;
         if(segment_size <= SegmentReduce::small_items_per_tile)
@@ -369,16 +914,17 @@ class DeviceSegmentReduce : public LuisaModule
         const auto num_segments_per_invocation = static_cast<uint>(std::numeric_limits<int32_t>::max());
         const auto num_invocations = ceil_div(num_segments, num_segments_per_invocation);
 
-        auto key                             = get_type_and_op_desc<Type4Byte>(reduce_op);
-        auto ms_fixed_size_segment_reduce_it = ms_fixed_segment_reduce_map.find(key);
-        if(ms_fixed_size_segment_reduce_it == ms_fixed_segment_reduce_map.end())
+        auto ms_fixed_size_segment_reduce_ptr = [&]
         {
-            auto shader = SegmentReduce().compile_fixed_size(m_device, m_shared_mem_size, reduce_op);
-            ms_fixed_segment_reduce_map.try_emplace(key, std::move(shader));
-            ms_fixed_size_segment_reduce_it = ms_fixed_segment_reduce_map.find(key);
-        }
-        auto ms_fixed_size_segment_reduce_ptr =
-            reinterpret_cast<FixedSizeSegmentReduceKernel*>(&(*ms_fixed_size_segment_reduce_it->second));
+            if constexpr(KeyValuePairType<Type4Byte> && !std::is_same_v<InputT, Type4Byte>)
+            {
+                return arg_fixed_segment_reduce_shader<InputT>(reduce_op);
+            }
+            else
+            {
+                return fixed_segment_reduce_shader<Type4Byte, InputT>(reduce_op);
+            }
+        }();
         for(auto invocation_index = 0u; invocation_index < num_invocations; invocation_index++)
         {
             const auto current_seg_offset = invocation_index * num_segments_per_invocation;
@@ -392,28 +938,6 @@ class DeviceSegmentReduce : public LuisaModule
     }
 
 
-    template <NumericT Type4Byte>
-    void arg_construct(CommandList&                           cmdlist,
-                       BufferView<Type4Byte>                  d_in,
-                       BufferView<IndexValuePairT<Type4Byte>> d_kv_out,
-                       uint                                   num_segments)
-    {
-        using ArgReduce          = details::ArgSegmentReduceModule<Type4Byte, BLOCK_SIZE>;
-        using ArgConstructShader = ArgReduce::ArgConstructShaderT;
-        auto key = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
-        auto ms_arg_construct_it = ms_arg_construct_map.find(key);
-        if(ms_arg_construct_it == ms_arg_construct_map.end())
-        {
-            auto shader = ArgReduce().compile_arg_construct_shader(m_device);
-            ms_arg_construct_map.try_emplace(key, std::move(shader));
-            ms_arg_construct_it = ms_arg_construct_map.find(key);
-        }
-        auto ms_arg_construct_ptr = reinterpret_cast<ArgConstructShader*>(&(*ms_arg_construct_it->second));
-
-        auto num_tiles = ceil_div(num_segments, m_block_size);
-        cmdlist << (*ms_arg_construct_ptr)(d_in, d_kv_out).dispatch(d_in.size());
-    }
-
     template <NumericT Type4Byte>
     void arg_assign(CommandList&                           cmdlist,
                     BufferView<IndexValuePairT<Type4Byte>> d_kv_in,
@@ -422,17 +946,7 @@ class DeviceSegmentReduce : public LuisaModule
                     BufferView<Type4Byte>                  d_value_out,
                     uint                                   num_segments)
     {
-        using ArgReduce       = details::ArgSegmentReduceModule<Type4Byte, WARP_NUMS>;
-        using ArgAssignShader = ArgReduce::ArgAssignShaderT;
-        auto key              = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
-        auto ms_arg_assign_it = ms_arg_assign_map.find(key);
-        if(ms_arg_assign_it == ms_arg_assign_map.end())
-        {
-            auto shader = ArgReduce().compile_arg_assign_shader(m_device);
-            ms_arg_assign_map.try_emplace(key, std::move(shader));
-            ms_arg_assign_it = ms_arg_assign_map.find(key);
-        }
-        auto ms_arg_assign_ptr = reinterpret_cast<ArgAssignShader*>(&(*ms_arg_assign_it->second));
+        auto ms_arg_assign_ptr = arg_assign_shader<Type4Byte>();
         cmdlist << (*ms_arg_assign_ptr)(d_kv_in, d_begin_offset, d_index_out, d_value_out).dispatch(num_segments * WARP_NUMS);
     }
 
@@ -444,29 +958,115 @@ class DeviceSegmentReduce : public LuisaModule
                                uint                                   num_segments,
                                uint                                   segment_size)
     {
-        using ArgReduce       = details::ArgSegmentReduceModule<Type4Byte, WARP_NUMS>;
-        using ArgAssignShader = ArgReduce::ArgFixedSizeAssignShaderT;
-
         const auto num_segments_per_invocation = static_cast<uint>(std::numeric_limits<int32_t>::max());
         const auto num_invocations = ceil_div(num_segments, num_segments_per_invocation);
 
-        auto key              = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
-        auto ms_arg_assign_it = ms_arg_assign_map.find(key);
-        if(ms_arg_assign_it == ms_arg_assign_map.end())
-        {
-            auto shader = ArgReduce().compile_arg_assign_shader(m_device);
-            ms_arg_assign_map.try_emplace(key, std::move(shader));
-            ms_arg_assign_it = ms_arg_assign_map.find(key);
-        }
-        auto ms_arg_assign_ptr = reinterpret_cast<ArgAssignShader*>(&(*ms_arg_assign_it->second));
+        auto ms_arg_assign_ptr = arg_fixed_size_assign_shader<Type4Byte>();
         cmdlist << (*ms_arg_assign_ptr)(d_kv_in, segment_size, d_index_out, d_value_out).dispatch(num_segments * WARP_NUMS);
     }
 
-  private:
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_segment_reduce_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_fixed_segment_reduce_map;
+    // an InputT other than Type is lifted into Type while loading (the WelfordStats of MeanVariance)
+    template <typename Type, typename InputT = Type, typename ReduceOp>
+    auto segment_reduce_shader(ReduceOp reduce_op)
+    {
+        using SegmentReduce = details::SegmentReduceModule<Type, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, InputT>;
+        using SegmentReduceKernel = SegmentReduce::SegmentReduceKernel;
+
+        constexpr auto key = shader_key<"segment_reduce", DeviceSegmentReduce, SegmentReduce, ReduceOp>();
+        return m_shaders->get_or_compile<SegmentReduceKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type>(reduce_op);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, reduce_op]() mutable
+            { return SegmentReduce().compile(device, shared_mem_size, reduce_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <typename Type4Byte, typename InputT = Type4Byte, typename ReduceOp>
+    auto fixed_segment_reduce_shader(ReduceOp reduce_op)
+    {
+        using SegmentReduce = details::SegmentReduceModule<Type4Byte, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, InputT>;
+        using FixedSizeSegmentReduceKernel = SegmentReduce::FixedSizeSegmentReduceKernel;
+
+        constexpr auto key = shader_key<"fixed_segment_reduce", DeviceSegmentReduce, SegmentReduce, ReduceOp>();
+        return m_shaders->get_or_compile<FixedSizeSegmentReduceKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(reduce_op);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, reduce_op]() mutable
+            { return SegmentReduce().compile_fixed_size(device, shared_mem_size, reduce_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp>
+    auto arg_segment_reduce_shader(ReduceOp reduce_op)
+    {
+        using SegmentReduce =
+            details::SegmentReduceModule<IndexValuePairT<Type4Byte>, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, Type4Byte>;
+        using SegmentReduceKernel = SegmentReduce::SegmentReduceKernel;
+
+        constexpr auto key = shader_key<"arg_segment_reduce", DeviceSegmentReduce, SegmentReduce, ReduceOp>();
+        return m_shaders->get_or_compile<SegmentReduceKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(reduce_op);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, reduce_op]() mutable
+            { return SegmentReduce().compile(device, shared_mem_size, reduce_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type4Byte, typename ReduceOp>
+    auto arg_fixed_segment_reduce_shader(ReduceOp reduce_op)
+    {
+        using SegmentReduce =
+            details::SegmentReduceModule<IndexValuePairT<Type4Byte>, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, Type4Byte>;
+        using FixedSizeSegmentReduceKernel = SegmentReduce::FixedSizeSegmentReduceKernel;
+
+        constexpr auto key = shader_key<"arg_fixed_segment_reduce", DeviceSegmentReduce, SegmentReduce, ReduceOp>();
+        return m_shaders->get_or_compile<FixedSizeSegmentReduceKernel>(key, [&]
+        {
+            auto desc = get_type_and_op_desc<Type4Byte>(reduce_op);
+            auto compile = [device = m_device, shared_mem_size = m_shared_mem_size, reduce_op]() mutable
+            { return SegmentReduce().compile_fixed_size(device, shared_mem_size, reduce_op); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type4Byte>
+    auto arg_assign_shader()
+    {
+        using ArgReduce       = details::ArgSegmentReduceModule<Type4Byte, WARP_NUMS>;
+        using ArgAssignShader = ArgReduce::ArgAssignShaderT;
+
+        constexpr auto key = shader_key<"arg_assign", DeviceSegmentReduce, ArgReduce>();
+        return m_shaders->get_or_compile<ArgAssignShader>(key, [&]
+        {
+            auto desc = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
+            auto compile = [device = m_device]() mutable
+            { return ArgReduce().compile_arg_assign_shader(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <NumericT Type4Byte>
+    auto arg_fixed_size_assign_shader()
+    {
+        using ArgReduce       = details::ArgSegmentReduceModule<Type4Byte, WARP_NUMS>;
+        using ArgAssignShader = ArgReduce::ArgFixedSizeAssignShaderT;
 
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_arg_construct_map;
-    luisa::unordered_map<luisa::string, luisa::shared_ptr<luisa::compute::Resource>> ms_arg_assign_map;
+        constexpr auto key = shader_key<"arg_fixed_size_assign", DeviceSegmentReduce, ArgReduce>();
+        return m_shaders->get_or_compile<ArgAssignShader>(key, [&]
+        {
+            auto desc = luisa::string{luisa::compute::Type::of<Type4Byte>()->description()};
+            auto compile = [device = m_device]() mutable
+            { return ArgReduce().compile_arg_fixed_size_assign_shader(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceSegmentReduce<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
 };
 }  // namespace luisa::parallel_primitive
\ No newline at end of file
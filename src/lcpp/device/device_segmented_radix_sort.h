@@ -0,0 +1,396 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 22:48:02
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 22:48:02
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <luisa/core/basic_traits.h>
+#include <luisa/ast/type.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/byte_buffer.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/memory.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/var.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/agent/policy.h>
+#include <lcpp/device/details/segmented_radix_sort.h>
+
+namespace luisa::parallel_primitive
+{
+
+using namespace luisa::compute;
+
+/**
+ * @brief Ascending radix sort of many independent segments [d_begin_offsets[i], d_end_offsets[i]) in one call.
+ * Every segment gets one block: segments of at most one tile are sorted in registers and shared memory with
+ * BlockRadixRankMatchEarlyCounts in a single dispatch, longer ones take one dispatch per digit in which their
+ * block walks the segment tile by tile. The sort is stable, items outside every segment are left untouched.
+ */
+template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+class DeviceSegmentedRadixSort : public LuisaModule
+{
+  private:
+    uint m_block_size = BLOCK_SIZE;
+    uint m_warp_nums  = WARP_NUMS;
+
+    Device m_device;
+    bool   m_created = false;
+
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
+  public:
+    DeviceSegmentedRadixSort()  = default;
+    ~DeviceSegmentedRadixSort() = default;
+
+    void create(Device& device)
+    {
+        m_device    = device;
+        m_allocator = CachingAllocator::shared(device);
+        m_shaders   = ShaderRegistry::shared(device);
+        m_created   = true;
+    }
+
+    // compiles ahead of time, Warmup<uint>() for SortKeys and Warmup<uint, float>() for SortPairs
+    template <NumericT KeyType>
+    void Warmup()
+    {
+        segmented_sort_small_shader<true, KeyType, KeyType>();
+        segmented_sort_large_shader<true, KeyType, KeyType>();
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void Warmup()
+    {
+        segmented_sort_small_shader<false, KeyType, ValueType>();
+        segmented_sort_large_shader<false, KeyType, ValueType>();
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairs(CommandList&          cmdlist,
+                   ByteBufferView        temp_storage,
+                   size_t&               temp_storage_bytes,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   uint                  num_items,
+                   uint                  num_segments,
+                   BufferView<uint>      d_begin_offsets,
+                   BufferView<uint>      d_end_offsets)
+    {
+        segmented_radix_sort<false>(cmdlist,
+                                    temp_storage,
+                                    temp_storage_bytes,
+                                    d_keys_in,
+                                    d_keys_out,
+                                    d_values_in,
+                                    d_values_out,
+                                    num_items,
+                                    num_segments,
+                                    d_begin_offsets,
+                                    d_end_offsets);
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairs(CommandList&          cmdlist,
+                   Stream&               stream,
+                   ByteBufferView        temp_storage,
+                   size_t&               temp_storage_bytes,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   uint                  num_items,
+                   uint                  num_segments,
+                   BufferView<uint>      d_begin_offsets,
+                   BufferView<uint>      d_end_offsets)
+    {
+        SortPairs(cmdlist,
+                  temp_storage,
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items,
+                  num_segments,
+                  d_begin_offsets,
+                  d_end_offsets);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairs(CommandList&          cmdlist,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   uint                  num_items,
+                   uint                  num_segments,
+                   BufferView<uint>      d_begin_offsets,
+                   BufferView<uint>      d_end_offsets)
+    {
+        size_t temp_storage_bytes = 0;
+        SortPairs(cmdlist,
+                  temp_storage_query(),
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items,
+                  num_segments,
+                  d_begin_offsets,
+                  d_end_offsets);
+        SortPairs(cmdlist,
+                  m_allocator->allocate(cmdlist, temp_storage_bytes),
+                  temp_storage_bytes,
+                  d_keys_in,
+                  d_keys_out,
+                  d_values_in,
+                  d_values_out,
+                  num_items,
+                  num_segments,
+                  d_begin_offsets,
+                  d_end_offsets);
+    }
+
+    template <NumericT KeyType, NumericT ValueType>
+    void SortPairs(CommandList&          cmdlist,
+                   Stream&               stream,
+                   BufferView<KeyType>   d_keys_in,
+                   BufferView<KeyType>   d_keys_out,
+                   BufferView<ValueType> d_values_in,
+                   BufferView<ValueType> d_values_out,
+                   uint                  num_items,
+                   uint                  num_segments,
+                   BufferView<uint>      d_begin_offsets,
+                   BufferView<uint>      d_end_offsets)
+    {
+        SortPairs(cmdlist, d_keys_in, d_keys_out, d_values_in, d_values_out, num_items, num_segments, d_begin_offsets, d_end_offsets);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    template <NumericT KeyType>
+    void SortKeys(CommandList&        cmdlist,
+                  ByteBufferView      temp_storage,
+                  size_t&             temp_storage_bytes,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  uint                num_items,
+                  uint                num_segments,
+                  BufferView<uint>    d_begin_offsets,
+                  BufferView<uint>    d_end_offsets)
+    {
+        // keys only, the values arguments are unused and follow the keys
+        segmented_radix_sort<true>(cmdlist,
+                                   temp_storage,
+                                   temp_storage_bytes,
+                                   d_keys_in,
+                                   d_keys_out,
+                                   d_keys_in,
+                                   d_keys_out,
+                                   num_items,
+                                   num_segments,
+                                   d_begin_offsets,
+                                   d_end_offsets);
+    }
+
+    template <NumericT KeyType>
+    void SortKeys(CommandList&        cmdlist,
+                  Stream&             stream,
+                  ByteBufferView      temp_storage,
+                  size_t&             temp_storage_bytes,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  uint                num_items,
+                  uint                num_segments,
+                  BufferView<uint>    d_begin_offsets,
+                  BufferView<uint>    d_end_offsets)
+    {
+        SortKeys(cmdlist, temp_storage, temp_storage_bytes, d_keys_in, d_keys_out, num_items, num_segments, d_begin_offsets, d_end_offsets);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT KeyType>
+    void SortKeys(CommandList&        cmdlist,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  uint                num_items,
+                  uint                num_segments,
+                  BufferView<uint>    d_begin_offsets,
+                  BufferView<uint>    d_end_offsets)
+    {
+        size_t temp_storage_bytes = 0;
+        SortKeys(cmdlist, temp_storage_query(), temp_storage_bytes, d_keys_in, d_keys_out, num_items, num_segments, d_begin_offsets, d_end_offsets);
+        SortKeys(cmdlist,
+                 m_allocator->allocate(cmdlist, temp_storage_bytes),
+                 temp_storage_bytes,
+                 d_keys_in,
+                 d_keys_out,
+                 num_items,
+                 num_segments,
+                 d_begin_offsets,
+                 d_end_offsets);
+    }
+
+    template <NumericT KeyType>
+    void SortKeys(CommandList&        cmdlist,
+                  Stream&             stream,
+                  BufferView<KeyType> d_keys_in,
+                  BufferView<KeyType> d_keys_out,
+                  uint                num_items,
+                  uint                num_segments,
+                  BufferView<uint>    d_begin_offsets,
+                  BufferView<uint>    d_end_offsets)
+    {
+        SortKeys(cmdlist, d_keys_in, d_keys_out, num_items, num_segments, d_begin_offsets, d_end_offsets);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+  private:
+    template <bool KEYS_ONLY, NumericT KeyType, typename ValueType>
+    using SegmentedRadixSortShader =
+        details::SegmentedRadixSortModule<KeyType, ValueType, KEYS_ONLY, OneSweepSmallKeyTunedPolicy<KeyType>::ONESWEEP_RADIX_BITS, BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD>;
+
+    template <bool KEYS_ONLY, NumericT KeyType, typename ValueType>
+    void segmented_radix_sort(CommandList&          cmdlist,
+                              ByteBufferView        temp_storage,
+                              size_t&               temp_storage_bytes,
+                              BufferView<KeyType>   d_keys_in,
+                              BufferView<KeyType>   d_keys_out,
+                              BufferView<ValueType> d_values_in,
+                              BufferView<ValueType> d_values_out,
+                              uint                  num_items,
+                              uint                  num_segments,
+                              BufferView<uint>      d_begin_offsets,
+                              BufferView<uint>      d_end_offsets)
+    {
+        using SegmentedSort = SegmentedRadixSortShader<KEYS_ONLY, KeyType, ValueType>;
+
+        // a segment can only outgrow a tile when the whole input does
+        bool has_large_segments = num_items > SegmentedSort::TILE_ITEMS;
+        bool needs_ping_pong    = has_large_segments && SegmentedSort::NUM_PASSES > 1;
+
+        TempStorageLayout<2> layout{{
+            // ping-pong keys of the oversized segments
+            needs_ping_pong ? num_items * sizeof(KeyType) : 0u,
+            // ping-pong values of the oversized segments
+            (!KEYS_ONLY && needs_ping_pong) ? num_items * sizeof(ValueType) : 0u,
+        }};
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        if(num_segments == 0)
+        {
+            return;
+        }
+
+        auto ms_segmented_sort_small_ptr = segmented_sort_small_shader<KEYS_ONLY, KeyType, ValueType>();
+        cmdlist << (*ms_segmented_sort_small_ptr)(ByteBufferView{d_keys_in},
+                                                  ByteBufferView{d_keys_out},
+                                                  d_values_in,
+                                                  d_values_out,
+                                                  d_begin_offsets,
+                                                  d_end_offsets)
+                       .dispatch(num_segments * m_block_size);
+        if(!has_large_segments)
+        {
+            return;
+        }
+
+        auto d_keys_tmp   = layout.get<KeyType>(temp_storage, 0);
+        auto d_values_tmp = layout.get<ValueType>(temp_storage, 1);
+        if constexpr(KEYS_ONLY)
+        {
+            d_values_tmp = d_keys_tmp;
+        }
+
+        // one dispatch per digit, the passes alternate so that the last one writes d_keys_out
+        auto ms_segmented_sort_large_ptr = segmented_sort_large_shader<KEYS_ONLY, KeyType, ValueType>();
+        BufferView<KeyType>   d_keys_src   = d_keys_in;
+        BufferView<ValueType> d_values_src = d_values_in;
+        for(uint pass = 0; pass < SegmentedSort::NUM_PASSES; ++pass)
+        {
+            bool                  to_out       = (SegmentedSort::NUM_PASSES - 1 - pass) % 2 == 0;
+            BufferView<KeyType>   d_keys_dst   = to_out ? d_keys_out : d_keys_tmp;
+            BufferView<ValueType> d_values_dst = to_out ? d_values_out : d_values_tmp;
+
+            uint current_bit = pass * SegmentedSort::PASS_BITS;
+            uint num_bits    = std::min(SegmentedSort::END_BIT - current_bit, SegmentedSort::PASS_BITS);
+            cmdlist << (*ms_segmented_sort_large_ptr)(ByteBufferView{d_keys_src},
+                                                      ByteBufferView{d_keys_dst},
+                                                      d_values_src,
+                                                      d_values_dst,
+                                                      d_begin_offsets,
+                                                      d_end_offsets,
+                                                      current_bit,
+                                                      num_bits)
+                           .dispatch(num_segments * m_block_size);
+            d_keys_src   = d_keys_dst;
+            d_values_src = d_values_dst;
+        }
+    }
+
+    template <bool KEYS_ONLY, NumericT KeyType, typename ValueType>
+    luisa::string segmented_radix_sort_key() const
+    {
+        return KEYS_ONLY ? luisa::string{luisa::compute::Type::of<KeyType>()->description()} :
+                           get_type_and_op_desc<KeyType, ValueType>();
+    }
+
+    template <bool KEYS_ONLY, NumericT KeyType, typename ValueType>
+    auto segmented_sort_small_shader()
+    {
+        using SegmentedSort            = SegmentedRadixSortShader<KEYS_ONLY, KeyType, ValueType>;
+        using SegmentedSortSmallKernel = SegmentedSort::SegmentedSortSmallKernel;
+
+        constexpr auto key = shader_key<"segmented_sort_small", DeviceSegmentedRadixSort, SegmentedSort>();
+        return m_shaders->get_or_compile<SegmentedSortSmallKernel>(key, [&]
+        {
+            auto desc    = segmented_radix_sort_key<KEYS_ONLY, KeyType, ValueType>();
+            auto compile = [device = m_device]() mutable { return SegmentedSort().compile_small(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    template <bool KEYS_ONLY, NumericT KeyType, typename ValueType>
+    auto segmented_sort_large_shader()
+    {
+        using SegmentedSort            = SegmentedRadixSortShader<KEYS_ONLY, KeyType, ValueType>;
+        using SegmentedSortLargeKernel = SegmentedSort::SegmentedSortLargeKernel;
+
+        constexpr auto key = shader_key<"segmented_sort_large", DeviceSegmentedRadixSort, SegmentedSort>();
+        return m_shaders->get_or_compile<SegmentedSortLargeKernel>(key, [&]
+        {
+            auto desc    = segmented_radix_sort_key<KEYS_ONLY, KeyType, ValueType>();
+            auto compile = [device = m_device]() mutable { return SegmentedSort().compile_large(device); };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceSegmentedRadixSort<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
+};
+}  // namespace luisa::parallel_primitive
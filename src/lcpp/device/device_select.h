@@ -0,0 +1,395 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 18:41:09
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 18:41:09
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <luisa/core/basic_traits.h>
+#include <luisa/ast/type.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/memory.h>
+#include <luisa/dsl/builtin.h>
+#include <luisa/dsl/resource.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/dsl/var.h>
+#include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
+#include <lcpp/common/type_trait.h>
+#include <lcpp/common/util_type.h>
+#include <lcpp/common/thread_operators.h>
+#include <lcpp/common/utils.h>
+#include <lcpp/device/details/select.h>
+
+namespace luisa::parallel_primitive
+{
+
+using namespace luisa::compute;
+
+/**
+ * @brief Stream compaction in one pass: every tile counts its selected items, finds its output
+ * offset by decoupled look-back and scatters, the last tile writes d_num_selected_out.
+ */
+template <size_t BLOCK_SIZE = details::BLOCK_SIZE, size_t WARP_NUMS = details::WARP_SIZE, size_t ITEMS_PER_THREAD = details::ITEMS_PER_THREAD>
+class DeviceSelect : public LuisaModule
+{
+  private:
+    uint m_block_size = BLOCK_SIZE;
+    uint m_warp_nums  = WARP_NUMS;
+
+    uint   m_shared_mem_size = 0;
+    Device m_device;
+    bool   m_created = false;
+
+    LookBackDelayPolicy m_look_back_delay   = LookBackDelayPolicy::NO_DELAY;
+    bool                m_packed_tile_state = false;
+
+    S<CachingAllocator> m_allocator;
+    S<ShaderRegistry>   m_shaders;
+
+  public:
+    DeviceSelect()  = default;
+    ~DeviceSelect() = default;
+
+    void create(Device& device)
+    {
+        m_device                   = device;
+        int num_elements_per_block = m_block_size * ITEMS_PER_THREAD;
+        int extra_space            = num_elements_per_block / m_warp_nums;
+        m_shared_mem_size          = (num_elements_per_block + extra_space);
+        m_allocator                = CachingAllocator::shared(device);
+        m_shaders                  = ShaderRegistry::shared(device);
+        m_packed_tile_state        = packed_tile_state_supported(device);
+        m_created                  = true;
+    }
+
+    // compiles ahead of time Flagged (uint flags), Unique and If for these select operators
+    template <NumericT Type4Byte, typename... SelectOps>
+    void Warmup(SelectOps... select_ops)
+    {
+        visit_tile_state_layout(m_packed_tile_state,
+                                [&]<bool PACKED>(std::bool_constant<PACKED>)
+                                {
+                                    select_tile_state_init_shader<PACKED>();
+                                    select_shader<PACKED, details::SelectMode::FLAGGED, Type4Byte, uint>(IdentityOp());
+                                    select_shader<PACKED, details::SelectMode::UNIQUE, Type4Byte, uint>(IdentityOp());
+                                    (select_shader<PACKED, details::SelectMode::IF, Type4Byte, uint>(select_ops), ...);
+                                });
+    }
+
+    // how tiles wait on their predecessors during look-back
+    void set_look_back_delay(LookBackDelayPolicy policy) noexcept { m_look_back_delay = policy; }
+
+    [[nodiscard]] LookBackDelayPolicy look_back_delay() const noexcept { return m_look_back_delay; }
+
+    /**
+     * @brief Copies the items for which select_op(item) is true to d_out, keeping their order,
+     * e.g. [](const Var<uint>& ray) { return ray != ~0u; } to compact live rays.
+     */
+    template <NumericT Type4Byte, typename SelectOp>
+    void If(CommandList&          cmdlist,
+            ByteBufferView        temp_storage,
+            size_t&               temp_storage_bytes,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectOp              select_op)
+    {
+        auto layout = select_temp_storage_layout(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        select_array<details::SelectMode::IF, Type4Byte, uint>(
+            cmdlist, layout.get_bytes(temp_storage, 0), d_in, d_out, d_num_selected_out, num_items, select_op);
+    }
+
+    template <NumericT Type4Byte, typename SelectOp>
+    void If(CommandList&          cmdlist,
+            Stream&               stream,
+            ByteBufferView        temp_storage,
+            size_t&               temp_storage_bytes,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectOp              select_op)
+    {
+        If(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, d_num_selected_out, num_items, select_op);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, typename SelectOp>
+    void If(CommandList&          cmdlist,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectOp              select_op)
+    {
+        size_t temp_storage_bytes = 0;
+        If(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, d_num_selected_out, num_items, select_op);
+        If(cmdlist,
+           m_allocator->allocate(cmdlist, temp_storage_bytes),
+           temp_storage_bytes,
+           d_in,
+           d_out,
+           d_num_selected_out,
+           num_items,
+           select_op);
+    }
+
+    template <NumericT Type4Byte, typename SelectOp>
+    void If(CommandList&          cmdlist,
+            Stream&               stream,
+            BufferView<Type4Byte> d_in,
+            BufferView<Type4Byte> d_out,
+            BufferView<uint>      d_num_selected_out,
+            size_t                num_items,
+            SelectOp              select_op)
+    {
+        If(cmdlist, d_in, d_out, d_num_selected_out, num_items, select_op);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    // copies the items whose flag is non-zero to d_out, keeping their order
+    template <NumericT Type4Byte, NumericT FlagT>
+    void Flagged(CommandList&          cmdlist,
+                 ByteBufferView        temp_storage,
+                 size_t&               temp_storage_bytes,
+                 BufferView<Type4Byte> d_in,
+                 BufferView<FlagT>     d_flags,
+                 BufferView<Type4Byte> d_out,
+                 BufferView<uint>      d_num_selected_out,
+                 size_t                num_items)
+    {
+        auto layout = select_temp_storage_layout(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        select_array<details::SelectMode::FLAGGED, Type4Byte, FlagT>(
+            cmdlist, layout.get_bytes(temp_storage, 0), d_in, d_out, d_num_selected_out, num_items, IdentityOp(), d_flags);
+    }
+
+    template <NumericT Type4Byte, NumericT FlagT>
+    void Flagged(CommandList&          cmdlist,
+                 Stream&               stream,
+                 ByteBufferView        temp_storage,
+                 size_t&               temp_storage_bytes,
+                 BufferView<Type4Byte> d_in,
+                 BufferView<FlagT>     d_flags,
+                 BufferView<Type4Byte> d_out,
+                 BufferView<uint>      d_num_selected_out,
+                 size_t                num_items)
+    {
+        Flagged(cmdlist, temp_storage, temp_storage_bytes, d_in, d_flags, d_out, d_num_selected_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte, NumericT FlagT>
+    void Flagged(CommandList&          cmdlist,
+                 BufferView<Type4Byte> d_in,
+                 BufferView<FlagT>     d_flags,
+                 BufferView<Type4Byte> d_out,
+                 BufferView<uint>      d_num_selected_out,
+                 size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        Flagged(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_flags, d_out, d_num_selected_out, num_items);
+        Flagged(cmdlist,
+                m_allocator->allocate(cmdlist, temp_storage_bytes),
+                temp_storage_bytes,
+                d_in,
+                d_flags,
+                d_out,
+                d_num_selected_out,
+                num_items);
+    }
+
+    template <NumericT Type4Byte, NumericT FlagT>
+    void Flagged(CommandList&          cmdlist,
+                 Stream&               stream,
+                 BufferView<Type4Byte> d_in,
+                 BufferView<FlagT>     d_flags,
+                 BufferView<Type4Byte> d_out,
+                 BufferView<uint>      d_num_selected_out,
+                 size_t                num_items)
+    {
+        Flagged(cmdlist, d_in, d_flags, d_out, d_num_selected_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+    // copies the first item of every run of equal consecutive items to d_out
+    template <NumericT Type4Byte>
+    void Unique(CommandList&          cmdlist,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_num_selected_out,
+                size_t                num_items)
+    {
+        auto layout = select_temp_storage_layout(num_items);
+        if(layout.query(temp_storage, temp_storage_bytes))
+        {
+            return;
+        }
+        select_array<details::SelectMode::UNIQUE, Type4Byte, uint>(
+            cmdlist, layout.get_bytes(temp_storage, 0), d_in, d_out, d_num_selected_out, num_items, IdentityOp());
+    }
+
+    template <NumericT Type4Byte>
+    void Unique(CommandList&          cmdlist,
+                Stream&               stream,
+                ByteBufferView        temp_storage,
+                size_t&               temp_storage_bytes,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_num_selected_out,
+                size_t                num_items)
+    {
+        Unique(cmdlist, temp_storage, temp_storage_bytes, d_in, d_out, d_num_selected_out, num_items);
+        if(!is_temp_storage_query(temp_storage))
+        {
+            stream << cmdlist.commit() << synchronize();
+        }
+    }
+
+    template <NumericT Type4Byte>
+    void Unique(CommandList&          cmdlist,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_num_selected_out,
+                size_t                num_items)
+    {
+        size_t temp_storage_bytes = 0;
+        Unique(cmdlist, temp_storage_query(), temp_storage_bytes, d_in, d_out, d_num_selected_out, num_items);
+        Unique(cmdlist,
+               m_allocator->allocate(cmdlist, temp_storage_bytes),
+               temp_storage_bytes,
+               d_in,
+               d_out,
+               d_num_selected_out,
+               num_items);
+    }
+
+    template <NumericT Type4Byte>
+    void Unique(CommandList&          cmdlist,
+                Stream&               stream,
+                BufferView<Type4Byte> d_in,
+                BufferView<Type4Byte> d_out,
+                BufferView<uint>      d_num_selected_out,
+                size_t                num_items)
+    {
+        Unique(cmdlist, d_in, d_out, d_num_selected_out, num_items);
+        stream << cmdlist.commit() << synchronize();
+    }
+
+  private:
+    uint select_num_tiles(size_t num_items) const noexcept
+    {
+        return std::max(1u, ceil_div(static_cast<uint>(num_items), static_cast<uint>(ITEMS_PER_THREAD * BLOCK_SIZE)));
+    }
+
+    TempStorageLayout<1> select_temp_storage_layout(size_t num_items) const noexcept
+    {
+        // tile states behind the warp of out-of-bounds padding read by the first tiles' look-back
+        size_t tile_state_size = scan_tile_state_size<uint>(m_packed_tile_state);
+        return TempStorageLayout<1>{{(details::WARP_SIZE + select_num_tiles(num_items)) * tile_state_size}};
+    }
+
+    // d_flags is the flags buffer of FLAGGED, the other modes pass none
+    template <details::SelectMode MODE, NumericT Type4Byte, NumericT FlagT, typename SelectOp, typename... FlagViews>
+    void select_array(CommandList&          cmdlist,
+                      ByteBufferView        tile_state_bytes,
+                      BufferView<Type4Byte> d_in,
+                      BufferView<Type4Byte> d_out,
+                      BufferView<uint>      d_num_selected_out,
+                      size_t                num_items,
+                      SelectOp              select_op,
+                      FlagViews...          d_flags)
+    {
+        static_assert(sizeof...(FlagViews) == (MODE == details::SelectMode::FLAGGED ? 1 : 0));
+        // an empty input still runs one tile, it writes zero to d_num_selected_out
+        uint num_tiles = select_num_tiles(num_items);
+        visit_tile_state_layout(
+            m_packed_tile_state,
+            [&]<bool PACKED>(std::bool_constant<PACKED>)
+            {
+                using TileState = details::SelectModule<uint, uint, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>::ScanTileState;
+
+                auto tile_states                   = details::reinterpret_view<TileState>(tile_state_bytes);
+                auto ms_select_tile_state_init_ptr = select_tile_state_init_shader<PACKED>();
+                auto ms_select_ptr                 = select_shader<PACKED, MODE, Type4Byte, FlagT>(select_op);
+
+                cmdlist << (*ms_select_tile_state_init_ptr)(tile_states, static_cast<int>(num_tiles)).dispatch(num_tiles * m_block_size);
+                cmdlist << (*ms_select_ptr)(
+                               tile_states, d_in, d_flags..., d_out, d_num_selected_out, static_cast<uint>(num_items), op_params(select_op))
+                               .dispatch(num_tiles * m_block_size);
+            });
+    }
+
+    template <bool PACKED>
+    auto select_tile_state_init_shader()
+    {
+        using SelectShader              = details::SelectModule<uint, uint, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using SelectTileStateInitKernel = SelectShader::ScanTileStateInitKernel;
+
+        constexpr auto key = shader_key<"select_tile_state_init", DeviceSelect, SelectShader>();
+        return m_shaders->get_or_compile<SelectTileStateInitKernel>(key, [&]
+        {
+            auto compile = [device = m_device]() mutable { return SelectShader().compile_scan_tile_state_init(device); };
+            return compile_async(shader_cache_module(key.name), luisa::string{"uint"} + tile_state_layout_desc(PACKED), std::move(compile));
+        });
+    }
+
+    template <bool PACKED, details::SelectMode MODE, NumericT Type4Byte, NumericT FlagT, typename SelectOp>
+    auto select_shader(SelectOp select_op)
+    {
+        using SelectShader = details::SelectModule<Type4Byte, FlagT, BLOCK_SIZE, ITEMS_PER_THREAD, PACKED>;
+        using SelectKernel = SelectShader::template SelectKernel<MODE>;
+
+        const auto key = shader_key<"select", DeviceSelect, SelectShader, std::integral_constant<details::SelectMode, MODE>, SelectOp>(
+            static_cast<uint64_t>(m_look_back_delay));
+        return m_shaders->get_or_compile<SelectKernel>(key, [&]
+        {
+            constexpr const char* mode_desc = MODE == details::SelectMode::IF      ? "_if" :
+                                              MODE == details::SelectMode::FLAGGED ? "_flagged" :
+                                                                                     "_unique";
+            auto desc = get_type_and_op_desc<Type4Byte>(select_op) + mode_desc + look_back_delay_desc(m_look_back_delay)
+                        + tile_state_layout_desc(PACKED);
+            LUISA_INFO("Compiling Select shader for key: {}", desc);
+            auto compile = [device          = m_device,
+                            shared_mem_size = m_shared_mem_size,
+                            look_back_delay = m_look_back_delay,
+                            select_op]() mutable
+            {
+                return visit_delay_constructor<uint>(
+                    look_back_delay,
+                    [&]<typename DelayConstructorT>(std::type_identity<DelayConstructorT>) {
+                        return SelectShader().template compile<MODE, DelayConstructorT>(device, shared_mem_size, select_op);
+                    });
+            };
+            return compile_async(shader_cache_module(key.name), desc, std::move(compile));
+        });
+    }
+
+    luisa::string shader_cache_module(luisa::string_view name) const
+    {
+        return luisa::format("DeviceSelect<{},{},{}>::{}", BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD, name);
+    }
+};
+}  // namespace luisa::parallel_primitive
@@ -11,6 +11,10 @@
 #include <lcpp/common/utils.h>
 #include <lcpp/common/thread_operators.h>
 #include <lcpp/common/grid_even_shared.h>
+#include <lcpp/common/iterator.h>
+// runtime
+#include <lcpp/runtime/core.h>
+#include <lcpp/runtime/temp_storage.h>
 // thread level
 #include <lcpp/thread/thread_reduce.h>
 #include <lcpp/thread/thread_scan.h>
@@ -25,10 +29,16 @@
 #include <lcpp/block/block_store.h>
 #include <lcpp/block/block_radix_rank.h>
 #include <lcpp/block/block_discontinuity.h>
+#include <lcpp/block/block_merge_sort.h>
 // device level
 #include <lcpp/device/device_for.h>
 #include <lcpp/device/device_histogram.h>
 #include <lcpp/device/device_radix_sort.h>
 #include <lcpp/device/device_reduce.h>
 #include <lcpp/device/device_scan.h>
-#include <lcpp/device/device_segment_reduce.h>
\ No newline at end of file
+#include <lcpp/device/device_segment_reduce.h>
+#include <lcpp/device/device_select.h>
+#include <lcpp/device/device_partition.h>
+#include <lcpp/device/device_run_length_encode.h>
+#include <lcpp/device/device_merge_sort.h>
+#include <lcpp/device/device_segmented_radix_sort.h>
\ No newline at end of file
@@ -11,6 +11,9 @@
 #include <luisa/dsl/builtin.h>
 #include <luisa/dsl/var.h>
 #include <lcpp/common/type_trait.h>
+#include <lcpp/runtime/shader_cache.h>
+#include <lcpp/runtime/shader_compiler.h>
+#include <lcpp/runtime/shader_registry.h>
 
 namespace luisa::parallel_primitive
 {
@@ -36,11 +39,7 @@ template <size_t I, typename F, typename... Args>
 inline void lazy_compile(luisa::compute::Device&                device,
                          U<luisa::compute::Shader<I, Args...>>& ushader,
                          F&&                                    func,
-                         const luisa::compute::ShaderOption&    option = {
-#ifndef NDEBUG
-                             .enable_debug_info = true
-#endif
-                         }) noexcept
+                         const luisa::compute::ShaderOption&    option = shader_cache_option()) noexcept
 {
     using S = luisa::compute::Shader<I, Args...>;
     if(!ushader)
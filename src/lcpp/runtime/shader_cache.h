@@ -0,0 +1,79 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 11:02:18
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 11:02:18
+ */
+
+#pragma once
+#include <utility>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/format.h>
+#include <luisa/core/stl/hash.h>
+#include <luisa/core/stl/string.h>
+#include <luisa/runtime/rhi/device_interface.h>
+
+namespace luisa::parallel_primitive
+{
+/**
+ * @brief Process-wide settings for persisting compiled shaders.
+ *
+ * With persistent set, every shader compiled by a device primitive gets a stable ShaderOption::name
+ * derived from its module, launch configuration, data type and operator, so the backend stores
+ * the binary on disk and the next process start reuses it instead of compiling again.
+ */
+struct ShaderCacheConfig
+{
+    bool          persistent = true;
+    luisa::string prefix     = "lcpp";
+};
+
+inline ShaderCacheConfig& shader_cache_config() noexcept
+{
+    static ShaderCacheConfig config;
+    return config;
+}
+
+namespace details
+{
+    inline luisa::string& current_shader_cache_key() noexcept
+    {
+        thread_local luisa::string key;
+        return key;
+    }
+}  // namespace details
+
+// names the shaders compiled on this thread while the scope is alive
+class ShaderCacheScope
+{
+    luisa::string m_previous;
+
+  public:
+    ShaderCacheScope(luisa::string_view module, luisa::string_view key) noexcept
+        : m_previous{std::exchange(details::current_shader_cache_key(), luisa::format("{}:{}", module, key))}
+    {
+    }
+
+    ~ShaderCacheScope() noexcept { details::current_shader_cache_key() = std::move(m_previous); }
+
+    ShaderCacheScope(const ShaderCacheScope&)            = delete;
+    ShaderCacheScope& operator=(const ShaderCacheScope&) = delete;
+};
+
+// option used by lazy_compile, the name stays empty outside a ShaderCacheScope
+inline luisa::compute::ShaderOption shader_cache_option() noexcept
+{
+    luisa::compute::ShaderOption option{};
+#ifndef NDEBUG
+    option.enable_debug_info = true;
+#endif
+    auto&       config = shader_cache_config();
+    const auto& key    = details::current_shader_cache_key();
+    if(config.persistent && !key.empty())
+    {
+        option.enable_cache = true;
+        option.name         = luisa::format("{}_{:016x}", config.prefix, luisa::hash_value(key));
+    }
+    return option;
+}
+}  // namespace luisa::parallel_primitive
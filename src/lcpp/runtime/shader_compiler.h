@@ -0,0 +1,170 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 13:40:05
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 13:40:05
+ */
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <luisa/core/stl/memory.h>
+#include <luisa/core/stl/string.h>
+#include <luisa/core/stl/vector.h>
+#include <luisa/runtime/rhi/resource.h>
+#include <lcpp/runtime/shader_cache.h>
+
+namespace luisa::parallel_primitive
+{
+// a shader that may still be compiling on the pool
+using ShaderFuture = std::shared_future<luisa::shared_ptr<luisa::compute::Resource>>;
+
+/**
+ * @brief Host thread pool the device modules compile their shaders on.
+ *
+ * Independent shaders (the passes of one sort, a Warmup list) compile concurrently, and a
+ * dispatch only blocks on the shaders it actually records. Warmup returns before its compiles
+ * run, wait_idle() blocks until every queued compile has finished.
+ */
+class ShaderCompilePool
+{
+    using Task = std::packaged_task<luisa::shared_ptr<luisa::compute::Resource>()>;
+
+    luisa::vector<std::thread> m_workers;
+    std::queue<Task>           m_tasks;
+    std::mutex                 m_mutex;
+    std::condition_variable    m_cv;
+    std::condition_variable    m_idle_cv;
+    size_t                     m_running = 0;
+    bool                       m_stop    = false;
+
+  public:
+    explicit ShaderCompilePool(size_t num_threads)
+    {
+        m_workers.reserve(num_threads);
+        for(size_t i = 0; i < num_threads; i++)
+        {
+            m_workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ShaderCompilePool()
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for(auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    ShaderCompilePool(const ShaderCompilePool&)            = delete;
+    ShaderCompilePool& operator=(const ShaderCompilePool&) = delete;
+
+    [[nodiscard]] size_t size() const noexcept { return m_workers.size(); }
+
+    // blocks until the queue is drained and no compile is running
+    void wait_idle()
+    {
+        std::unique_lock lock{m_mutex};
+        m_idle_cv.wait(lock, [this] { return m_tasks.empty() && m_running == 0; });
+    }
+
+    template <typename F>
+    ShaderFuture submit(F&& compile)
+    {
+        Task         task{std::forward<F>(compile)};
+        ShaderFuture future = task.get_future().share();
+        {
+            std::lock_guard lock{m_mutex};
+            m_tasks.push(std::move(task));
+        }
+        m_cv.notify_one();
+        return future;
+    }
+
+  private:
+    void run()
+    {
+        for(;;)
+        {
+            Task task;
+            {
+                std::unique_lock lock{m_mutex};
+                m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+                // drain what is queued before stopping
+                if(m_tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+                m_running++;
+            }
+            task();
+            {
+                std::lock_guard lock{m_mutex};
+                m_running--;
+            }
+            m_idle_cv.notify_all();
+        }
+    }
+};
+
+inline ShaderCompilePool& shader_compile_pool()
+{
+    static ShaderCompilePool pool{std::max(1u, std::thread::hardware_concurrency())};
+    return pool;
+}
+
+// typed handle to a pooled shader, dereferencing waits for its compilation
+template <typename KernelT>
+class AsyncShader
+{
+    ShaderFuture m_future;
+
+  public:
+    explicit AsyncShader(ShaderFuture future) noexcept
+        : m_future{std::move(future)}
+    {
+    }
+
+    [[nodiscard]] KernelT& operator*() const { return *get(); }
+    [[nodiscard]] KernelT* operator->() const { return get(); }
+    // the pool stores shaders as their Resource base, KernelT is the type the module compiled
+    [[nodiscard]] KernelT* get() const { return static_cast<KernelT*>(m_future.get().get()); }
+
+    [[nodiscard]] bool ready() const noexcept
+    {
+        return m_future.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+    }
+};
+
+/**
+ * @brief Queues compile() on the pool under the persistent cache name module:key.
+ *
+ * compile runs on a worker thread, so it must capture what it needs by value (the Device
+ * handle, shared memory size, operators) and return the module's U<Shader>. The operators are
+ * copied, but whatever a user lambda captures by reference is still read when the compile runs:
+ * after a Warmup, call shader_compile_pool().wait_idle() before such captures go out of scope.
+ */
+template <typename F>
+ShaderFuture compile_async(luisa::string_view module, luisa::string_view key, F&& compile)
+{
+    return shader_compile_pool().submit(
+        [module = luisa::string{module}, key = luisa::string{key}, compile = std::forward<F>(compile)]() mutable
+        {
+            ShaderCacheScope cache_scope{module, key};
+            return luisa::shared_ptr<luisa::compute::Resource>{compile()};
+        });
+}
+}  // namespace luisa::parallel_primitive
@@ -0,0 +1,150 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 15:06:44
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 15:06:44
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <luisa/core/stl/memory.h>
+#include <luisa/core/stl/string.h>
+#include <luisa/core/stl/unordered_map.h>
+#include <luisa/runtime/device.h>
+#include <lcpp/runtime/shader_compiler.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    // string literal usable as a template argument
+    template <size_t N>
+    struct ShaderName
+    {
+        char value[N]{};
+
+        constexpr ShaderName(const char (&name)[N]) noexcept { std::copy_n(name, N, value); }
+        constexpr luisa::string_view view() const noexcept { return {value, N - 1}; }
+    };
+
+    // one object per (name, types) instantiation, its address is the shader identity
+    template <ShaderName Name, typename... Ts>
+    struct ShaderTag
+    {
+        static constexpr char id = 0;
+    };
+}  // namespace details
+
+/**
+ * @brief Identity of a shader in the ShaderRegistry.
+ *
+ * tag is unique per (name, module, value and operator types) and fixed at compile time, variant
+ * carries the runtime switches (inclusive flag, look-back delay policy). Lookups never allocate.
+ */
+struct ShaderKey
+{
+    const void*        tag     = nullptr;
+    uint64_t           variant = 0;
+    luisa::string_view name;
+
+    [[nodiscard]] bool operator==(const ShaderKey& other) const noexcept
+    {
+        return tag == other.tag && variant == other.variant;
+    }
+};
+
+struct ShaderKeyHash
+{
+    [[nodiscard]] size_t operator()(const ShaderKey& key) const noexcept
+    {
+        auto h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key.tag));
+        h ^= key.variant + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+};
+
+template <details::ShaderName Name, typename... Ts>
+constexpr ShaderKey shader_key(uint64_t variant = 0) noexcept
+{
+    return ShaderKey{&details::ShaderTag<Name, Ts...>::id, variant, Name.view()};
+}
+
+/**
+ * @brief Compiled shaders of every device module created on one Device.
+ *
+ * Two DeviceReduce instances on the same device share their shaders, and concurrent host
+ * threads may look up and compile through the same registry. Hits take a reader lock only.
+ */
+class ShaderRegistry
+{
+    using Device = luisa::compute::Device;
+
+    luisa::unordered_map<ShaderKey, ShaderFuture, ShaderKeyHash> m_shaders;
+    mutable std::shared_mutex                                    m_mutex;
+
+  public:
+    ShaderRegistry()  = default;
+    ~ShaderRegistry() = default;
+
+    ShaderRegistry(const ShaderRegistry&)            = delete;
+    ShaderRegistry& operator=(const ShaderRegistry&) = delete;
+
+    // one registry per device, shared by every module created on it
+    static luisa::shared_ptr<ShaderRegistry> shared(Device& device)
+    {
+        static std::mutex registry_mutex;
+        static luisa::unordered_map<const luisa::compute::DeviceInterface*, luisa::weak_ptr<ShaderRegistry>> registry;
+
+        std::lock_guard lock{registry_mutex};
+        auto&           slot    = registry[device.impl()];
+        auto            shaders = slot.lock();
+        if(!shaders)
+        {
+            shaders = luisa::make_shared<ShaderRegistry>();
+            slot    = shaders;
+        }
+        return shaders;
+    }
+
+    /**
+     * @brief Returns the shader for key, calling compile() once on a miss.
+     *
+     * compile() runs under the writer lock and must only queue the work (compile_async), it
+     * returns the ShaderFuture that is stored.
+     */
+    template <typename KernelT, typename F>
+    AsyncShader<KernelT> get_or_compile(const ShaderKey& key, F&& compile)
+    {
+        {
+            std::shared_lock lock{m_mutex};
+            if(auto it = m_shaders.find(key); it != m_shaders.end())
+            {
+                return AsyncShader<KernelT>{it->second};
+            }
+        }
+        std::unique_lock lock{m_mutex};
+        auto             it = m_shaders.find(key);
+        if(it == m_shaders.end())
+        {
+            it = m_shaders.try_emplace(key, compile()).first;
+        }
+        return AsyncShader<KernelT>{it->second};
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        std::shared_lock lock{m_mutex};
+        return m_shaders.size();
+    }
+
+    void clear()
+    {
+        std::unique_lock lock{m_mutex};
+        m_shaders.clear();
+    }
+};
+}  // namespace luisa::parallel_primitive
@@ -0,0 +1,349 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 10:12:31
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 10:12:31
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/memory.h>
+#include <luisa/core/stl/vector.h>
+#include <luisa/core/stl/unordered_map.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/runtime/byte_buffer.h>
+#include <luisa/runtime/command_list.h>
+#include <lcpp/runtime/core.h>
+
+namespace luisa::parallel_primitive
+{
+namespace details
+{
+    // reinterpret a byte range of a raw buffer as a typed view
+    template <typename T>
+    luisa::compute::BufferView<T> reinterpret_view(luisa::compute::ByteBufferView view,
+                                                   size_t                         offset_bytes,
+                                                   size_t                         count) noexcept
+    {
+        LUISA_ASSERT(offset_bytes % alignof(T) == 0, "Misaligned temp storage offset {}.", offset_bytes);
+        LUISA_ASSERT(offset_bytes + count * sizeof(T) <= view.size_bytes(),
+                     "Temp storage view too small ({} < {}).",
+                     view.size_bytes(),
+                     offset_bytes + count * sizeof(T));
+        return luisa::compute::BufferView<T>{view.native_handle(),
+                                             view.handle(),
+                                             sizeof(T),
+                                             view.offset_bytes() + offset_bytes,
+                                             count,
+                                             view.total_size() / sizeof(T)};
+    }
+
+    // the whole byte range as a typed view
+    template <typename T>
+    luisa::compute::BufferView<T> reinterpret_view(luisa::compute::ByteBufferView view) noexcept
+    {
+        return reinterpret_view<T>(view, 0, view.size_bytes() / sizeof(T));
+    }
+}  // namespace details
+
+// pass as temp_storage to query the required temp_storage_bytes
+inline luisa::compute::ByteBufferView temp_storage_query() noexcept
+{
+    return luisa::compute::ByteBufferView{nullptr, luisa::compute::invalid_resource_handle, 0u, 0u, 0u};
+}
+
+inline bool is_temp_storage_query(const luisa::compute::ByteBufferView& temp_storage) noexcept
+{
+    return temp_storage.handle() == luisa::compute::invalid_resource_handle;
+}
+
+/**
+ * @brief Carves N scratch allocations out of one temp_storage slab (like cub::AliasTemporaries).
+ *
+ * Every allocation starts at a TEMP_STORAGE_ALIGNMENT boundary, bytes() is what callers
+ * of the two-phase API have to provide.
+ */
+template <size_t N>
+class TempStorageLayout
+{
+  public:
+    static constexpr size_t TEMP_STORAGE_ALIGNMENT = 256;
+
+  private:
+    size_t m_offsets[N] = {};
+    size_t m_sizes[N]   = {};
+    size_t m_bytes      = 0;
+
+  public:
+    explicit TempStorageLayout(const size_t (&allocation_bytes)[N]) noexcept
+    {
+        for(size_t i = 0; i < N; ++i)
+        {
+            m_offsets[i] = m_bytes;
+            m_sizes[i]   = allocation_bytes[i];
+            m_bytes += (allocation_bytes[i] + TEMP_STORAGE_ALIGNMENT - 1) / TEMP_STORAGE_ALIGNMENT * TEMP_STORAGE_ALIGNMENT;
+        }
+        // backends can not create empty buffers
+        m_bytes = std::max<size_t>(m_bytes, 4u);
+    }
+
+    [[nodiscard]] size_t bytes() const noexcept { return m_bytes; }
+
+    template <typename T>
+    [[nodiscard]] luisa::compute::BufferView<T> get(luisa::compute::ByteBufferView temp_storage, size_t index) const noexcept
+    {
+        return details::reinterpret_view<T>(temp_storage, m_offsets[index], m_sizes[index] / sizeof(T));
+    }
+
+    // the raw bytes of one allocation, for element types only chosen at dispatch (the tile state layout)
+    [[nodiscard]] luisa::compute::ByteBufferView get_bytes(luisa::compute::ByteBufferView temp_storage, size_t index) const noexcept
+    {
+        return temp_storage.subview(m_offsets[index], m_sizes[index]);
+    }
+
+    // returns true (and fills temp_storage_bytes) when the caller is only querying the size
+    bool query(luisa::compute::ByteBufferView temp_storage, size_t& temp_storage_bytes) const noexcept
+    {
+        if(is_temp_storage_query(temp_storage))
+        {
+            temp_storage_bytes = m_bytes;
+            return true;
+        }
+        LUISA_ASSERT(temp_storage.size_bytes() >= m_bytes,
+                     "Temp storage too small ({} bytes provided, {} bytes required).",
+                     temp_storage.size_bytes(),
+                     m_bytes);
+        return false;
+    }
+};
+
+/**
+ * @brief Size-class caching allocator for the scratch buffers of the device primitives.
+ *
+ * Blocks are binned by powers of bin_growth. A freed block goes back to its bin
+ * until max_cached_bytes is reached, so steady-state calls never hit the driver.
+ * One allocator is shared per Device, see CachingAllocator::shared.
+ */
+class CachingAllocator : public luisa::enable_shared_from_this<CachingAllocator>
+{
+  public:
+    using Device         = luisa::compute::Device;
+    using ByteBuffer     = luisa::compute::ByteBuffer;
+    using ByteBufferView = luisa::compute::ByteBufferView;
+
+    static constexpr uint   DEFAULT_BIN_GROWTH       = 2;
+    static constexpr uint   DEFAULT_MIN_BIN          = 8;   // 256 B
+    static constexpr uint   DEFAULT_MAX_BIN          = 30;  // 1 GB
+    static constexpr size_t DEFAULT_MAX_CACHED_BYTES = size_t{1} << 29;
+    static constexpr uint   INVALID_BIN              = ~0u;
+
+  private:
+    struct Block
+    {
+        ByteBuffer buffer;
+        size_t     bytes = 0;
+        uint       bin   = INVALID_BIN;
+    };
+
+    Device m_device;
+    uint   m_bin_growth;
+    uint   m_min_bin;
+    uint   m_max_bin;
+    size_t m_min_bin_bytes;
+    size_t m_max_bin_bytes;
+    size_t m_max_cached_bytes;
+
+    size_t m_cached_bytes = 0;
+    size_t m_live_bytes   = 0;
+
+    luisa::unordered_map<uint64_t, Block>            m_live_blocks;
+    luisa::unordered_map<uint, luisa::vector<Block>> m_cached_blocks;
+    mutable std::mutex                               m_mutex;
+
+  public:
+    explicit CachingAllocator(Device& device,
+                              uint    bin_growth       = DEFAULT_BIN_GROWTH,
+                              uint    min_bin          = DEFAULT_MIN_BIN,
+                              uint    max_bin          = DEFAULT_MAX_BIN,
+                              size_t  max_cached_bytes = DEFAULT_MAX_CACHED_BYTES)
+        : m_device(device)
+        , m_bin_growth(bin_growth)
+        , m_min_bin(min_bin)
+        , m_max_bin(max_bin)
+        , m_min_bin_bytes(int_pow(bin_growth, min_bin))
+        , m_max_bin_bytes(int_pow(bin_growth, max_bin))
+        , m_max_cached_bytes(max_cached_bytes)
+    {
+    }
+
+    ~CachingAllocator() = default;
+
+    CachingAllocator(const CachingAllocator&)            = delete;
+    CachingAllocator& operator=(const CachingAllocator&) = delete;
+
+    // one allocator per device, shared by every module created on it
+    static S<CachingAllocator> shared(Device& device)
+    {
+        static std::mutex registry_mutex;
+        static luisa::unordered_map<const luisa::compute::DeviceInterface*, luisa::weak_ptr<CachingAllocator>> registry;
+
+        std::lock_guard lock{registry_mutex};
+        auto&           slot      = registry[device.impl()];
+        auto            allocator = slot.lock();
+        if(!allocator)
+        {
+            allocator = luisa::make_shared<CachingAllocator>(device);
+            slot      = allocator;
+        }
+        return allocator;
+    }
+
+    ByteBufferView allocate(size_t bytes)
+    {
+        std::lock_guard lock{m_mutex};
+
+        uint   bin         = INVALID_BIN;
+        size_t block_bytes = bytes;
+        bin_for(bytes, bin, block_bytes);
+
+        Block block;
+        if(bin != INVALID_BIN)
+        {
+            auto it = m_cached_blocks.find(bin);
+            if(it != m_cached_blocks.end() && !it->second.empty())
+            {
+                block = std::move(it->second.back());
+                it->second.pop_back();
+                m_cached_bytes -= block.bytes;
+            }
+        }
+        if(!block.buffer)
+        {
+            block.buffer = m_device.create_byte_buffer(block_bytes);
+            block.bytes  = block_bytes;
+            block.bin    = bin;
+        }
+
+        auto view = block.buffer.view().subview(0, std::max<size_t>(bytes, 4u));
+        m_live_bytes += block.bytes;
+        m_live_blocks.try_emplace(view.handle(), std::move(block));
+        return view;
+    }
+
+    // the block goes back to the cache once cmdlist has finished executing
+    ByteBufferView allocate(luisa::compute::CommandList& cmdlist, size_t bytes)
+    {
+        auto view = allocate(bytes);
+        cmdlist.add_callback([self = shared_from_this(), view] { self->free(view); });
+        return view;
+    }
+
+    template <typename T>
+    luisa::compute::BufferView<T> allocate(size_t count)
+    {
+        auto view = allocate(std::max<size_t>(count, 1u) * sizeof(T));
+        return details::reinterpret_view<T>(view, 0, count);
+    }
+
+    void free(ByteBufferView view)
+    {
+        std::lock_guard lock{m_mutex};
+
+        auto it = m_live_blocks.find(view.handle());
+        if(it == m_live_blocks.end())
+        {
+            LUISA_WARNING("Freeing a buffer that was not allocated by this CachingAllocator.");
+            return;
+        }
+        Block block = std::move(it->second);
+        m_live_blocks.erase(it);
+        m_live_bytes -= block.bytes;
+
+        if(block.bin != INVALID_BIN && m_cached_bytes + block.bytes <= m_max_cached_bytes)
+        {
+            m_cached_bytes += block.bytes;
+            m_cached_blocks[block.bin].emplace_back(std::move(block));
+        }
+        // otherwise the block is released when it goes out of scope
+    }
+
+    template <typename T>
+    void free(luisa::compute::BufferView<T> view)
+    {
+        free(luisa::compute::ByteBufferView{view});
+    }
+
+    // high-water cap of the bytes kept around between calls
+    void set_max_cached_bytes(size_t max_cached_bytes)
+    {
+        std::lock_guard lock{m_mutex};
+        m_max_cached_bytes = max_cached_bytes;
+        trim_to(m_max_cached_bytes);
+    }
+
+    // release every cached block back to the driver
+    void trim()
+    {
+        std::lock_guard lock{m_mutex};
+        trim_to(0);
+    }
+
+    [[nodiscard]] size_t cached_bytes() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_cached_bytes;
+    }
+
+    [[nodiscard]] size_t live_bytes() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_live_bytes;
+    }
+
+  private:
+    static size_t int_pow(size_t base, uint exp)
+    {
+        size_t result = 1;
+        while(exp-- > 0)
+        {
+            result *= base;
+        }
+        return result;
+    }
+
+    void bin_for(size_t bytes, uint& bin, size_t& bin_bytes) const
+    {
+        if(bytes > m_max_bin_bytes)
+        {
+            // too large to cache, allocate exactly
+            bin       = INVALID_BIN;
+            bin_bytes = bytes;
+            return;
+        }
+        bin       = m_min_bin;
+        bin_bytes = m_min_bin_bytes;
+        while(bin_bytes < bytes)
+        {
+            bin_bytes *= m_bin_growth;
+            ++bin;
+        }
+    }
+
+    void trim_to(size_t target_bytes)
+    {
+        for(auto&& [bin, blocks] : m_cached_blocks)
+        {
+            while(m_cached_bytes > target_bytes && !blocks.empty())
+            {
+                m_cached_bytes -= blocks.back().bytes;
+                blocks.pop_back();
+            }
+        }
+    }
+};
+}  // namespace luisa::parallel_primitive
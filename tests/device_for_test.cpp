@@ -0,0 +1,170 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 17:58:40
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 17:58:40
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <algorithm>
+#include <cstdint>
+#include <lcpp/parallel_primitive.h>
+#include <boost/ut.hpp>
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+using namespace boost::ut;
+
+// named operator whose offset is a kernel argument
+struct OffsetOp
+{
+    static constexpr luisa::string_view name = "offset";
+
+    float offset = 0.0f;
+
+    float4 params() const noexcept { return make_float4(offset, 0.0f, 0.0f, 0.0f); }
+
+    void operator()(Var<float>& x, Expr<float4> params) const noexcept { x += params.x; }
+};
+
+int main(int argc, char* argv[])
+{
+    log_level_verbose();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+
+    DeviceFor<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> device_for;
+    device_for.create(device);
+
+    // not a multiple of the tile, the last tile takes the guarded path
+    constexpr uint array_size = (1 << 20) + 123;
+
+    "fill_sequence"_test = [&]
+    {
+        auto                 buffer = device.create_buffer<int32>(array_size);
+        luisa::vector<int32> result(array_size);
+
+        device_for.Fill(cmdlist, stream, buffer.view(), 7);
+        stream << buffer.copy_to(result.data()) << synchronize();
+        expect(std::all_of(result.begin(), result.end(), [](int32 v) { return v == 7; }));
+
+        device_for.Sequence(cmdlist, stream, buffer.view(), -5);
+        stream << buffer.copy_to(result.data()) << synchronize();
+        bool sequence_ok = true;
+        for(uint i = 0; i < array_size; i++)
+        {
+            sequence_ok &= result[i] == static_cast<int32>(i) - 5;
+        }
+        expect(sequence_ok);
+    };
+
+    "for_each"_test = [&]
+    {
+        auto                 buffer = device.create_buffer<float>(array_size);
+        luisa::vector<float> result(array_size);
+        device_for.Sequence(cmdlist, buffer.view(), 0.0f);
+        device_for.ForEach(cmdlist, stream, buffer.view(), [](Var<float>& x) { x = x * 2.0f; });
+        stream << buffer.copy_to(result.data()) << synchronize();
+        bool for_each_ok = true;
+        for(uint i = 0; i < array_size; i++)
+        {
+            for_each_ok &= result[i] == 2.0f * static_cast<float>(i);
+        }
+        expect(for_each_ok);
+
+        // only the first half is touched
+        device_for.Fill(cmdlist, buffer.view(), 1.0f);
+        device_for.ForEachN(cmdlist, stream, buffer.view(), array_size / 2, OffsetOp{0.5f});
+        stream << buffer.copy_to(result.data()) << synchronize();
+        expect(result[0] == 1.5f && result[array_size / 2 - 1] == 1.5f && result[array_size / 2] == 1.0f);
+
+        // another offset reuses the compiled shader
+        auto registry = ShaderRegistry::shared(device);
+        auto compiled = registry->size();
+        device_for.ForEachN(cmdlist, stream, buffer.view(), array_size / 2, OffsetOp{-1.0f});
+        stream << buffer.copy_to(result.data()) << synchronize();
+        expect(result[0] == 0.5f);
+        expect(compiled == registry->size());
+    };
+
+    "bulk_extents"_test = [&]
+    {
+        auto                buffer = device.create_buffer<uint>(array_size);
+        luisa::vector<uint> result(array_size);
+        device_for.Bulk(
+            cmdlist, stream, array_size, [](const UInt& index, BufferVar<uint>& out) { out.write(index, index * 3u); }, buffer.view());
+        stream << buffer.copy_to(result.data()) << synchronize();
+        bool bulk_ok = true;
+        for(uint i = 0; i < array_size; i++)
+        {
+            bulk_ok &= result[i] == i * 3u;
+        }
+        expect(bulk_ok);
+
+        constexpr uint3 extents = make_uint3(37u, 19u, 5u);
+        device_for.ForEachInExtents(cmdlist,
+                                    stream,
+                                    extents,
+                                    [](const UInt& index, const UInt3& coord, BufferVar<uint>& out)
+                                    { out.write(index, coord.x + coord.y * 100u + coord.z * 10000u); },
+                                    buffer.view());
+        stream << buffer.copy_to(result.data()) << synchronize();
+        bool extents_ok = true;
+        for(uint z = 0; z < extents.z; z++)
+        {
+            for(uint y = 0; y < extents.y; y++)
+            {
+                for(uint x = 0; x < extents.x; x++)
+                {
+                    extents_ok &= result[(z * extents.y + y) * extents.x + x] == x + y * 100u + z * 10000u;
+                }
+            }
+        }
+        expect(extents_ok);
+    };
+    "bulk_other_buffer"_test = [&]
+    {
+        // one call site, one cached shader, each call writes the buffer it is given
+        luisa::vector<Buffer<uint>> buffers;
+        buffers.emplace_back(device.create_buffer<uint>(array_size));
+        buffers.emplace_back(device.create_buffer<uint>(array_size));
+        device_for.Fill(cmdlist, stream, buffers[1].view(), 0u);
+
+        auto registry = ShaderRegistry::shared(device);
+        auto compiled = registry->size();
+        for(uint i = 0; i < buffers.size(); i++)
+        {
+            device_for.Bulk(
+                cmdlist, stream, array_size, [](const UInt& index, BufferVar<uint>& out) { out.write(index, index + 1u); }, buffers[i].view());
+            expect(compiled + 1 == registry->size());
+        }
+
+        luisa::vector<uint> result(array_size);
+        for(auto& buffer : buffers)
+        {
+            stream << buffer.copy_to(result.data()) << synchronize();
+            bool bulk_ok = true;
+            for(uint i = 0; i < array_size; i++)
+            {
+                bulk_ok &= result[i] == i + 1u;
+            }
+            expect(bulk_ok);
+        }
+    };
+}
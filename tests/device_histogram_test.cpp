@@ -0,0 +1,168 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 17:05:31
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 17:05:31
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <lcpp/parallel_primitive.h>
+#include <random>
+#include <boost/ut.hpp>
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+using namespace boost::ut;
+int main(int argc, char* argv[])
+{
+    log_level_verbose();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+
+    DeviceHistogram<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> histogram;
+    histogram.create(device);
+
+    constexpr uint num_pixels = 1 << 20;
+    std::mt19937   rng(114521);
+
+    // smooth ramp with noise, long runs of equal values like a luminance buffer
+    luisa::vector<uint> ramp(num_pixels);
+    for(uint i = 0; i < num_pixels; i++)
+    {
+        ramp[i] = std::min(255u, (i / 4096u) + (rng() % 3u));
+    }
+    auto ramp_buffer = device.create_buffer<uint>(num_pixels);
+    stream << ramp_buffer.copy_from(ramp.data()) << synchronize();
+
+    "histogram_even"_test = [&]
+    {
+        // 64 bins over [0, 256), every bin 4 values wide
+        constexpr int       num_levels = 65;
+        luisa::vector<uint> expected(num_levels - 1, 0u);
+        for(auto v : ramp)
+        {
+            expected[v / 4]++;
+        }
+
+        auto out_buffer = device.create_buffer<uint>(num_levels - 1);
+        for(auto [rle, work_stealing] : {std::pair{false, false}, std::pair{true, false}, std::pair{false, true}})
+        {
+            histogram.set_rle_compress(rle);
+            histogram.set_work_stealing(work_stealing);
+            histogram.HistogramEven(cmdlist, stream, ramp_buffer.view(), out_buffer.view(), num_levels, 0u, 256u, num_pixels);
+
+            luisa::vector<uint> result(num_levels - 1);
+            stream << out_buffer.copy_to(result.data()) << synchronize();
+            expect(std::equal(result.begin(), result.end(), expected.begin()))
+                << "rle " << rle << " work stealing " << work_stealing;
+        }
+        histogram.set_rle_compress(false);
+        histogram.set_work_stealing(false);
+    };
+
+    "histogram_range"_test = [&]
+    {
+        // uneven bins, samples at and above the last level are dropped
+        luisa::vector<float> levels{0.0f, 0.5f, 2.0f, 10.0f, 100.0f, 200.0f};
+        luisa::vector<float> samples(num_pixels);
+        for(auto& s : samples)
+        {
+            s = static_cast<float>(rng() % 250u);
+        }
+        luisa::vector<uint> expected(levels.size() - 1, 0u);
+        for(auto s : samples)
+        {
+            auto it = std::upper_bound(levels.begin(), levels.end(), s);
+            if(s >= levels.front() && it != levels.end())
+            {
+                expected[it - levels.begin() - 1]++;
+            }
+        }
+
+        auto samples_buffer = device.create_buffer<float>(num_pixels);
+        auto levels_buffer  = device.create_buffer<float>(levels.size());
+        auto out_buffer     = device.create_buffer<uint>(levels.size() - 1);
+        stream << samples_buffer.copy_from(samples.data()) << levels_buffer.copy_from(levels.data()) << synchronize();
+
+        histogram.HistogramRange(cmdlist,
+                                 stream,
+                                 samples_buffer.view(),
+                                 out_buffer.view(),
+                                 static_cast<int>(levels.size()),
+                                 levels_buffer.view(),
+                                 num_pixels);
+
+        luisa::vector<uint> result(levels.size() - 1);
+        stream << out_buffer.copy_to(result.data()) << synchronize();
+        expect(std::equal(result.begin(), result.end(), expected.begin()));
+    };
+
+    "multi_histogram_even"_test = [&]
+    {
+        // RGBA pixels, histograms of RGB only
+        constexpr uint      rgba_pixels = 1 << 18;
+        luisa::vector<uint> rgba(rgba_pixels * 4);
+        for(auto& c : rgba)
+        {
+            c = rng() % 256u;
+        }
+        std::array<luisa::vector<uint>, 3> expected;
+        for(auto& e : expected)
+        {
+            e.assign(256, 0u);
+        }
+        for(uint p = 0; p < rgba_pixels; p++)
+        {
+            for(uint c = 0; c < 3; c++)
+            {
+                expected[c][rgba[p * 4 + c]]++;
+            }
+        }
+
+        auto rgba_buffer = device.create_buffer<uint>(rgba.size());
+        auto r_buffer    = device.create_buffer<uint>(256);
+        auto g_buffer    = device.create_buffer<uint>(256);
+        auto b_buffer    = device.create_buffer<uint>(256);
+        stream << rgba_buffer.copy_from(rgba.data()) << synchronize();
+
+        histogram.MultiHistogramEven<4, 3>(cmdlist,
+                                           stream,
+                                           rgba_buffer.view(),
+                                           {r_buffer.view(), g_buffer.view(), b_buffer.view()},
+                                           {257, 257, 257},
+                                           {0u, 0u, 0u},
+                                           {256u, 256u, 256u},
+                                           rgba_pixels);
+
+        std::array<luisa::vector<uint>, 3> result;
+        for(auto& r : result)
+        {
+            r.resize(256);
+        }
+        stream << r_buffer.copy_to(result[0].data()) << g_buffer.copy_to(result[1].data())
+               << b_buffer.copy_to(result[2].data()) << synchronize();
+        for(uint c = 0; c < 3; c++)
+        {
+            expect(std::equal(result[c].begin(), result[c].end(), expected[c].begin())) << "channel " << c;
+        }
+    };
+}
@@ -0,0 +1,131 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 22:05:33
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 22:05:33
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <luisa/dsl/struct.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <lcpp/parallel_primitive.h>
+#include <random>
+#include <boost/ut.hpp>
+
+struct Hit
+{
+    uint  material;
+    float depth;
+};
+LUISA_STRUCT(Hit, material, depth) {};
+
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+using namespace boost::ut;
+int main(int argc, char* argv[])
+{
+    log_level_verbose();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+
+    DeviceMergeSort<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> merge_sort;
+    merge_sort.create(device);
+
+    std::mt19937 rng(114521);
+
+    "merge_sort_keys"_test = [&]
+    {
+        // a single tile, one merge pass and an odd number of passes with a partial last tile
+        for(uint array_size : {1000u, 2048u, (1u << 20) + 77u})
+        {
+            luisa::vector<uint> keys(array_size);
+            for(auto& key : keys)
+            {
+                key = rng();
+            }
+            auto keys_in_buffer  = device.create_buffer<uint>(array_size);
+            auto keys_out_buffer = device.create_buffer<uint>(array_size);
+            stream << keys_in_buffer.copy_from(keys.data()) << synchronize();
+
+            merge_sort.SortKeys(cmdlist,
+                                stream,
+                                keys_in_buffer.view(),
+                                keys_out_buffer.view(),
+                                array_size,
+                                [](const Var<uint>& a, const Var<uint>& b) { return a > b; });
+
+            luisa::vector<uint> result(array_size);
+            stream << keys_out_buffer.copy_to(result.data()) << synchronize();
+            std::sort(keys.begin(), keys.end(), std::greater<uint>());
+            expect(std::equal(keys.begin(), keys.end(), result.begin())) << "array size " << array_size;
+        }
+    };
+
+    "merge_sort_pairs_struct"_test = [&]
+    {
+        // few materials and depths, many equal keys to check that the sort is stable
+        constexpr uint      array_size = (1 << 20) + 77;
+        luisa::vector<Hit>  hits(array_size);
+        luisa::vector<uint> indices(array_size);
+        for(uint i = 0; i < array_size; i++)
+        {
+            hits[i]    = Hit{static_cast<uint>(rng() % 16u), static_cast<float>(rng() % 64u) * 0.25f};
+            indices[i] = i;
+        }
+
+        auto hits_in_buffer     = device.create_buffer<Hit>(array_size);
+        auto hits_out_buffer    = device.create_buffer<Hit>(array_size);
+        auto indices_in_buffer  = device.create_buffer<uint>(array_size);
+        auto indices_out_buffer = device.create_buffer<uint>(array_size);
+        stream << hits_in_buffer.copy_from(hits.data()) << indices_in_buffer.copy_from(indices.data()) << synchronize();
+
+        merge_sort.StableSortPairs(cmdlist,
+                                   stream,
+                                   hits_in_buffer.view(),
+                                   hits_out_buffer.view(),
+                                   indices_in_buffer.view(),
+                                   indices_out_buffer.view(),
+                                   array_size,
+                                   [](const Var<Hit>& a, const Var<Hit>& b)
+                                   { return a.material < b.material | (a.material == b.material & a.depth < b.depth); });
+
+        std::stable_sort(indices.begin(),
+                         indices.end(),
+                         [&](uint a, uint b)
+                         {
+                             return hits[a].material < hits[b].material
+                                    || (hits[a].material == hits[b].material && hits[a].depth < hits[b].depth);
+                         });
+
+        luisa::vector<uint> result_indices(array_size);
+        luisa::vector<Hit>  result_hits(array_size);
+        stream << indices_out_buffer.copy_to(result_indices.data()) << hits_out_buffer.copy_to(result_hits.data()) << synchronize();
+        expect(std::equal(indices.begin(), indices.end(), result_indices.begin()));
+
+        bool keys_match = true;
+        for(uint i = 0; i < array_size; i++)
+        {
+            keys_match &= result_hits[i].material == hits[indices[i]].material && result_hits[i].depth == hits[indices[i]].depth;
+        }
+        expect(keys_match);
+    };
+}
@@ -0,0 +1,171 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 19:52:40
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 19:52:40
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <lcpp/parallel_primitive.h>
+#include <random>
+#include <boost/ut.hpp>
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+using namespace boost::ut;
+int main(int argc, char* argv[])
+{
+    log_level_verbose();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+
+    DevicePartition<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> partition;
+    partition.create(device);
+
+    constexpr uint      array_size = (1 << 20) + 77;
+    std::mt19937        rng(114521);
+    luisa::vector<uint> input(array_size);
+    for(auto& v : input)
+    {
+        v = rng() % 1000u;
+    }
+
+    auto in_buffer           = device.create_buffer<uint>(array_size);
+    auto out_buffer          = device.create_buffer<uint>(array_size);
+    auto num_selected_buffer = device.create_buffer<uint>(2);
+    stream << in_buffer.copy_from(input.data()) << synchronize();
+
+    // selected items in order, then the rejected ones in reverse order
+    auto check_two_way = [&](const luisa::vector<uint>& selected, const luisa::vector<uint>& rejected)
+    {
+        uint num_selected = 0;
+        stream << num_selected_buffer.view(0, 1).copy_to(&num_selected) << synchronize();
+        expect(num_selected == selected.size()) << num_selected << " vs " << selected.size();
+
+        luisa::vector<uint> result(array_size);
+        stream << out_buffer.copy_to(result.data()) << synchronize();
+        expect(std::equal(selected.begin(), selected.end(), result.begin()));
+        expect(std::equal(rejected.rbegin(), rejected.rend(), result.begin() + selected.size()));
+    };
+
+    "partition_if"_test = [&]
+    {
+        luisa::vector<uint> selected;
+        luisa::vector<uint> rejected;
+        std::partition_copy(input.begin(),
+                            input.end(),
+                            std::back_inserter(selected),
+                            std::back_inserter(rejected),
+                            [](uint v) { return v < 300u; });
+
+        for(auto policy : {LookBackDelayPolicy::NO_DELAY, LookBackDelayPolicy::EXPONENTIAL_BACKOFF})
+        {
+            partition.set_look_back_delay(policy);
+            partition.If(cmdlist,
+                         stream,
+                         in_buffer.view(),
+                         out_buffer.view(),
+                         num_selected_buffer.view(),
+                         array_size,
+                         [](const Var<uint>& v) { return v < 300u; });
+            check_two_way(selected, rejected);
+        }
+        partition.set_look_back_delay(LookBackDelayPolicy::NO_DELAY);
+    };
+
+    "partition_flagged"_test = [&]
+    {
+        luisa::vector<int32> flags(array_size);
+        luisa::vector<uint>  selected;
+        luisa::vector<uint>  rejected;
+        for(uint i = 0; i < array_size; i++)
+        {
+            flags[i] = static_cast<int32>(rng() % 2u);
+            (flags[i] != 0 ? selected : rejected).push_back(input[i]);
+        }
+        auto flags_buffer = device.create_buffer<int32>(array_size);
+        stream << flags_buffer.copy_from(flags.data()) << synchronize();
+
+        partition.Flagged(
+            cmdlist, stream, in_buffer.view(), flags_buffer.view(), out_buffer.view(), num_selected_buffer.view(), array_size);
+        check_two_way(selected, rejected);
+    };
+
+    "partition_three_way"_test = [&]
+    {
+        luisa::vector<uint> first_part;
+        luisa::vector<uint> second_part;
+        luisa::vector<uint> unselected;
+        for(auto v : input)
+        {
+            (v < 200u ? first_part : v < 700u ? second_part : unselected).push_back(v);
+        }
+
+        auto second_part_buffer = device.create_buffer<uint>(array_size);
+        auto unselected_buffer  = device.create_buffer<uint>(array_size);
+        for(auto policy : {LookBackDelayPolicy::NO_DELAY, LookBackDelayPolicy::EXPONENTIAL_BACKOFF})
+        {
+            partition.set_look_back_delay(policy);
+            partition.If(
+                cmdlist,
+                stream,
+                in_buffer.view(),
+                out_buffer.view(),
+                second_part_buffer.view(),
+                unselected_buffer.view(),
+                num_selected_buffer.view(),
+                array_size,
+                [](const Var<uint>& v) { return v < 200u; },
+                [](const Var<uint>& v) { return v < 700u; });
+
+            uint num_selected[2] = {0, 0};
+            stream << num_selected_buffer.copy_to(num_selected) << synchronize();
+            expect(num_selected[0] == first_part.size()) << num_selected[0] << " vs " << first_part.size();
+            expect(num_selected[1] == second_part.size()) << num_selected[1] << " vs " << second_part.size();
+
+            luisa::vector<uint> result(array_size);
+            stream << out_buffer.copy_to(result.data()) << synchronize();
+            expect(std::equal(first_part.begin(), first_part.end(), result.begin()));
+            stream << second_part_buffer.copy_to(result.data()) << synchronize();
+            expect(std::equal(second_part.begin(), second_part.end(), result.begin()));
+            stream << unselected_buffer.copy_to(result.data()) << synchronize();
+            expect(std::equal(unselected.begin(), unselected.end(), result.begin()));
+        }
+        partition.set_look_back_delay(LookBackDelayPolicy::NO_DELAY);
+    };
+
+    "partition_empty"_test = [&]
+    {
+        uint sentinel = 12345u;
+        stream << num_selected_buffer.view(0, 1).copy_from(&sentinel) << synchronize();
+        partition.If(cmdlist,
+                     stream,
+                     in_buffer.view(),
+                     out_buffer.view(),
+                     num_selected_buffer.view(),
+                     0,
+                     [](const Var<uint>& v) { return v < 300u; });
+        uint num_selected = sentinel;
+        stream << num_selected_buffer.view(0, 1).copy_to(&num_selected) << synchronize();
+        expect(num_selected == 0u);
+    };
+}
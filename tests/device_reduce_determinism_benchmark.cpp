@@ -0,0 +1,85 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-17 12:02:15
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-17 12:02:15
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <chrono>
+#include <cstdint>
+#include <lcpp/parallel_primitive.h>
+#include <utility>
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+int main(int argc, char* argv[])
+{
+    log_level_info();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+    constexpr int32_t ITERATIONS       = 20;
+
+    constexpr std::pair<ReduceDeterminism, const char*> modes[] = {
+        {ReduceDeterminism::RUN_TO_RUN, "run to run"},
+        {ReduceDeterminism::GPU_TO_GPU, "gpu to gpu"},
+    };
+    for(uint array_size : {1u << 16, 1u << 20, 1u << 26})
+    {
+        luisa::vector<float> input_data(array_size, 1.0f);
+        auto                 in_buffer  = device.create_buffer<float>(array_size);
+        auto                 out_buffer = device.create_buffer<float>(1);
+        stream << in_buffer.copy_from(input_data.data()) << synchronize();
+
+        double run_to_run_ms = 0.0;
+        for(auto [mode, name] : modes)
+        {
+            DeviceReduce<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> reducer;
+            reducer.create(device);
+            reducer.set_determinism(mode);
+
+            // one temp slab for every iteration, the enqueued reductions run back to back on the stream
+            size_t temp_storage_bytes = 0;
+            reducer.Sum(cmdlist, temp_storage_query(), temp_storage_bytes, in_buffer.view(), out_buffer.view(), array_size);
+            auto temp_storage = device.create_byte_buffer(temp_storage_bytes);
+
+            // warm up, compiles the shaders
+            reducer.Sum(cmdlist, stream, temp_storage.view(), temp_storage_bytes, in_buffer.view(), out_buffer.view(), array_size);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for(auto i = 0; i < ITERATIONS; i++)
+            {
+                reducer.Sum(cmdlist, temp_storage.view(), temp_storage_bytes, in_buffer.view(), out_buffer.view(), array_size);
+            }
+            stream << cmdlist.commit() << synchronize();
+            auto   end = std::chrono::high_resolution_clock::now();
+            double ms  = std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS;
+            if(mode == ReduceDeterminism::RUN_TO_RUN)
+            {
+                run_to_run_ms = ms;
+            }
+            LUISA_INFO("Sum {} floats, {}: {:.3f} ms ({:.2f} GItems/s, {:.2f}x run to run)",
+                       array_size,
+                       name,
+                       ms,
+                       array_size / ms * 1e-6,
+                       ms / run_to_run_ms);
+        }
+    }
+}
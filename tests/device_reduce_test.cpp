@@ -10,8 +10,12 @@
 #include <luisa/core/logging.h>
 #include <luisa/vstl/config.h>
 #include <algorithm>
+#include <bit>
+#include <cmath>
 #include <cstdint>
+#include <limits>
 #include <lcpp/parallel_primitive.h>
+#include <numeric>
 #include <random>
 #include <vector>
 #include <boost/ut.hpp>
@@ -19,6 +23,22 @@ using namespace luisa;
 using namespace luisa::compute;
 using namespace luisa::parallel_primitive;
 using namespace boost::ut;
+
+// named operator whose factor is a kernel argument, not a compile time constant
+struct ScaleOp
+{
+    static constexpr luisa::string_view name = "scale";
+
+    int32 factor = 1;
+
+    float4 params() const noexcept { return make_float4(static_cast<float>(factor), 0.0f, 0.0f, 0.0f); }
+
+    Var<int32> operator()(const Var<int32>& x, Expr<float4> params) const noexcept
+    {
+        return x * cast<int32>(params.x);
+    }
+};
+
 int main(int argc, char* argv[])
 {
     log_level_verbose();
@@ -65,6 +85,25 @@ int main(int argc, char* argv[])
         expect((((array_size - 1) * array_size) / 2) == result[0]);
     };
 
+    "reduce_sizes"_test = [&]
+    {
+        // partial tiles, uneven shares and more tiles than the grid pass has blocks
+        constexpr uint TILE_ITEMS = BLOCK_SIZE * ITEMS_PER_THREAD;
+        for(uint num_items : {1u, 7u, TILE_ITEMS - 1, TILE_ITEMS + 1, TILE_ITEMS * TILE_ITEMS + 3, 3u << 22})
+        {
+            luisa::vector<uint> input(num_items, 1u);
+            luisa::vector<uint> result(1);
+            auto                in_buffer  = device.create_buffer<uint>(num_items);
+            auto                out_buffer = device.create_buffer<uint>(1);
+            stream << in_buffer.copy_from(input.data()) << synchronize();
+
+            reducer.Sum(cmdlist, stream, in_buffer.view(), out_buffer.view(), num_items);
+
+            stream << out_buffer.copy_to(result.data()) << synchronize();
+            expect(result[0] == num_items) << "Reduce failed for " << num_items << " items";
+        }
+    };
+
     "reduce_transform"_test = [&]
     {
         luisa::vector<int32> result(1);
@@ -85,6 +124,60 @@ int main(int argc, char* argv[])
         expect((array_size - 1) * (array_size - 1) == result[0]);
     };
 
+    "reduce_named_op_params"_test = [&]
+    {
+        luisa::vector<int32> result(1);
+        auto                 in_buffer  = device.create_buffer<int32>(array_size);
+        auto                 out_buffer = device.create_buffer<int32>(1);
+        stream << in_buffer.copy_from(input_data.data()) << synchronize();
+
+        // a new factor every frame, the shaders compiled for the first one are reused
+        auto registry = ShaderRegistry::shared(device);
+        auto compiled = registry->size();
+        for(int32 factor : {1, 2, 3})
+        {
+            reducer.TransformReduce(
+                cmdlist, stream, in_buffer.view(), out_buffer.view(), in_buffer.size(), SumOp{}, ScaleOp{factor}, 0);
+            stream << out_buffer.copy_to(result.data()) << synchronize();
+            expect(factor * (((array_size - 1) * array_size) / 2) == result[0]) << "factor " << factor;
+            if(factor == 1)
+            {
+                compiled = registry->size();
+            }
+        }
+        expect(compiled == registry->size());
+    };
+
+    "reduce_counting_iterator"_test = [&]
+    {
+        // sum of 0..n-1 with no input buffer at all
+        const uint          num_items = 1 << 16;
+        luisa::vector<uint> result(1);
+        auto                out_buffer = device.create_buffer<uint>(1);
+
+        reducer.Reduce(cmdlist, stream, make_counting_iterator(0u), out_buffer.view(), num_items, SumOp(), 0u);
+        stream << out_buffer.copy_to(result.data()) << synchronize();
+        expect(num_items / 2 * (num_items - 1) == result[0]);
+    };
+
+    "reduce_narrow_input"_test = [&]
+    {
+        // a sum of ushort counts far past 65535, the partials and the result are uint
+        luisa::vector<ushort> counts(1 << 20);
+        for(auto& count : counts)
+        {
+            count = static_cast<ushort>(rng() % 1000u);
+        }
+        auto in_buffer  = device.create_buffer<ushort>(counts.size());
+        auto out_buffer = device.create_buffer<uint>(1);
+        stream << in_buffer.copy_from(counts.data()) << synchronize();
+
+        uint result = 0;
+        reducer.Sum(cmdlist, stream, in_buffer.view(), out_buffer.view(), counts.size());
+        stream << out_buffer.copy_to(&result) << synchronize();
+        expect(result == std::accumulate(counts.begin(), counts.end(), 0u));
+    };
+
     //reduce(min)
     "reduce min"_test = [&]
     {
@@ -115,6 +208,24 @@ int main(int argc, char* argv[])
         expect(*std::max_element(input_data.begin(), input_data.end()) == result[0]);
     };
 
+    "reduce_max_negative_float"_test = [&]
+    {
+        // every input is below zero, a numeric_limits::min() seed (smallest positive float) would win
+        luisa::vector<float>                  values(array_size);
+        std::uniform_real_distribution<float> dist(-1000.0f, -1.0f);
+        for(auto& value : values)
+        {
+            value = dist(rng);
+        }
+        auto in_buffer  = device.create_buffer<float>(values.size());
+        auto out_buffer = device.create_buffer<float>(1);
+        stream << in_buffer.copy_from(values.data()) << synchronize();
+
+        float result = 0.0f;
+        reducer.Max(cmdlist, stream, in_buffer.view(), out_buffer.view(), values.size());
+        stream << out_buffer.copy_to(&result) << synchronize();
+        expect(result == *std::max_element(values.begin(), values.end()));
+    };
 
     "reduce argmin"_test = [&]
     {
@@ -163,6 +274,215 @@ int main(int argc, char* argv[])
     };
 
 
+    "reduce_argmax_fused"_test = [&]
+    {
+        // negative floats, the index is synthesized on load so the scratch does not grow with the input
+        luisa::vector<float> float_data(array_size);
+        for(int i = 0; i < array_size; i++)
+        {
+            float_data[i] = -1.0f - static_cast<float>(input_data[i]);
+        }
+        auto in_buffer        = device.create_buffer<float>(array_size);
+        auto out_buffer       = device.create_buffer<float>(1);
+        auto index_out_buffer = device.create_buffer<luisa::uint>(1);
+        stream << in_buffer.copy_from(float_data.data()) << synchronize();
+
+        size_t small_bytes = 0;
+        size_t large_bytes = 0;
+        reducer.ArgMax(cmdlist, temp_storage_query(), small_bytes, in_buffer.view(), out_buffer.view(), index_out_buffer.view(), 1u << 20);
+        reducer.ArgMax(cmdlist, temp_storage_query(), large_bytes, in_buffer.view(), out_buffer.view(), index_out_buffer.view(), 1u << 26);
+        expect(small_bytes == large_bytes);
+
+        luisa::vector<float>       result(1);
+        luisa::vector<luisa::uint> index_result(1);
+        reducer.ArgMax(
+            cmdlist, stream, in_buffer.view(), out_buffer.view(), index_out_buffer.view(), in_buffer.size());
+        stream << out_buffer.copy_to(result.data()) << index_out_buffer.copy_to(index_result.data()) << synchronize();
+
+        auto max_it = std::max_element(float_data.begin(), float_data.end());
+        expect((max_it - float_data.begin()) == index_result[0]);
+        expect(*max_it == result[0]);
+    };
+
+    "reduce_min_max_sum"_test = [&]
+    {
+        // one pass over shifted ints, plus the empty input reporting the identity
+        luisa::vector<int32> shifted(array_size);
+        for(int i = 0; i < array_size; i++)
+        {
+            shifted[i] = input_data[i] - array_size / 2;
+        }
+        auto in_buffer  = device.create_buffer<int32>(array_size);
+        auto out_buffer = device.create_buffer<ReduceStats<int32>>(1);
+        stream << in_buffer.copy_from(shifted.data()) << synchronize();
+
+        ReduceStats<int32> result{};
+        reducer.MinMaxSum(cmdlist, stream, in_buffer.view(), out_buffer.view(), in_buffer.size());
+        stream << out_buffer.copy_to(&result) << synchronize();
+        expect(result.minimum == *std::min_element(shifted.begin(), shifted.end()));
+        expect(result.maximum == *std::max_element(shifted.begin(), shifted.end()));
+        expect(result.sum == std::accumulate(shifted.begin(), shifted.end(), 0));
+        expect(result.count == static_cast<uint>(array_size));
+
+        reducer.MinMaxSum(cmdlist, stream, in_buffer.view(), out_buffer.view(), 0u);
+        stream << out_buffer.copy_to(&result) << synchronize();
+        expect(result.count == 0u && result.sum == 0);
+        expect(result.minimum == std::numeric_limits<int32>::max());
+    };
+
+    "reduce_mean_variance"_test = [&]
+    {
+        // 16M floats around a large offset, where a float sum of squares has no digits left for the variance
+        const uint                            num_items = 1 << 24;
+        std::mt19937                          gen(114521);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        luisa::vector<float>                  float_data(num_items);
+        for(auto& x : float_data)
+        {
+            x = 1000.0f + dist(gen);
+        }
+        auto in_buffer  = device.create_buffer<float>(num_items);
+        auto out_buffer = device.create_buffer<WelfordStats<float>>(1);
+        stream << in_buffer.copy_from(float_data.data()) << synchronize();
+
+        double mean = std::accumulate(float_data.begin(), float_data.end(), 0.0) / num_items;
+        double m2   = 0.0;
+        for(float x : float_data)
+        {
+            m2 += (x - mean) * (x - mean);
+        }
+
+        WelfordStats<float> result{};
+        reducer.MeanVariance(cmdlist, stream, in_buffer.view(), out_buffer.view(), num_items);
+        stream << out_buffer.copy_to(&result) << synchronize();
+        expect(result.count == num_items);
+        expect(std::abs(result.mean - mean) < 1e-3);
+        expect(std::abs(result.variance() - m2 / num_items) < 1e-3 * (m2 / num_items));
+    };
+
+    "reduce_deterministic"_test = [&]
+    {
+        // another block shape reduces with a different grid, the bits of the sum must not change
+        DeviceReduce<128, WARP_NUMS, 8> other_reducer;
+        other_reducer.create(device);
+        reducer.set_determinism(ReduceDeterminism::GPU_TO_GPU);
+        other_reducer.set_determinism(ReduceDeterminism::GPU_TO_GPU);
+
+        // the same pairwise tree on the host: item i absorbs item i + stride inside every tile, pass after pass
+        auto pairwise_sum = [](luisa::vector<float> items)
+        {
+            constexpr uint TILE_ITEMS = details::deterministic_reduce_tile_items<float>();
+            do
+            {
+                luisa::vector<float> partials;
+                for(size_t tile = 0; tile < std::max<size_t>(items.size(), 1u); tile += TILE_ITEMS)
+                {
+                    size_t valid_items = std::min<size_t>(items.size() - tile, TILE_ITEMS);
+                    for(size_t stride = 1; stride < TILE_ITEMS; stride *= 2)
+                    {
+                        for(size_t i = 0; i + stride < valid_items; i += 2 * stride)
+                        {
+                            items[tile + i] = items[tile + i] + items[tile + i + stride];
+                        }
+                    }
+                    partials.push_back(valid_items > 0 ? items[tile] : 0.0f);
+                }
+                items = std::move(partials);
+            } while(items.size() > 1);
+            return 0.0f + items[0];
+        };
+
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        for(uint num_items : {0u, 1000u, 2048u * 2048u + 5u, 3u << 22})
+        {
+            luisa::vector<float> float_data(num_items);
+            for(auto& x : float_data)
+            {
+                x = dist(rng) * 1000.0f;
+            }
+            auto in_buffer  = device.create_buffer<float>(std::max(num_items, 1u));
+            auto out_buffer = device.create_buffer<float>(1);
+            if(num_items > 0)
+            {
+                stream << in_buffer.copy_from(float_data.data()) << synchronize();
+            }
+
+            float result       = 0.0f;
+            float other_result = 0.0f;
+            reducer.Sum(cmdlist, stream, in_buffer.view(), out_buffer.view(), num_items);
+            stream << out_buffer.copy_to(&result) << synchronize();
+            other_reducer.Sum(cmdlist, stream, in_buffer.view(), out_buffer.view(), num_items);
+            stream << out_buffer.copy_to(&other_result) << synchronize();
+
+            float expected = pairwise_sum(float_data);
+            expect(std::bit_cast<uint>(result) == std::bit_cast<uint>(other_result)) << "block shapes differ for " << num_items;
+            expect(std::bit_cast<uint>(result) == std::bit_cast<uint>(expected)) << "tree differs for " << num_items;
+        }
+        reducer.set_determinism(ReduceDeterminism::RUN_TO_RUN);
+    };
+
+    "reduce_temp_storage_reuse"_test = [&]
+    {
+        auto allocator  = CachingAllocator::shared(device);
+        auto in_buffer  = device.create_buffer<int32>(array_size);
+        auto out_buffer = device.create_buffer<int32>(1);
+        stream << in_buffer.copy_from(input_data.data()) << synchronize();
+
+        reducer.Sum(cmdlist, stream, in_buffer.view(), out_buffer.view(), in_buffer.size());
+        auto cached_bytes = allocator->cached_bytes();
+        reducer.Sum(cmdlist, stream, in_buffer.view(), out_buffer.view(), in_buffer.size());
+
+        LUISA_INFO("Temp storage cached bytes: {}, live bytes: {}", allocator->cached_bytes(), allocator->live_bytes());
+        expect(allocator->live_bytes() == 0u);
+        expect(cached_bytes > 0u);
+        expect(allocator->cached_bytes() == cached_bytes);
+
+        allocator->trim();
+        expect(allocator->cached_bytes() == 0u);
+    };
+
+    "reduce_warmup"_test = [&]
+    {
+        // compile ahead of time, the first Sum afterwards only dispatches
+        DeviceReduce<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> warm_reducer;
+        warm_reducer.create(device);
+        warm_reducer.Warmup<int32>(SumOp{}, MinOp{}, MaxOp{});
+
+        luisa::vector<int32> result(1);
+        auto                 in_buffer  = device.create_buffer<int32>(array_size);
+        auto                 out_buffer = device.create_buffer<int32>(1);
+        stream << in_buffer.copy_from(input_data.data()) << synchronize();
+
+        warm_reducer.Sum(cmdlist, stream, in_buffer.view(), out_buffer.view(), in_buffer.size());
+        stream << out_buffer.copy_to(result.data()) << synchronize();
+        expect((((array_size - 1) * array_size) / 2) == result[0]);
+    };
+
+    "reduce_shared_registry"_test = [&]
+    {
+        // a second reducer on the same device reuses the shaders of the first
+        DeviceReduce<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> first_reducer;
+        DeviceReduce<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> second_reducer;
+        first_reducer.create(device);
+        second_reducer.create(device);
+
+        auto registry = ShaderRegistry::shared(device);
+        first_reducer.Warmup<int32>(SumOp{});
+        auto compiled = registry->size();
+        second_reducer.Warmup<int32>(SumOp{});
+        expect(compiled == registry->size());
+
+        luisa::vector<int32> result(1);
+        auto                 in_buffer  = device.create_buffer<int32>(array_size);
+        auto                 out_buffer = device.create_buffer<int32>(1);
+        stream << in_buffer.copy_from(input_data.data()) << synchronize();
+
+        second_reducer.Sum(cmdlist, stream, in_buffer.view(), out_buffer.view(), in_buffer.size());
+        stream << out_buffer.copy_to(result.data()) << synchronize();
+        expect((((array_size - 1) * array_size) / 2) == result[0]);
+    };
+
+
     // reduce by key
     "reduce_by_key"_test = [&]
     {
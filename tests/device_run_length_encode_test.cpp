@@ -0,0 +1,136 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 20:44:17
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 20:44:17
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <algorithm>
+#include <cstdint>
+#include <lcpp/parallel_primitive.h>
+#include <random>
+#include <boost/ut.hpp>
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+using namespace boost::ut;
+int main(int argc, char* argv[])
+{
+    log_level_verbose();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+
+    DeviceRunLengthEncode<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> run_length_encode;
+    run_length_encode.create(device);
+
+    // runs of up to 8 equal items with many single item runs, some crossing tile boundaries
+    constexpr uint      array_size = (1 << 20) + 77;
+    std::mt19937        rng(114521);
+    luisa::vector<uint> input(array_size);
+    uint                value = 0;
+    for(uint i = 0; i < array_size;)
+    {
+        uint run = rng() % 2u == 0u ? 1u : 1u + rng() % 8u;
+        for(uint j = 0; j < run && i < array_size; j++, i++)
+        {
+            input[i] = value;
+        }
+        value += 1u + rng() % 3u;
+    }
+
+    luisa::vector<uint> run_values;
+    luisa::vector<uint> run_offsets;
+    luisa::vector<uint> run_lengths;
+    for(uint i = 0; i < array_size; i++)
+    {
+        if(i == 0 || input[i] != input[i - 1])
+        {
+            run_values.push_back(input[i]);
+            run_offsets.push_back(i);
+            run_lengths.push_back(0);
+        }
+        run_lengths.back()++;
+    }
+
+    auto in_buffer       = device.create_buffer<uint>(array_size);
+    auto unique_buffer   = device.create_buffer<uint>(array_size);
+    auto offsets_buffer  = device.create_buffer<uint>(array_size);
+    auto lengths_buffer  = device.create_buffer<uint>(array_size);
+    auto num_runs_buffer = device.create_buffer<uint>(1);
+    stream << in_buffer.copy_from(input.data()) << synchronize();
+
+    auto check = [&](Buffer<uint>& buffer, const luisa::vector<uint>& expected)
+    {
+        luisa::vector<uint> result(std::max<size_t>(expected.size(), 1));
+        stream << buffer.view(0, result.size()).copy_to(result.data()) << synchronize();
+        expect(std::equal(expected.begin(), expected.end(), result.begin()));
+    };
+
+    "run_length_encode"_test = [&]
+    {
+        for(auto policy : {LookBackDelayPolicy::NO_DELAY, LookBackDelayPolicy::EXPONENTIAL_BACKOFF})
+        {
+            run_length_encode.set_look_back_delay(policy);
+            run_length_encode.Encode(
+                cmdlist, stream, in_buffer.view(), unique_buffer.view(), lengths_buffer.view(), num_runs_buffer.view(), array_size);
+
+            uint num_runs = 0;
+            stream << num_runs_buffer.copy_to(&num_runs) << synchronize();
+            expect(num_runs == run_values.size()) << num_runs << " vs " << run_values.size();
+            check(unique_buffer, run_values);
+            check(lengths_buffer, run_lengths);
+        }
+        run_length_encode.set_look_back_delay(LookBackDelayPolicy::NO_DELAY);
+    };
+
+    "non_trivial_runs"_test = [&]
+    {
+        luisa::vector<uint> expected_offsets;
+        luisa::vector<uint> expected_lengths;
+        for(size_t run = 0; run < run_lengths.size(); run++)
+        {
+            if(run_lengths[run] > 1)
+            {
+                expected_offsets.push_back(run_offsets[run]);
+                expected_lengths.push_back(run_lengths[run]);
+            }
+        }
+
+        run_length_encode.NonTrivialRuns(
+            cmdlist, stream, in_buffer.view(), offsets_buffer.view(), lengths_buffer.view(), num_runs_buffer.view(), array_size);
+
+        uint num_runs = 0;
+        stream << num_runs_buffer.copy_to(&num_runs) << synchronize();
+        expect(num_runs == expected_offsets.size()) << num_runs << " vs " << expected_offsets.size();
+        check(offsets_buffer, expected_offsets);
+        check(lengths_buffer, expected_lengths);
+    };
+
+    "run_length_encode_empty"_test = [&]
+    {
+        uint sentinel = 12345u;
+        stream << num_runs_buffer.copy_from(&sentinel) << synchronize();
+        run_length_encode.Encode(
+            cmdlist, stream, in_buffer.view(), unique_buffer.view(), lengths_buffer.view(), num_runs_buffer.view(), 0);
+        uint num_runs = sentinel;
+        stream << num_runs_buffer.copy_to(&num_runs) << synchronize();
+        expect(num_runs == 0u);
+    };
+}
@@ -0,0 +1,75 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 10:12:37
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 10:12:37
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <chrono>
+#include <cstdint>
+#include <lcpp/parallel_primitive.h>
+#include <utility>
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+int main(int argc, char* argv[])
+{
+    log_level_info();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+    constexpr int32_t ITERATIONS       = 20;
+
+    const uint          array_size = 1 << 26;
+    luisa::vector<uint> input_data(array_size, 1);
+    auto                in_buffer  = device.create_buffer<uint>(array_size);
+    auto                out_buffer = device.create_buffer<uint>(array_size);
+    stream << in_buffer.copy_from(input_data.data()) << synchronize();
+
+    constexpr std::pair<LookBackDelayPolicy, const char*> policies[] = {
+        {LookBackDelayPolicy::NO_DELAY, "no delay"},
+        {LookBackDelayPolicy::FIXED, "fixed"},
+        {LookBackDelayPolicy::EXPONENTIAL_BACKOFF, "exponential backoff"},
+        {LookBackDelayPolicy::TILE_INDEX, "tile index"},
+    };
+    for(auto [policy, name] : policies)
+    {
+        DeviceScan<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> scanner;
+        scanner.create(device, DeviceScanAlgorithm::DECOUPLED_LOOK_BACK);
+        scanner.set_look_back_delay(policy);
+
+        // one temp slab for every iteration, the enqueued scans run back to back on the stream
+        size_t temp_storage_bytes = 0;
+        scanner.ExclusiveSum(cmdlist, temp_storage_query(), temp_storage_bytes, in_buffer.view(), out_buffer.view(), array_size);
+        auto temp_storage = device.create_byte_buffer(temp_storage_bytes);
+
+        // warm up, compiles the shaders
+        scanner.ExclusiveSum(cmdlist, stream, temp_storage.view(), temp_storage_bytes, in_buffer.view(), out_buffer.view(), array_size);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for(auto i = 0; i < ITERATIONS; i++)
+        {
+            scanner.ExclusiveSum(cmdlist, temp_storage.view(), temp_storage_bytes, in_buffer.view(), out_buffer.view(), array_size);
+        }
+        stream << cmdlist.commit() << synchronize();
+        auto   end = std::chrono::high_resolution_clock::now();
+        double ms  = std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS;
+        LUISA_INFO("ExclusiveSum {} items, {}: {:.3f} ms ({:.2f} GItems/s)", array_size, name, ms, array_size / ms * 1e-6);
+    }
+}
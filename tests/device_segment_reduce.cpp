@@ -253,4 +253,54 @@ int main(int argc, char* argv[])
             }
         }
     };
-}
\ No newline at end of file
+
+    "segment_mean_variance"_test = [&]
+    {
+        // segments of different lengths around a large offset, one of them empty
+        luisa::vector<uint> begin_offsets_array{0u, 100u, 100u, 5000u};
+        luisa::vector<uint> end_offsets_array{100u, 100u, 5000u, 70000u};
+        uint                num_segments = static_cast<uint>(begin_offsets_array.size());
+        uint                array_size   = end_offsets_array.back();
+
+        std::mt19937                          rng(114521);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        luisa::vector<float>                  input_data(array_size);
+        for(auto& x : input_data)
+        {
+            x = 1000.0f + dist(rng);
+        }
+
+        auto in_buffer     = device.create_buffer<float>(array_size);
+        auto out_buffer    = device.create_buffer<WelfordStats<float>>(num_segments);
+        auto begin_offsets = device.create_buffer<uint>(num_segments);
+        auto end_offsets   = device.create_buffer<uint>(num_segments);
+        stream << in_buffer.copy_from(input_data.data()) << begin_offsets.copy_from(begin_offsets_array.data())
+               << end_offsets.copy_from(end_offsets_array.data()) << synchronize();
+
+        reducer.MeanVariance(
+            cmdlist, stream, in_buffer.view(), out_buffer.view(), num_segments, begin_offsets.view(), end_offsets.view());
+
+        luisa::vector<WelfordStats<float>> result(num_segments);
+        stream << out_buffer.copy_to(result.data()) << synchronize();
+        for(uint segment = 0; segment < num_segments; ++segment)
+        {
+            uint   count = end_offsets_array[segment] - begin_offsets_array[segment];
+            double mean  = 0.0;
+            double m2    = 0.0;
+            for(uint i = begin_offsets_array[segment]; i < end_offsets_array[segment]; ++i)
+            {
+                mean += input_data[i];
+            }
+            mean = count > 0 ? mean / count : 0.0;
+            for(uint i = begin_offsets_array[segment]; i < end_offsets_array[segment]; ++i)
+            {
+                m2 += (input_data[i] - mean) * (input_data[i] - mean);
+            }
+            double variance = count > 0 ? m2 / count : 0.0;
+            expect(result[segment].count == count) << "segment " << segment;
+            expect(std::abs(result[segment].mean - mean) < 1e-3) << "segment " << segment;
+            expect(std::abs(result[segment].variance() - variance) < 1e-2 * std::max(variance, 1e-3))
+                << "segment " << segment;
+        }
+    };
+}
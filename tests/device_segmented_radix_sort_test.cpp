@@ -0,0 +1,141 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 23:02:14
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 23:02:14
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <lcpp/parallel_primitive.h>
+#include <random>
+#include <boost/ut.hpp>
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+using namespace boost::ut;
+int main(int argc, char* argv[])
+{
+    log_level_verbose();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+
+    DeviceSegmentedRadixSort<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> segmented_sort;
+    segmented_sort.create(device);
+
+    std::mt19937 rng(114521);
+
+    // many small light lists, a few empty ones and one longer than a tile to take the per digit passes
+    luisa::vector<uint> begin_offsets;
+    luisa::vector<uint> end_offsets;
+    uint                num_items = 0;
+    for(uint segment = 0; segment < 4096; ++segment)
+    {
+        uint segment_size = segment == 1234 ? 20000u : (segment % 7 == 0 ? 0u : rng() % 300u);
+        begin_offsets.push_back(num_items);
+        num_items += segment_size;
+        end_offsets.push_back(num_items);
+    }
+    uint num_segments = static_cast<uint>(begin_offsets.size());
+
+    auto begin_offsets_buffer = device.create_buffer<uint>(num_segments);
+    auto end_offsets_buffer   = device.create_buffer<uint>(num_segments);
+    stream << begin_offsets_buffer.copy_from(begin_offsets.data()) << end_offsets_buffer.copy_from(end_offsets.data())
+           << synchronize();
+
+    "segmented_radix_sort_keys"_test = [&]
+    {
+        luisa::vector<uint> keys(num_items);
+        for(auto& key : keys)
+        {
+            key = rng();
+        }
+        auto keys_in_buffer  = device.create_buffer<uint>(num_items);
+        auto keys_out_buffer = device.create_buffer<uint>(num_items);
+        stream << keys_in_buffer.copy_from(keys.data()) << synchronize();
+
+        segmented_sort.SortKeys(cmdlist,
+                                stream,
+                                keys_in_buffer.view(),
+                                keys_out_buffer.view(),
+                                num_items,
+                                num_segments,
+                                begin_offsets_buffer.view(),
+                                end_offsets_buffer.view());
+
+        luisa::vector<uint> result(num_items);
+        stream << keys_out_buffer.copy_to(result.data()) << synchronize();
+        for(uint segment = 0; segment < num_segments; ++segment)
+        {
+            std::sort(keys.begin() + begin_offsets[segment], keys.begin() + end_offsets[segment]);
+        }
+        expect(std::equal(keys.begin(), keys.end(), result.begin()));
+    };
+
+    "segmented_radix_sort_pairs"_test = [&]
+    {
+        // few distinct depths so the stability of the values shows
+        luisa::vector<float> keys(num_items);
+        luisa::vector<uint>  values(num_items);
+        std::uniform_int_distribution<int> dist(-32, 32);
+        for(uint i = 0; i < num_items; ++i)
+        {
+            keys[i]   = dist(rng) * 0.25f;
+            values[i] = i;
+        }
+        auto keys_in_buffer    = device.create_buffer<float>(num_items);
+        auto keys_out_buffer   = device.create_buffer<float>(num_items);
+        auto values_in_buffer  = device.create_buffer<uint>(num_items);
+        auto values_out_buffer = device.create_buffer<uint>(num_items);
+        stream << keys_in_buffer.copy_from(keys.data()) << values_in_buffer.copy_from(values.data()) << synchronize();
+
+        segmented_sort.SortPairs(cmdlist,
+                                 stream,
+                                 keys_in_buffer.view(),
+                                 keys_out_buffer.view(),
+                                 values_in_buffer.view(),
+                                 values_out_buffer.view(),
+                                 num_items,
+                                 num_segments,
+                                 begin_offsets_buffer.view(),
+                                 end_offsets_buffer.view());
+
+        luisa::vector<float> keys_result(num_items);
+        luisa::vector<uint>  values_result(num_items);
+        stream << keys_out_buffer.copy_to(keys_result.data()) << values_out_buffer.copy_to(values_result.data())
+               << synchronize();
+
+        luisa::vector<uint> expected(num_items);
+        std::iota(expected.begin(), expected.end(), 0u);
+        for(uint segment = 0; segment < num_segments; ++segment)
+        {
+            std::stable_sort(expected.begin() + begin_offsets[segment],
+                             expected.begin() + end_offsets[segment],
+                             [&](uint a, uint b) { return keys[a] < keys[b]; });
+        }
+        bool pass = true;
+        for(uint i = 0; i < num_items; ++i)
+        {
+            pass &= values_result[i] == expected[i] && keys_result[i] == keys[expected[i]];
+        }
+        expect(pass);
+    };
+}
@@ -0,0 +1,139 @@
+/*
+ * @Author: Ligo
+ * @Date: 2026-10-16 18:58:12
+ * @Last Modified by: Ligo
+ * @Last Modified time: 2026-10-16 18:58:12
+ */
+
+
+#include <luisa/core/basic_traits.h>
+#include <luisa/core/logging.h>
+#include <luisa/vstl/config.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <lcpp/parallel_primitive.h>
+#include <random>
+#include <boost/ut.hpp>
+using namespace luisa;
+using namespace luisa::compute;
+using namespace luisa::parallel_primitive;
+using namespace boost::ut;
+int main(int argc, char* argv[])
+{
+    log_level_verbose();
+
+    Context context{argv[1]};
+#ifdef _WIN32
+    Device device = context.create_device("cuda");
+#elif __APPLE__
+    Device device = context.create_device("metal");
+#else
+    Device device = context.create_device("cuda");
+#endif
+    Stream      stream = device.create_stream();
+    CommandList cmdlist;
+
+    constexpr int32_t BLOCK_SIZE       = 256;
+    constexpr int32_t ITEMS_PER_THREAD = 4;
+    constexpr int32_t WARP_NUMS        = 32;
+
+    DeviceSelect<BLOCK_SIZE, WARP_NUMS, ITEMS_PER_THREAD> select;
+    select.create(device);
+
+    constexpr uint      array_size = (1 << 20) + 77;
+    std::mt19937        rng(114521);
+    luisa::vector<uint> input(array_size);
+    for(auto& v : input)
+    {
+        // ~0u marks a terminated ray
+        v = rng() % 4u == 0u ? ~0u : rng() % 1000u;
+    }
+
+    auto in_buffer           = device.create_buffer<uint>(array_size);
+    auto out_buffer          = device.create_buffer<uint>(array_size);
+    auto num_selected_buffer = device.create_buffer<uint>(1);
+    stream << in_buffer.copy_from(input.data()) << synchronize();
+
+    auto check = [&](const luisa::vector<uint>& expected)
+    {
+        uint num_selected = 0;
+        stream << num_selected_buffer.copy_to(&num_selected) << synchronize();
+        expect(num_selected == expected.size()) << num_selected << " vs " << expected.size();
+        luisa::vector<uint> result(std::max<size_t>(expected.size(), 1));
+        stream << out_buffer.view(0, result.size()).copy_to(result.data()) << synchronize();
+        expect(std::equal(expected.begin(), expected.end(), result.begin()));
+    };
+
+    "select_if"_test = [&]
+    {
+        luisa::vector<uint> expected;
+        std::copy_if(input.begin(), input.end(), std::back_inserter(expected), [](uint v) { return v != ~0u; });
+
+        for(auto policy : {LookBackDelayPolicy::NO_DELAY, LookBackDelayPolicy::EXPONENTIAL_BACKOFF})
+        {
+            select.set_look_back_delay(policy);
+            select.If(cmdlist,
+                      stream,
+                      in_buffer.view(),
+                      out_buffer.view(),
+                      num_selected_buffer.view(),
+                      array_size,
+                      [](const Var<uint>& ray) { return ray != ~0u; });
+            check(expected);
+        }
+        select.set_look_back_delay(LookBackDelayPolicy::NO_DELAY);
+    };
+
+    "select_flagged"_test = [&]
+    {
+        luisa::vector<int32> flags(array_size);
+        luisa::vector<uint>  expected;
+        for(uint i = 0; i < array_size; i++)
+        {
+            flags[i] = static_cast<int32>(rng() % 2u);
+            if(flags[i] != 0)
+            {
+                expected.push_back(input[i]);
+            }
+        }
+        auto flags_buffer = device.create_buffer<int32>(array_size);
+        stream << flags_buffer.copy_from(flags.data()) << synchronize();
+
+        select.Flagged(cmdlist, stream, in_buffer.view(), flags_buffer.view(), out_buffer.view(), num_selected_buffer.view(), array_size);
+        check(expected);
+    };
+
+    "select_unique"_test = [&]
+    {
+        // runs of up to 8 equal items, some crossing tile boundaries
+        luisa::vector<uint> runs(array_size);
+        uint                value = 0;
+        for(uint i = 0; i < array_size;)
+        {
+            uint run = 1u + rng() % 8u;
+            for(uint j = 0; j < run && i < array_size; j++, i++)
+            {
+                runs[i] = value;
+            }
+            value += 1u + rng() % 3u;
+        }
+        luisa::vector<uint> expected;
+        std::unique_copy(runs.begin(), runs.end(), std::back_inserter(expected));
+        stream << in_buffer.copy_from(runs.data()) << synchronize();
+
+        select.Unique(cmdlist, stream, in_buffer.view(), out_buffer.view(), num_selected_buffer.view(), array_size);
+        check(expected);
+        stream << in_buffer.copy_from(input.data()) << synchronize();
+    };
+
+    "select_empty"_test = [&]
+    {
+        uint sentinel = 12345u;
+        stream << num_selected_buffer.copy_from(&sentinel) << synchronize();
+        select.Unique(cmdlist, stream, in_buffer.view(), out_buffer.view(), num_selected_buffer.view(), 0);
+        uint num_selected = sentinel;
+        stream << num_selected_buffer.copy_to(&num_selected) << synchronize();
+        expect(num_selected == 0u);
+    };
+}
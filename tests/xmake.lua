@@ -1,6 +1,8 @@
 add_requires("boost_ut","cpptrace")
-local function add_test_target(file_name)
+local function add_test_target(file_name, group)
     target(file_name)
+        set_group(group or "tests")
+        set_default(group == nil)
         set_kind("binary")
         add_files(file_name..".cpp")
         set_languages("c++20")
@@ -31,7 +33,18 @@ end
 add_test_target("block_level_test")
 add_test_target("warp_level_test")
 add_test_target("decoupled_look_back")
+add_test_target("device_for_test")
+add_test_target("device_histogram_test")
+add_test_target("device_merge_sort_test")
 add_test_target("device_reduce_test")
+add_test_target("device_select_test")
+add_test_target("device_partition_test")
+add_test_target("device_run_length_encode_test")
 add_test_target("device_scan_test")
 add_test_target("device_segment_reduce")
-add_test_target("device_radix_sort_one_sweep")
\ No newline at end of file
+add_test_target("device_segmented_radix_sort_test")
+add_test_target("device_radix_sort_one_sweep")
+
+-- timing runs, only built on request: xmake build -g benchmarks
+add_test_target("device_scan_delay_benchmark", "benchmarks")
+add_test_target("device_reduce_determinism_benchmark", "benchmarks")